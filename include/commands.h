@@ -4,7 +4,9 @@
 #ifndef HDD_COMMANDS_H
 #define HDD_COMMANDS_H
 
+#include "hdd-utils.h"
 #include <windows.h>
+#include <string>
 
 namespace hdd {
 namespace commands {
@@ -15,17 +17,21 @@ namespace commands {
 int RunRelay(int argc, char* argv[]);
 
 // Wake command: Power on and wake the drive
-// Usage: hdd-toggle wake
+// Usage: hdd-toggle wake [--all]
 int RunWake(int argc, char* argv[]);
 
 // Sleep command: Safely eject and power off the drive
-// Usage: hdd-toggle sleep [--offline]
+// Usage: hdd-toggle sleep [--offline] [--close-blockers] [--force]
 int RunSleep(int argc, char* argv[]);
 
 // Status command: Show current drive status
 // Usage: hdd-toggle status [--json]
 int RunStatus(int argc, char* argv[]);
 
+// Bench command: Measure latency of detection and control paths
+// Usage: hdd-toggle bench <detect|shell|relay|hid> [--iterations N] [--channel N]
+int RunBench(int argc, char* argv[]);
+
 // GUI command: Launch the system tray application
 // Usage: hdd-toggle [gui]
 int LaunchTrayApp(HINSTANCE hInstance);
@@ -40,6 +46,22 @@ int ShowVersion();
 // Simpler interface for internal use
 bool ControlRelayPower(bool on);
 
+// Helper: Switch one relay channel (0 = all), used by pool wake
+bool ControlRelayChannel(int channel, bool on);
+
+// Helper: Power one drive on or off: its RelayChannel when configured,
+// otherwise every channel (or the [Relay] sequence) as ControlRelayPower
+bool ControlDrivePower(const DriveTarget& drive, bool on);
+
+// Describes what ControlDrivePower switches, e.g. "relay 2" or "all relays"
+std::string DrivePowerTarget(const DriveTarget& drive);
+
+// Progress: receives short status lines while wake/sleep run (may be called
+// from worker threads). Pass nullptr to stop receiving them.
+typedef void (*ProgressHandler)(const char* message);
+void SetProgressHandler(ProgressHandler handler);
+void ReportProgress(const char* message);
+
 } // namespace commands
 } // namespace hdd
 
@@ -0,0 +1,203 @@
+#pragma once
+// Wake-on-access for HDD Toggle (Linux)
+// Watches the drive's mount root while it is unmounted with fanotify
+// permission events. An open of the root is held, the drive is woken
+// through the supplied wake function, and the open is released once a
+// filesystem is mounted there, so the first access costs one wake instead
+// of a failure and a manual retry.
+//
+// Limits: only opens of the root itself can be held. A lookup below an
+// unmounted root (open("/mnt/hdd/a/b")) fails before any event is sent,
+// and a held open gets the placeholder directory; the mounted drive is
+// seen from the next path lookup on. Windows has no user-mode equivalent
+// (it would take a file system minifilter), so the tray does not use this.
+
+#ifndef HDD_CORE_ACCESS_WAKE_H
+#define HDD_CORE_ACCESS_WAKE_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#ifdef __linux__
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/fanotify.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+namespace hdd {
+namespace core {
+
+// What the watcher has done so far
+struct AccessWakeStats {
+    uint32_t held = 0;          // Accesses held for a wake
+    uint32_t passed = 0;        // Accesses let through at once (already mounted)
+    uint32_t wakes = 0;         // Wake function calls
+    uint32_t failedWakes = 0;
+    uint32_t maxHoldMs = 0;     // Longest an access was held
+};
+
+#ifdef __linux__
+
+// True if path is the root of a mounted filesystem (not the placeholder)
+inline bool IsMountRoot(const std::string& path) {
+    struct stat self, parent;
+    if (stat(path.c_str(), &self) != 0 || stat((path + "/..").c_str(), &parent) != 0) return false;
+    return self.st_dev != parent.st_dev || self.st_ino == parent.st_ino;
+}
+
+// fanotify watcher on one mount root. Needs CAP_SYS_ADMIN. Events are
+// handled one at a time on the watcher thread: accesses that arrive during
+// a wake queue in the kernel and are let through together once it is done.
+class FanotifyAccessWaker {
+public:
+    // Returns true once the drive is mounted at the root (or on giving up)
+    typedef std::function<bool()> WakeFunction;
+
+    FanotifyAccessWaker() : m_fanotify(-1), m_stop(-1), m_threadId(0) {}
+    ~FanotifyAccessWaker() { Stop(); }
+
+    // Start holding opens of root. False if fanotify is unavailable
+    // (no CAP_SYS_ADMIN, or a kernel without FAN_REPORT_TID).
+    bool Start(const std::string& root, WakeFunction wake) {
+        Stop();
+        m_root = root;
+        m_wake = std::move(wake);
+        m_stats = AccessWakeStats();
+
+        // Thread IDs in events, so the wake's own opens are not held
+        m_fanotify = fanotify_init(FAN_CLASS_CONTENT | FAN_CLOEXEC | FAN_REPORT_TID, O_RDONLY | O_CLOEXEC);
+        if (m_fanotify < 0) return false;
+        if (fanotify_mark(m_fanotify, FAN_MARK_ADD, FAN_OPEN_PERM | FAN_ONDIR, AT_FDCWD, root.c_str()) != 0) {
+            Stop();
+            return false;
+        }
+        m_stop = eventfd(0, EFD_CLOEXEC);
+        if (m_stop < 0) {
+            Stop();
+            return false;
+        }
+
+        m_thread = std::thread([this] { Run(); });
+        return true;
+    }
+
+    // Stop watching. A wake in progress is finished first.
+    void Stop() {
+        if (m_thread.joinable()) {
+            uint64_t one = 1;
+            (void)!write(m_stop, &one, sizeof(one));
+            m_thread.join();
+        }
+        if (m_fanotify >= 0) close(m_fanotify);
+        if (m_stop >= 0) close(m_stop);
+        m_fanotify = m_stop = -1;
+    }
+
+    AccessWakeStats Stats() const {
+        AccessWakeStats stats;
+        stats.held = m_stats.held;
+        stats.passed = m_stats.passed;
+        stats.wakes = m_stats.wakes;
+        stats.failedWakes = m_stats.failedWakes;
+        stats.maxHoldMs = m_stats.maxHoldMs;
+        return stats;
+    }
+
+    // Non-copyable
+    FanotifyAccessWaker(const FanotifyAccessWaker&) = delete;
+    FanotifyAccessWaker& operator=(const FanotifyAccessWaker&) = delete;
+
+private:
+    void Run() {
+        m_threadId = static_cast<pid_t>(syscall(SYS_gettid));
+        alignas(fanotify_event_metadata) char buffer[4096];
+
+        while (true) {
+            pollfd fds[2] = {{m_fanotify, POLLIN, 0}, {m_stop, POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            if (fds[1].revents) return;
+
+            ssize_t length = read(m_fanotify, buffer, sizeof(buffer));
+            if (length <= 0) {
+                if (length < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+                return;
+            }
+
+            const fanotify_event_metadata* event = reinterpret_cast<const fanotify_event_metadata*>(buffer);
+            for (; FAN_EVENT_OK(event, length); event = FAN_EVENT_NEXT(event, length)) {
+                if (event->vers != FANOTIFY_METADATA_VERSION) return;
+                if (event->fd >= 0) {
+                    if (event->mask & FAN_OPEN_PERM) Handle(*event);
+                    close(event->fd);
+                }
+            }
+        }
+    }
+
+    void Handle(const fanotify_event_metadata& event) {
+        // The wake runs on this thread; its own opens must not wait on it
+        if (event.pid != m_threadId) {
+            if (IsMountRoot(m_root)) {
+                m_stats.passed++;
+            } else {
+                auto start = std::chrono::steady_clock::now();
+                m_stats.held++;
+                m_stats.wakes++;
+                if (!m_wake() || !IsMountRoot(m_root)) m_stats.failedWakes++;
+
+                uint32_t heldMs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+                if (heldMs > m_stats.maxHoldMs) m_stats.maxHoldMs = heldMs;
+            }
+        }
+
+        // Always allowed: after a failed wake the access sees the empty
+        // placeholder, as it would without the watcher
+        fanotify_response response = {event.fd, FAN_ALLOW};
+        (void)!write(m_fanotify, &response, sizeof(response));
+    }
+
+    struct AtomicStats {
+        std::atomic<uint32_t> held{0};
+        std::atomic<uint32_t> passed{0};
+        std::atomic<uint32_t> wakes{0};
+        std::atomic<uint32_t> failedWakes{0};
+        std::atomic<uint32_t> maxHoldMs{0};
+
+        AtomicStats& operator=(const AccessWakeStats& stats) {
+            held = stats.held;
+            passed = stats.passed;
+            wakes = stats.wakes;
+            failedWakes = stats.failedWakes;
+            maxHoldMs = stats.maxHoldMs;
+            return *this;
+        }
+    };
+
+    int m_fanotify;
+    int m_stop;
+    std::atomic<pid_t> m_threadId;
+    std::string m_root;
+    WakeFunction m_wake;
+    AtomicStats m_stats;
+    std::thread m_thread;
+};
+
+#endif // __linux__
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_ACCESS_WAKE_H
@@ -4,6 +4,9 @@
 #ifndef HDD_CORE_ADMIN_H
 #define HDD_CORE_ADMIN_H
 
+#include <cstdint>
+#include <string>
+
 namespace hdd {
 namespace core {
 
@@ -15,6 +18,11 @@ bool IsRunningAsAdmin();
 // Returns false if elevation was declined or failed
 bool RequestElevation();
 
+// Launch a program elevated ("runas") and wait up to timeoutMs for it to exit
+// An elevated child cannot be killed from here, so on timeout we just stop waiting
+// Returns false if the UAC prompt was declined or the launch failed
+bool RunElevated(const std::string& file, const std::string& parameters, uint32_t timeoutMs);
+
 } // namespace core
 } // namespace hdd
 
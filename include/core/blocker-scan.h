@@ -0,0 +1,290 @@
+#pragma once
+// Open-handle blocker scan for HDD Toggle
+// Finds the processes that keep a drive from being ejected: open files,
+// working directories and mapped files on its volumes. Matching, grouping
+// and reporting are platform-neutral; the Windows handle walk lives in
+// blocker-scan.cpp and the Linux /proc walk is here so tests can run it
+// against throwaway processes.
+
+#ifndef HDD_CORE_BLOCKER_SCAN_H
+#define HDD_CORE_BLOCKER_SCAN_H
+
+#include "hdd-utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+namespace hdd {
+namespace core {
+
+// Most paths listed per process in a report line
+constexpr size_t BLOCKER_REPORT_PATHS = 3;
+
+enum class BlockerKind {
+    File,       // Open file or directory handle
+    Cwd,        // Working directory
+    Root,       // Root directory (chroot)
+    Map         // Memory-mapped file (e.g. a loaded DLL or shared object)
+};
+
+inline const char* BlockerKindName(BlockerKind kind) {
+    switch (kind) {
+        case BlockerKind::File: return "file";
+        case BlockerKind::Cwd: return "cwd";
+        case BlockerKind::Root: return "root";
+        case BlockerKind::Map: return "map";
+    }
+    return "?";
+}
+
+// One thing a process holds on the drive
+struct BlockerHit {
+    uint32_t pid = 0;
+    std::string process;
+    BlockerKind kind = BlockerKind::File;
+    std::string path;
+};
+
+struct BlockerUse {
+    BlockerKind kind = BlockerKind::File;
+    std::string path;
+
+    bool operator==(const BlockerUse& other) const { return kind == other.kind && path == other.path; }
+};
+
+// Everything one process holds on the drive
+struct BlockerProcess {
+    uint32_t pid = 0;
+    std::string process;
+    std::vector<BlockerUse> uses;   // Working directory first, then by path; no duplicates
+};
+
+// True if path lies on one of the volumes, given as path prefixes such as
+// "\\?\Volume{GUID}\" or "/mnt/hdd/". Case-insensitive, as on Windows.
+inline bool PathOnVolumes(const std::string& path, const std::vector<std::string>& volumes) {
+    for (const auto& volume : volumes) {
+        if (path.size() >= volume.size() && EqualsIgnoreCase(path.substr(0, volume.size()), volume)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// One entry per process, in pid order
+inline std::vector<BlockerProcess> GroupBlockers(std::vector<BlockerHit> hits) {
+    auto rank = [](BlockerKind kind) { return kind == BlockerKind::Cwd ? -1 : static_cast<int>(kind); };
+    std::sort(hits.begin(), hits.end(), [&](const BlockerHit& a, const BlockerHit& b) {
+        if (a.pid != b.pid) return a.pid < b.pid;
+        if (a.kind != b.kind) return rank(a.kind) < rank(b.kind);
+        return a.path < b.path;
+    });
+
+    std::vector<BlockerProcess> processes;
+    for (auto& hit : hits) {
+        if (processes.empty() || processes.back().pid != hit.pid) {
+            BlockerProcess process;
+            process.pid = hit.pid;
+            process.process = hit.process;
+            processes.push_back(process);
+        }
+        BlockerUse use;
+        use.kind = hit.kind;
+        use.path = std::move(hit.path);
+        if (processes.back().uses.empty() || !(processes.back().uses.back() == use)) {
+            processes.back().uses.push_back(std::move(use));
+        }
+    }
+    return processes;
+}
+
+// "explorer.exe (1234): cwd E:\Photos, file E:\a.txt (+2 more)"
+inline std::string FormatBlocker(const BlockerProcess& process) {
+    std::string text = (process.process.empty() ? std::string("?") : process.process) +
+                       " (" + std::to_string(process.pid) + "):";
+    size_t shown = std::min(process.uses.size(), BLOCKER_REPORT_PATHS);
+    for (size_t i = 0; i < shown; i++) {
+        text += (i == 0 ? " " : ", ");
+        text += BlockerKindName(process.uses[i].kind);
+        text += ' ';
+        text += process.uses[i].path;
+    }
+    if (process.uses.size() > shown) {
+        text += " (+" + std::to_string(process.uses.size() - shown) + " more)";
+    }
+    return text;
+}
+
+// Device ("08:11") of a /proc/<pid>/maps line; false for anonymous or
+// malformed lines
+inline bool ParseMapsDevice(const char* line, unsigned& major, unsigned& minor) {
+    // address perms offset dev inode path
+    const char* p = line;
+    for (int field = 0; field < 3; field++) {
+        while (*p && *p != ' ') p++;
+        while (*p == ' ') p++;
+    }
+    char* next = nullptr;
+    unsigned long high = strtoul(p, &next, 16);
+    if (next == p || *next != ':') return false;
+    const char* low = next + 1;
+    unsigned long lowValue = strtoul(low, &next, 16);
+    if (next == low || *next != ' ') return false;
+
+    major = static_cast<unsigned>(high);
+    minor = static_cast<unsigned>(lowValue);
+    return major != 0 || minor != 0;
+}
+
+#ifdef __linux__
+
+// Scans /proc for processes holding anything on the given devices (the
+// st_dev of the drive's mounts; every mount of one filesystem shares it).
+// Processes are split over a small thread pool, and only what matches is
+// turned into strings.
+class ProcBlockerScanner {
+public:
+    explicit ProcBlockerScanner(std::vector<dev_t> devices, const std::string& procRoot = "/proc")
+        : m_devices(std::move(devices)), m_procRoot(procRoot) {}
+
+    std::vector<BlockerProcess> Scan(unsigned threads = 0) const {
+        std::vector<uint32_t> pids = ListPids();
+        if (threads == 0) threads = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+        threads = std::min<unsigned>(threads, static_cast<unsigned>(std::max<size_t>(1, pids.size())));
+
+        std::atomic<size_t> next(0);
+        std::vector<std::vector<BlockerHit>> found(threads);
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; t++) {
+            pool.emplace_back([&, t] {
+                for (size_t i; (i = next++) < pids.size();) ScanProcess(pids[i], found[t]);
+            });
+        }
+        for (auto& thread : pool) thread.join();
+
+        std::vector<BlockerHit> hits;
+        for (auto& part : found) hits.insert(hits.end(), part.begin(), part.end());
+        return GroupBlockers(std::move(hits));
+    }
+
+private:
+    std::vector<uint32_t> ListPids() const {
+        std::vector<uint32_t> pids;
+        DIR* dir = opendir(m_procRoot.c_str());
+        if (!dir) return pids;
+        while (dirent* entry = readdir(dir)) {
+            char* end = nullptr;
+            unsigned long pid = strtoul(entry->d_name, &end, 10);
+            if (end != entry->d_name && *end == '\0') pids.push_back(static_cast<uint32_t>(pid));
+        }
+        closedir(dir);
+        return pids;
+    }
+
+    bool OnDevices(dev_t device) const {
+        return std::find(m_devices.begin(), m_devices.end(), device) != m_devices.end();
+    }
+
+    // stat() follows the /proc link to the held object without opening it
+    bool LinkOnDevices(const char* link) const {
+        struct stat info;
+        return stat(link, &info) == 0 && OnDevices(info.st_dev);
+    }
+
+    static std::string ReadLink(const char* link) {
+        char target[4096];
+        ssize_t length = readlink(link, target, sizeof(target) - 1);
+        return length > 0 ? std::string(target, static_cast<size_t>(length)) : std::string();
+    }
+
+    void ScanProcess(uint32_t pid, std::vector<BlockerHit>& hits) const {
+        char base[64];
+        snprintf(base, sizeof(base), "%s/%u", m_procRoot.c_str(), pid);
+        std::string process;
+        size_t before = hits.size();
+
+        char path[128];
+        static const struct { const char* name; BlockerKind kind; } links[] = {
+            {"cwd", BlockerKind::Cwd}, {"root", BlockerKind::Root}};
+        for (const auto& link : links) {
+            snprintf(path, sizeof(path), "%s/%s", base, link.name);
+            if (LinkOnDevices(path)) Add(hits, pid, link.kind, ReadLink(path));
+        }
+
+        snprintf(path, sizeof(path), "%s/fd", base);
+        if (DIR* fds = opendir(path)) {
+            while (dirent* entry = readdir(fds)) {
+                if (entry->d_name[0] == '.') continue;
+                char fdPath[384];
+                snprintf(fdPath, sizeof(fdPath), "%s/fd/%s", base, entry->d_name);
+                if (LinkOnDevices(fdPath)) Add(hits, pid, BlockerKind::File, ReadLink(fdPath));
+            }
+            closedir(fds);
+        }
+
+        snprintf(path, sizeof(path), "%s/maps", base);
+        if (FILE* maps = fopen(path, "r")) {
+            char line[4608];
+            while (fgets(line, sizeof(line), maps)) {
+                unsigned major = 0, minor = 0;
+                if (!ParseMapsDevice(line, major, minor) || !OnDevices(makedev(major, minor))) continue;
+                char* file = strchr(line, '/');
+                if (!file) continue;
+                file[strcspn(file, "\n")] = '\0';
+                Add(hits, pid, BlockerKind::Map, file);
+            }
+            fclose(maps);
+        }
+
+        if (hits.size() > before) {
+            snprintf(path, sizeof(path), "%s/comm", base);
+            if (FILE* comm = fopen(path, "r")) {
+                char name[64] = {};
+                if (fgets(name, sizeof(name), comm)) process = TrimWhitespace(name);
+                fclose(comm);
+            }
+            for (size_t i = before; i < hits.size(); i++) hits[i].process = process;
+        }
+    }
+
+    static void Add(std::vector<BlockerHit>& hits, uint32_t pid, BlockerKind kind, const std::string& path) {
+        BlockerHit hit;
+        hit.pid = pid;
+        hit.kind = kind;
+        hit.path = path;
+        hits.push_back(std::move(hit));
+    }
+
+    std::vector<dev_t> m_devices;
+    std::string m_procRoot;
+};
+
+// Ask the blockers to exit (SIGTERM by default). Returns how many were sent.
+inline size_t SignalBlockers(const std::vector<BlockerProcess>& blockers, int signal = SIGTERM) {
+    size_t sent = 0;
+    for (const auto& blocker : blockers) {
+        if (static_cast<pid_t>(blocker.pid) != getpid() && kill(static_cast<pid_t>(blocker.pid), signal) == 0) sent++;
+    }
+    return sent;
+}
+
+#endif // __linux__
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_BLOCKER_SCAN_H
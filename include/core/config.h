@@ -0,0 +1,43 @@
+#pragma once
+// Configuration loading for HDD Toggle
+// Reads hdd-control.ini next to the executable; shared by the tray and CLI
+
+#ifndef HDD_CORE_CONFIG_H
+#define HDD_CORE_CONFIG_H
+
+#include "hdd-utils.h"
+#include "core/wake-predictor.h"
+#include "core/wake-readiness.h"
+#include <string>
+
+namespace hdd {
+namespace core {
+
+// Full path of hdd-control.ini beside the executable
+std::string GetConfigPath();
+
+// Load configuration from an ini file. Missing file or keys keep defaults.
+// Drives come from [Drive] followed by [Drive.1], [Drive.2], ... in order;
+// with none configured, the built-in default drive is used.
+Config LoadConfig(const std::string& iniPath);
+
+// Full path of hdd-state.ini beside the executable: things learned at run
+// time, kept apart from the user's configuration
+std::string GetStatePath();
+
+// Learned spin-up times for a drive (by serial number); empty if none yet
+SpinUpModel LoadSpinUpModel(const std::string& serial);
+bool SaveSpinUpModel(const std::string& serial, const SpinUpModel& model);
+
+// Pre-wake use history and hit/miss counts (settings come from the caller)
+bool LoadWakePredictor(WakePredictor& predictor);
+bool SaveWakePredictor(const WakePredictor& predictor);
+
+// Process-wide configuration, loaded on first use.
+// First use also selects the detection backend from [Advanced].
+const Config& GetConfig();
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_CONFIG_H
@@ -0,0 +1,277 @@
+#pragma once
+// Device change events for HDD Toggle
+// What the drive watcher does with a device notification, independent of
+// where it came from: which events mean "re-detect the drive" or "the relay
+// may be gone", and the settle timer that turns the burst of events one
+// power change produces into a single detection pass. Windows feeds it
+// WM_DEVICECHANGE broadcasts (drive-watcher.cpp); on Linux the netlink
+// uevent listener below does, and tests drive it over a socketpair.
+
+#ifndef HDD_CORE_DEVICE_EVENTS_H
+#define HDD_CORE_DEVICE_EVENTS_H
+
+#include "hdd-utils.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <chrono>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace hdd {
+namespace core {
+
+// Quiet time that ends a burst of notifications (disk interface, then each
+// volume) before the drive is detected again
+constexpr uint32_t DEVICE_CHANGE_SETTLE_MS = 500;
+
+// Longest a detection pass waits behind a burst that keeps going, e.g. a
+// drive dropping in and out of a flaky USB bridge
+constexpr uint32_t DEVICE_CHANGE_MAX_DELAY_MS = 3000;
+
+enum class DeviceAction { Arrival, Removal, Other };
+
+// Kind of device the event is about. VolumeMount is a drive letter
+// broadcast (Windows DBT_DEVTYP_VOLUME), sent whatever was registered.
+enum class DeviceClass { Disk, Volume, VolumeMount, Hid, Other };
+
+// What a batch of events asks the watcher's owner to do
+struct DeviceChanges {
+    bool disk = false;          // Re-detect the drive (after settling)
+    bool hidRemoved = false;    // Drop any cached relay handle (at once)
+
+    bool Any() const { return disk || hidRemoved; }
+
+    void Merge(const DeviceChanges& other) {
+        disk = disk || other.disk;
+        hidRemoved = hidRemoved || other.hidRemoved;
+    }
+};
+
+inline DeviceChanges ClassifyDeviceEvent(DeviceAction action, DeviceClass deviceClass) {
+    DeviceChanges changes;
+    if (action == DeviceAction::Other) return changes;
+
+    changes.disk = deviceClass == DeviceClass::Disk || deviceClass == DeviceClass::Volume ||
+                   deviceClass == DeviceClass::VolumeMount;
+    changes.hidRemoved = deviceClass == DeviceClass::Hid && action == DeviceAction::Removal;
+    return changes;
+}
+
+// Settle timer for disk changes: fires settleMs after the last event, but
+// no later than maxDelayMs after the first one of the burst. Times are
+// monotonic milliseconds supplied by the caller.
+class DeviceSettleTimer {
+public:
+    explicit DeviceSettleTimer(uint32_t settleMs = DEVICE_CHANGE_SETTLE_MS,
+                               uint32_t maxDelayMs = DEVICE_CHANGE_MAX_DELAY_MS)
+        : m_settleMs(settleMs), m_maxDelayMs(maxDelayMs), m_pending(false), m_first(0), m_last(0) {}
+
+    void Trigger(uint64_t now) {
+        if (!m_pending) m_first = now;
+        m_pending = true;
+        m_last = now;
+    }
+
+    bool IsPending() const { return m_pending; }
+
+    // Time until Fire() would succeed; WAIT_NO_TIMEOUT when nothing is pending
+    uint32_t RemainingMs(uint64_t now) const {
+        return m_pending ? RemainingWaitMs(DueAt(), now) : WAIT_NO_TIMEOUT;
+    }
+
+    // True once per burst, when it has settled
+    bool Fire(uint64_t now) {
+        if (!m_pending || now < DueAt()) return false;
+        m_pending = false;
+        return true;
+    }
+
+    void Cancel() { m_pending = false; }
+
+private:
+    uint64_t DueAt() const {
+        uint64_t settled = m_last + m_settleMs;
+        uint64_t latest = m_first + m_maxDelayMs;
+        return settled < latest ? settled : latest;
+    }
+
+    uint32_t m_settleMs;
+    uint32_t m_maxDelayMs;
+    bool m_pending;
+    uint64_t m_first;
+    uint64_t m_last;
+};
+
+// One kernel uevent: "add@/devices/...\0ACTION=add\0SUBSYSTEM=block\0..."
+struct Uevent {
+    std::string action;
+    std::string devpath;
+    std::string subsystem;
+    std::string devtype;
+    std::string devname;
+};
+
+// Parse a kernel uevent datagram. Returns false for anything else,
+// including udev's own "libudev" re-broadcasts.
+inline bool ParseUevent(const char* data, size_t size, Uevent& event) {
+    event = Uevent();
+    size_t headerLength = strnlen(data, size);
+    if (headerLength == size || !memchr(data, '@', headerLength)) return false;
+
+    for (size_t pos = headerLength + 1; pos < size;) {
+        size_t length = strnlen(data + pos, size - pos);
+        std::string field(data + pos, length);
+        pos += length + 1;
+
+        size_t equals = field.find('=');
+        if (equals == std::string::npos) continue;
+        std::string key = field.substr(0, equals);
+        std::string value = field.substr(equals + 1);
+        if (key == "ACTION") event.action = value;
+        else if (key == "DEVPATH") event.devpath = value;
+        else if (key == "SUBSYSTEM") event.subsystem = value;
+        else if (key == "DEVTYPE") event.devtype = value;
+        else if (key == "DEVNAME") event.devname = value;
+    }
+    return !event.action.empty() && !event.subsystem.empty();
+}
+
+// Map a uevent onto the platform-neutral classification: whole disks and
+// partitions of the block subsystem, and hidraw nodes (the relay)
+inline DeviceChanges ClassifyUevent(const Uevent& event) {
+    DeviceAction action = event.action == "add" ? DeviceAction::Arrival
+                        : event.action == "remove" ? DeviceAction::Removal
+                        : DeviceAction::Other;
+
+    DeviceClass deviceClass = DeviceClass::Other;
+    if (event.subsystem == "block") {
+        if (event.devtype == "disk") deviceClass = DeviceClass::Disk;
+        else if (event.devtype == "partition") deviceClass = DeviceClass::Volume;
+    } else if (event.subsystem == "hidraw") {
+        deviceClass = DeviceClass::Hid;
+    }
+    return ClassifyDeviceEvent(action, deviceClass);
+}
+
+#ifdef __linux__
+
+// Listens for kernel uevents on a NETLINK_KOBJECT_UEVENT socket and turns
+// them into settled DeviceChanges. Nothing runs between events.
+class UeventWatcher {
+public:
+    explicit UeventWatcher(uint32_t settleMs = DEVICE_CHANGE_SETTLE_MS,
+                           uint32_t maxDelayMs = DEVICE_CHANGE_MAX_DELAY_MS)
+        : m_fd(-1), m_netlink(false), m_settle(settleMs, maxDelayMs) {}
+    ~UeventWatcher() { Stop(); }
+
+    // Subscribe to the kernel's uevent broadcast. False if the socket could
+    // not be bound (caller should fall back to polling).
+    bool Start() {
+        Stop();
+        int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+        if (fd < 0) return false;
+
+        sockaddr_nl address = {};
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = 1;   // Kernel broadcasts; udev re-sends on group 2
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return false;
+        }
+        m_fd = fd;
+        m_netlink = true;
+        return true;
+    }
+
+    // Read datagrams from an already open socket instead (tests feed
+    // synthetic uevents through a socketpair). Takes ownership of fd.
+    void Adopt(int fd) {
+        Stop();
+        m_fd = fd;
+        m_netlink = false;
+    }
+
+    void Stop() {
+        if (m_fd >= 0) close(m_fd);
+        m_fd = -1;
+        m_settle.Cancel();
+    }
+
+    bool IsActive() const { return m_fd >= 0; }
+    int Fd() const { return m_fd; }
+
+    // Wait up to timeoutMs for something to act on. HID removals are
+    // returned as soon as they arrive, disk changes once they have settled.
+    DeviceChanges Wait(uint32_t timeoutMs) {
+        DeviceChanges result;
+        uint64_t deadline = DeadlineAfter(NowMs(), timeoutMs);
+        while (m_fd >= 0) {
+            uint64_t now = NowMs();
+            if (m_settle.Fire(now)) result.disk = true;
+            if (result.Any()) break;
+
+            // Sleep until the next event, the end of the burst or the deadline
+            uint32_t remaining = RemainingWaitMs(deadline, now);
+            uint32_t settle = m_settle.RemainingMs(now);
+            uint32_t waitMs = settle < remaining ? settle : remaining;
+            pollfd entry = {m_fd, POLLIN, 0};
+            int ready = poll(&entry, 1, waitMs == WAIT_NO_TIMEOUT ? -1 : static_cast<int>(waitMs));
+            if (ready < 0 && errno != EINTR) break;
+
+            if (ready > 0) {
+                DeviceChanges changes = ReadPending();
+                if (changes.disk) m_settle.Trigger(NowMs());
+                result.hidRemoved = result.hidRemoved || changes.hidRemoved;
+            } else if (ready == 0 && remaining == 0) {
+                // Deadline: a burst still settling is reported by a later Wait
+                break;
+            }
+        }
+        return result;
+    }
+
+private:
+    static uint64_t NowMs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Drain every queued datagram without blocking
+    DeviceChanges ReadPending() {
+        DeviceChanges changes;
+        char buffer[8192];
+        for (;;) {
+            sockaddr_nl sender = {};
+            socklen_t senderLength = sizeof(sender);
+            ssize_t size = recvfrom(m_fd, buffer, sizeof(buffer), MSG_DONTWAIT,
+                                    reinterpret_cast<sockaddr*>(&sender), &senderLength);
+            if (size < 0 && errno == EINTR) continue;
+            if (size <= 0) break;
+
+            // Only the kernel (port 0) may speak on the uevent socket
+            if (m_netlink && (senderLength < sizeof(sender) || sender.nl_pid != 0)) continue;
+
+            Uevent event;
+            if (ParseUevent(buffer, static_cast<size_t>(size), event)) changes.Merge(ClassifyUevent(event));
+        }
+        return changes;
+    }
+
+    int m_fd;
+    bool m_netlink;
+    DeviceSettleTimer m_settle;
+};
+
+#endif // __linux__
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_DEVICE_EVENTS_H
@@ -0,0 +1,186 @@
+#pragma once
+// Persistent disk query session for HDD Toggle
+// Keeps one backend connection open across queries and reconnects when it
+// breaks. Platform-neutral: the Native (IOCTL) and WMI backends live in
+// disk.cpp, the Linux sysfs backend in core/disk-sysfs.h, and tests drive
+// the same lifecycle with a fake backend.
+
+#ifndef HDD_CORE_DISK_SESSION_H
+#define HDD_CORE_DISK_SESSION_H
+
+#include "hdd-utils.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hdd {
+namespace core {
+
+// One row of a disk enumeration
+struct DiskRecord {
+    std::string serialNumber;
+    std::string model;
+    int number = -1;
+    bool isOffline = false;
+    std::string device;     // Kernel name where the backend has one ("sdb")
+};
+
+// Result of a single backend enumeration
+enum class QueryStatus {
+    Ok,             // Enumeration completed
+    Disconnected,   // Connection broke; the session reconnects and retries once
+    Failed          // Query failed for another reason; retrying will not help
+};
+
+// A source of disk records with an explicit connection lifecycle
+class DiskQueryBackend {
+public:
+    virtual ~DiskQueryBackend() = default;
+
+    // Establish the connection. Called lazily before the first query.
+    virtual bool Connect() = 0;
+
+    // Drop the connection. Must be safe to call when not connected.
+    virtual void Disconnect() = 0;
+
+    // Enumerate all disks (disks is cleared first)
+    virtual QueryStatus EnumerateDisks(std::vector<DiskRecord>& disks) = 0;
+};
+
+// Long-lived, thread-safe wrapper around a backend.
+// Connection setup is paid once; later queries reuse it.
+class DiskQuerySession {
+public:
+    explicit DiskQuerySession(std::unique_ptr<DiskQueryBackend> backend)
+        : m_backend(std::move(backend)), m_connected(false), m_connectCount(0) {}
+
+    ~DiskQuerySession() {
+        if (m_connected) m_backend->Disconnect();
+    }
+
+    // Enumerate disks, connecting or reconnecting as needed.
+    // Returns false if no connection could be made or the query failed.
+    bool EnumerateDisks(std::vector<DiskRecord>& disks) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        disks.clear();
+
+        if (!EnsureConnected()) return false;
+
+        QueryStatus status = m_backend->EnumerateDisks(disks);
+        if (status == QueryStatus::Disconnected) {
+            // Stale connection (service restarted, RPC dropped): reconnect once
+            DropConnection();
+            disks.clear();
+            if (!EnsureConnected()) return false;
+            status = m_backend->EnumerateDisks(disks);
+            if (status == QueryStatus::Disconnected) DropConnection();
+        }
+
+        return status == QueryStatus::Ok;
+    }
+
+    // Drop the current connection; the next query reconnects
+    void Reset() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        DropConnection();
+    }
+
+    bool IsConnected() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_connected;
+    }
+
+    // Number of successful connects so far (for diagnostics and tests)
+    unsigned int ConnectCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_connectCount;
+    }
+
+    // Non-copyable
+    DiskQuerySession(const DiskQuerySession&) = delete;
+    DiskQuerySession& operator=(const DiskQuerySession&) = delete;
+
+private:
+    bool EnsureConnected() {
+        if (m_connected) return true;
+        m_connected = m_backend->Connect();
+        if (m_connected) m_connectCount++;
+        return m_connected;
+    }
+
+    void DropConnection() {
+        if (m_connected) {
+            m_backend->Disconnect();
+            m_connected = false;
+        }
+    }
+
+    std::unique_ptr<DiskQueryBackend> m_backend;
+    mutable std::mutex m_mutex;
+    bool m_connected;
+    unsigned int m_connectCount;
+};
+
+// Find the record whose serial matches target (case-insensitive, trimmed)
+// Returns nullptr if no disk matches
+inline const DiskRecord* FindDiskBySerial(const std::vector<DiskRecord>& disks,
+                                          const std::string& targetSerial) {
+    for (const auto& disk : disks) {
+        if (SerialMatches(disk.serialNumber, targetSerial)) return &disk;
+    }
+    return nullptr;
+}
+
+// Find the target disk: serial match first, then a case-insensitive model
+// substring match (mirrors the old Get-Disk "-match serial -or -match model")
+// Returns nullptr if neither matches
+inline const DiskRecord* FindDiskByTarget(const std::vector<DiskRecord>& disks,
+                                          const std::string& targetSerial,
+                                          const std::string& targetModel) {
+    const DiskRecord* disk = FindDiskBySerial(disks, targetSerial);
+    if (disk) return disk;
+
+    std::string model = ToLower(TrimWhitespace(targetModel));
+    if (model.empty()) return nullptr;
+
+    for (const auto& candidate : disks) {
+        if (ToLower(candidate.model).find(model) != std::string::npos) return &candidate;
+    }
+    return nullptr;
+}
+
+// State of a configured drive given its record from an enumeration that
+// succeeded. A drive that is not enumerated at all is powered off, so
+// nullptr is Offline; Unknown is left for a failed enumeration.
+inline DriveState DiskRecordState(const DiskRecord* disk) {
+    return disk && !disk->isOffline ? DriveState::Online : DriveState::Offline;
+}
+
+// Match every configured target against one enumeration
+// matches[i] is the disk for targets[i], or nullptr. Serials go into a hash
+// map once, so the pass costs O(disks + targets). Targets without a serial
+// never match; if two targets share a serial, the first one wins.
+inline std::vector<const DiskRecord*> MatchDiskTargets(const std::vector<DiskRecord>& disks,
+                                                       const std::vector<DriveTarget>& targets) {
+    std::unordered_map<std::string, size_t> bySerial;
+    bySerial.reserve(targets.size());
+    for (size_t i = 0; i < targets.size(); i++) {
+        std::string key = NormalizeSerial(targets[i].serial);
+        if (!key.empty()) bySerial.emplace(key, i);
+    }
+
+    std::vector<const DiskRecord*> matches(targets.size(), nullptr);
+    for (const auto& disk : disks) {
+        auto it = bySerial.find(NormalizeSerial(disk.serialNumber));
+        if (it != bySerial.end() && !matches[it->second]) matches[it->second] = &disk;
+    }
+    return matches;
+}
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_DISK_SESSION_H
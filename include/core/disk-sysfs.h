@@ -0,0 +1,189 @@
+#pragma once
+// Linux sysfs disk backend for HDD Toggle
+// A DiskQueryBackend that reads /sys/block instead of spawning lsblk or
+// udevadm: a handful of small file reads per disk. The serial comes from
+// device/serial, the SCSI unit serial VPD page, a t10 wwid or, last, the
+// /dev/disk/by-id link names. Both roots are configurable so tests run
+// against a fixture tree. The parsers are platform-neutral.
+
+#ifndef HDD_CORE_DISK_SYSFS_H
+#define HDD_CORE_DISK_SYSFS_H
+
+#include "core/disk-session.h"
+#include "hdd-utils.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace hdd {
+namespace core {
+
+// Serial out of the SCSI unit serial number VPD page (0x80), as exposed in
+// device/vpd_pg80: 4-byte header, big-endian length, space-padded ASCII.
+// "" if the page is malformed.
+inline std::string ParseVpdUnitSerial(const std::string& page) {
+    if (page.size() < 4 || static_cast<unsigned char>(page[1]) != 0x80) return "";
+    size_t length = (static_cast<size_t>(static_cast<unsigned char>(page[2])) << 8) |
+                    static_cast<unsigned char>(page[3]);
+    if (length > page.size() - 4) return "";
+
+    std::string serial = page.substr(4, length);
+    serial.erase(std::find(serial.begin(), serial.end(), '\0'), serial.end());
+    return TrimWhitespace(serial);
+}
+
+// Serial out of a t10 world-wide ID ("t10.ATA     <model>     <serial>"),
+// which libata builds from IDENTIFY data; "" for other wwid forms
+inline std::string ParseT10WwidSerial(const std::string& wwid) {
+    std::string id = TrimWhitespace(wwid);
+    if (!StartsWith(id, "t10.")) return "";
+
+    size_t lastSpace = id.find_last_of(" \t");
+    if (lastSpace == std::string::npos) return "";
+    return id.substr(lastSpace + 1);
+}
+
+// Serial out of a /dev/disk/by-id link name, where udev appends it to the
+// model after the last '_': "ata-ST4000DM004-2CV104_ZFN0A1B2",
+// "usb-WD_Elements_25A3_575835-0:0", "nvme-Samsung_SSD_970_S4EWNX0R". Partition
+// links and ID schemes without a serial (wwn-, eui.) yield "".
+inline std::string ParseByIdSerial(const std::string& name) {
+    if (name.find("-part") != std::string::npos) return "";
+
+    static const char* const prefixes[] = {"ata-", "scsi-SATA_", "scsi-SATA-", "nvme-", "usb-"};
+    std::string id;
+    for (const char* prefix : prefixes) {
+        if (StartsWith(name, prefix)) {
+            id = name.substr(strlen(prefix));
+            break;
+        }
+    }
+    if (id.empty() || StartsWith(id, "eui.") || StartsWith(id, "nvme.")) return "";
+
+    // usb- names end in the LUN ("-0:0")
+    if (StartsWith(name, "usb-")) {
+        size_t lun = id.rfind('-');
+        if (lun != std::string::npos && id.find(':', lun) != std::string::npos) id.erase(lun);
+    }
+
+    size_t underscore = id.rfind('_');
+    if (underscore == std::string::npos || underscore + 1 == id.size()) return "";
+    return id.substr(underscore + 1);
+}
+
+#ifdef __linux__
+
+// Enumerates the disks under <sysRoot>/block. Virtual block devices (loop,
+// ram, device-mapper) have no "device" link and are skipped. A disk's
+// number is its position in name order. A SCSI device whose state is
+// "offline" (or an NVMe controller that is "dead") is reported offline.
+class SysfsDiskBackend : public DiskQueryBackend {
+public:
+    explicit SysfsDiskBackend(const std::string& sysRoot = "/sys",
+                              const std::string& byIdDir = "/dev/disk/by-id")
+        : m_blockDir(sysRoot + "/block"), m_byIdDir(byIdDir) {}
+
+    // Nothing to hold open; fails only without a readable block directory
+    bool Connect() override { return access(m_blockDir.c_str(), R_OK | X_OK) == 0; }
+    void Disconnect() override {}
+
+    QueryStatus EnumerateDisks(std::vector<DiskRecord>& disks) override {
+        disks.clear();
+        DIR* dir = opendir(m_blockDir.c_str());
+        if (!dir) return QueryStatus::Failed;
+
+        std::vector<std::string> names;
+        while (dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;
+            std::string name = entry->d_name;
+            if (access((m_blockDir + "/" + name + "/device").c_str(), F_OK) == 0) names.push_back(name);
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+
+        // by-id is only read if some disk exposes no serial in sysfs
+        bool byIdLoaded = false;
+        std::unordered_map<std::string, std::string> byIdSerials;
+
+        for (size_t i = 0; i < names.size(); i++) {
+            std::string device = m_blockDir + "/" + names[i] + "/device/";
+            DiskRecord record;
+            record.number = static_cast<int>(i);
+            record.device = names[i];
+            record.model = TrimWhitespace(ReadSysfsFile(device + "model"));
+
+            std::string& serial = record.serialNumber;
+            serial = TrimWhitespace(ReadSysfsFile(device + "serial"));
+            if (serial.empty()) serial = ParseVpdUnitSerial(ReadSysfsFile(device + "vpd_pg80"));
+            if (serial.empty()) serial = ParseT10WwidSerial(ReadSysfsFile(device + "wwid"));
+            if (serial.empty()) {
+                if (!byIdLoaded) {
+                    byIdSerials = ReadByIdSerials();
+                    byIdLoaded = true;
+                }
+                auto it = byIdSerials.find(names[i]);
+                if (it != byIdSerials.end()) serial = it->second;
+            }
+
+            std::string state = TrimWhitespace(ReadSysfsFile(device + "state"));
+            record.isOffline = state == "offline" || state == "dead";
+            disks.push_back(std::move(record));
+        }
+        return QueryStatus::Ok;
+    }
+
+private:
+    // Whole file (sysfs attributes are small); "" if missing or unreadable
+    static std::string ReadSysfsFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return "";
+
+        std::string contents;
+        char buffer[4096];
+        ssize_t size;
+        while ((size = read(fd, buffer, sizeof(buffer))) > 0) contents.append(buffer, static_cast<size_t>(size));
+        close(fd);
+        return contents;
+    }
+
+    // Disk name ("sdb") -> serial, from the by-id links that carry one
+    std::unordered_map<std::string, std::string> ReadByIdSerials() const {
+        std::unordered_map<std::string, std::string> serials;
+        DIR* dir = opendir(m_byIdDir.c_str());
+        if (!dir) return serials;
+
+        while (dirent* entry = readdir(dir)) {
+            std::string serial = ParseByIdSerial(entry->d_name);
+            if (serial.empty()) continue;
+
+            char target[512];
+            ssize_t length = readlink((m_byIdDir + "/" + entry->d_name).c_str(), target, sizeof(target) - 1);
+            if (length <= 0) continue;
+            std::string path(target, static_cast<size_t>(length));
+            std::string disk = path.substr(path.rfind('/') + 1);
+
+            // Prefer ata-/nvme- over usb- when a disk has both
+            if (!serials.count(disk) || !StartsWith(entry->d_name, "usb-")) serials[disk] = serial;
+        }
+        closedir(dir);
+        return serials;
+    }
+
+    std::string m_blockDir;
+    std::string m_byIdDir;
+};
+
+#endif // __linux__
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_DISK_SYSFS_H
@@ -6,13 +6,17 @@
 #define HDD_CORE_DISK_H
 
 #include "hdd-utils.h"
+#include "core/disk-session.h"
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace hdd {
 namespace core {
 
 // Drive information structure
 struct DriveInfo {
+    std::string name;           // Config section of the drive ("Drive.2")
     DriveState state = DriveState::Unknown;
     std::string serialNumber;
     std::string model;
@@ -20,10 +24,37 @@ struct DriveInfo {
     bool found = false;
 };
 
-// Detect drive information using WMI
-// Queries MSFT_Disk for the target drive by serial number
+// Disk enumeration backends
+enum class DiskBackendType {
+    Native,     // DeviceIoControl on \\.\PhysicalDriveN (default, fastest)
+    Wmi         // MSFT_Disk via WMI
+};
+
+// Create a backend that queries MSFT_Disk over WMI
+// Each backend owns its own connection; most callers want GetDiskQuerySession()
+std::unique_ptr<DiskQueryBackend> CreateWmiDiskBackend();
+
+// Create a backend that reads storage descriptors directly from the disks
+std::unique_ptr<DiskQueryBackend> CreateNativeDiskBackend();
+
+// Choose the backend used by GetDiskQuerySession()
+// Only takes effect if called before the session is first used
+void SetPreferredDiskBackend(DiskBackendType type);
+
+// Process-wide disk query session, created on first use and kept open
+// Shared by status, wake, sleep and the tray so the connection is set up once
+DiskQuerySession& GetDiskQuerySession();
+
+// Detect drive information using the shared disk query session
+// Looks up the target drive by serial number. A drive that is not found
+// keeps the target serial; state is Offline, or Unknown if the query failed.
 DriveInfo DetectDriveInfo(const std::string& targetSerial);
 
+// Detect every configured drive from a single enumeration
+// Result is index-aligned with targets. Drives that are not found keep the
+// configured serial and model; state is Offline, or Unknown if the query failed.
+std::vector<DriveInfo> DetectDriveInfos(const std::vector<DriveTarget>& targets);
+
 // Check if the target disk is currently online
 bool IsDiskOnline(const std::string& targetSerial, const std::string& targetModel);
 
@@ -0,0 +1,67 @@
+#pragma once
+// Drive presence watcher for HDD Toggle
+// Event-driven replacement for polling: subscribes to disk and volume
+// arrival/removal notifications so state changes reach the tray immediately.
+// Classification and settling are in device-events.h.
+
+#ifndef HDD_CORE_DRIVE_WATCHER_H
+#define HDD_CORE_DRIVE_WATCHER_H
+
+#include "core/device-events.h"
+#include <windows.h>
+#include <dbt.h>
+
+namespace hdd {
+namespace core {
+
+// GUID_DEVINTERFACE_DISK and GUID_DEVINTERFACE_VOLUME from ntddstor.h.
+// Defined here to avoid the initguid.h include-order dance with windows.h;
+// storage.cpp registers for disk arrivals with the same GUID.
+inline const GUID kDiskInterfaceGuid =
+    { 0x53f56307, 0xb6bf, 0x11d0, { 0x94, 0xf2, 0x00, 0xa0, 0xc9, 0x1e, 0xfb, 0x8b } };
+inline const GUID kVolumeInterfaceGuid =
+    { 0x53f5630d, 0xb6bf, 0x11d0, { 0x94, 0xf2, 0x00, 0xa0, 0xc9, 0x1e, 0xfb, 0x8b } };
+// GUID_DEVINTERFACE_HID from hidclass.h
+inline const GUID kHidInterfaceGuid =
+    { 0x4d1e55b2, 0xf16f, 0x11cf, { 0x88, 0xcb, 0x00, 0x11, 0x11, 0x00, 0x00, 0x30 } };
+
+class DriveWatcher {
+public:
+    DriveWatcher();
+    ~DriveWatcher();
+
+    // Register for disk, volume and HID interface notifications.
+    // Events are delivered to hwnd as WM_DEVICECHANGE messages.
+    // Returns false if registration failed (caller should fall back to polling)
+    bool Start(HWND hwnd);
+
+    // Unregister all notifications (safe to call more than once)
+    void Stop();
+
+    // True while at least the disk interface notification is registered
+    bool IsActive() const { return m_diskNotify != nullptr; }
+
+    // What a WM_DEVICECHANGE message asks for (see ClassifyDeviceEvent)
+    static DeviceChanges Classify(WPARAM wParam, LPARAM lParam);
+
+    // Check whether a WM_DEVICECHANGE message describes a disk or volume
+    // arriving or leaving. Other device classes and event types are ignored.
+    static bool IsDiskChange(WPARAM wParam, LPARAM lParam);
+
+    // Check whether a WM_DEVICECHANGE message reports a HID device leaving
+    static bool IsHidRemoval(WPARAM wParam, LPARAM lParam);
+
+    // Non-copyable
+    DriveWatcher(const DriveWatcher&) = delete;
+    DriveWatcher& operator=(const DriveWatcher&) = delete;
+
+private:
+    HDEVNOTIFY m_diskNotify;
+    HDEVNOTIFY m_volumeNotify;
+    HDEVNOTIFY m_hidNotify;
+};
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_DRIVE_WATCHER_H
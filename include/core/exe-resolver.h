@@ -0,0 +1,202 @@
+#pragma once
+// Cached executable lookup for HDD Toggle
+// Resolves a program name against the exe directory, the working directory
+// and PATH, and remembers the answer (including "not found") until PATH
+// changes or one of the searched directories is modified. File checks go
+// through an ExeProbe: the Windows probe lives in process.cpp, the POSIX one
+// below is used by the tests.
+
+#ifndef HDD_CORE_EXE_RESOLVER_H
+#define HDD_CORE_EXE_RESOLVER_H
+
+#include "hdd-utils.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hdd {
+namespace core {
+
+#ifdef _WIN32
+constexpr char PATH_LIST_SEPARATOR = ';';
+constexpr char PATH_DIR_SEPARATOR = '\\';
+#else
+constexpr char PATH_LIST_SEPARATOR = ':';
+constexpr char PATH_DIR_SEPARATOR = '/';
+#endif
+
+// How long a cached answer is trusted before directory mtimes are rechecked
+constexpr uint64_t EXE_CACHE_REVALIDATE_MS = 30000;
+
+// Split a PATH-style list. Empty entries are skipped and surrounding quotes
+// ("C:\Program Files\x") removed.
+inline std::vector<std::string> SplitSearchPath(const std::string& list, char separator) {
+    std::vector<std::string> dirs;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(separator, start);
+        if (end == std::string::npos) end = list.size();
+
+        std::string dir = TrimWhitespace(list.substr(start, end - start));
+        if (dir.size() >= 2 && dir.front() == '"' && dir.back() == '"') {
+            dir = dir.substr(1, dir.size() - 2);
+        }
+        if (!dir.empty()) dirs.push_back(dir);
+
+        start = end + 1;
+    }
+    return dirs;
+}
+
+// dir + separator + name; an empty dir means name as given (working directory)
+inline std::string JoinSearchPath(const std::string& dir, const std::string& name, char separator) {
+    if (dir.empty()) return name;
+    char last = dir.back();
+    if (last == '\\' || last == '/') return dir + name;
+    return dir + separator + name;
+}
+
+// File-system access used by the resolver
+class ExeProbe {
+public:
+    virtual ~ExeProbe() = default;
+
+    // True if path is a file we could run
+    virtual bool IsExecutable(const std::string& path) = 0;
+
+    // Modification stamp of a directory ("" = working directory), 0 if missing
+    virtual uint64_t DirectoryStamp(const std::string& dir) = 0;
+};
+
+#ifndef _WIN32
+// Regular file with an execute bit for us
+class PosixExeProbe : public ExeProbe {
+public:
+    bool IsExecutable(const std::string& path) override {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(path.c_str(), X_OK) == 0;
+    }
+
+    uint64_t DirectoryStamp(const std::string& dir) override {
+        struct stat st;
+        if (stat(dir.empty() ? "." : dir.c_str(), &st) != 0) return 0;
+        return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ull +
+               static_cast<uint64_t>(st.st_mtim.tv_nsec);
+    }
+};
+#endif
+
+// Thread-safe resolver cache.
+// A hit within EXE_CACHE_REVALIDATE_MS is a hash lookup with no file-system
+// work. After that, the directories the answer depended on are re-stamped
+// and the entry is only resolved again if one of them changed.
+class ExeResolverCache {
+public:
+    explicit ExeResolverCache(char listSeparator = PATH_LIST_SEPARATOR,
+                              char dirSeparator = PATH_DIR_SEPARATOR)
+        : m_listSeparator(listSeparator), m_dirSeparator(dirSeparator),
+          m_environment(0), m_hasEnvironment(false) {}
+
+    // Find name in exeDir, the working directory, then each PATH entry.
+    // Returns the full path, or "" if not found.
+    std::string Resolve(ExeProbe& probe, const std::string& name, const std::string& pathList,
+                        const std::string& exeDir, uint64_t nowMs) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Any change to PATH or the exe directory drops every answer
+        uint64_t environment = HashFnv1a(pathList, HashFnv1a(exeDir));
+        if (!m_hasEnvironment || environment != m_environment) {
+            m_entries.clear();
+            m_environment = environment;
+            m_hasEnvironment = true;
+        }
+
+        auto it = m_entries.find(name);
+        if (it != m_entries.end()) {
+            Entry& entry = it->second;
+            if (nowMs - entry.checkedMs < EXE_CACHE_REVALIDATE_MS) return entry.path;
+
+            if (StampDirectories(probe, entry.dirs) == entry.stamp) {
+                entry.checkedMs = nowMs;
+                return entry.path;
+            }
+        }
+
+        Entry entry = Search(probe, name, pathList, exeDir);
+        entry.checkedMs = nowMs;
+        std::string path = entry.path;
+        m_entries[name] = std::move(entry);
+        return path;
+    }
+
+    // Forget everything (e.g. after installing a helper)
+    void Invalidate() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.clear();
+    }
+
+    size_t Size() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_entries.size();
+    }
+
+private:
+    struct Entry {
+        std::string path;                   // "" = not found (negative entry)
+        std::vector<std::string> dirs;      // Directories searched up to the hit
+        uint64_t stamp = 0;                 // Combined stamp of dirs
+        uint64_t checkedMs = 0;
+    };
+
+    Entry Search(ExeProbe& probe, const std::string& name, const std::string& pathList,
+                 const std::string& exeDir) const {
+        Entry entry;
+
+        std::vector<std::string> dirs;
+        if (!exeDir.empty()) dirs.push_back(exeDir);
+        dirs.push_back("");
+        for (auto& dir : SplitSearchPath(pathList, m_listSeparator)) dirs.push_back(std::move(dir));
+
+        // A hit can only be shadowed by something appearing in an earlier
+        // directory, so later ones do not need watching
+        for (const auto& dir : dirs) {
+            entry.dirs.push_back(dir);
+            std::string candidate = JoinSearchPath(dir, name, m_dirSeparator);
+            if (probe.IsExecutable(candidate)) {
+                entry.path = candidate;
+                break;
+            }
+        }
+
+        entry.stamp = StampDirectories(probe, entry.dirs);
+        return entry;
+    }
+
+    static uint64_t StampDirectories(ExeProbe& probe, const std::vector<std::string>& dirs) {
+        uint64_t stamp = FNV1A_OFFSET_BASIS;
+        for (const auto& dir : dirs) {
+            uint64_t dirStamp = probe.DirectoryStamp(dir);
+            stamp = HashFnv1a(reinterpret_cast<const char*>(&dirStamp), sizeof(dirStamp), stamp);
+        }
+        return stamp;
+    }
+
+    char m_listSeparator;
+    char m_dirSeparator;
+    uint64_t m_environment;
+    bool m_hasEnvironment;
+    std::unordered_map<std::string, Entry> m_entries;
+    mutable std::mutex m_mutex;
+};
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_EXE_RESOLVER_H
@@ -0,0 +1,58 @@
+#pragma once
+// HID interface path matching for HDD Toggle
+// SetupDi device interface paths carry the USB vendor and product IDs
+// ("\\?\hid#vid_16c0&pid_05df#..."), so relay lookup can skip devices by
+// name instead of opening each one. Pure string parsing, tested on Linux.
+
+#ifndef HDD_CORE_HID_PATH_H
+#define HDD_CORE_HID_PATH_H
+
+#include <cctype>
+#include <string>
+
+namespace hdd {
+namespace core {
+
+// Parse the 4 hex digits after tag ("vid_" or "pid_", any case) in path
+inline bool ParseHidPathId(const std::string& path, const char* tag, unsigned short& id) {
+    const size_t tagLength = 4;
+    for (size_t pos = 0; pos + tagLength + 4 <= path.size(); pos++) {
+        bool tagMatch = true;
+        for (size_t i = 0; i < tagLength && tagMatch; i++) {
+            tagMatch = tolower(static_cast<unsigned char>(path[pos + i])) == tag[i];
+        }
+        if (!tagMatch) continue;
+
+        unsigned int value = 0;
+        for (size_t i = 0; i < 4; i++) {
+            char c = path[pos + tagLength + i];
+            if (!isxdigit(static_cast<unsigned char>(c))) return false;
+            value = value * 16 + static_cast<unsigned int>(isdigit(static_cast<unsigned char>(c))
+                ? c - '0' : tolower(static_cast<unsigned char>(c)) - 'a' + 10);
+        }
+        id = static_cast<unsigned short>(value);
+        return true;
+    }
+    return false;
+}
+
+// Whether a device interface path can belong to vendorId/productId
+enum class HidPathMatch {
+    Match,      // IDs in the path are the ones wanted
+    Mismatch,   // IDs in the path are different: no need to open it
+    Unknown     // No USB IDs in the path (e.g. Bluetooth): open and ask
+};
+
+inline HidPathMatch MatchHidInterfacePath(const std::string& path, unsigned short vendorId,
+                                          unsigned short productId) {
+    unsigned short vendor = 0, product = 0;
+    if (!ParseHidPathId(path, "vid_", vendor) || !ParseHidPathId(path, "pid_", product)) {
+        return HidPathMatch::Unknown;
+    }
+    return vendor == vendorId && product == productId ? HidPathMatch::Match : HidPathMatch::Mismatch;
+}
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_HID_PATH_H
@@ -0,0 +1,196 @@
+#pragma once
+// Idle detection for HDD Toggle
+// Decides when a drive has seen no reads or writes for long enough to be
+// put to sleep, from its cumulative I/O counters sampled now and then.
+// The counters come from IOCTL_DISK_PERFORMANCE on Windows (storage.cpp)
+// and /proc/diskstats on Linux (here); neither touches the disk itself.
+
+#ifndef HDD_CORE_IDLE_MONITOR_H
+#define HDD_CORE_IDLE_MONITOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace hdd {
+namespace core {
+
+// How often the tray samples an online drive's counters
+constexpr uint32_t IDLE_SAMPLE_MS = 30000;
+
+// Cumulative I/O on a disk since it arrived
+struct DiskIoCounters {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+
+    uint64_t Operations() const { return reads + writes; }
+
+    bool operator==(const DiskIoCounters& other) const {
+        return reads == other.reads && writes == other.writes;
+    }
+    bool operator!=(const DiskIoCounters& other) const { return !(*this == other); }
+};
+
+// Tracks how long the counters have stayed flat
+class IdleTracker {
+public:
+    // maxGapMs: samples further apart than this (the PC was suspended)
+    // restart the window instead of counting as idle time; 0 = no limit
+    explicit IdleTracker(uint64_t idleMs = 0, uint64_t maxGapMs = 0)
+        : m_idleMs(idleMs), m_maxGapMs(maxGapMs) { Reset(); }
+
+    // Forget everything, e.g. after the drive was slept or woken
+    void Reset() {
+        m_hasSample = false;
+        m_fired = false;
+        m_lastSampleMs = 0;
+        m_lastActivityMs = 0;
+    }
+
+    // Feed a sample. True once per idle period, when the counters have not
+    // moved for the idle window.
+    bool Sample(uint64_t nowMs, const DiskIoCounters& counters) {
+        bool gap = m_hasSample && m_maxGapMs > 0 && nowMs - m_lastSampleMs > m_maxGapMs;
+        if (!m_hasSample || gap || counters != m_last) {
+            // Any change counts, including counters going back to zero
+            // (the disk was re-enumerated)
+            m_last = counters;
+            m_lastActivityMs = nowMs;
+            m_fired = false;
+        }
+        m_hasSample = true;
+        m_lastSampleMs = nowMs;
+
+        if (m_idleMs == 0 || m_fired || IdleForMs(nowMs) < m_idleMs) return false;
+        m_fired = true;
+        return true;
+    }
+
+    // Time since the counters last moved; 0 before the first sample
+    uint64_t IdleForMs(uint64_t nowMs) const {
+        return m_hasSample && nowMs > m_lastActivityMs ? nowMs - m_lastActivityMs : 0;
+    }
+
+private:
+    uint64_t m_idleMs;
+    uint64_t m_maxGapMs;
+    bool m_hasSample;
+    bool m_fired;
+    uint64_t m_lastSampleMs;
+    uint64_t m_lastActivityMs;
+    DiskIoCounters m_last;
+};
+
+// Find device's line in /proc/diskstats text and read its completed reads
+// and writes (fields 4 and 8). Scans the buffer in place without
+// allocating. Returns false if the device is missing or its line malformed.
+inline bool ParseDiskstats(const char* text, size_t size, const char* device, DiskIoCounters& counters) {
+    size_t deviceLength = 0;
+    while (device[deviceLength]) deviceLength++;
+
+    const char* end = text + size;
+    for (const char* line = text; line < end;) {
+        const char* lineEnd = line;
+        while (lineEnd < end && *lineEnd != '\n') lineEnd++;
+
+        // Fields: major minor name reads merged sectors ms writes ...
+        uint64_t values[8] = {};
+        const char* name = nullptr;
+        size_t nameLength = 0;
+        int field = 0;
+        const char* p = line;
+        while (p < lineEnd && field < 8) {
+            while (p < lineEnd && (*p == ' ' || *p == '\t')) p++;
+            if (p == lineEnd) break;
+            const char* start = p;
+            while (p < lineEnd && *p != ' ' && *p != '\t') p++;
+
+            if (field == 2) {
+                name = start;
+                nameLength = static_cast<size_t>(p - start);
+            } else {
+                uint64_t value = 0;
+                for (const char* digit = start; digit < p; digit++) {
+                    if (*digit < '0' || *digit > '9') {
+                        field = -1;
+                        break;
+                    }
+                    value = value * 10 + static_cast<uint64_t>(*digit - '0');
+                }
+                if (field < 0) break;
+                values[field] = value;
+            }
+            field++;
+        }
+
+        if (name && nameLength == deviceLength) {
+            bool same = true;
+            for (size_t i = 0; i < nameLength && same; i++) same = name[i] == device[i];
+            if (same) {
+                if (field < 8) return false;
+                counters.reads = values[3];
+                counters.writes = values[7];
+                return true;
+            }
+        }
+        line = lineEnd + 1;
+    }
+    return false;
+}
+
+#ifdef __linux__
+
+// Reads one device's counters from /proc/diskstats. The file stays open
+// and is re-read into a buffer sized once, so a sample costs one pread
+// and a scan, with no allocation and no I/O on the disk.
+class DiskstatsSampler {
+public:
+    DiskstatsSampler() : m_fd(-1) {}
+    ~DiskstatsSampler() { Close(); }
+
+    bool Open(const std::string& path = "/proc/diskstats", size_t bufferSize = 64 * 1024) {
+        Close();
+        m_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        m_buffer.resize(bufferSize);
+        return m_fd >= 0;
+    }
+
+    void Close() {
+        if (m_fd >= 0) close(m_fd);
+        m_fd = -1;
+    }
+
+    // device is the kernel name, e.g. "sdb"
+    bool Read(const char* device, DiskIoCounters& counters) {
+        if (m_fd < 0) return false;
+        size_t size = 0;
+        while (size < m_buffer.size()) {
+            ssize_t count = pread(m_fd, m_buffer.data() + size, m_buffer.size() - size, static_cast<off_t>(size));
+            if (count < 0) return false;
+            if (count == 0) break;
+            size += static_cast<size_t>(count);
+        }
+        return ParseDiskstats(m_buffer.data(), size, device, counters);
+    }
+
+    // Non-copyable
+    DiskstatsSampler(const DiskstatsSampler&) = delete;
+    DiskstatsSampler& operator=(const DiskstatsSampler&) = delete;
+
+private:
+    int m_fd;
+    std::vector<char> m_buffer;
+};
+
+#endif // __linux__
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_IDLE_MONITOR_H
@@ -0,0 +1,125 @@
+#pragma once
+// Streaming child-process output for HDD Toggle
+// Splits a byte stream into lines as it arrives and keeps a bounded tail of
+// it, so memory stays flat however much a child prints. Pure: the pipe
+// readers that feed these live in process.cpp.
+
+#ifndef HDD_CORE_OUTPUT_STREAM_H
+#define HDD_CORE_OUTPUT_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace hdd {
+namespace core {
+
+// Longest line handed to a line callback; longer lines arrive in pieces
+constexpr size_t MAX_OUTPUT_LINE = 4096;
+
+// Splits output into lines using a fixed, preallocated buffer.
+// Lines are delivered without the trailing "\n" or "\r\n".
+class LineAssembler {
+public:
+    explicit LineAssembler(size_t maxLine = MAX_OUTPUT_LINE)
+        : m_buffer(maxLine > 0 ? maxLine : 1), m_length(0) {}
+
+    // Feed a chunk; calls emit(const std::string&) for every completed line
+    template <typename Emit>
+    void Feed(const char* data, size_t size, Emit&& emit) {
+        for (size_t i = 0; i < size; i++) {
+            if (data[i] == '\n') {
+                EmitLine(emit);
+            } else {
+                if (m_length == m_buffer.size()) EmitLine(emit);
+                m_buffer[m_length++] = data[i];
+            }
+        }
+    }
+
+    // Deliver a final line that had no newline (call at end of stream)
+    template <typename Emit>
+    void Flush(Emit&& emit) {
+        if (m_length > 0) EmitLine(emit);
+    }
+
+private:
+    template <typename Emit>
+    void EmitLine(Emit& emit) {
+        size_t length = m_length;
+        if (length > 0 && m_buffer[length - 1] == '\r') length--;
+        m_length = 0;
+        emit(std::string(m_buffer.data(), length));
+    }
+
+    std::vector<char> m_buffer;
+    size_t m_length;
+};
+
+// Keeps the last `capacity` bytes of a stream in a ring buffer allocated up
+// front. Capacity 0 keeps everything (the old unbounded behaviour).
+class BoundedTail {
+public:
+    explicit BoundedTail(size_t capacity = 0)
+        : m_capacity(capacity), m_start(0), m_size(0), m_dropped(0) {
+        if (m_capacity > 0) m_ring.resize(m_capacity);
+    }
+
+    void Append(const char* data, size_t size) {
+        if (m_capacity == 0) {
+            m_unbounded.append(data, size);
+            return;
+        }
+
+        // Only the last `capacity` bytes of this chunk can survive
+        if (size > m_capacity) {
+            m_dropped += m_size + (size - m_capacity);
+            data += size - m_capacity;
+            size = m_capacity;
+            m_start = 0;
+            m_size = 0;
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            size_t end = (m_start + m_size) % m_capacity;
+            m_ring[end] = data[i];
+            if (m_size < m_capacity) {
+                m_size++;
+            } else {
+                m_start = (m_start + 1) % m_capacity;
+                m_dropped++;
+            }
+        }
+    }
+
+    // Retained bytes in order
+    std::string Str() const {
+        if (m_capacity == 0) return m_unbounded;
+
+        std::string out;
+        out.reserve(m_size);
+        size_t first = m_capacity - m_start < m_size ? m_capacity - m_start : m_size;
+        out.append(m_ring.data() + m_start, first);
+        out.append(m_ring.data(), m_size - first);
+        return out;
+    }
+
+    size_t Size() const { return m_capacity == 0 ? m_unbounded.size() : m_size; }
+
+    // Bytes discarded from the front so far
+    uint64_t Dropped() const { return m_dropped; }
+
+private:
+    size_t m_capacity;
+    std::vector<char> m_ring;
+    size_t m_start;
+    size_t m_size;
+    uint64_t m_dropped;
+    std::string m_unbounded;
+};
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_OUTPUT_STREAM_H
@@ -0,0 +1,498 @@
+#pragma once
+// POSIX process runner for HDD Toggle
+// The Linux counterpart of ChildProcess/RunCommand in process.cpp: children
+// are started with posix_spawn through /bin/sh in their own process group,
+// so a kill reaches everything they started (the job object's role on
+// Windows). Exits are waited on through pidfds, so many children can be
+// waited on at once with poll(2). PosixShellHost is the /bin/sh ShellHost.
+// Used by the tests with sleep(1) children.
+
+#ifndef HDD_CORE_PROCESS_POSIX_H
+#define HDD_CORE_PROCESS_POSIX_H
+
+#include "core/process.h"
+
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace hdd {
+namespace core {
+
+// A child process started without waiting for it (see ChildProcess)
+class PosixChildProcess {
+public:
+    ~PosixChildProcess() {
+        // Also kill when only grandchildren still hold the pipes
+        if (!m_reaped || StreamsOpen()) Kill();
+        JoinReaders();
+        if (m_pidfd >= 0) close(m_pidfd);
+    }
+
+    // Run command with /bin/sh -c. Returns nullptr if it could not be started.
+    static std::unique_ptr<PosixChildProcess> Start(const std::string& command, bool captureOutput) {
+        CaptureOptions capture;
+        return Launch(command, captureOutput ? &capture : nullptr);
+    }
+
+    static std::unique_ptr<PosixChildProcess> Start(const std::string& command, const CaptureOptions& capture) {
+        return Launch(command, &capture);
+    }
+
+    // Wait up to timeoutMs (WAIT_NO_TIMEOUT = forever) for the process to exit
+    // and, when capturing, for its output to be drained. True once finished.
+    bool Wait(uint32_t timeoutMs) {
+        uint64_t deadline = DeadlineAfter(NowMs(), timeoutMs);
+        if (!m_reaped) {
+            if (!WaitReadable(m_pidfd, RemainingWaitMs(deadline, NowMs()))) return false;
+            Reap();
+        }
+
+        std::unique_lock<std::mutex> lock(m_streamMutex);
+        auto drained = [this] { return m_openStreams == 0; };
+        if (deadline == NO_DEADLINE) {
+            m_streamsDone.wait(lock, drained);
+        } else if (!m_streamsDone.wait_for(lock, std::chrono::milliseconds(RemainingWaitMs(deadline, NowMs())),
+                                           drained)) {
+            return false;
+        }
+        lock.unlock();
+        JoinReaders();
+        return true;
+    }
+
+    // Kill the whole process group and wait for it to go away
+    void Kill() {
+        // Once the leader is reaped the group only lives on while something
+        // in it still holds the pipes
+        if (!m_reaped || StreamsOpen()) kill(-m_pid, SIGKILL);
+        if (!m_reaped) Reap();
+        JoinReaders();
+    }
+
+    // Exit code once Wait() returned true; 1 if killed
+    int ExitCode() const {
+        if (!m_reaped || !WIFEXITED(m_status)) return 1;
+        return WEXITSTATUS(m_status);
+    }
+
+    std::string Output() const { return m_output.Str(); }
+    std::string ErrorOutput() const { return m_errorOutput.Str(); }
+    uint64_t DroppedBytes() const { return m_output.Dropped() + m_errorOutput.Dropped(); }
+
+    // Process ID, which is also the process group ID
+    pid_t Pid() const { return m_pid; }
+
+    // pidfd that becomes readable when the process exits, for WaitForAnyPosixChild
+    int NativeHandle() const { return m_pidfd; }
+
+    PosixChildProcess(const PosixChildProcess&) = delete;
+    PosixChildProcess& operator=(const PosixChildProcess&) = delete;
+
+private:
+    PosixChildProcess() : m_pid(-1), m_pidfd(-1), m_reaped(false), m_status(0), m_openStreams(0) {}
+
+    static uint64_t NowMs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static bool WaitReadable(int fd, uint32_t timeoutMs) {
+        pollfd entry = {fd, POLLIN, 0};
+        int timeout = timeoutMs == WAIT_NO_TIMEOUT ? -1 : static_cast<int>(std::min<uint32_t>(timeoutMs, INT32_MAX));
+        for (;;) {
+            int ready = poll(&entry, 1, timeout);
+            if (ready > 0) return true;
+            if (ready == 0 || errno != EINTR) return false;
+        }
+    }
+
+    static std::unique_ptr<PosixChildProcess> Launch(const std::string& command, const CaptureOptions* capture) {
+        int out[2] = {-1, -1};
+        int err[2] = {-1, -1};
+        bool separate = capture && capture->separateStderr;
+        if (capture && pipe2(out, O_CLOEXEC) != 0) return nullptr;
+        if (separate && pipe2(err, O_CLOEXEC) != 0) {
+            close(out[0]);
+            close(out[1]);
+            return nullptr;
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+        if (capture) {
+            posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+            posix_spawn_file_actions_adddup2(&actions, separate ? err[1] : out[1], STDERR_FILENO);
+        }
+
+        // Own process group for the kill; default signals and an empty mask,
+        // whatever the caller had installed
+        posix_spawnattr_t attr;
+        posix_spawnattr_init(&attr);
+        sigset_t all, none;
+        sigfillset(&all);
+        sigemptyset(&none);
+        posix_spawnattr_setsigdefault(&attr, &all);
+        posix_spawnattr_setsigmask(&attr, &none);
+        posix_spawnattr_setpgroup(&attr, 0);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+        const char* argv[] = {"/bin/sh", "-c", command.c_str(), nullptr};
+        pid_t pid = -1;
+        int spawned = posix_spawn(&pid, "/bin/sh", &actions, &attr, const_cast<char* const*>(argv), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+
+        // Our copies of the write ends must go, or the readers never see EOF
+        if (out[1] >= 0) close(out[1]);
+        if (err[1] >= 0) close(err[1]);
+
+        int pidfd = spawned == 0 ? static_cast<int>(syscall(SYS_pidfd_open, pid, 0)) : -1;
+        if (spawned == 0 && pidfd < 0) {
+            // Kernel without pidfds (before 5.3): nothing to wait on
+            kill(-pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+        if (pidfd < 0) {
+            if (out[0] >= 0) close(out[0]);
+            if (err[0] >= 0) close(err[0]);
+            return nullptr;
+        }
+
+        std::unique_ptr<PosixChildProcess> child(new PosixChildProcess());
+        child->m_pid = pid;
+        child->m_pidfd = pidfd;
+
+        if (capture) {
+            child->m_onLine = capture->onLine;
+            child->m_output = BoundedTail(capture->maxRetainedBytes);
+            child->m_errorOutput = BoundedTail(capture->maxRetainedBytes);
+            child->m_openStreams = separate ? 2 : 1;
+
+            PosixChildProcess* self = child.get();
+            int readOut = out[0];
+            child->m_reader = std::thread([self, readOut] {
+                self->ReadStream(readOut, OutputSource::Stdout, self->m_output);
+            });
+            if (separate) {
+                int readErr = err[0];
+                child->m_errorReader = std::thread([self, readErr] {
+                    self->ReadStream(readErr, OutputSource::Stderr, self->m_errorOutput);
+                });
+            }
+        }
+        return child;
+    }
+
+    void ReadStream(int fd, OutputSource source, BoundedTail& tail) {
+        LineAssembler lines;
+        auto emit = [this, source](const std::string& line) {
+            std::lock_guard<std::mutex> lock(m_lineMutex);
+            m_onLine(source, line);
+        };
+
+        char buffer[4096];
+        for (;;) {
+            ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
+            if (bytesRead < 0 && errno == EINTR) continue;
+            if (bytesRead <= 0) break;
+            tail.Append(buffer, static_cast<size_t>(bytesRead));
+            if (m_onLine) lines.Feed(buffer, static_cast<size_t>(bytesRead), emit);
+        }
+        if (m_onLine) lines.Flush(emit);
+        close(fd);
+
+        std::lock_guard<std::mutex> lock(m_streamMutex);
+        if (--m_openStreams == 0) m_streamsDone.notify_all();
+    }
+
+    bool StreamsOpen() {
+        std::lock_guard<std::mutex> lock(m_streamMutex);
+        return m_openStreams > 0;
+    }
+
+    void Reap() {
+        while (waitpid(m_pid, &m_status, 0) < 0 && errno == EINTR) {}
+        m_reaped = true;
+    }
+
+    void JoinReaders() {
+        if (m_reader.joinable()) m_reader.join();
+        if (m_errorReader.joinable()) m_errorReader.join();
+    }
+
+    pid_t m_pid;
+    int m_pidfd;
+    bool m_reaped;
+    int m_status;
+    std::mutex m_streamMutex;
+    std::condition_variable m_streamsDone;
+    int m_openStreams;
+    std::thread m_reader;
+    std::thread m_errorReader;
+    OutputLineHandler m_onLine;
+    std::mutex m_lineMutex;
+    BoundedTail m_output;
+    BoundedTail m_errorOutput;
+};
+
+// Wait until one of the children exits. Returns its index, or -1 on
+// timeout or error.
+inline int WaitForAnyPosixChild(const std::vector<PosixChildProcess*>& children, uint32_t timeoutMs) {
+    if (children.empty()) return -1;
+
+    std::vector<pollfd> fds;
+    for (const auto* child : children) fds.push_back({child->NativeHandle(), POLLIN, 0});
+
+    int timeout = timeoutMs == WAIT_NO_TIMEOUT ? -1 : static_cast<int>(std::min<uint32_t>(timeoutMs, INT32_MAX));
+    int ready;
+    while ((ready = poll(fds.data(), fds.size(), timeout)) < 0 && errno == EINTR) {}
+    if (ready <= 0) return -1;
+    for (size_t i = 0; i < fds.size(); i++) {
+        if (fds[i].revents) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+namespace detail {
+
+inline CommandResult WaitForPosixCommand(std::unique_ptr<PosixChildProcess> child, uint32_t timeoutMs) {
+    CommandResult result;
+    if (!child) return result;
+    result.started = true;
+
+    if (!child->Wait(timeoutMs)) {
+        child->Kill();
+        result.timedOut = true;
+    }
+
+    result.exitCode = child->ExitCode();
+    result.output = child->Output();
+    result.errorOutput = child->ErrorOutput();
+    result.droppedBytes = child->DroppedBytes();
+    return result;
+}
+
+} // namespace detail
+
+// Run a command until it exits or timeoutMs passes (see RunCommand)
+inline CommandResult RunPosixCommand(const std::string& command, uint32_t timeoutMs, bool captureOutput) {
+    return detail::WaitForPosixCommand(PosixChildProcess::Start(command, captureOutput), timeoutMs);
+}
+
+inline CommandResult RunPosixCommand(const std::string& command, uint32_t timeoutMs, const CaptureOptions& capture) {
+    return detail::WaitForPosixCommand(PosixChildProcess::Start(command, capture), timeoutMs);
+}
+
+// The /bin/sh counterpart of ShellHost: one long-lived shell in its own
+// process group, fed framed commands (ShellDialect::Posix) over stdin. Each
+// command runs in a subshell, so "exit", cd and variables do not leak into
+// the next one. The shell is started on first use and again after it dies
+// or a command times out.
+class PosixShellHost {
+public:
+    PosixShellHost()
+        : m_pid(-1), m_stdin(-1), m_exited(false),
+          m_marker("__HDD_FRAME_" + std::to_string(getpid()) + "_" + std::to_string(NowMs()) + "_"),
+          m_parser(m_marker), m_seq(0), m_startCount(0) {}
+    ~PosixShellHost() { Stop(); }
+
+    // Run a shell command and wait up to timeoutMs for its end marker.
+    // Output holds stdout and stderr. On timeout the shell is killed.
+    CommandResult Run(const std::string& command, uint32_t timeoutMs) {
+        std::lock_guard<std::mutex> lock(m_runMutex);
+        CommandResult result;
+
+        // A dead shell found before sending is safe to replace and retry;
+        // one that dies mid-command is not, since the command may have run
+        uint32_t seq = ++m_seq;
+        std::string frame = BuildShellFrame(ShellDialect::Posix, m_marker, seq, command);
+        if (!EnsureStarted() || !SendLine(frame)) {
+            Shutdown();
+            if (!EnsureStarted() || !SendLine(frame)) {
+                Shutdown();
+                return result;
+            }
+        }
+        result.started = true;
+
+        std::unique_lock<std::mutex> state(m_stateMutex);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        ShellFrame done;
+        for (;;) {
+            bool found = false;
+            while (m_parser.Next(done)) {
+                if (done.seq == seq) {
+                    found = true;
+                    break;
+                }
+                // Older frames belong to commands that already gave up
+            }
+            if (found) {
+                result.exitCode = done.exitCode;
+                result.output = std::move(done.output);
+                return result;
+            }
+            if (m_exited) break;
+
+            if (timeoutMs == WAIT_NO_TIMEOUT) {
+                m_frameReady.wait(state);
+            } else if (m_frameReady.wait_until(state, deadline) == std::cv_status::timeout) {
+                result.timedOut = true;
+                break;
+            }
+        }
+
+        state.unlock();
+        Shutdown();
+        return result;
+    }
+
+    // Kill the shell; the next Run starts a new one
+    void Stop() {
+        std::lock_guard<std::mutex> lock(m_runMutex);
+        Shutdown();
+    }
+
+    // Number of shell starts so far
+    unsigned int StartCount() const { return m_startCount; }
+
+    PosixShellHost(const PosixShellHost&) = delete;
+    PosixShellHost& operator=(const PosixShellHost&) = delete;
+
+private:
+    static uint64_t NowMs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    bool EnsureStarted() {
+        if (m_pid > 0) {
+            std::lock_guard<std::mutex> state(m_stateMutex);
+            if (!m_exited) return true;
+        }
+        Shutdown();   // Died or never started
+
+        // stdin is a socket so a write to a dead shell fails with EPIPE
+        // (MSG_NOSIGNAL) instead of raising SIGPIPE in this process
+        int in[2];
+        int out[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, in) != 0) return false;
+        if (pipe2(out, O_CLOEXEC) != 0) {
+            close(in[0]);
+            close(in[1]);
+            return false;
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, in[1], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, out[1], STDERR_FILENO);
+
+        posix_spawnattr_t attr;
+        posix_spawnattr_init(&attr);
+        sigset_t all, none;
+        sigfillset(&all);
+        sigemptyset(&none);
+        posix_spawnattr_setsigdefault(&attr, &all);
+        posix_spawnattr_setsigmask(&attr, &none);
+        posix_spawnattr_setpgroup(&attr, 0);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+        const char* argv[] = {"/bin/sh", "-s", nullptr};
+        pid_t pid = -1;
+        int spawned = posix_spawn(&pid, "/bin/sh", &actions, &attr, const_cast<char* const*>(argv), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+        close(in[1]);
+        close(out[1]);
+        if (spawned != 0) {
+            close(in[0]);
+            close(out[0]);
+            return false;
+        }
+
+        m_pid = pid;
+        m_stdin = in[0];
+        m_startCount++;
+
+        int outRead = out[0];
+        m_reader = std::thread([this, outRead] {
+            char buffer[4096];
+            for (;;) {
+                ssize_t bytesRead = read(outRead, buffer, sizeof(buffer));
+                if (bytesRead < 0 && errno == EINTR) continue;
+                if (bytesRead <= 0) break;
+                std::lock_guard<std::mutex> state(m_stateMutex);
+                m_parser.Feed(buffer, static_cast<size_t>(bytesRead));
+                m_frameReady.notify_all();
+            }
+            close(outRead);
+
+            std::lock_guard<std::mutex> state(m_stateMutex);
+            m_exited = true;
+            m_frameReady.notify_all();
+        });
+        return true;
+    }
+
+    bool SendLine(const std::string& line) {
+        size_t sent = 0;
+        while (sent < line.size()) {
+            ssize_t written = send(m_stdin, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) return false;
+            sent += static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    void Shutdown() {
+        if (m_stdin >= 0) {
+            close(m_stdin);
+            m_stdin = -1;
+        }
+        if (m_pid > 0) {
+            kill(-m_pid, SIGKILL);
+            while (waitpid(m_pid, nullptr, 0) < 0 && errno == EINTR) {}
+        }
+        if (m_reader.joinable()) m_reader.join();
+        m_pid = -1;
+
+        std::lock_guard<std::mutex> state(m_stateMutex);
+        m_parser.Reset();
+        m_exited = false;
+    }
+
+    std::mutex m_runMutex;              // One command at a time
+    std::mutex m_stateMutex;            // Guards m_parser and m_exited
+    std::condition_variable m_frameReady;
+    pid_t m_pid;
+    int m_stdin;
+    std::thread m_reader;
+    bool m_exited;
+    std::string m_marker;
+    ShellFrameParser m_parser;
+    uint32_t m_seq;
+    unsigned int m_startCount;
+};
+
+} // namespace core
+} // namespace hdd
+
+#endif // __linux__
+
+#endif // HDD_CORE_PROCESS_POSIX_H
@@ -4,11 +4,161 @@
 #ifndef HDD_CORE_PROCESS_H
 #define HDD_CORE_PROCESS_H
 
+#include "hdd-utils.h"
+#include "core/exe-resolver.h"
+#include "core/output-stream.h"
+#include "core/shell-frame.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace hdd {
 namespace core {
 
+// Which pipe a line of output came from
+enum class OutputSource { Stdout, Stderr };
+
+// Receives output line by line while the child runs.
+// Called on a reader thread, one call at a time.
+typedef std::function<void(OutputSource source, const std::string& line)> OutputLineHandler;
+
+// How a child's output is collected
+struct CaptureOptions {
+    bool separateStderr = false;    // Otherwise stderr is merged into stdout
+    size_t maxRetainedBytes = 0;    // Tail kept per stream; 0 = everything
+    OutputLineHandler onLine;       // Optional live line callback
+};
+
+// A child process started without waiting for it.
+// The child runs in its own job object, so Kill() takes down everything it
+// spawned as well, and so does destroying a ChildProcess that is still running.
+class ChildProcess {
+public:
+    ~ChildProcess();
+
+    // Start a command. With captureOutput, stdout and stderr are collected in
+    // the background. Returns nullptr if the process could not be started.
+    static std::unique_ptr<ChildProcess> Start(const std::string& command, bool captureOutput,
+                                               bool hideWindow = true);
+
+    // Start a command and capture its output as described by capture
+    static std::unique_ptr<ChildProcess> Start(const std::string& command, const CaptureOptions& capture,
+                                               bool hideWindow = true);
+
+    // Wait up to timeoutMs (WAIT_NO_TIMEOUT = forever) for the process to exit
+    // and, when capturing, for its output to be drained. True once finished.
+    bool Wait(uint32_t timeoutMs);
+
+    // Terminate the whole process tree and wait for it to go away
+    void Kill();
+
+    // Exit code once Wait() returned true; 1 if killed
+    int ExitCode() const;
+
+    // Captured (retained) output; complete once Wait() returned true or after Kill()
+    std::string Output() const { return m_output.Str(); }
+    std::string ErrorOutput() const { return m_errorOutput.Str(); }
+
+    // Bytes dropped by maxRetainedBytes across both streams
+    uint64_t DroppedBytes() const { return m_output.Dropped() + m_errorOutput.Dropped(); }
+
+    // Process handle (HANDLE), for WaitForAnyChild
+    void* NativeHandle() const { return m_process; }
+
+    // Non-copyable
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+private:
+    ChildProcess();
+
+    static std::unique_ptr<ChildProcess> Launch(const std::string& command, const CaptureOptions* capture,
+                                                bool hideWindow);
+    void ReadStream(void* pipe, OutputSource source, BoundedTail& tail);
+    void JoinReaders();
+
+    void* m_process;
+    void* m_job;
+    void* m_outputDone;     // Event set when every output pipe is drained (capture only)
+    std::atomic<int> m_openStreams;
+    std::thread m_reader;
+    std::thread m_errorReader;
+    OutputLineHandler m_onLine;
+    std::mutex m_lineMutex;
+    BoundedTail m_output;
+    BoundedTail m_errorOutput;
+};
+
+// Wait until one of the children exits (at most 64)
+// Returns its index, or -1 on timeout or error
+int WaitForAnyChild(const std::vector<ChildProcess*>& children, uint32_t timeoutMs);
+
+// Outcome of RunCommand
+struct CommandResult {
+    bool started = false;
+    bool timedOut = false;      // Deadline hit; the process tree was killed
+    int exitCode = 1;
+    std::string output;         // Only when capturing (stdout, plus stderr unless separated)
+    std::string errorOutput;    // stderr with CaptureOptions::separateStderr
+    uint64_t droppedBytes = 0;  // Output beyond CaptureOptions::maxRetainedBytes
+};
+
+// Run a command until it exits or timeoutMs passes
+CommandResult RunCommand(const std::string& command, uint32_t timeoutMs,
+                         bool captureOutput, bool hideWindow = true);
+
+// Same, streaming output through capture (line callback, bounded retention)
+CommandResult RunCommand(const std::string& command, uint32_t timeoutMs,
+                         const CaptureOptions& capture, bool hideWindow = true);
+
+// One long-lived PowerShell interpreter that runs commands sent over stdin.
+// Pays the interpreter start (300-800 ms) once instead of per command.
+// The interpreter is started on first use and again after it crashes or a
+// command times out. Commands run one at a time in the shared session scope,
+// so they must not call "exit" and should not rely on leftover variables.
+class ShellHost {
+public:
+    ShellHost();
+    ~ShellHost();
+
+    // Run a PowerShell command and wait up to timeoutMs for its end marker.
+    // Output holds stdout and stderr. On timeout the interpreter is killed.
+    CommandResult Run(const std::string& command, uint32_t timeoutMs);
+
+    // Kill the interpreter; the next Run starts a new one
+    void Stop();
+
+    // Number of interpreter starts so far (for diagnostics and bench)
+    unsigned int StartCount() const { return m_startCount; }
+
+    // Non-copyable
+    ShellHost(const ShellHost&) = delete;
+    ShellHost& operator=(const ShellHost&) = delete;
+
+private:
+    bool EnsureStarted();
+    bool SendLine(const std::string& line);
+    void Shutdown();
+
+    std::mutex m_runMutex;              // One command at a time
+    std::mutex m_stateMutex;            // Guards m_parser and m_exited
+    std::condition_variable m_frameReady;
+    void* m_process;
+    void* m_job;
+    void* m_stdin;
+    std::thread m_reader;
+    bool m_exited;
+    std::string m_marker;
+    ShellFrameParser m_parser;
+    uint32_t m_seq;
+    unsigned int m_startCount;
+};
+
 // Execute a command and wait for completion
 // Returns the exit code of the process
 // If hideWindow is true, the process runs without a visible window
@@ -18,13 +168,22 @@ int ExecuteCommand(const std::string& command, bool hideWindow = true);
 // Returns the exit code, and fills output with stdout content
 int ExecuteCommandWithOutput(const std::string& command, std::string& output, bool hideWindow = true);
 
+// Number of child processes this process has started so far
+// Every launch path (ExecuteCommand*, RunElevated) counts; wake and sleep
+// report it so helper processes creeping back in are easy to spot
+unsigned long GetSpawnedProcessCount();
+
+// Record a child process started outside ExecuteCommand*
+void CountSpawnedProcess();
+
 // Get the directory containing the current executable
 std::string GetExeDirectory();
 
 // Get the full path to the current executable
 std::string GetExePath();
 
-// Find an executable on PATH or in current directory
+// Find an executable in the exe directory, the current directory or on PATH
+// Results (including misses) are cached; see core/exe-resolver.h
 // Returns empty string if not found
 std::string FindExecutable(const std::string& name);
 
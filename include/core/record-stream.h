@@ -0,0 +1,171 @@
+#pragma once
+// Record-oriented helper output for HDD Toggle
+// A helper that reports structured results prints one record per line with
+// '|'-separated fields ("1|ST4000DM004-2CV104|ZFN0A1B2"). The records are
+// parsed as they come through the pipe, so there is no temp file to poll
+// and no clash between two instances in the same directory. The parser is
+// pure; RunRecordCommand runs the helper through RunCommand on Windows and
+// RunPosixCommand (/bin/sh) on Linux.
+
+#ifndef HDD_CORE_RECORD_STREAM_H
+#define HDD_CORE_RECORD_STREAM_H
+
+#include "hdd-utils.h"
+#include "core/process.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include "core/process-posix.h"
+#endif
+
+namespace hdd {
+namespace core {
+
+constexpr char RECORD_SEPARATOR = '|';
+
+// Raw output kept from a record helper for logging; the records themselves
+// are parsed live and do not count against it
+constexpr size_t RECORD_RETAINED_BYTES = 4096;
+
+// Split a record line into trimmed fields. False unless it has exactly
+// fieldCount fields (any number when fieldCount is 0).
+inline bool SplitRecord(const std::string& line, size_t fieldCount, std::vector<std::string>& fields,
+                        char separator = RECORD_SEPARATOR) {
+    fields.clear();
+    size_t start = 0;
+    for (;;) {
+        size_t end = line.find(separator, start);
+        if (end == std::string::npos) end = line.size();
+        fields.push_back(TrimWhitespace(line.substr(start, end - start)));
+        if (end == line.size()) break;
+        start = end + 1;
+    }
+    return fieldCount == 0 || fields.size() == fieldCount;
+}
+
+// Typed field conversions. False if the field is not entirely a value of
+// that type; the output is left alone then.
+inline bool ParseRecordField(const std::string& field, std::string& value) {
+    value = field;
+    return true;
+}
+
+inline bool ParseRecordField(const std::string& field, int64_t& value) {
+    if (field.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    long long parsed = strtoll(field.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE) return false;
+    value = static_cast<int64_t>(parsed);
+    return true;
+}
+
+inline bool ParseRecordField(const std::string& field, int& value) {
+    int64_t parsed = 0;
+    if (!ParseRecordField(field, parsed) || parsed < INT32_MIN || parsed > INT32_MAX) return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+inline bool ParseRecordField(const std::string& field, uint64_t& value) {
+    if (field.empty() || field[0] == '-') return false;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = strtoull(field.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE) return false;
+    value = static_cast<uint64_t>(parsed);
+    return true;
+}
+
+// "1"/"0" and "true"/"false" in any case (PowerShell prints "True")
+inline bool ParseRecordField(const std::string& field, bool& value) {
+    if (field == "1" || EqualsIgnoreCase(field, "true")) {
+        value = true;
+    } else if (field == "0" || EqualsIgnoreCase(field, "false")) {
+        value = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Collects typed records from a stream of lines. parse turns the fields of
+// one line into a Record and returns false to reject it. Blank lines are
+// skipped; lines with the wrong field count or rejected by parse are counted
+// as malformed.
+template <typename Record>
+class RecordCollector {
+public:
+    typedef std::function<bool(const std::vector<std::string>& fields, Record& record)> Parser;
+
+    RecordCollector(size_t fieldCount, Parser parse)
+        : m_fieldCount(fieldCount), m_parse(std::move(parse)), m_malformed(0) {}
+
+    void AddLine(const std::string& line) {
+        if (TrimWhitespace(line).empty()) return;
+
+        Record record;
+        if (SplitRecord(line, m_fieldCount, m_fields) && m_parse(m_fields, record)) {
+            m_records.push_back(std::move(record));
+        } else {
+            m_malformed++;
+        }
+    }
+
+    const std::vector<Record>& Records() const { return m_records; }
+    std::vector<Record> TakeRecords() { return std::move(m_records); }
+    size_t MalformedLines() const { return m_malformed; }
+
+private:
+    size_t m_fieldCount;
+    Parser m_parse;
+    std::vector<std::string> m_fields;   // Reused between lines
+    std::vector<Record> m_records;
+    size_t m_malformed;
+};
+
+// Outcome of RunRecordCommand
+template <typename Record>
+struct RecordCommandResult {
+    CommandResult command;          // output holds only the last RECORD_RETAINED_BYTES
+    std::vector<Record> records;    // Complete even when the helper timed out
+    size_t malformedLines = 0;
+};
+
+// Run a helper and parse its stdout as records while it runs. stderr is
+// kept apart and never parsed. Records received before a timeout are kept.
+template <typename Record>
+RecordCommandResult<Record> RunRecordCommand(const std::string& command, uint32_t timeoutMs, size_t fieldCount,
+                                             typename RecordCollector<Record>::Parser parse) {
+    RecordCollector<Record> collector(fieldCount, std::move(parse));
+
+    // The line callback runs on the stdout reader thread, one line at a time;
+    // the runner joins the readers before returning
+    CaptureOptions capture;
+    capture.separateStderr = true;
+    capture.maxRetainedBytes = RECORD_RETAINED_BYTES;
+    capture.onLine = [&collector](OutputSource source, const std::string& line) {
+        if (source == OutputSource::Stdout) collector.AddLine(line);
+    };
+
+    RecordCommandResult<Record> result;
+#ifdef __linux__
+    result.command = RunPosixCommand(command, timeoutMs, capture);
+#else
+    result.command = RunCommand(command, timeoutMs, capture);
+#endif
+    result.malformedLines = collector.MalformedLines();
+    result.records = collector.TakeRecords();
+    return result;
+}
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_RECORD_STREAM_H
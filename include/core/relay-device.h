@@ -0,0 +1,51 @@
+#pragma once
+// Relay access for HDD Toggle
+// Windows transports (DCT Tech USB HID relay, LCUS serial board) and the
+// process-wide connection
+
+#ifndef HDD_CORE_RELAY_DEVICE_H
+#define HDD_CORE_RELAY_DEVICE_H
+
+#include "core/relay-sequence.h"
+#include "core/relay-session.h"
+#include <memory>
+#include <string>
+
+namespace hdd {
+namespace core {
+
+// HID transport: finds the relay by VID/PID with SetupDi, opening only
+// interfaces whose path could be the relay, and keeps its device path, so
+// reopening after a stale handle skips the enumeration
+std::unique_ptr<RelayTransport> CreateHidRelayTransport();
+
+// Serial transport for an LCUS board on a COM port ("COM3")
+std::unique_ptr<RelayTransport> CreateSerialRelayTransport(const std::string& portName);
+
+// Transport selected by [Relay] Type (hid or serial)
+std::unique_ptr<RelayTransport> CreateRelayTransport();
+
+// Shared connection used by the relay command, wake, sleep and the tray
+RelayConnection& GetRelayConnection();
+
+// Sequence clock on QueryPerformanceCounter and a high-resolution waitable
+// timer (falls back to a regular timer before Windows 10 1803)
+std::unique_ptr<SequenceClock> CreatePrecisionClock();
+
+// Interfaces seen and opened by one enumeration
+struct RelayScanStats {
+    unsigned long interfaces = 0;
+    unsigned long opened = 0;
+};
+
+// One full HID enumeration looking for the relay, with or without the
+// path prefilter (bench). True if the relay was found.
+bool ScanForRelay(bool prefilter, RelayScanStats& stats);
+
+// Number of full HID enumerations this process has done (bench/diagnostics)
+unsigned long GetRelayEnumerationCount();
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_RELAY_DEVICE_H
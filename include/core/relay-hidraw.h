@@ -0,0 +1,204 @@
+#pragma once
+// Linux hidraw transport for the DCT Tech relay
+// Finds the relay's /dev/hidrawN node through the HID_ID line of
+// /sys/class/hidraw/*/device/uevent and exchanges feature reports with
+// HIDIOCSFEATURE / HIDIOCGFEATURE. Device I/O goes through HidrawIo, so
+// tests can stand in a fake relay that records reports. The uevent parser
+// is platform-neutral.
+
+#ifndef HDD_CORE_RELAY_HIDRAW_H
+#define HDD_CORE_RELAY_HIDRAW_H
+
+#include "core/relay-session.h"
+#include "hdd-utils.h"
+#include <cstdlib>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/hidraw.h>
+#include <vector>
+#endif
+
+namespace hdd {
+namespace core {
+
+// Parse "HID_ID=0003:000016C0:000005DF" (bus:vendor:product, hex) out of a
+// uevent file. Returns false if the line is missing or malformed.
+inline bool ParseHidIdUevent(const std::string& uevent, unsigned short& vendorId, unsigned short& productId) {
+    size_t pos = 0;
+    while (pos < uevent.size()) {
+        size_t end = uevent.find('\n', pos);
+        if (end == std::string::npos) end = uevent.size();
+        std::string line = TrimWhitespace(uevent.substr(pos, end - pos));
+        pos = end + 1;
+
+        if (!StartsWith(line, "HID_ID=")) continue;
+
+        const char* text = line.c_str() + 7;
+        char* next = nullptr;
+        strtoul(text, &next, 16);                   // Bus type
+        if (next == text || *next != ':') return false;
+
+        text = next + 1;
+        unsigned long vendor = strtoul(text, &next, 16);
+        if (next == text || *next != ':') return false;
+
+        text = next + 1;
+        unsigned long product = strtoul(text, &next, 16);
+        if (next == text || *next != '\0' || vendor > 0xFFFF || product > 0xFFFF) return false;
+
+        vendorId = static_cast<unsigned short>(vendor);
+        productId = static_cast<unsigned short>(product);
+        return true;
+    }
+    return false;
+}
+
+#ifdef __linux__
+
+// Raw device access used by the hidraw transport
+class HidrawIo {
+public:
+    virtual ~HidrawIo() = default;
+
+    // Open a device node read/write; returns a descriptor or -1 (errno set)
+    virtual int Open(const std::string& path) = 0;
+
+    virtual void Close(int fd) = 0;
+
+    // HIDIOCSFEATURE / HIDIOCGFEATURE; return bytes transferred or -1 (errno set)
+    virtual int SetFeature(int fd, const unsigned char* report, size_t size) = 0;
+    virtual int GetFeature(int fd, unsigned char* report, size_t size) = 0;
+};
+
+// The real thing: open(2) and ioctl(2)
+class SystemHidrawIo : public HidrawIo {
+public:
+    int Open(const std::string& path) override {
+        return open(path.c_str(), O_RDWR | O_CLOEXEC);
+    }
+
+    void Close(int fd) override {
+        close(fd);
+    }
+
+    int SetFeature(int fd, const unsigned char* report, size_t size) override {
+        std::vector<unsigned char> buffer(report, report + size);   // ioctl wants it writable
+        return ioctl(fd, HIDIOCSFEATURE(size), buffer.data());
+    }
+
+    int GetFeature(int fd, unsigned char* report, size_t size) override {
+        return ioctl(fd, HIDIOCGFEATURE(size), report);
+    }
+};
+
+// Name of the first hidraw node ("hidraw3") whose uevent matches vendor and
+// product, or "" if none. sysClassDir is normally /sys/class/hidraw.
+inline std::string FindHidrawNode(const std::string& sysClassDir,
+                                  unsigned short vendorId, unsigned short productId) {
+    DIR* dir = opendir(sysClassDir.c_str());
+    if (!dir) return "";
+
+    std::string found;
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (!StartsWith(name, "hidraw")) continue;
+
+        std::ifstream file(sysClassDir + "/" + name + "/device/uevent");
+        if (!file) continue;
+        std::stringstream contents;
+        contents << file.rdbuf();
+
+        unsigned short vendor = 0, product = 0;
+        if (ParseHidIdUevent(contents.str(), vendor, product) &&
+            vendor == vendorId && product == productId) {
+            found = name;
+            break;
+        }
+    }
+
+    closedir(dir);
+    return found;
+}
+
+// Relay transport over /dev/hidrawN. Remembers the node name so reopening
+// skips the sysfs scan until the node stops working.
+class HidrawRelayTransport : public RelayTransport {
+public:
+    explicit HidrawRelayTransport(HidrawIo& io,
+                                  const std::string& sysClassDir = "/sys/class/hidraw",
+                                  const std::string& devDir = "/dev")
+        : m_io(io), m_sysClassDir(sysClassDir), m_devDir(devDir), m_fd(-1), m_scans(0) {}
+
+    ~HidrawRelayTransport() override { Close(); }
+
+    bool Open() override {
+        Close();
+
+        if (!m_node.empty()) {
+            m_fd = m_io.Open(m_devDir + "/" + m_node);
+            if (m_fd >= 0) return true;
+            m_node.clear();   // Replugged and renumbered, or gone
+        }
+
+        m_scans++;
+        m_node = FindHidrawNode(m_sysClassDir, RELAY_VENDOR_ID, RELAY_PRODUCT_ID);
+        if (m_node.empty()) return false;
+
+        m_fd = m_io.Open(m_devDir + "/" + m_node);
+        return m_fd >= 0;
+    }
+
+    void Close() override {
+        if (m_fd >= 0) {
+            m_io.Close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    void ForgetDevice() override {
+        m_node.clear();
+    }
+
+    RelayIoStatus SetFeature(const unsigned char* report, size_t size) override {
+        if (m_io.SetFeature(m_fd, report, size) >= 0) return RelayIoStatus::Ok;
+        return IsDisconnectError(errno) ? RelayIoStatus::Disconnected : RelayIoStatus::Failed;
+    }
+
+    RelayIoStatus GetFeature(unsigned char* report, size_t size) override {
+        if (m_io.GetFeature(m_fd, report, size) >= 0) return RelayIoStatus::Ok;
+        return IsDisconnectError(errno) ? RelayIoStatus::Disconnected : RelayIoStatus::Failed;
+    }
+
+    // Node in use ("hidraw3"), empty until found
+    const std::string& Node() const { return m_node; }
+
+    // Number of sysfs scans so far
+    unsigned int ScanCount() const { return m_scans; }
+
+private:
+    static bool IsDisconnectError(int error) {
+        return error == ENODEV || error == ENXIO || error == EBADF || error == ENOENT || error == EPIPE;
+    }
+
+    HidrawIo& m_io;
+    std::string m_sysClassDir;
+    std::string m_devDir;
+    std::string m_node;
+    int m_fd;
+    unsigned int m_scans;
+};
+
+#endif // __linux__
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_RELAY_HIDRAW_H
@@ -0,0 +1,115 @@
+#pragma once
+// Relay firmware protocols for HDD Toggle
+// Compile-time description of a HID relay's feature reports: report size,
+// channel count, command encoding and where the channel bits come back.
+// RelayProtocol<N> covers the common 1/2/4/8-channel boards; the rest of
+// the relay code is written against ActiveRelayProtocol.
+
+#ifndef HDD_CORE_RELAY_PROTOCOL_H
+#define HDD_CORE_RELAY_PROTOCOL_H
+
+#include "hdd-toggle.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace hdd {
+namespace core {
+
+// DCT Tech / ucreatefun "USBRelayN" boards (VID 16C0, PID 05DF). Every size
+// uses the same 8-byte feature report (plus report ID): one command for a
+// single channel or one for all channels, with no command for an arbitrary
+// subset. GetFeature returns the 5-character serial, two reserved bytes and
+// the channel bits.
+template <unsigned N>
+struct DctHidRelayProtocol {
+    static_assert(N >= 1 && N <= 8, "DCT Tech relays have 1 to 8 channels");
+
+    static constexpr unsigned Channels = N;
+    static constexpr size_t ReportSize = 9;
+    static constexpr size_t StateOffset = 8;
+    static constexpr bool HasMaskCommand = false;
+
+    typedef std::array<unsigned char, ReportSize> Report;
+
+    static constexpr uint8_t AllChannels() { return static_cast<uint8_t>((1u << N) - 1); }
+
+    // Firmware command bytes: 0xFE = all on, 0xFC = all off,
+    // 0xFF = one on, 0xFD = one off (channel number in the next byte)
+    static void EncodeAll(bool on, unsigned char* report) {
+        memset(report, 0, ReportSize);
+        report[1] = on ? 0xFE : 0xFC;
+    }
+
+    // channel is 1-based
+    static void EncodeChannel(unsigned channel, bool on, unsigned char* report) {
+        memset(report, 0, ReportSize);
+        report[1] = on ? 0xFF : 0xFD;
+        report[2] = static_cast<unsigned char>(channel);
+    }
+
+    static uint8_t ParseState(const unsigned char* report) {
+        return static_cast<uint8_t>(report[StateOffset] & AllChannels());
+    }
+};
+
+// Protocol by channel count
+template <unsigned Channels>
+struct RelayProtocol;
+
+template <> struct RelayProtocol<1> : DctHidRelayProtocol<1> {};
+template <> struct RelayProtocol<2> : DctHidRelayProtocol<2> {};
+template <> struct RelayProtocol<4> : DctHidRelayProtocol<4> {};
+template <> struct RelayProtocol<8> : DctHidRelayProtocol<8> {};
+
+// The board this build drives
+typedef RelayProtocol<RELAY_CHANNEL_COUNT> ActiveRelayProtocol;
+static_assert(ActiveRelayProtocol::ReportSize == RELAY_REPORT_SIZE, "RELAY_REPORT_SIZE does not match the protocol");
+
+// Reports that take the board from current to having every channel in mask
+// set to on. Channels already there are left alone when current is known.
+// Uses one report where the firmware allows it: the all-channels command
+// when every channel ends up alike, else a bitmask command
+// (HasMaskCommand, EncodeMask(bits, report)) if the firmware has one.
+template <typename Protocol>
+std::vector<typename Protocol::Report> PlanRelayReports(uint8_t mask, bool on, uint8_t current, bool currentKnown) {
+    typedef typename Protocol::Report Report;
+    std::vector<Report> reports;
+
+    mask = static_cast<uint8_t>(mask & Protocol::AllChannels());
+    uint8_t target = static_cast<uint8_t>(on ? (current | mask) : (current & ~mask));
+    uint8_t changed = currentKnown ? static_cast<uint8_t>((current ^ target) & mask) : mask;
+    if (changed == 0) return reports;
+
+    Report report;
+    if (mask == Protocol::AllChannels() ||
+        (currentKnown && target == (on ? Protocol::AllChannels() : 0))) {
+        Protocol::EncodeAll(on, report.data());
+        reports.push_back(report);
+        return reports;
+    }
+
+    if constexpr (Protocol::HasMaskCommand) {
+        // Sets every channel, so only usable when the others are known
+        if (currentKnown) {
+            Protocol::EncodeMask(target, report.data());
+            reports.push_back(report);
+            return reports;
+        }
+    }
+
+    for (unsigned channel = 1; channel <= Protocol::Channels; channel++) {
+        if (changed & (1u << (channel - 1))) {
+            Protocol::EncodeChannel(channel, on, report.data());
+            reports.push_back(report);
+        }
+    }
+    return reports;
+}
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_RELAY_PROTOCOL_H
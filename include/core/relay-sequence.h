@@ -0,0 +1,225 @@
+#pragma once
+// Timed relay sequences for HDD Toggle
+// An ordered list of channel switches with millisecond gaps, run on one
+// open relay connection against an absolute schedule, so write latency
+// does not add up between steps. Platform-neutral: the Windows
+// high-resolution clock lives in relay-device.cpp, and tests use a fake one.
+
+#ifndef HDD_CORE_RELAY_SEQUENCE_H
+#define HDD_CORE_RELAY_SEQUENCE_H
+
+#include "core/relay-session.h"
+#include "hdd-utils.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hdd {
+namespace core {
+
+// Longest single gap between two steps
+constexpr uint32_t RELAY_SEQUENCE_MAX_DELAY_MS = 60000;
+
+// One switch in a sequence
+struct RelayStep {
+    int channel = 0;            // 0 = all relays
+    bool on = false;
+    uint32_t delayMs = 0;       // Wait after the previous step (or the start)
+};
+
+// Parse a sequence spec: steps "<N|all>:<on|off>" separated by spaces or
+// commas, with a number of milliseconds ("200" or "200ms") between two steps
+// to wait that long. Example: "2:on 200 1:on".
+inline bool ParseRelaySequence(const std::string& spec, std::vector<RelayStep>& steps, std::string& error) {
+    steps.clear();
+    uint32_t pendingDelay = 0;
+    bool delayPending = false;
+
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t end = spec.find_first_of(" \t,", pos);
+        if (end == std::string::npos) end = spec.size();
+        std::string token = spec.substr(pos, end - pos);
+        pos = end + 1;
+        if (token.empty()) continue;
+
+        size_t colon = token.find(':');
+        if (colon == std::string::npos) {
+            std::string number = token;
+            if (number.size() > 2 && EqualsIgnoreCase(number.substr(number.size() - 2), "ms")) {
+                number.resize(number.size() - 2);
+            }
+            char* next = nullptr;
+            unsigned long delay = strtoul(number.c_str(), &next, 10);
+            if (number.empty() || *next != '\0' || number[0] == '-' ||
+                delay > RELAY_SEQUENCE_MAX_DELAY_MS ||
+                pendingDelay + delay > RELAY_SEQUENCE_MAX_DELAY_MS) {
+                error = "Invalid delay '" + token + "' (0 to " +
+                        std::to_string(RELAY_SEQUENCE_MAX_DELAY_MS) + " ms)";
+                return false;
+            }
+            pendingDelay += static_cast<uint32_t>(delay);
+            delayPending = true;
+            continue;
+        }
+
+        RelayStep step;
+        std::string channel = token.substr(0, colon);
+        std::string state = token.substr(colon + 1);
+
+        if (EqualsIgnoreCase(channel, "all")) {
+            step.channel = 0;
+        } else {
+            char* next = nullptr;
+            long number = strtol(channel.c_str(), &next, 10);
+            if (channel.empty() || *next != '\0' || number < 1 || number > RELAY_CHANNEL_COUNT) {
+                error = "Invalid relay '" + channel + "' in '" + token + "' (use " + RelayChannelChoices() + ")";
+                return false;
+            }
+            step.channel = static_cast<int>(number);
+        }
+
+        if (EqualsIgnoreCase(state, "on")) step.on = true;
+        else if (EqualsIgnoreCase(state, "off")) step.on = false;
+        else {
+            error = "Invalid state '" + state + "' in '" + token + "' (use on or off)";
+            return false;
+        }
+
+        step.delayMs = pendingDelay;
+        pendingDelay = 0;
+        delayPending = false;
+        steps.push_back(step);
+    }
+
+    if (steps.empty()) {
+        error = "Sequence has no steps";
+        return false;
+    }
+    if (delayPending) {
+        error = "Sequence ends with a delay";
+        return false;
+    }
+    return true;
+}
+
+// Back to spec form ("2:on 200 1:on")
+inline std::string FormatRelaySequence(const std::vector<RelayStep>& steps) {
+    std::string spec;
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (i > 0) spec += ' ';
+        if (steps[i].delayMs > 0) spec += std::to_string(steps[i].delayMs) + ' ';
+        spec += (steps[i].channel == 0 ? std::string("all") : std::to_string(steps[i].channel));
+        spec += steps[i].on ? ":on" : ":off";
+    }
+    return spec;
+}
+
+// The same switches undone in reverse order with the same gaps, e.g. the
+// power-down that matches a power-up sequence
+inline std::vector<RelayStep> ReverseRelaySequence(const std::vector<RelayStep>& steps) {
+    std::vector<RelayStep> reversed;
+    for (size_t i = steps.size(); i-- > 0;) {
+        RelayStep step = steps[i];
+        step.on = !step.on;
+        step.delayMs = i + 1 < steps.size() ? steps[i + 1].delayMs : 0;
+        reversed.push_back(step);
+    }
+    return reversed;
+}
+
+// Monotonic time source and sleeper for running a sequence
+class SequenceClock {
+public:
+    virtual ~SequenceClock() = default;
+
+    virtual int64_t NowUs() = 0;
+
+    // Return as close to deadline (NowUs scale) as possible, never early
+    virtual void SleepUntilUs(int64_t deadlineUs) = 0;
+};
+
+// Portable clock: sleeps until shortly before the deadline, then spins.
+// Only as precise as the OS sleep; Windows uses its own high-resolution one.
+class SteadySequenceClock : public SequenceClock {
+public:
+    explicit SteadySequenceClock(int64_t spinUs = 2000) : m_spinUs(spinUs) {}
+
+    int64_t NowUs() override {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void SleepUntilUs(int64_t deadlineUs) override {
+        int64_t remaining = deadlineUs - NowUs();
+        if (remaining > m_spinUs) {
+            std::this_thread::sleep_for(std::chrono::microseconds(remaining - m_spinUs));
+        }
+        while (NowUs() < deadlineUs) std::this_thread::yield();
+    }
+
+private:
+    int64_t m_spinUs;
+};
+
+// Timing of one executed step, relative to the sequence start
+struct RelayStepTiming {
+    int64_t plannedUs = 0;
+    int64_t issuedUs = 0;       // Write started
+    int64_t doneUs = 0;         // Write (and readback) finished
+    RelaySwitchResult result = RelaySwitchResult::Failed;
+
+    int64_t ErrorUs() const { return issuedUs - plannedUs; }
+};
+
+struct RelaySequenceResult {
+    bool ok = false;
+    std::vector<RelayStepTiming> steps;     // Executed steps; stops at the first failure
+
+    // Largest lateness of any step against its planned time
+    int64_t MaxErrorUs() const {
+        int64_t worst = 0;
+        for (const auto& step : steps) {
+            if (step.ErrorUs() > worst) worst = step.ErrorUs();
+        }
+        return worst;
+    }
+};
+
+// Run steps on the connection. Each step is due at the sum of the delays up
+// to it, measured from the first step, so a slow write does not push later
+// steps back. The device is opened and its state read before the clock
+// starts, so the first step is not late by the lookup.
+inline RelaySequenceResult RunRelaySequence(RelayConnection& relay, const std::vector<RelayStep>& steps,
+                                            SequenceClock& clock) {
+    RelaySequenceResult result;
+    uint8_t mask = 0;
+    relay.GetState(mask, true);
+
+    int64_t start = clock.NowUs();
+    int64_t planned = 0;
+    for (const auto& step : steps) {
+        planned += static_cast<int64_t>(step.delayMs) * 1000;
+        clock.SleepUntilUs(start + planned);
+
+        RelayStepTiming timing;
+        timing.plannedUs = planned;
+        timing.issuedUs = clock.NowUs() - start;
+        timing.result = relay.Switch(step.channel, step.on);
+        timing.doneUs = clock.NowUs() - start;
+        result.steps.push_back(timing);
+
+        if (timing.result == RelaySwitchResult::Failed) return result;
+    }
+
+    result.ok = true;
+    return result;
+}
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_RELAY_SEQUENCE_H
@@ -0,0 +1,289 @@
+#pragma once
+// Serial relay transport for HDD Toggle
+// Drives CH340-based "LCUS" relay boards, which take 4-byte frames
+// (A0 <channel> <state> <sum>) on a 9600 baud serial port instead of HID
+// feature reports. The port stays open between switches, unless the
+// platform locks it (Windows COM ports), and writes never wait on the
+// board. Port access goes through SerialPort: the Windows COM port lives in
+// relay-device.cpp, the POSIX one is here so tests can play the board on a
+// pseudo-terminal.
+
+#ifndef HDD_CORE_RELAY_SERIAL_H
+#define HDD_CORE_RELAY_SERIAL_H
+
+#include "core/relay-session.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace hdd {
+namespace core {
+
+constexpr unsigned int RELAY_SERIAL_BAUD = 9600;
+constexpr size_t LCUS_FRAME_SIZE = 4;
+
+// How long to wait for a board's acknowledgement. Boards that never answer
+// are detected on the first switch and not waited on again.
+constexpr uint32_t LCUS_ACK_TIMEOUT_MS = 50;
+
+// Bound on a write the port cannot take at once (output buffer full)
+constexpr uint32_t SERIAL_WRITE_TIMEOUT_MS = 200;
+
+typedef std::array<unsigned char, LCUS_FRAME_SIZE> LcusFrame;
+
+// Frame switching one channel (1-based): A0 01 01 A2 = relay 1 on
+inline LcusFrame BuildLcusFrame(int channel, bool on) {
+    LcusFrame frame;
+    frame[0] = 0xA0;
+    frame[1] = static_cast<unsigned char>(channel);
+    frame[2] = on ? 0x01 : 0x00;
+    frame[3] = static_cast<unsigned char>(frame[0] + frame[1] + frame[2]);
+    return frame;
+}
+
+// Check the header and checksum of a received frame
+inline bool IsValidLcusFrame(const unsigned char* data, size_t size) {
+    return size == LCUS_FRAME_SIZE && data[0] == 0xA0 && data[2] <= 0x01 &&
+           data[3] == static_cast<unsigned char>(data[0] + data[1] + data[2]);
+}
+
+// LCUS frames equivalent to one ActiveRelayProtocol report, so the serial
+// board runs behind the same RelayConnection. The board has no
+// all-channels command, so "all" becomes one frame per channel.
+inline bool LcusFramesForReport(const unsigned char* report, size_t size, std::vector<LcusFrame>& frames) {
+    frames.clear();
+    if (size < 3) return false;
+
+    switch (report[1]) {
+        case 0xFE:
+        case 0xFC:
+            for (int channel = 1; channel <= RELAY_CHANNEL_COUNT; channel++) {
+                frames.push_back(BuildLcusFrame(channel, report[1] == 0xFE));
+            }
+            return true;
+        case 0xFF:
+        case 0xFD:
+            if (report[2] < 1 || report[2] > RELAY_CHANNEL_COUNT) return false;
+            frames.push_back(BuildLcusFrame(report[2], report[1] == 0xFF));
+            return true;
+        default:
+            return false;
+    }
+}
+
+// A serial port opened once and configured for the board
+class SerialPort {
+public:
+    virtual ~SerialPort() = default;
+
+    // Open and configure (RELAY_SERIAL_BAUD, 8N1, raw, non-blocking)
+    virtual bool Open(const std::string& name) = 0;
+
+    // Must be safe to call when not open
+    virtual void Close() = 0;
+
+    // Hand bytes to the driver without waiting for them to go out
+    virtual RelayIoStatus Write(const unsigned char* data, size_t size) = 0;
+
+    // Read what arrives within timeoutMs (0 = only what is already there).
+    // Returns the byte count, or -1 if the port is gone.
+    virtual int Read(unsigned char* buffer, size_t size, uint32_t timeoutMs) = 0;
+
+    // True if the last failed Open found the port held by another process
+    virtual bool IsBusy() const { return false; }
+
+    // True if an open port locks out other processes (see RelayTransport)
+    virtual bool IsExclusive() const { return false; }
+};
+
+// Relay transport over an LCUS board. Relay state cannot be read back, so
+// switches through it are reported as unverified.
+class SerialRelayTransport : public RelayTransport {
+public:
+    enum class AckMode {
+        Unknown,    // Not seen yet: wait once to find out
+        Acks,       // Board echoes each frame
+        Silent      // Board never answers
+    };
+
+    SerialRelayTransport(SerialPort& port, const std::string& portName)
+        : m_port(port), m_portName(portName), m_open(false), m_ackMode(AckMode::Unknown) {}
+
+    ~SerialRelayTransport() override { Close(); }
+
+    bool Open() override {
+        Close();
+        m_open = m_port.Open(m_portName);
+        return m_open;
+    }
+
+    void Close() override {
+        if (m_open) {
+            m_port.Close();
+            m_open = false;
+        }
+    }
+
+    // A COM port name does not move, so there is nothing to forget
+    void ForgetDevice() override {}
+
+    RelayIoStatus SetFeature(const unsigned char* report, size_t size) override {
+        std::vector<LcusFrame> frames;
+        if (!LcusFramesForReport(report, size, frames)) return RelayIoStatus::Failed;
+
+        for (const auto& frame : frames) {
+            // Drop stray bytes so they are not taken for this frame's ack
+            unsigned char stale[32];
+            while (true) {
+                int count = m_port.Read(stale, sizeof(stale), 0);
+                if (count < 0) return RelayIoStatus::Disconnected;
+                if (count == 0) break;
+            }
+
+            RelayIoStatus status = m_port.Write(frame.data(), frame.size());
+            if (status != RelayIoStatus::Ok) return status;
+
+            status = ReadAck(frame);
+            if (status != RelayIoStatus::Ok) return status;
+        }
+        return RelayIoStatus::Ok;
+    }
+
+    RelayIoStatus GetFeature(unsigned char*, size_t) override {
+        return RelayIoStatus::Failed;
+    }
+
+    bool IsBusy() const override { return m_port.IsBusy(); }
+    bool IsExclusive() const override { return m_port.IsExclusive(); }
+
+    AckMode GetAckMode() const { return m_ackMode; }
+
+private:
+    RelayIoStatus ReadAck(const LcusFrame& frame) {
+        if (m_ackMode == AckMode::Silent) return RelayIoStatus::Ok;
+
+        unsigned char ack[LCUS_FRAME_SIZE];
+        size_t received = 0;
+        while (received < LCUS_FRAME_SIZE) {
+            int count = m_port.Read(ack + received, LCUS_FRAME_SIZE - received, LCUS_ACK_TIMEOUT_MS);
+            if (count < 0) return RelayIoStatus::Disconnected;
+            if (count == 0) break;
+            received += static_cast<size_t>(count);
+        }
+
+        if (received == 0) {
+            if (m_ackMode == AckMode::Unknown) {
+                m_ackMode = AckMode::Silent;
+                return RelayIoStatus::Ok;
+            }
+            return RelayIoStatus::Failed;   // Stopped answering
+        }
+
+        bool matches = IsValidLcusFrame(ack, received) &&
+                       std::equal(frame.begin(), frame.end(), ack);
+        if (matches) m_ackMode = AckMode::Acks;
+        return matches ? RelayIoStatus::Ok : RelayIoStatus::Failed;
+    }
+
+    SerialPort& m_port;
+    std::string m_portName;
+    bool m_open;
+    AckMode m_ackMode;
+};
+
+#ifndef _WIN32
+
+// termios serial port, e.g. /dev/ttyUSB0 (or a pty in tests)
+class PosixSerialPort : public SerialPort {
+public:
+    PosixSerialPort() : m_fd(-1), m_busy(false) {}
+    ~PosixSerialPort() override { Close(); }
+
+    bool Open(const std::string& name) override {
+        Close();
+        m_fd = open(name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        m_busy = m_fd < 0 && errno == EBUSY;   // Another process set TIOCEXCL
+        if (m_fd < 0) return false;
+
+        termios options;
+        if (tcgetattr(m_fd, &options) != 0) {
+            Close();
+            return false;
+        }
+        cfmakeraw(&options);
+        cfsetispeed(&options, B9600);
+        cfsetospeed(&options, B9600);
+        options.c_cflag |= CLOCAL | CREAD;
+        options.c_cc[VMIN] = 0;
+        options.c_cc[VTIME] = 0;
+        if (tcsetattr(m_fd, TCSANOW, &options) != 0) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() override {
+        if (m_fd >= 0) {
+            close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    RelayIoStatus Write(const unsigned char* data, size_t size) override {
+        size_t written = 0;
+        while (written < size) {
+            ssize_t count = write(m_fd, data + written, size - written);
+            if (count > 0) {
+                written += static_cast<size_t>(count);
+            } else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                pollfd pfd = {m_fd, POLLOUT, 0};
+                if (poll(&pfd, 1, static_cast<int>(SERIAL_WRITE_TIMEOUT_MS)) <= 0) return RelayIoStatus::Failed;
+            } else if (count < 0 && errno != EINTR) {
+                return IsDisconnectError(errno) ? RelayIoStatus::Disconnected : RelayIoStatus::Failed;
+            }
+        }
+        return RelayIoStatus::Ok;
+    }
+
+    int Read(unsigned char* buffer, size_t size, uint32_t timeoutMs) override {
+        pollfd pfd = {m_fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, static_cast<int>(timeoutMs));
+        if (ready < 0) return errno == EINTR ? 0 : -1;
+        if (ready == 0) return 0;
+        if (pfd.revents & (POLLERR | POLLNVAL)) return -1;
+
+        ssize_t count = read(m_fd, buffer, size);
+        if (count > 0) return static_cast<int>(count);
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+        return -1;  // Hangup or error: the adapter is gone
+    }
+
+    bool IsBusy() const override { return m_busy; }
+
+private:
+    static bool IsDisconnectError(int error) {
+        return error == EIO || error == ENXIO || error == ENODEV || error == EBADF;
+    }
+
+    int m_fd;
+    bool m_busy;
+};
+
+#endif // _WIN32
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_RELAY_SERIAL_H
@@ -0,0 +1,476 @@
+#pragma once
+// Persistent relay connection for HDD Toggle
+// Keeps the relay device open across switches and only looks for it again
+// when a write fails or the device goes away. Platform-neutral: the HID
+// transport lives in src/core/relay-device.cpp, and tests drive the same
+// lifecycle with a fake transport.
+
+#ifndef HDD_CORE_RELAY_SESSION_H
+#define HDD_CORE_RELAY_SESSION_H
+
+#include "hdd-toggle.h"
+#include "hdd-utils.h"
+#include "core/relay-protocol.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace hdd {
+namespace core {
+
+// Feature report for the relay
+// channel: 0 = all relays, 1..RELAY_CHANNEL_COUNT = specific relay
+inline void BuildRelayReport(int channel, bool on, unsigned char (&report)[RELAY_REPORT_SIZE]) {
+    if (channel > 0) ActiveRelayProtocol::EncodeChannel(static_cast<unsigned>(channel), on, report);
+    else ActiveRelayProtocol::EncodeAll(on, report);
+}
+
+// Channel bits as reported by the relay: bit 0 = relay 1, bit 1 = relay 2, ...
+// Channel 0 means all relays.
+inline uint8_t RelayChannelMask(int channel) {
+    if (channel <= 0) return ActiveRelayProtocol::AllChannels();
+    return static_cast<uint8_t>(1u << (channel - 1));
+}
+
+// Valid channel numbers for messages: "1, 2, or all"
+inline std::string RelayChannelChoices() {
+    std::string choices;
+    for (int channel = 1; channel <= RELAY_CHANNEL_COUNT; channel++) {
+        choices += std::to_string(channel) + ", ";
+    }
+    return choices + "or all";
+}
+
+// Byte of the GetFeature report that holds the channel bits
+constexpr size_t RELAY_STATE_OFFSET = ActiveRelayProtocol::StateOffset;
+
+// Channel bits from a GetFeature report; false if it is too short
+inline bool ParseRelayStateReport(const unsigned char* report, size_t size, uint8_t& mask) {
+    if (size <= RELAY_STATE_OFFSET) return false;
+    mask = ActiveRelayProtocol::ParseState(report);
+    return true;
+}
+
+// Result of a single report write
+enum class RelayIoStatus {
+    Ok,
+    Disconnected,   // Handle is stale (unplugged, re-enumerated); reopen and retry once
+    Failed          // Device rejected the report; the handle is still good
+};
+
+// A way to reach the relay with an explicit open/close lifecycle
+class RelayTransport {
+public:
+    virtual ~RelayTransport() = default;
+
+    // Open the device. May reuse a location found earlier, but must search
+    // again itself if that location no longer opens.
+    virtual bool Open() = 0;
+
+    // Close the device. Must be safe to call when not open.
+    virtual void Close() = 0;
+
+    // Forget any cached device location so the next Open searches again
+    virtual void ForgetDevice() = 0;
+
+    // Send one feature report (report[0] is the report ID)
+    virtual RelayIoStatus SetFeature(const unsigned char* report, size_t size) = 0;
+
+    // Read one feature report (set report[0] to the report ID first)
+    virtual RelayIoStatus GetFeature(unsigned char* report, size_t size) = 0;
+
+    // True if the last failed Open found the device held by another
+    // process, rather than missing
+    virtual bool IsBusy() const { return false; }
+
+    // True if holding the device open locks every other process out (COM
+    // ports). The connection then closes it after each operation, so the
+    // tray does not keep the CLI from switching the relay.
+    virtual bool IsExclusive() const { return false; }
+};
+
+// Why the last RelayConnection operation failed
+enum class RelayError {
+    None,
+    NotFound,       // No relay (unplugged, wrong port)
+    Busy,           // Held open by another process
+    Failed          // Reached, but the write or readback failed
+};
+
+inline const char* RelayErrorMessage(RelayError error) {
+    switch (error) {
+        case RelayError::None: return "no error";
+        case RelayError::NotFound: return "USB relay not found";
+        case RelayError::Busy: return "relay is in use by another program";
+        case RelayError::Failed: return "relay did not accept the command";
+    }
+    return "unknown error";
+}
+
+// How long a cached channel state is trusted to skip a switch. Another
+// process (tray vs. CLI) may switch the relay, so older state is re-read.
+constexpr uint32_t RELAY_STATE_TRUST_MS = 5000;
+
+// Writes per switch before giving up when the readback disagrees
+constexpr int RELAY_WRITE_ATTEMPTS = 3;
+
+// Opens tried, RELAY_BUSY_WAIT_MS apart, while another process holds an
+// exclusive device for its own (short) switch
+constexpr int RELAY_BUSY_ATTEMPTS = 10;
+constexpr uint32_t RELAY_BUSY_WAIT_MS = 20;
+
+// Outcome of RelayConnection::Switch
+enum class RelaySwitchResult {
+    Switched,       // Written and confirmed by readback
+    Skipped,        // Channels were already in the requested state
+    Unverified,     // Written, but the relay could not be read back
+    Failed          // Not reachable, write failed, or readback never agreed
+};
+
+// Long-lived, thread-safe wrapper around a transport.
+// Device lookup and open are paid once; later switches are a single write.
+// Also caches the channel state last written or read for stateTrustMs, so
+// redundant switches and status queries need no I/O. The cache is
+// per-process: a switch made by another process is only seen once the
+// cached state has aged out.
+class RelayConnection {
+public:
+    explicit RelayConnection(std::unique_ptr<RelayTransport> transport,
+                             uint32_t stateTrustMs = RELAY_STATE_TRUST_MS)
+        : m_transport(std::move(transport)), m_open(false), m_openCount(0), m_stateTrustMs(stateTrustMs),
+          m_stateKnown(false), m_stateMask(0), m_lastError(RelayError::None) {}
+
+    ~RelayConnection() {
+        if (m_open) m_transport->Close();
+    }
+
+    // Send a feature report, opening the device as needed.
+    // A stale handle is dropped, the device looked up again and the write
+    // retried once. Returns false if the relay could not be reached.
+    // Raw writes bypass the state cache, so it is cleared.
+    bool SetFeature(const unsigned char* report, size_t size) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Operation operation(*this);
+        m_stateKnown = false;
+        return Write(report, size);
+    }
+
+    // Set channel (0 = all) on or off
+    RelaySwitchResult Switch(int channel, bool on) {
+        return SwitchChannels(RelayChannelMask(channel), on);
+    }
+
+    // Set every channel in bits on or off, in as few reports as the
+    // firmware allows (see PlanRelayReports).
+    // Skips the write if the cached state (younger than stateTrustMs, else
+    // freshly read) already matches, and confirms the writes by reading
+    // the state back, trying up to RELAY_WRITE_ATTEMPTS times. A report the
+    // device rejects counts as one of those attempts, on the same handle.
+    RelaySwitchResult SwitchChannels(uint8_t bits, bool on) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Operation operation(*this);
+
+        uint8_t mask = 0;
+        bool known = CachedState(mask) || Read(mask);
+        if (known && Matches(mask, bits, on)) return RelaySwitchResult::Skipped;
+        if (!known && m_lastError != RelayError::Failed) return RelaySwitchResult::Failed;  // Not reachable
+
+        for (int attempt = 0; attempt < RELAY_WRITE_ATTEMPTS; attempt++) {
+            bool written = true;
+            for (const auto& report : PlanRelayReports<ActiveRelayProtocol>(bits, on, mask, known)) {
+                if (Write(report.data(), report.size())) continue;
+                if (m_lastError != RelayError::Failed) return RelaySwitchResult::Failed;   // Gone or busy
+                written = false;
+                break;
+            }
+            if (!written) {
+                // Earlier reports of this plan may have landed: plan the next
+                // attempt without assuming any channel state
+                known = false;
+                continue;
+            }
+
+            if (!Read(mask)) {
+                // No readback (firmware without state report): assume it took
+                uint8_t assumed = m_stateKnown ? m_stateMask : 0;
+                Remember(static_cast<uint8_t>(on ? (assumed | bits) : (assumed & ~bits)));
+                return RelaySwitchResult::Unverified;
+            }
+            known = true;
+            if (Matches(mask, bits, on)) return RelaySwitchResult::Switched;
+        }
+        m_lastError = RelayError::Failed;
+        return RelaySwitchResult::Failed;
+    }
+
+    // Channel bits (see RelayChannelMask). Served from the cache while it is
+    // younger than stateTrustMs, unless fresh is set; read from the relay
+    // otherwise. False if the relay could not be read.
+    bool GetState(uint8_t& mask, bool fresh = false) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Operation operation(*this);
+        if (!fresh && CachedState(mask)) return true;
+        return Read(mask);
+    }
+
+    // The device was removed (hotplug notification): close and search again next time
+    void OnDeviceRemoved() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        DropConnection();
+        m_transport->ForgetDevice();
+    }
+
+    // Close the handle but keep the cached location
+    void Reset() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        DropConnection();
+    }
+
+    bool IsOpen() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_open;
+    }
+
+    // Why the last call failed; only meaningful after a failure (a switch
+    // without readback can succeed after a failed read)
+    RelayError LastError() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_lastError;
+    }
+
+    // Number of successful opens so far (for diagnostics, bench and tests)
+    unsigned int OpenCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_openCount;
+    }
+
+    // Non-copyable
+    RelayConnection(const RelayConnection&) = delete;
+    RelayConnection& operator=(const RelayConnection&) = delete;
+
+private:
+    // Scope of one public call: clears the last error, and afterwards
+    // closes an exclusive device (keeping the cached state)
+    class Operation {
+    public:
+        explicit Operation(RelayConnection& connection) : m_connection(connection) {
+            m_connection.m_lastError = RelayError::None;
+        }
+        ~Operation() {
+            if (m_connection.m_open && m_connection.m_transport->IsExclusive()) {
+                m_connection.m_transport->Close();
+                m_connection.m_open = false;
+            }
+        }
+        Operation(const Operation&) = delete;
+        Operation& operator=(const Operation&) = delete;
+
+    private:
+        RelayConnection& m_connection;
+    };
+
+    static std::chrono::steady_clock::time_point Now() { return std::chrono::steady_clock::now(); }
+
+    static bool Matches(uint8_t mask, uint8_t bits, bool on) {
+        return (mask & bits) == (on ? bits : 0);
+    }
+
+    // The cached state, if it is still young enough to trust
+    bool CachedState(uint8_t& mask) const {
+        if (!m_stateKnown || Now() - m_stateTime >= std::chrono::milliseconds(m_stateTrustMs)) return false;
+        mask = m_stateMask;
+        return true;
+    }
+
+    void Remember(uint8_t mask) {
+        m_stateKnown = true;
+        m_stateMask = mask;
+        m_stateTime = Now();
+    }
+
+    // Run one transport call; on a stale handle reopen and retry once
+    template <typename Io>
+    bool Transfer(Io&& io) {
+        if (!EnsureOpen()) return false;
+
+        RelayIoStatus status = io();
+        if (status == RelayIoStatus::Disconnected) {
+            DropConnection();
+            m_transport->ForgetDevice();
+            if (!EnsureOpen()) return false;
+            status = io();
+            if (status == RelayIoStatus::Disconnected) DropConnection();
+        }
+        if (status != RelayIoStatus::Ok) {
+            m_lastError = status == RelayIoStatus::Disconnected ? RelayError::NotFound : RelayError::Failed;
+        }
+        return status == RelayIoStatus::Ok;
+    }
+
+    bool Write(const unsigned char* report, size_t size) {
+        return Transfer([&] { return m_transport->SetFeature(report, size); });
+    }
+
+    bool Read(uint8_t& mask) {
+        unsigned char report[RELAY_REPORT_SIZE] = {0};
+        if (!Transfer([&] { return m_transport->GetFeature(report, RELAY_REPORT_SIZE); }) ||
+            !ParseRelayStateReport(report, RELAY_REPORT_SIZE, mask)) {
+            return false;
+        }
+        Remember(mask);
+        return true;
+    }
+
+    bool EnsureOpen() {
+        if (m_open) return true;
+        for (int attempt = 1; attempt <= RELAY_BUSY_ATTEMPTS; attempt++) {
+            m_open = m_transport->Open();
+            if (m_open) {
+                m_openCount++;
+                return true;
+            }
+            if (!m_transport->IsBusy()) {
+                m_lastError = RelayError::NotFound;
+                return false;
+            }
+            if (attempt < RELAY_BUSY_ATTEMPTS) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(RELAY_BUSY_WAIT_MS));
+            }
+        }
+        m_lastError = RelayError::Busy;
+        return false;
+    }
+
+    void DropConnection() {
+        // A relay that went away may come back with every channel off
+        m_stateKnown = false;
+        if (m_open) {
+            m_transport->Close();
+            m_open = false;
+        }
+    }
+
+    std::unique_ptr<RelayTransport> m_transport;
+    mutable std::mutex m_mutex;
+    bool m_open;
+    unsigned int m_openCount;
+    uint32_t m_stateTrustMs;
+    bool m_stateKnown;
+    uint8_t m_stateMask;
+    std::chrono::steady_clock::time_point m_stateTime;
+    RelayError m_lastError;
+};
+
+// Switch one channel (0 = all) through a connection
+inline bool SwitchRelay(RelayConnection& relay, int channel, bool on) {
+    return relay.Switch(channel, on) != RelaySwitchResult::Failed;
+}
+
+// What "hdd-toggle relay ..." was asked to do
+enum class RelayAction {
+    Usage,      // No arguments or a help flag
+    Switch,     // Set channel to on
+    Status,     // Print channel states; fresh forces a hardware read
+    Sequence,   // Run the timed steps in sequence (see ParseRelaySequence)
+    Invalid     // See error; showUsage says whether to print usage too
+};
+
+struct RelayArgs {
+    RelayAction action = RelayAction::Usage;
+    int channel = 0;            // 0 = all relays
+    bool on = false;
+    bool fresh = false;
+    std::string sequence;
+    std::string error;
+    bool showUsage = false;
+};
+
+// Parse the arguments after "relay":
+//   <on|off>              all relays
+//   <N|all> <on|off>      one relay, or all
+//   status [--fresh]      channel states
+//   sequence <steps...>   timed steps, joined into one spec
+inline RelayArgs ParseRelayArgs(int argc, char* argv[]) {
+    RelayArgs args;
+    if (argc < 1) return args;
+
+    std::string first = argv[0];
+    if (argc == 1 && (first == "-h" || first == "--help" || first == "/?")) return args;
+
+    if (EqualsIgnoreCase(first, "status")) {
+        args.action = RelayAction::Status;
+        for (int i = 1; i < argc; i++) {
+            if (EqualsIgnoreCase(argv[i], "--fresh") || EqualsIgnoreCase(argv[i], "-f")) {
+                args.fresh = true;
+            } else {
+                args.action = RelayAction::Invalid;
+                args.error = std::string("Unknown status option '") + argv[i] + "'";
+                args.showUsage = true;
+            }
+        }
+        return args;
+    }
+
+    if (EqualsIgnoreCase(first, "sequence")) {
+        args.action = RelayAction::Sequence;
+        for (int i = 1; i < argc; i++) {
+            if (i > 1) args.sequence += ' ';
+            args.sequence += argv[i];
+        }
+        if (args.sequence.empty()) {
+            args.action = RelayAction::Invalid;
+            args.error = "No sequence steps given";
+            args.showUsage = true;
+        }
+        return args;
+    }
+
+    // Shorthand: "on" or "off" means all relays
+    if (argc == 1 && (EqualsIgnoreCase(first, "on") || EqualsIgnoreCase(first, "off"))) {
+        args.action = RelayAction::Switch;
+        args.on = EqualsIgnoreCase(first, "on");
+        return args;
+    }
+
+    args.action = RelayAction::Invalid;
+    if (argc != 2) {
+        args.error = "Invalid arguments";
+        args.showUsage = true;
+        return args;
+    }
+
+    if (EqualsIgnoreCase(first, "all")) {
+        args.channel = 0;
+    } else {
+        char* next = nullptr;
+        long channel = strtol(first.c_str(), &next, 10);
+        if (first.empty() || *next != '\0' || channel < 1 || channel > RELAY_CHANNEL_COUNT) {
+            args.error = "Invalid relay '" + first + "' (use " + RelayChannelChoices() + ")";
+            return args;
+        }
+        args.channel = static_cast<int>(channel);
+    }
+
+    std::string state = argv[1];
+    if (EqualsIgnoreCase(state, "on")) args.on = true;
+    else if (EqualsIgnoreCase(state, "off")) args.on = false;
+    else {
+        args.error = "Invalid state '" + state + "' (use on or off)";
+        return args;
+    }
+
+    args.action = RelayAction::Switch;
+    return args;
+}
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_RELAY_SESSION_H
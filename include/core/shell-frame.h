@@ -0,0 +1,171 @@
+#pragma once
+// Command framing for a long-lived shell coprocess
+// A command is wrapped so the interpreter prints an end marker with the exit
+// code after its output; the parser splits the output stream back into one
+// frame per command. Platform-neutral: the PowerShell host lives in
+// process.cpp, and tests round-trip the POSIX dialect through /bin/sh.
+
+#ifndef HDD_CORE_SHELL_FRAME_H
+#define HDD_CORE_SHELL_FRAME_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <string>
+
+namespace hdd {
+namespace core {
+
+enum class ShellDialect {
+    PowerShell,     // powershell.exe -Command - (the Windows host)
+    Posix           // /bin/sh (tests)
+};
+
+// Standard base64 with padding
+inline std::string EncodeBase64(const std::string& data) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t n = (static_cast<uint8_t>(data[i]) << 16) |
+                     (static_cast<uint8_t>(data[i + 1]) << 8) |
+                     static_cast<uint8_t>(data[i + 2]);
+        out += alphabet[(n >> 18) & 63];
+        out += alphabet[(n >> 12) & 63];
+        out += alphabet[(n >> 6) & 63];
+        out += alphabet[n & 63];
+    }
+
+    size_t rest = data.size() - i;
+    if (rest > 0) {
+        uint32_t n = static_cast<uint8_t>(data[i]) << 16;
+        if (rest == 2) n |= static_cast<uint8_t>(data[i + 1]) << 8;
+        out += alphabet[(n >> 18) & 63];
+        out += alphabet[(n >> 12) & 63];
+        out += rest == 2 ? alphabet[(n >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+// Build the single line to write to the interpreter's stdin for one command.
+// The output is followed by a newline and "<marker><seq> <exitcode>".
+// PowerShell: the command is base64-encoded, so quotes and newlines are safe,
+// but it runs in the host's scope and must not call "exit".
+// Posix: the command runs in a subshell, so "exit" only ends that command.
+inline std::string BuildShellFrame(ShellDialect dialect, const std::string& marker,
+                                   uint32_t seq, const std::string& command) {
+    std::string seqText = std::to_string(seq);
+
+    if (dialect == ShellDialect::PowerShell) {
+        return "$global:LASTEXITCODE = 0; $hddCode = 0; "
+               "try { Invoke-Expression ([Text.Encoding]::UTF8.GetString([Convert]::FromBase64String('" +
+               EncodeBase64(command) + "'))) | Out-String -Stream -Width 4096; "
+               "if ($global:LASTEXITCODE) { $hddCode = $global:LASTEXITCODE } } "
+               "catch { $_ | Out-String -Stream -Width 4096; $hddCode = 1 }; "
+               "\"`n" + marker + seqText + " $hddCode\"\n";
+    }
+
+    std::string quoted;
+    for (char c : command) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return "( eval '" + quoted + "' ) </dev/null 2>&1; printf '\\n%s %d\\n' '" +
+           marker + seqText + "' $?\n";
+}
+
+// One completed command
+struct ShellFrame {
+    uint32_t seq = 0;
+    int exitCode = 0;
+    std::string output;
+};
+
+// Splits interpreter output into frames.
+// Feed() takes raw chunks as they arrive (any split); Next() pops frames in
+// order. A marker only counts at the start of a line, and the line break the
+// frame puts in front of it (\n or \r\n) is removed again, so output comes
+// back unchanged.
+class ShellFrameParser {
+public:
+    explicit ShellFrameParser(const std::string& marker) : m_marker(marker), m_scan(0) {}
+
+    void Feed(const char* data, size_t size) {
+        m_pending.append(data, size);
+
+        size_t newline;
+        while ((newline = m_pending.find('\n', m_scan)) != std::string::npos) {
+            size_t lineStart = m_scan;
+            m_scan = newline + 1;
+
+            ShellFrame frame;
+            if (!ParseMarkerLine(lineStart, newline, frame)) continue;
+
+            // Body is everything before the marker line, minus the frame's newline
+            size_t bodyEnd = lineStart;
+            if (bodyEnd > 0 && m_pending[bodyEnd - 1] == '\n') bodyEnd--;
+            if (bodyEnd > 0 && m_pending[bodyEnd - 1] == '\r') bodyEnd--;
+            frame.output = m_pending.substr(0, bodyEnd);
+            m_frames.push_back(std::move(frame));
+
+            m_pending.erase(0, m_scan);
+            m_scan = 0;
+        }
+    }
+
+    // Pop the next completed frame; false if none is ready
+    bool Next(ShellFrame& frame) {
+        if (m_frames.empty()) return false;
+        frame = std::move(m_frames.front());
+        m_frames.pop_front();
+        return true;
+    }
+
+    // Drop partial output and queued frames (after the interpreter restarts)
+    void Reset() {
+        m_pending.clear();
+        m_frames.clear();
+        m_scan = 0;
+    }
+
+    // Bytes received since the last complete frame
+    size_t PendingSize() const { return m_pending.size(); }
+
+private:
+    // "<marker><seq> <code>" with an optional trailing '\r'
+    bool ParseMarkerLine(size_t begin, size_t end, ShellFrame& frame) const {
+        if (end > begin && m_pending[end - 1] == '\r') end--;
+        if (end - begin <= m_marker.size() ||
+            m_pending.compare(begin, m_marker.size(), m_marker) != 0) {
+            return false;
+        }
+
+        std::string rest = m_pending.substr(begin + m_marker.size(), end - begin - m_marker.size());
+        char* next = nullptr;
+        unsigned long seq = strtoul(rest.c_str(), &next, 10);
+        if (next == rest.c_str() || *next != ' ') return false;
+
+        const char* codeText = next + 1;
+        long code = strtol(codeText, &next, 10);
+        if (next == codeText || *next != '\0') return false;
+
+        frame.seq = static_cast<uint32_t>(seq);
+        frame.exitCode = static_cast<int>(code);
+        return true;
+    }
+
+    std::string m_marker;
+    std::string m_pending;      // Output of the command in flight
+    size_t m_scan;              // Start of the first line not yet checked
+    std::deque<ShellFrame> m_frames;
+};
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_SHELL_FRAME_H
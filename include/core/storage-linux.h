@@ -0,0 +1,218 @@
+#pragma once
+// Linux storage queries for HDD Toggle
+// The sysfs/procfs counterpart of storage.cpp: finding the target disk,
+// where its partitions are mounted, its I/O counters, taking it offline and
+// rescanning the SCSI hosts, all with file reads and writes instead of
+// lsblk, findmnt or udevadm. Disks are named by their kernel name ("sdb").
+// Roots are configurable so tests run against a fixture tree; the
+// mountinfo parser is platform-neutral.
+
+#ifndef HDD_CORE_STORAGE_LINUX_H
+#define HDD_CORE_STORAGE_LINUX_H
+
+#include "core/disk-sysfs.h"
+#include "core/idle-monitor.h"
+#include "core/volume-map.h"
+#include "hdd-utils.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <unistd.h>
+#endif
+
+namespace hdd {
+namespace core {
+
+// One /proc/self/mountinfo line:
+// "36 25 8:17 / /mnt/backup rw,noatime shared:1 - ext4 /dev/sdb1 rw"
+struct MountinfoEntry {
+    unsigned major = 0;
+    unsigned minor = 0;
+    std::string root;           // Path inside the filesystem ("/" unless a bind mount)
+    std::string mountPoint;
+    std::string source;         // "/dev/sdb1"
+};
+
+// Undo the octal escapes mountinfo uses for space, tab, newline and '\'
+inline std::string UnescapeMountPath(const std::string& path) {
+    std::string result;
+    result.reserve(path.size());
+    for (size_t i = 0; i < path.size(); i++) {
+        if (path[i] == '\\' && i + 3 < path.size() && path[i + 1] >= '0' && path[i + 1] <= '3' &&
+            path[i + 2] >= '0' && path[i + 2] <= '7' && path[i + 3] >= '0' && path[i + 3] <= '7') {
+            result += static_cast<char>(((path[i + 1] - '0') << 6) | ((path[i + 2] - '0') << 3) | (path[i + 3] - '0'));
+            i += 3;
+        } else {
+            result += path[i];
+        }
+    }
+    return result;
+}
+
+// Parse one mountinfo line. Returns false for malformed lines.
+inline bool ParseMountinfoLine(const std::string& line, MountinfoEntry& entry) {
+    entry = MountinfoEntry();
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (start < line.size()) {
+        size_t end = line.find(' ', start);
+        if (end == std::string::npos) end = line.size();
+        if (end > start) fields.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+
+    // Optional fields (shared:N, master:N) run up to the "-" separator
+    size_t separator = 6;
+    while (separator < fields.size() && fields[separator] != "-") separator++;
+    if (fields.size() < 5 || separator + 2 >= fields.size()) return false;
+
+    const std::string& device = fields[2];
+    size_t colon = device.find(':');
+    if (colon == std::string::npos) return false;
+    char* end = nullptr;
+    entry.major = static_cast<unsigned>(strtoul(device.c_str(), &end, 10));
+    if (end != device.c_str() + colon) return false;
+    entry.minor = static_cast<unsigned>(strtoul(device.c_str() + colon + 1, &end, 10));
+    if (*end != '\0') return false;
+
+    entry.root = UnescapeMountPath(fields[3]);
+    entry.mountPoint = UnescapeMountPath(fields[4]);
+    entry.source = UnescapeMountPath(fields[separator + 2]);
+    return true;
+}
+
+#ifdef __linux__
+
+class SysfsStorage {
+public:
+    explicit SysfsStorage(const std::string& sysRoot = "/sys", const std::string& procRoot = "/proc",
+                          const std::string& byIdDir = "/dev/disk/by-id")
+        : m_sysRoot(sysRoot), m_procRoot(procRoot), m_disks(sysRoot, byIdDir) {}
+
+    // Find the target disk by serial, falling back to a model match.
+    // disk.device is its kernel name.
+    bool FindTargetDisk(const std::string& targetSerial, const std::string& targetModel, DiskRecord& disk) {
+        std::vector<DiskRecord> disks;
+        if (m_disks.EnumerateDisks(disks) != QueryStatus::Ok) return false;
+        const DiskRecord* found = FindDiskByTarget(disks, targetSerial, targetModel);
+        if (!found) return false;
+        disk = *found;
+        return true;
+    }
+
+    // The disk and each of its partitions, with where they are mounted.
+    // volumeName is the device node ("/dev/sdb1"); bind mounts are skipped.
+    std::vector<VolumeMount> ResolveDiskVolumes(const std::string& device) {
+        std::vector<VolumeMount> volumes;
+        std::string diskDir = m_sysRoot + "/block/" + device;
+
+        // Partitions are subdirectories named after the disk ("sdb1", "nvme0n1p1")
+        std::map<std::string, std::string> devices;   // "8:17" -> name
+        std::string wholeDisk = ReadTrimmed(diskDir + "/dev");
+        if (wholeDisk.empty()) return volumes;
+        devices[wholeDisk] = device;
+
+        DIR* dir = opendir(diskDir.c_str());
+        if (!dir) return volumes;
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (!StartsWith(name, device) || name == device) continue;
+            std::string number = ReadTrimmed(diskDir + "/" + name + "/dev");
+            if (!number.empty()) devices[number] = name;
+        }
+        closedir(dir);
+
+        std::map<std::string, VolumeMount> byName;
+        for (const auto& entry : devices) {
+            VolumeMount volume;
+            volume.volumeName = "/dev/" + entry.second;
+            if (entry.second != device) {
+                volume.partitionNumber = atoi(ReadTrimmed(diskDir + "/" + entry.second + "/partition").c_str());
+            }
+            byName[entry.second] = volume;
+        }
+
+        std::ifstream mountinfo(m_procRoot + "/self/mountinfo");
+        std::string line;
+        while (std::getline(mountinfo, line)) {
+            MountinfoEntry mount;
+            if (!ParseMountinfoLine(line, mount) || mount.root != "/") continue;
+            auto it = devices.find(std::to_string(mount.major) + ":" + std::to_string(mount.minor));
+            if (it != devices.end()) byName[it->second].mountPoints.push_back(mount.mountPoint);
+        }
+
+        // Whole disk first only if it carries a filesystem itself
+        for (auto& entry : byName) {
+            if (entry.first == device && entry.second.mountPoints.empty() && byName.size() > 1) continue;
+            volumes.push_back(std::move(entry.second));
+        }
+        return volumes;
+    }
+
+    // Present and accepting I/O (SCSI state "running", NVMe "live")
+    bool IsDiskOnline(const std::string& device) {
+        std::string state = ReadTrimmed(m_sysRoot + "/block/" + device + "/device/state");
+        if (state.empty()) return access((m_sysRoot + "/block/" + device).c_str(), F_OK) == 0;
+        return state == "running" || state == "live";
+    }
+
+    // Take a SCSI disk offline or back to running (needs root). The kernel
+    // then fails I/O to it, the counterpart of the Windows offline attribute.
+    bool SetDiskOffline(const std::string& device, bool offline) {
+        return WriteFile(m_sysRoot + "/block/" + device + "/device/state", offline ? "offline" : "running");
+    }
+
+    // Completed reads and writes from /proc/diskstats
+    bool ReadDiskIoCounters(const std::string& device, DiskIoCounters& counters) {
+        DiskstatsSampler sampler;
+        return sampler.Open(m_procRoot + "/diskstats") && sampler.Read(device.c_str(), counters);
+    }
+
+    // Ask every SCSI host to scan for new devices, like "Scan for hardware
+    // changes". Needs root. Returns how many hosts accepted the request.
+    size_t RescanDevices() {
+        std::string hostsDir = m_sysRoot + "/class/scsi_host";
+        DIR* dir = opendir(hostsDir.c_str());
+        if (!dir) return 0;
+
+        size_t scanned = 0;
+        while (dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;
+            if (WriteFile(hostsDir + "/" + entry->d_name + "/scan", "- - -")) scanned++;
+        }
+        closedir(dir);
+        return scanned;
+    }
+
+private:
+    static std::string ReadTrimmed(const std::string& path) {
+        std::ifstream file(path);
+        std::string contents;
+        std::getline(file, contents);
+        return TrimWhitespace(contents);
+    }
+
+    static bool WriteFile(const std::string& path, const std::string& value) {
+        int fd = open(path.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+        if (fd < 0) return false;
+        bool ok = write(fd, value.data(), value.size()) == static_cast<ssize_t>(value.size());
+        return close(fd) == 0 && ok;
+    }
+
+    std::string m_sysRoot;
+    std::string m_procRoot;
+    SysfsDiskBackend m_disks;
+};
+
+#endif // __linux__
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_STORAGE_LINUX_H
@@ -0,0 +1,97 @@
+#pragma once
+// In-process storage queries for HDD Toggle
+// Lookups and disk state changes for wake and sleep without starting
+// PowerShell, diskpart or pnputil
+
+#ifndef HDD_CORE_STORAGE_H
+#define HDD_CORE_STORAGE_H
+
+#include "core/blocker-scan.h"
+#include "core/disk-session.h"
+#include "core/idle-monitor.h"
+#include "core/volume-flush.h"
+#include "core/volume-map.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hdd {
+namespace core {
+
+// Find the target disk by serial, falling back to a model match
+// Uses the shared disk query session; returns false if not found
+bool FindTargetDisk(const std::string& targetSerial, const std::string& targetModel, DiskRecord& disk);
+
+// Volumes on the given disk and where they are mounted
+// The full walk is cached until the system volume set changes
+std::vector<VolumeMount> ResolveDiskVolumes(int diskNumber);
+
+// Drop the cached volume walk. Call on disk arrival/removal: a disk that
+// returns under another number keeps its volume GUIDs and letters, which
+// the cache key alone would not notice.
+void InvalidateVolumeCache();
+
+// Drive letters ("E:") of the volumes that live on the given disk
+std::vector<std::string> GetDiskDriveLetters(int diskNumber);
+
+// Set or clear the disk's offline attribute (persistent, requires administrator)
+bool SetDiskOffline(int diskNumber, bool offline);
+
+// Read the disk's I/O counters (IOCTL_DISK_PERFORMANCE; no admin needed)
+bool ReadDiskIoCounters(int diskNumber, DiskIoCounters& counters);
+
+// Write back a volume's cached data (FlushFileBuffers on the volume, which
+// needs administrator), measuring the bytes written with IOCTL_DISK_PERFORMANCE.
+// Takes a GUID path ("\\?\Volume{...}\"); a VolumeFlusher for FlushVolumesInParallel.
+void FlushVolume(const std::string& volumeName, VolumeFlushResult& result);
+
+// Processes with files open on the volumes, from the system handle table
+// (blocker-scan.cpp). Paths are shown under each volume's first mount point.
+// Without administrator only this user's processes can be inspected.
+std::vector<BlockerProcess> FindVolumeBlockers(const std::vector<VolumeMount>& volumes);
+
+// Post WM_CLOSE to the blockers' top-level windows, as if the user closed
+// them; unsaved work gets the application's own prompt. Returns windows asked.
+size_t RequestBlockersClose(const std::vector<BlockerProcess>& blockers);
+
+// Re-enumerate the device tree, like "Scan for hardware changes"
+// Synchronous; fails with access denied when not running as administrator
+bool RescanDevices();
+
+// Counts disk interface arrivals while alive, without a window
+// (CM_Register_Notification), so wake can react the moment a drive shows up.
+class DiskArrivalListener {
+public:
+    DiskArrivalListener();
+    ~DiskArrivalListener();
+
+    // False if notifications could not be registered; waits then just time out
+    bool IsActive() const { return m_notify != nullptr; }
+
+    // Arrivals so far
+    uint64_t Count();
+
+    // Wait until more than seen arrivals have happened or timeoutMs passes.
+    // Returns true on an arrival.
+    bool WaitForArrival(uint64_t seen, uint32_t timeoutMs);
+
+    // Non-copyable
+    DiskArrivalListener(const DiskArrivalListener&) = delete;
+    DiskArrivalListener& operator=(const DiskArrivalListener&) = delete;
+
+private:
+    void OnArrival();
+    friend struct DiskArrivalCallback;
+
+    void* m_notify;     // HCMNOTIFICATION
+    std::mutex m_mutex;
+    std::condition_variable m_arrived;
+    uint64_t m_count;
+};
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_STORAGE_H
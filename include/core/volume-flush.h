@@ -0,0 +1,120 @@
+#pragma once
+// Volume flush stage for HDD Toggle
+// Writes back every mounted volume of a disk before it is ejected, all
+// volumes at once, so RemoveDrive does not find the system still writing.
+// The flush itself is per platform: FlushFileBuffers on a volume handle
+// in storage.cpp, syncfs here on Linux.
+
+#ifndef HDD_CORE_VOLUME_FLUSH_H
+#define HDD_CORE_VOLUME_FLUSH_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+namespace hdd {
+namespace core {
+
+// Outcome of flushing one volume
+struct VolumeFlushResult {
+    std::string volume;
+    bool ok = false;
+    bool accessDenied = false;  // Windows: volume handles need administrator
+    bool bytesKnown = false;    // Volume reports write counters
+    uint64_t bytesWritten = 0;  // Written to the volume during the flush
+    uint32_t durationMs = 0;
+};
+
+// Flush one volume; fills everything but volume and durationMs
+typedef std::function<void(const std::string& volume, VolumeFlushResult& result)> VolumeFlusher;
+
+// Flush all volumes in parallel, one thread each, and return when every
+// flush is done. Results are in the order of volumes.
+inline std::vector<VolumeFlushResult> FlushVolumesInParallel(const std::vector<std::string>& volumes,
+                                                             const VolumeFlusher& flush) {
+    std::vector<VolumeFlushResult> results(volumes.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < volumes.size(); i++) {
+        threads.emplace_back([&, i] {
+            VolumeFlushResult& result = results[i];
+            auto start = std::chrono::steady_clock::now();
+            flush(volumes[i], result);
+            result.volume = volumes[i];
+            result.durationMs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    return results;
+}
+
+// "12.3 MB", "512 KB", "40 B"
+inline std::string FormatByteCount(uint64_t bytes) {
+    char text[32];
+    if (bytes >= 1024 * 1024) {
+        snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+    } else if (bytes >= 1024) {
+        snprintf(text, sizeof(text), "%llu KB", static_cast<unsigned long long>(bytes / 1024));
+    } else {
+        snprintf(text, sizeof(text), "%llu B", static_cast<unsigned long long>(bytes));
+    }
+    return text;
+}
+
+#ifdef __linux__
+
+// Sectors written so far to the block device holding path, from
+// /sys/dev/block/<major>:<minor>/stat; false for filesystems without one
+inline bool ReadBlockSectorsWritten(const std::string& path, uint64_t& sectors) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+
+    char statPath[64];
+    snprintf(statPath, sizeof(statPath), "/sys/dev/block/%u:%u/stat", major(info.st_dev), minor(info.st_dev));
+    FILE* file = fopen(statPath, "r");
+    if (!file) return false;
+
+    // Fields: reads merged sectors ticks writes merged sectors ...
+    unsigned long long values[7] = {};
+    int count = fscanf(file, "%llu %llu %llu %llu %llu %llu %llu", &values[0], &values[1], &values[2],
+                       &values[3], &values[4], &values[5], &values[6]);
+    fclose(file);
+    if (count != 7) return false;
+
+    sectors = values[6];
+    return true;
+}
+
+// syncfs the filesystem mounted at (or holding) path
+inline void SyncfsVolume(const std::string& path, VolumeFlushResult& result) {
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    uint64_t before = 0, after = 0;
+    bool counted = ReadBlockSectorsWritten(path, before);
+    result.ok = syncfs(fd) == 0;
+    close(fd);
+
+    if (counted && ReadBlockSectorsWritten(path, after)) {
+        result.bytesKnown = true;
+        result.bytesWritten = (after - before) * 512;   // stat counts 512-byte sectors
+    }
+}
+
+#endif // __linux__
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_VOLUME_FLUSH_H
@@ -0,0 +1,114 @@
+#pragma once
+// Disk-to-volume mapping for HDD Toggle
+// Which volumes (and mount points) live on which disk, plus a cache that is
+// reused until the system's volume set changes or a disk arrives or leaves.
+// Pure: the Windows walk that fills it lives in storage.cpp.
+
+#ifndef HDD_CORE_VOLUME_MAP_H
+#define HDD_CORE_VOLUME_MAP_H
+
+#include "hdd-utils.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hdd {
+namespace core {
+
+// One volume on a disk
+struct VolumeMount {
+    std::string volumeName;                 // "\\?\Volume{GUID}\"
+    int partitionNumber = 0;                // 0 if unknown
+    std::vector<std::string> mountPoints;   // "E:\", "C:\Mount\Data\"
+};
+
+// Volumes per disk number
+typedef std::unordered_map<int, std::vector<VolumeMount>> DiskVolumeMap;
+
+// Drive letters ("E:") among the mount points of the given volumes
+inline std::vector<std::string> DriveLettersFromMounts(const std::vector<VolumeMount>& volumes) {
+    std::vector<std::string> letters;
+    for (const auto& volume : volumes) {
+        for (const auto& mount : volume.mountPoints) {
+            if (mount.size() == 3 && mount[1] == ':' && mount[2] == '\\') {
+                letters.push_back(mount.substr(0, 2));
+            }
+        }
+    }
+    return letters;
+}
+
+// Generation of the system volume set: changes when a volume arrives or
+// leaves, or a drive letter is assigned or removed. Disk numbers are not in
+// it (reading them means opening every volume): a disk that comes back
+// under another number with the same volumes and letters needs an
+// Invalidate on the device-change event.
+inline uint64_t VolumeSetGeneration(const std::vector<std::string>& volumeNames, uint32_t driveMask) {
+    uint64_t hash = HashFnv1a(reinterpret_cast<const char*>(&driveMask), sizeof(driveMask));
+    for (const auto& name : volumeNames) {
+        hash = HashFnv1a(name, hash);
+        hash = HashFnv1a("\n", 1, hash);   // Keep {"ab","c"} distinct from {"a","bc"}
+    }
+    return hash;
+}
+
+// Thread-safe cache of the last full walk, valid for one generation
+class VolumeMapCache {
+public:
+    VolumeMapCache() : m_valid(false), m_generation(0), m_epoch(0) {}
+
+    // Taken before a walk and passed to Store, so a walk that overlapped an
+    // Invalidate is not stored
+    uint64_t Epoch() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_epoch;
+    }
+
+    // Copy the volumes for diskNumber if the cache matches generation.
+    // A disk with no volumes is a valid (empty) hit.
+    bool Lookup(int diskNumber, uint64_t generation, std::vector<VolumeMount>& volumes) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_valid || m_generation != generation) return false;
+
+        auto it = m_map.find(diskNumber);
+        if (it != m_map.end()) {
+            volumes = it->second;
+        } else {
+            volumes.clear();
+        }
+        return true;
+    }
+
+    // Replace the cache with a fresh walk taken at generation, unless it
+    // was invalidated since epoch
+    void Store(uint64_t generation, DiskVolumeMap map, uint64_t epoch) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (epoch != m_epoch) return;
+        m_map = std::move(map);
+        m_generation = generation;
+        m_valid = true;
+    }
+
+    // Forget the walk, e.g. when a disk arrives or leaves
+    void Invalidate() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_valid = false;
+        m_epoch++;
+        m_map.clear();
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    bool m_valid;
+    uint64_t m_generation;
+    uint64_t m_epoch;
+    DiskVolumeMap m_map;
+};
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_VOLUME_MAP_H
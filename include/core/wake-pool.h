@@ -0,0 +1,120 @@
+#pragma once
+// Staggered wake planning for drive pools
+// Decides when each relay channel is switched on so concurrent spin-ups stay
+// within the PSU inrush budget, and provides the barrier the orchestrator
+// waits on until every drive is ready. Pure; wake.cpp does the I/O.
+
+#ifndef HDD_CORE_WAKE_POOL_H
+#define HDD_CORE_WAKE_POOL_H
+
+#include "hdd-utils.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace hdd {
+namespace core {
+
+// One relay switch in a wake plan
+struct PowerSlot {
+    int channel = 0;                // Relay channel (0 = all)
+    uint32_t startMs = 0;           // Offset from the start of the wake
+    std::vector<size_t> drives;     // Indexes of the drives it powers
+};
+
+// Drives that count against the inrush budget when a slot is switched.
+// Channel 0 switches every relay, so it counts as the whole pool.
+inline size_t PowerSlotLoad(const PowerSlot& slot, size_t poolSize) {
+    return slot.channel == 0 ? poolSize : slot.drives.size();
+}
+
+// Plan power-on slots for drives on the given relay channels.
+// Drives sharing a channel are switched together and all count against the
+// budget. A slot starts no sooner than staggerMs after the previous one and
+// only once the drives still spinning up leave room for it; a channel with
+// more drives than the budget waits until everything before it has settled.
+// Drives on channel 0 ("all") are switched last, after every other slot,
+// since switching it powers every channel at once.
+inline std::vector<PowerSlot> PlanStaggeredPowerOn(const std::vector<int>& driveChannels,
+                                                   const PowerSettings& power) {
+    // Group drives by channel, in first-seen order
+    std::vector<PowerSlot> slots;
+    for (size_t i = 0; i < driveChannels.size(); i++) {
+        PowerSlot* slot = nullptr;
+        for (auto& existing : slots) {
+            if (existing.channel == driveChannels[i]) slot = &existing;
+        }
+        if (!slot) {
+            slots.emplace_back();
+            slot = &slots.back();
+            slot->channel = driveChannels[i];
+        }
+        slot->drives.push_back(i);
+    }
+    std::stable_partition(slots.begin(), slots.end(), [](const PowerSlot& slot) { return slot.channel != 0; });
+
+    const size_t budget = power.inrushBudget < 1 ? 1 : power.inrushBudget;
+
+    for (size_t s = 0; s < slots.size(); s++) {
+        uint32_t start = s == 0 ? 0 : slots[s - 1].startMs + power.staggerMs;
+
+        for (;;) {
+            // Drives from earlier slots still drawing inrush current at start
+            size_t load = 0;
+            uint32_t nextSettle = UINT32_MAX;
+            for (size_t p = 0; p < s; p++) {
+                uint32_t settle = slots[p].startMs + power.spinUpMs;
+                if (settle > start) {
+                    load += PowerSlotLoad(slots[p], driveChannels.size());
+                    if (settle < nextSettle) nextSettle = settle;
+                }
+            }
+
+            if (load == 0 || load + PowerSlotLoad(slots[s], driveChannels.size()) <= budget) break;
+            start = nextSettle;
+        }
+
+        slots[s].startMs = start;
+    }
+
+    return slots;
+}
+
+// Pool-level readiness barrier: each member arrives once with its result;
+// Wait() returns when all have arrived, true only if every member succeeded
+class ReadinessBarrier {
+public:
+    explicit ReadinessBarrier(size_t members)
+        : m_remaining(members), m_allSucceeded(true) {}
+
+    void Arrive(bool succeeded) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_remaining == 0) return;
+        if (!succeeded) m_allSucceeded = false;
+        if (--m_remaining == 0) m_released.notify_all();
+    }
+
+    bool Wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_released.wait(lock, [this] { return m_remaining == 0; });
+        return m_allSucceeded;
+    }
+
+    // Non-copyable
+    ReadinessBarrier(const ReadinessBarrier&) = delete;
+    ReadinessBarrier& operator=(const ReadinessBarrier&) = delete;
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_released;
+    size_t m_remaining;
+    bool m_allSucceeded;
+};
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_WAKE_POOL_H
@@ -0,0 +1,200 @@
+#pragma once
+// Predictive pre-wake for HDD Toggle
+// Learns at which times of the week the drive gets used and says when to
+// wake it ahead of the next likely use. Time is plain minutes (local wall
+// clock, minutes since 1970) passed in by the caller, so tests can run
+// weeks of simulated use in milliseconds; the tray supplies the real clock.
+
+#ifndef HDD_CORE_WAKE_PREDICTOR_H
+#define HDD_CORE_WAKE_PREDICTOR_H
+
+#include "hdd-utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace hdd {
+namespace core {
+
+constexpr int64_t MINUTES_PER_WEEK = 7 * 24 * 60;
+
+// Weeks of history needed before anything is predicted
+constexpr uint32_t PREDICTOR_MIN_WEEKS = 2;
+
+// Use times kept (oldest dropped first)
+constexpr size_t PREDICTOR_MAX_USES = 512;
+
+// Outcome counts for pre-wakes
+struct PredictorStats {
+    uint32_t hits = 0;          // Pre-woken, then used
+    uint32_t falseWakes = 0;    // Pre-woken, not used in time
+    uint32_t uncovered = 0;     // Used without a pre-wake (the user waited)
+
+    // Share of pre-wakes that were used; 0 with none
+    double HitRate() const {
+        uint32_t wakes = hits + falseWakes;
+        return wakes > 0 ? static_cast<double>(hits) / wakes : 0.0;
+    }
+
+    // Share of uses that found the drive pre-woken; 0 with none
+    double Coverage() const {
+        uint32_t uses = hits + uncovered;
+        return uses > 0 ? static_cast<double>(hits) / uses : 0.0;
+    }
+};
+
+// A scheduled pre-wake
+struct PreWakePlan {
+    int64_t wakeAt = -1;        // Minute to wake the drive
+    int64_t slot = -1;          // Start of the slot it is for
+
+    bool IsValid() const { return wakeAt >= 0; }
+};
+
+class WakePredictor {
+public:
+    explicit WakePredictor(const PredictorSettings& settings = PredictorSettings())
+        : m_settings(settings), m_pendingDeadline(-1) {
+        if (m_settings.slotMinutes == 0) m_settings.slotMinutes = 1;
+    }
+
+    const PredictorSettings& Settings() const { return m_settings; }
+    const PredictorStats& Stats() const { return m_stats; }
+    const std::vector<int64_t>& Uses() const { return m_uses; }
+
+    // Start of the slot holding minute
+    int64_t SlotStart(int64_t minute) const {
+        int64_t slot = m_settings.slotMinutes;
+        return minute - ((minute % slot) + slot) % slot;
+    }
+
+    // The drive was wanted at minute (a manual wake, or I/O on a pre-woken
+    // drive). Settles a pending pre-wake as a hit.
+    void RecordUse(int64_t minute) {
+        if (m_pendingDeadline >= 0) {
+            m_pendingDeadline = -1;
+            m_stats.hits++;
+        } else {
+            m_stats.uncovered++;
+        }
+        AddUse(minute);
+    }
+
+    // The drive was woken ahead of the slot starting at slotStart
+    void OnPreWake(int64_t slotStart) {
+        m_pendingDeadline = slotStart + m_settings.slotMinutes + m_settings.hitWindowMinutes;
+    }
+
+    bool IsPreWakePending() const { return m_pendingDeadline >= 0; }
+
+    // Close a pre-wake nobody used by now. True if it just became a false
+    // wake (the caller may put the drive back to sleep).
+    bool Expire(int64_t now) {
+        if (m_pendingDeadline < 0 || now <= m_pendingDeadline) return false;
+        m_pendingDeadline = -1;
+        m_stats.falseWakes++;
+        return true;
+    }
+
+    // Share of the looked-back weeks with a use in the slot holding minute.
+    // Only weeks since the first recorded use count, and nothing is
+    // predicted until PREDICTOR_MIN_WEEKS of them exist.
+    double Confidence(int64_t minute) const {
+        if (m_uses.empty()) return 0.0;
+
+        int64_t slot = SlotStart(minute);
+        int64_t first = SlotStart(m_uses.front());
+        uint32_t weeks = 0;
+        uint32_t hitWeeks = 0;
+        for (uint32_t back = 1; back <= m_settings.historyWeeks; back++) {
+            int64_t from = slot - back * MINUTES_PER_WEEK;
+            if (from < first) break;
+            weeks++;
+            if (HasUseIn(from, from + m_settings.slotMinutes)) hitWeeks++;
+        }
+        return weeks >= PREDICTOR_MIN_WEEKS ? static_cast<double>(hitWeeks) / weeks : 0.0;
+    }
+
+    // When to wake next: lead minutes before the first confident slot in
+    // the coming week that has not been used yet, or now if that is
+    // already past. Invalid if no slot qualifies.
+    PreWakePlan NextPreWake(int64_t now) const {
+        PreWakePlan plan;
+        int64_t slot = SlotStart(now);
+        for (int64_t checked = 0; checked <= MINUTES_PER_WEEK; checked += m_settings.slotMinutes, slot += m_settings.slotMinutes) {
+            if (HasUseIn(slot, slot + m_settings.slotMinutes)) continue;
+            if (Confidence(slot) < m_settings.confidence) continue;
+            plan.slot = slot;
+            plan.wakeAt = std::max(now, slot - static_cast<int64_t>(m_settings.leadMinutes));
+            break;
+        }
+        return plan;
+    }
+
+    // Persisted form: "hits,falseWakes,uncovered;use,use,..."
+    std::string Format() const {
+        std::string text = std::to_string(m_stats.hits) + "," + std::to_string(m_stats.falseWakes) + "," +
+                           std::to_string(m_stats.uncovered) + ";";
+        for (size_t i = 0; i < m_uses.size(); i++) {
+            if (i > 0) text += ',';
+            text += std::to_string(m_uses[i]);
+        }
+        return text;
+    }
+
+    // Load Format() output; malformed parts are skipped
+    bool Parse(const std::string& text) {
+        size_t semicolon = text.find(';');
+        if (semicolon == std::string::npos) return false;
+
+        std::vector<int64_t> stats = ParseList(text.substr(0, semicolon));
+        if (stats.size() == 3) {
+            m_stats.hits = static_cast<uint32_t>(stats[0]);
+            m_stats.falseWakes = static_cast<uint32_t>(stats[1]);
+            m_stats.uncovered = static_cast<uint32_t>(stats[2]);
+        }
+        m_uses.clear();
+        for (int64_t use : ParseList(text.substr(semicolon + 1))) AddUse(use);
+        return true;
+    }
+
+private:
+    void AddUse(int64_t minute) {
+        auto at = std::upper_bound(m_uses.begin(), m_uses.end(), minute);
+        m_uses.insert(at, minute);
+        if (m_uses.size() > PREDICTOR_MAX_USES) m_uses.erase(m_uses.begin());
+    }
+
+    bool HasUseIn(int64_t from, int64_t to) const {
+        auto at = std::lower_bound(m_uses.begin(), m_uses.end(), from);
+        return at != m_uses.end() && *at < to;
+    }
+
+    static std::vector<int64_t> ParseList(const std::string& text) {
+        std::vector<int64_t> values;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find(',', pos);
+            if (end == std::string::npos) end = text.size();
+            std::string item = text.substr(pos, end - pos);
+            pos = end + 1;
+
+            char* next = nullptr;
+            long long value = strtoll(item.c_str(), &next, 10);
+            if (!item.empty() && *next == '\0' && value >= 0) values.push_back(value);
+        }
+        return values;
+    }
+
+    PredictorSettings m_settings;
+    PredictorStats m_stats;
+    std::vector<int64_t> m_uses;        // Sorted
+    int64_t m_pendingDeadline;          // -1 when no pre-wake is pending
+};
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_WAKE_PREDICTOR_H
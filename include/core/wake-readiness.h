@@ -0,0 +1,131 @@
+#pragma once
+// Wake readiness timing for HDD Toggle
+// Learns how long each drive takes from power-on to showing up in Windows
+// and turns that into a probe schedule: the first look just before a
+// typical spin-up, then exponential backoff. Device-arrival events cut the
+// waits short; the probes only cover arrivals that are missed. Pure;
+// wake.cpp does the waiting and storage.cpp the events.
+
+#ifndef HDD_CORE_WAKE_READINESS_H
+#define HDD_CORE_WAKE_READINESS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace hdd {
+namespace core {
+
+// Spin-up samples kept per drive (newest replace oldest)
+constexpr size_t SPINUP_HISTORY_SIZE = 16;
+
+// Assumed spin-up before a drive has been timed; also when an unfound drive
+// first gets a device rescan (the old fixed settle time)
+constexpr uint32_t DEFAULT_SPINUP_MS = 3000;
+
+// First probe for a drive without history
+constexpr uint32_t DEFAULT_FIRST_PROBE_MS = 1000;
+
+// Backoff between probes: doubles from the initial gap up to the maximum
+constexpr uint32_t PROBE_INITIAL_GAP_MS = 250;
+constexpr uint32_t PROBE_MAX_GAP_MS = 2000;
+
+// Give up after this long (the old worst case: 2 settles and 4 retries),
+// or twice the slowest spin-up seen if that is longer
+constexpr uint32_t WAKE_READY_TIMEOUT_MS = 18000;
+
+// Samples needed before the learned times replace the defaults
+constexpr size_t SPINUP_MIN_SAMPLES = 3;
+
+// Power-on to detected times for one drive
+class SpinUpModel {
+public:
+    void Record(uint32_t ms) {
+        m_samples.push_back(ms);
+        if (m_samples.size() > SPINUP_HISTORY_SIZE) m_samples.erase(m_samples.begin());
+    }
+
+    size_t Count() const { return m_samples.size(); }
+
+    // Nearest-rank quantile (q in [0, 1]) of the samples; 0 with none
+    uint32_t Quantile(double q) const {
+        if (m_samples.empty()) return 0;
+        std::vector<uint32_t> sorted(m_samples);
+        std::sort(sorted.begin(), sorted.end());
+        size_t rank = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[rank < sorted.size() ? rank : sorted.size() - 1];
+    }
+
+    // First probe: at the fast end of what this drive usually takes
+    uint32_t FirstProbeMs() const {
+        return Learned() ? Quantile(0.25) : DEFAULT_FIRST_PROBE_MS;
+    }
+
+    // When an unfound drive gets a device rescan: later than most wakes took
+    uint32_t RescanAtMs() const {
+        return Learned() ? Quantile(0.9) + Quantile(0.9) / 4 : DEFAULT_SPINUP_MS;
+    }
+
+    uint32_t TimeoutMs() const {
+        uint32_t slowest = Quantile(1.0);
+        return slowest * 2 > WAKE_READY_TIMEOUT_MS ? slowest * 2 : WAKE_READY_TIMEOUT_MS;
+    }
+
+    // Samples as "5200,4900,5100", oldest first (persisted between runs)
+    std::string Format() const {
+        std::string text;
+        for (size_t i = 0; i < m_samples.size(); i++) {
+            if (i > 0) text += ',';
+            text += std::to_string(m_samples[i]);
+        }
+        return text;
+    }
+
+    // Load from Format() output; malformed entries are skipped
+    static SpinUpModel Parse(const std::string& text) {
+        SpinUpModel model;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find(',', pos);
+            if (end == std::string::npos) end = text.size();
+            std::string item = text.substr(pos, end - pos);
+            pos = end + 1;
+
+            char* next = nullptr;
+            unsigned long value = strtoul(item.c_str(), &next, 10);
+            if (!item.empty() && *next == '\0' && item[0] != '-' && value > 0 && value <= UINT32_MAX) {
+                model.Record(static_cast<uint32_t>(value));
+            }
+        }
+        return model;
+    }
+
+private:
+    bool Learned() const { return m_samples.size() >= SPINUP_MIN_SAMPLES; }
+
+    std::vector<uint32_t> m_samples;
+};
+
+// Probe times (ms after power-on): firstMs, then gaps doubling from
+// initialGapMs up to maxGapMs, ending with one probe at timeoutMs
+inline std::vector<uint32_t> PlanProbeTimes(uint32_t firstMs, uint32_t timeoutMs,
+                                            uint32_t initialGapMs = PROBE_INITIAL_GAP_MS,
+                                            uint32_t maxGapMs = PROBE_MAX_GAP_MS) {
+    std::vector<uint32_t> times;
+    uint32_t gap = initialGapMs > 0 ? initialGapMs : 1;
+    for (uint32_t at = firstMs; at < timeoutMs;) {
+        times.push_back(at);
+        at += gap;
+        gap = gap * 2 < maxGapMs ? gap * 2 : maxGapMs;
+    }
+    times.push_back(timeoutMs);
+    return times;
+}
+
+} // namespace core
+} // namespace hdd
+
+#endif // HDD_CORE_WAKE_READINESS_H
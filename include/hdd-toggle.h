@@ -40,6 +40,7 @@ constexpr const char* DEFAULT_TARGET_MODEL = "WDC WD181KFGX-68AFPN0";
 constexpr unsigned short RELAY_VENDOR_ID = 0x16C0;
 constexpr unsigned short RELAY_PRODUCT_ID = 0x05DF;
 constexpr int RELAY_REPORT_SIZE = 9;
+constexpr int RELAY_CHANNEL_COUNT = 2;
 
 //=============================================================================
 // Command Types
@@ -51,6 +52,7 @@ enum class Command {
     Sleep,      // Sleep the drive
     Relay,      // Control relay directly
     Status,     // Show drive status
+    Bench,      // Measure operation latency
     Help,       // Show help
     Version     // Show version
 };
@@ -6,6 +6,7 @@
 #include <cstring>
 #include <cstdint>
 #include <algorithm>
+#include <utility>
 #include <vector>
 
 namespace hdd {
@@ -88,6 +89,22 @@ inline std::string ToUpper(const std::string& str) {
     return result;
 }
 
+// 64-bit FNV-1a hash; pass the previous result as seed to hash several strings
+constexpr uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ULL;
+
+inline uint64_t HashFnv1a(const char* data, size_t length, uint64_t seed = FNV1A_OFFSET_BASIS) {
+    uint64_t hash = seed;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline uint64_t HashFnv1a(const std::string& str, uint64_t seed = FNV1A_OFFSET_BASIS) {
+    return HashFnv1a(str.data(), str.size(), seed);
+}
+
 //=============================================================================
 // Drive State
 //=============================================================================
@@ -206,16 +223,115 @@ inline bool ShouldPeriodicCheck(uint64_t lastCheckTime, uint64_t currentTime, bo
     return HasDebounceElapsed(lastCheckTime, currentTime, MinutesToMs(1));
 }
 
+// Timeout value meaning "no deadline" (same value as Win32 INFINITE)
+constexpr uint32_t WAIT_NO_TIMEOUT = 0xFFFFFFFFu;
+constexpr uint64_t NO_DEADLINE = UINT64_MAX;
+
+// Absolute deadline timeoutMs after now; WAIT_NO_TIMEOUT yields NO_DEADLINE
+inline uint64_t DeadlineAfter(uint64_t now, uint32_t timeoutMs) {
+    if (timeoutMs == WAIT_NO_TIMEOUT) return NO_DEADLINE;
+    return now + timeoutMs;
+}
+
+// Milliseconds left until deadline, suitable for a Win32 wait:
+// 0 once it has passed, WAIT_NO_TIMEOUT for NO_DEADLINE, and never
+// WAIT_NO_TIMEOUT for a finite deadline
+inline uint32_t RemainingWaitMs(uint64_t deadline, uint64_t now) {
+    if (deadline == NO_DEADLINE) return WAIT_NO_TIMEOUT;
+    if (deadline <= now) return 0;
+    uint64_t remaining = deadline - now;
+    return remaining >= WAIT_NO_TIMEOUT ? WAIT_NO_TIMEOUT - 1 : static_cast<uint32_t>(remaining);
+}
+
+// The shorter of a per-step timeout and what is left of an overall deadline
+inline uint32_t StepTimeoutMs(uint32_t stepTimeoutMs, uint64_t deadline, uint64_t now) {
+    uint32_t remaining = RemainingWaitMs(deadline, now);
+    return stepTimeoutMs < remaining ? stepTimeoutMs : remaining;
+}
+
+// Summary of latency samples in milliseconds (used by the bench command)
+struct LatencySummary {
+    size_t count = 0;
+    double min = 0.0;
+    double median = 0.0;
+    double mean = 0.0;
+    double max = 0.0;
+};
+
+// Compute min/median/mean/max; an empty sample set yields all zeros
+inline LatencySummary SummarizeLatencies(std::vector<double> samples) {
+    LatencySummary summary;
+    if (samples.empty()) return summary;
+
+    std::sort(samples.begin(), samples.end());
+    summary.count = samples.size();
+    summary.min = samples.front();
+    summary.max = samples.back();
+
+    size_t mid = samples.size() / 2;
+    summary.median = (samples.size() % 2 == 0)
+        ? (samples[mid - 1] + samples[mid]) / 2.0
+        : samples[mid];
+
+    double total = 0.0;
+    for (double sample : samples) total += sample;
+    summary.mean = total / static_cast<double>(samples.size());
+
+    return summary;
+}
+
 //=============================================================================
 // Configuration
 //=============================================================================
 
+// One configured drive ([Drive] or [Drive.N] section)
+struct DriveTarget {
+    std::string name;       // Section name, e.g. "Drive.2"
+    std::string serial;
+    std::string model;
+    int relayChannel = 0;   // 0 = all channels
+};
+
+// Power-on staggering for multi-drive wake ([Power] section)
+struct PowerSettings {
+    unsigned int inrushBudget = 2;      // Drives allowed to spin up at the same time
+    unsigned int spinUpMs = 6000;       // How long a spin-up draws inrush current
+    unsigned int staggerMs = 1000;      // Minimum gap between relay switches
+    unsigned int autoSleepIdleMinutes = 0;  // Tray sleeps the drive after this long without I/O; 0 = never
+};
+
+// Relay board and power sequences ([Relay] section).
+// Sequences are in ParseRelaySequence form. Empty means all channels at
+// once; an empty sleep sequence with a wake sequence set undoes the wake
+// sequence in reverse.
+struct RelaySettings {
+    std::string type = "hid";       // hid (DCT Tech USB HID) or serial (LCUS)
+    std::string port;               // Serial port for type=serial, e.g. COM3
+    std::string wakeSequence;
+    std::string sleepSequence;
+};
+
+// Predictive pre-wake ([Predictor] section), see core/wake-predictor.h
+struct PredictorSettings {
+    bool enabled = false;
+    double confidence = 0.6;            // Share of past weeks with a use in the slot
+    uint32_t slotMinutes = 15;          // Width of a time-of-week slot
+    uint32_t leadMinutes = 2;           // Wake this long before the slot starts
+    uint32_t historyWeeks = 8;          // Weeks looked back over
+    uint32_t hitWindowMinutes = 30;     // Use after the slot still counts as a hit
+};
+
 // Configuration structure
 struct Config {
-    std::string targetSerial;
+    std::string targetSerial;       // Primary drive (drives[0] once loaded)
     std::string targetModel;
+    std::vector<DriveTarget> drives;
+    PowerSettings power;
+    RelaySettings relay;
+    PredictorSettings predictor;
     std::string wakeCommand;
     std::string sleepCommand;
+    std::string detectionBackend;
     unsigned int periodicCheckMinutes;
     unsigned int postOperationCheckSeconds;
     bool showNotifications;
@@ -227,6 +343,7 @@ struct Config {
         , targetModel("WDC WD181KFGX-68AFPN0")
         , wakeCommand("wake-hdd.exe")
         , sleepCommand("sleep-hdd.exe")
+        , detectionBackend("native")
         , periodicCheckMinutes(10)
         , postOperationCheckSeconds(3)
         , showNotifications(true)
@@ -249,6 +366,203 @@ inline bool SerialMatches(const std::string& actual, const std::string& target)
     return EqualsIgnoreCase(TrimWhitespace(actual), TrimWhitespace(target));
 }
 
+// Canonical form of a serial for hashing: trimmed and uppercased
+// Two serials match exactly when their normalized forms are equal
+inline std::string NormalizeSerial(const std::string& serial) {
+    return ToUpper(TrimWhitespace(serial));
+}
+
+// Index N of a "[Drive.N]" section name (case-insensitive), or -1
+inline int ParseDriveSectionIndex(const std::string& section) {
+    static const char prefix[] = "drive.";
+    const size_t prefixLen = sizeof(prefix) - 1;
+    if (section.size() <= prefixLen || ToLower(section.substr(0, prefixLen)) != prefix) return -1;
+
+    int index = 0;
+    for (size_t i = prefixLen; i < section.size(); i++) {
+        char c = section[i];
+        if (c < '0' || c > '9') return -1;
+        index = index * 10 + (c - '0');
+        if (index > 9999) return -1;
+    }
+    return index;
+}
+
+// Pick the [Drive.N] sections out of an ini's section names, ordered by N
+inline std::vector<std::string> SelectDriveSections(const std::vector<std::string>& sections) {
+    std::vector<std::pair<int, std::string>> indexed;
+    for (const auto& section : sections) {
+        int index = ParseDriveSectionIndex(section);
+        if (index >= 0) indexed.emplace_back(index, section);
+    }
+    std::stable_sort(indexed.begin(), indexed.end(),
+                     [](const std::pair<int, std::string>& a, const std::pair<int, std::string>& b) {
+                         return a.first < b.first;
+                     });
+
+    std::vector<std::string> ordered;
+    for (const auto& entry : indexed) ordered.push_back(entry.second);
+    return ordered;
+}
+
+// Split a double-NUL-terminated string list (GetPrivateProfileSectionNames
+// and friends) into its entries
+inline std::vector<std::string> SplitMultiString(const char* buffer, size_t size) {
+    std::vector<std::string> entries;
+    size_t pos = 0;
+    while (pos < size && buffer[pos] != '\0') {
+        size_t len = strnlen(buffer + pos, size - pos);
+        entries.emplace_back(buffer + pos, len);
+        pos += len + 1;
+    }
+    return entries;
+}
+
+//=============================================================================
+// Disk Identification
+//=============================================================================
+
+// Parse the disk number from a DOS device name such as "PhysicalDrive3"
+// Returns -1 if the name is not a physical drive
+inline int ParsePhysicalDriveNumber(const char* name) {
+    static const char prefix[] = "PhysicalDrive";
+    if (!name || strncmp(name, prefix, sizeof(prefix) - 1) != 0) return -1;
+
+    const char* digits = name + sizeof(prefix) - 1;
+    if (!*digits) return -1;
+
+    int number = 0;
+    for (const char* p = digits; *p; ++p) {
+        if (*p < '0' || *p > '9') return -1;
+        number = number * 10 + (*p - '0');
+        if (number > 100000) return -1;
+    }
+    return number;
+}
+
+// Read a NUL-terminated string stored at offset inside a storage descriptor.
+// Offset 0 means the field is absent; out-of-range offsets yield "".
+// The result is whitespace-trimmed (descriptor fields are space padded).
+inline std::string ReadDescriptorString(const unsigned char* buffer, size_t size, uint32_t offset) {
+    if (!buffer || offset == 0 || offset >= size) return "";
+
+    const char* start = reinterpret_cast<const char*>(buffer + offset);
+    size_t maxLen = size - offset;
+    size_t len = 0;
+    while (len < maxLen && start[len] != '\0') len++;
+
+    return TrimWhitespace(std::string(start, len));
+}
+
+// Bus a disk's serial came from, as far as decoding it is concerned
+enum class SerialBus {
+    Unknown,    // Not reported
+    Ata,        // ATA/SATA: the 20-byte IDENTIFY serial field, in 16-bit words
+    Other       // NVMe, SCSI, USB, ...: passed on as the device reports it
+};
+
+// Swap each pair of characters: an ATA string read as little-endian words
+// ("V27HMTL9" for "2VH7TM9L"). A trailing odd character stays in place.
+inline std::string SwapSerialPairs(const std::string& serial) {
+    std::string swapped = serial;
+    for (size_t i = 0; i + 1 < swapped.size(); i += 2) std::swap(swapped[i], swapped[i + 1]);
+    return swapped;
+}
+
+// A byte-swapped ATA serial gives itself away by its padding: an odd run of
+// pad spaces ends up inside the serial ("W -DCW4C..."), and swapping the
+// pairs back makes it padding again. Trimming leading spaces never breaks
+// the pair alignment (a swapped field always starts with an even run).
+// A serial with an even run of padding cannot be told apart and is left
+// alone.
+inline bool HasSwappedPadding(const std::string& serial) {
+    std::string trimmed = TrimWhitespace(serial);
+    if (trimmed.find(' ') == std::string::npos) return false;
+    return TrimWhitespace(SwapSerialPairs(trimmed)).find(' ') == std::string::npos;
+}
+
+// Some storage drivers report the serial as hex-encoded ASCII ("3256483754..."
+// for "2VH7T..."), sometimes also byte-swapped. A genuine serial can be all
+// hex too, so it is only decoded when that is confirmed: by the bus (ATA
+// drivers are the ones that do this) or by the length, 40 hex digits being
+// exactly the 20-byte ATA serial field. The decoded text must be printable.
+// ATA serials, decoded or not, are then swapped back if their padding shows
+// they were read in the wrong byte order. Anything else is returned trimmed.
+inline std::string DecodeStorageSerial(const std::string& raw, SerialBus bus) {
+    std::string serial = TrimWhitespace(raw);
+    bool ataField = bus == SerialBus::Ata;
+
+    auto hexValue = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    bool confirmed = bus == SerialBus::Ata || serial.size() == 40;
+    if (confirmed && serial.size() >= 16 && serial.size() % 2 == 0) {
+        std::string decoded;
+        decoded.reserve(serial.size() / 2);
+        for (size_t i = 0; i < serial.size(); i += 2) {
+            int high = hexValue(serial[i]);
+            int low = hexValue(serial[i + 1]);
+            int value = (high << 4) | low;
+            if (high < 0 || low < 0 || value < 0x20 || value > 0x7E) {
+                decoded.clear();
+                break;
+            }
+            decoded.push_back(static_cast<char>(value));
+        }
+
+        if (!TrimWhitespace(decoded).empty()) {
+            serial = decoded;
+            ataField = true;
+        }
+    }
+
+    if (ataField && HasSwappedPadding(serial)) serial = SwapSerialPairs(TrimWhitespace(serial));
+    return TrimWhitespace(serial);
+}
+
+// Combine storage descriptor vendor and product IDs into a model name
+// matching what Windows shows as the disk's friendly name
+inline std::string ComposeDiskModel(const std::string& vendor, const std::string& product) {
+    std::string v = TrimWhitespace(vendor);
+    std::string p = TrimWhitespace(product);
+
+    // SATA disks behind the standard ATA stack report a generic "ATA" vendor
+    if (v.empty() || EqualsIgnoreCase(v, "ATA")) return p;
+    if (p.empty()) return v;
+    if (StartsWith(ToUpper(p), ToUpper(v))) return p;
+    return v + " " + p;
+}
+
+//=============================================================================
+// Command Output
+//=============================================================================
+
+// Split captured command output into trimmed, non-empty lines
+// Accepts \n and \r\n line endings
+inline std::vector<std::string> SplitOutputLines(const std::string& output) {
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start < output.size()) {
+        size_t end = output.find('\n', start);
+        if (end == std::string::npos) end = output.size();
+
+        std::string line = TrimWhitespace(output.substr(start, end - start));
+        if (!line.empty()) lines.push_back(line);
+        start = end + 1;
+    }
+    return lines;
+}
+
+// Last non-empty line of captured output (tools print their verdict last)
+inline std::string LastOutputLine(const std::string& output) {
+    std::vector<std::string> lines = SplitOutputLines(output);
+    return lines.empty() ? std::string() : lines.back();
+}
+
 //=============================================================================
 // Path Utilities
 //=============================================================================
@@ -49,26 +49,40 @@ cl.exe /nologo /O2 /MT /EHsc /std:c++17 /I include ^
     src\main.cpp ^
     src\core\process.cpp ^
     src\core\admin.cpp ^
+    src\core\config.cpp ^
     src\core\disk.cpp ^
+    src\core\storage.cpp ^
+    src\core\blocker-scan.cpp ^
+    src\core\relay-device.cpp ^
+    src\core\drive-watcher.cpp ^
     src\commands\relay.cpp ^
     src\commands\wake.cpp ^
     src\commands\sleep.cpp ^
     src\commands\status.cpp ^
+    src\commands\bench.cpp ^
+    src\commands\progress.cpp ^
     src\gui\tray-app.cpp ^
     /Fe:%OUTPUT% ^
     res\hdd-icon.res ^
-    shell32.lib advapi32.lib user32.lib comctl32.lib wbemuuid.lib ole32.lib oleaut32.lib setupapi.lib dwmapi.lib hid.lib WindowsApp.lib shlwapi.lib propsys.lib ^
+    shell32.lib advapi32.lib user32.lib comctl32.lib wbemuuid.lib ole32.lib oleaut32.lib setupapi.lib cfgmgr32.lib dwmapi.lib hid.lib WindowsApp.lib shlwapi.lib propsys.lib ^
     /link /SUBSYSTEM:WINDOWS
 
 REM Clean up intermediate files
 if exist src\main.obj del src\main.obj >nul 2>nul
 if exist src\core\process.obj del src\core\process.obj >nul 2>nul
 if exist src\core\admin.obj del src\core\admin.obj >nul 2>nul
+if exist src\core\config.obj del src\core\config.obj >nul 2>nul
 if exist src\core\disk.obj del src\core\disk.obj >nul 2>nul
+if exist src\core\storage.obj del src\core\storage.obj >nul 2>nul
+if exist src\core\blocker-scan.obj del src\core\blocker-scan.obj >nul 2>nul
+if exist src\core\relay-device.obj del src\core\relay-device.obj >nul 2>nul
+if exist src\core\drive-watcher.obj del src\core\drive-watcher.obj >nul 2>nul
 if exist src\commands\relay.obj del src\commands\relay.obj >nul 2>nul
 if exist src\commands\wake.obj del src\commands\wake.obj >nul 2>nul
 if exist src\commands\sleep.obj del src\commands\sleep.obj >nul 2>nul
 if exist src\commands\status.obj del src\commands\status.obj >nul 2>nul
+if exist src\commands\bench.obj del src\commands\bench.obj >nul 2>nul
+if exist src\commands\progress.obj del src\commands\progress.obj >nul 2>nul
 if exist src\gui\tray-app.obj del src\gui\tray-app.obj >nul 2>nul
 if exist *.obj del *.obj >nul 2>nul
 if exist res\hdd-icon.res del res\hdd-icon.res >nul 2>nul
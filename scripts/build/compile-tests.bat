@@ -21,13 +21,58 @@ set "INCLUDE=%VCPATH%\include;%SDKPATH%\Include\%SDKVER%\ucrt;%SDKPATH%\Include\
 set "LIB=%VCPATH%\lib\x64;%SDKPATH%\Lib\%SDKVER%\ucrt\x64;%SDKPATH%\Lib\%SDKVER%\um\x64"
 
 echo Compiling test runner (with debug symbols for coverage)...
-cl.exe /nologo /EHsc /std:c++17 /Zi /I include /Fe:tests\run-tests.exe /Fd:tests\run-tests.pdb tests\test_main.cpp tests\test_utils.cpp
+cl.exe /nologo /EHsc /std:c++17 /Zi /I include /Fe:tests\run-tests.exe /Fd:tests\run-tests.pdb tests\test_main.cpp tests\test_utils.cpp tests\test_disk_session.cpp tests\test_volume_map.cpp tests\test_wake_pool.cpp tests\test_shell_frame.cpp tests\test_exe_resolver.cpp tests\test_output_stream.cpp tests\test_relay_session.cpp tests\test_relay_hidraw.cpp tests\test_relay_sequence.cpp tests\test_relay_protocol.cpp tests\test_relay_serial.cpp tests\test_wake_readiness.cpp tests\test_wake_predictor.cpp tests\test_access_wake.cpp tests\test_idle_monitor.cpp tests\test_volume_flush.cpp tests\test_blocker_scan.cpp tests\test_process.cpp src\core\process.cpp tests\test_device_events.cpp tests\test_disk_sysfs.cpp tests\test_storage_linux.cpp tests\test_record_stream.cpp
 
 REM Clean up intermediate files (keep PDB for coverage)
 if exist tests\test_main.obj del tests\test_main.obj >nul 2>nul
 if exist tests\test_utils.obj del tests\test_utils.obj >nul 2>nul
+if exist tests\test_record_stream.obj del tests\test_record_stream.obj >nul 2>nul
+if exist tests\test_storage_linux.obj del tests\test_storage_linux.obj >nul 2>nul
+if exist tests\test_disk_sysfs.obj del tests\test_disk_sysfs.obj >nul 2>nul
+if exist tests\test_device_events.obj del tests\test_device_events.obj >nul 2>nul
+if exist tests\test_process.obj del tests\test_process.obj >nul 2>nul
+if exist tests\test_blocker_scan.obj del tests\test_blocker_scan.obj >nul 2>nul
+if exist tests\test_volume_flush.obj del tests\test_volume_flush.obj >nul 2>nul
+if exist tests\test_idle_monitor.obj del tests\test_idle_monitor.obj >nul 2>nul
+if exist tests\test_access_wake.obj del tests\test_access_wake.obj >nul 2>nul
+if exist tests\test_wake_predictor.obj del tests\test_wake_predictor.obj >nul 2>nul
+if exist tests\test_wake_readiness.obj del tests\test_wake_readiness.obj >nul 2>nul
+if exist tests\test_relay_serial.obj del tests\test_relay_serial.obj >nul 2>nul
+if exist tests\test_relay_protocol.obj del tests\test_relay_protocol.obj >nul 2>nul
+if exist tests\test_relay_sequence.obj del tests\test_relay_sequence.obj >nul 2>nul
+if exist tests\test_relay_hidraw.obj del tests\test_relay_hidraw.obj >nul 2>nul
+if exist tests\test_relay_session.obj del tests\test_relay_session.obj >nul 2>nul
+if exist tests\test_output_stream.obj del tests\test_output_stream.obj >nul 2>nul
+if exist tests\test_exe_resolver.obj del tests\test_exe_resolver.obj >nul 2>nul
+if exist tests\test_shell_frame.obj del tests\test_shell_frame.obj >nul 2>nul
+if exist tests\test_wake_pool.obj del tests\test_wake_pool.obj >nul 2>nul
+if exist tests\test_volume_map.obj del tests\test_volume_map.obj >nul 2>nul
+if exist tests\test_disk_session.obj del tests\test_disk_session.obj >nul 2>nul
 if exist test_main.obj del test_main.obj >nul 2>nul
 if exist test_utils.obj del test_utils.obj >nul 2>nul
+if exist test_record_stream.obj del test_record_stream.obj >nul 2>nul
+if exist test_storage_linux.obj del test_storage_linux.obj >nul 2>nul
+if exist test_disk_sysfs.obj del test_disk_sysfs.obj >nul 2>nul
+if exist test_device_events.obj del test_device_events.obj >nul 2>nul
+if exist test_process.obj del test_process.obj >nul 2>nul
+if exist process.obj del process.obj >nul 2>nul
+if exist test_blocker_scan.obj del test_blocker_scan.obj >nul 2>nul
+if exist test_volume_flush.obj del test_volume_flush.obj >nul 2>nul
+if exist test_idle_monitor.obj del test_idle_monitor.obj >nul 2>nul
+if exist test_access_wake.obj del test_access_wake.obj >nul 2>nul
+if exist test_wake_predictor.obj del test_wake_predictor.obj >nul 2>nul
+if exist test_wake_readiness.obj del test_wake_readiness.obj >nul 2>nul
+if exist test_relay_serial.obj del test_relay_serial.obj >nul 2>nul
+if exist test_relay_protocol.obj del test_relay_protocol.obj >nul 2>nul
+if exist test_relay_sequence.obj del test_relay_sequence.obj >nul 2>nul
+if exist test_relay_hidraw.obj del test_relay_hidraw.obj >nul 2>nul
+if exist test_relay_session.obj del test_relay_session.obj >nul 2>nul
+if exist test_output_stream.obj del test_output_stream.obj >nul 2>nul
+if exist test_exe_resolver.obj del test_exe_resolver.obj >nul 2>nul
+if exist test_shell_frame.obj del test_shell_frame.obj >nul 2>nul
+if exist test_wake_pool.obj del test_wake_pool.obj >nul 2>nul
+if exist test_volume_map.obj del test_volume_map.obj >nul 2>nul
+if exist test_disk_session.obj del test_disk_session.obj >nul 2>nul
 if exist vc140.pdb del vc140.pdb >nul 2>nul
 
 if %errorlevel% equ 0 (
@@ -0,0 +1,386 @@
+// Bench Command for HDD Toggle
+// Measures latency of detection and control paths on real hardware
+// Output is human-readable; numbers are wall-clock milliseconds
+
+#include "commands.h"
+#include "hdd-toggle.h"
+#include "hdd-utils.h"
+#include "core/disk.h"
+#include "core/hid-path.h"
+#include "core/process.h"
+#include "core/relay-device.h"
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hdd {
+namespace commands {
+
+namespace {
+
+const int DEFAULT_ITERATIONS = 20;
+
+struct BenchOptions {
+    bool help = false;
+    std::string target;
+    int iterations = DEFAULT_ITERATIONS;
+    int channel = 0;
+};
+
+BenchOptions ParseBenchArgs(int argc, char* argv[]) {
+    BenchOptions opts;
+
+    for (int i = 0; i < argc; i++) {
+        if (core::IsHelpFlag(argv[i])) {
+            opts.help = true;
+        }
+        else if ((_stricmp(argv[i], "--iterations") == 0 || _stricmp(argv[i], "-n") == 0) && i + 1 < argc) {
+            int value = atoi(argv[++i]);
+            if (value > 0) opts.iterations = value;
+        }
+        else if ((_stricmp(argv[i], "--channel") == 0 || _stricmp(argv[i], "-c") == 0) && i + 1 < argc) {
+            int value = atoi(argv[++i]);
+            if (value >= 0 && value <= RELAY_CHANNEL_COUNT) opts.channel = value;
+        }
+        else if (opts.target.empty()) {
+            opts.target = ToLower(argv[i]);
+        }
+    }
+
+    return opts;
+}
+
+void ShowBenchUsage() {
+    printf("Bench - Measure detection and control latency\n\n");
+    printf("Usage: hdd-toggle bench <target> [--iterations N] [--channel N] [-h|--help]\n\n");
+    printf("Targets:\n");
+    printf("  detect       Drive detection: cold vs. session queries, WMI and native backends\n");
+    printf("  shell        PowerShell command: new process per call vs. persistent shell host\n");
+    printf("  relay        Relay switch: look up + open per switch vs. persistent handle\n");
+    printf("               (uses the [Relay] Type board, HID or serial)\n");
+    printf("               (switches --channel ON repeatedly, so it stays on afterwards)\n");
+    printf("  hid          Relay lookup: open every HID interface vs. VID/PID path prefilter\n\n");
+    printf("Options:\n");
+    printf("  --iterations N, -n N   Samples per measurement (default %d)\n", DEFAULT_ITERATIONS);
+    printf("  --channel N, -c N      Relay channel for 'relay' (0 = all, default)\n");
+    printf("  -h, --help             Show this help message\n");
+}
+
+// High-resolution stopwatch based on QueryPerformanceCounter
+class Stopwatch {
+public:
+    Stopwatch() {
+        QueryPerformanceFrequency(&m_frequency);
+        QueryPerformanceCounter(&m_start);
+    }
+
+    void Restart() { QueryPerformanceCounter(&m_start); }
+
+    double ElapsedMs() const {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        return static_cast<double>(now.QuadPart - m_start.QuadPart) * 1000.0 /
+               static_cast<double>(m_frequency.QuadPart);
+    }
+
+private:
+    LARGE_INTEGER m_frequency;
+    LARGE_INTEGER m_start;
+};
+
+void PrintSummary(const char* label, const LatencySummary& summary) {
+    printf("  %-28s min %8.3f  median %8.3f  mean %8.3f  max %8.3f ms\n",
+           label, summary.min, summary.median, summary.mean, summary.max);
+}
+
+typedef std::unique_ptr<core::DiskQueryBackend> (*BackendFactory)();
+
+// Cold: a new session per query, so every sample pays connection setup
+// (the pre-session behaviour of DetectDriveInfo)
+bool TimeColdQueries(BackendFactory factory, int iterations, std::vector<double>& samples) {
+    for (int i = 0; i < iterations; i++) {
+        core::DiskQuerySession session(factory());
+        std::vector<core::DiskRecord> disks;
+
+        Stopwatch timer;
+        bool ok = session.EnumerateDisks(disks);
+        double elapsed = timer.ElapsedMs();
+        if (!ok) return false;
+        samples.push_back(elapsed);
+    }
+    return true;
+}
+
+// Warm: one session, connected before timing starts
+bool TimeWarmQueries(BackendFactory factory, int iterations, std::vector<double>& samples, size_t& diskCount) {
+    core::DiskQuerySession session(factory());
+    std::vector<core::DiskRecord> disks;
+    if (!session.EnumerateDisks(disks)) return false;
+    diskCount = disks.size();
+
+    for (int i = 0; i < iterations; i++) {
+        Stopwatch timer;
+        if (!session.EnumerateDisks(disks)) return false;
+        samples.push_back(timer.ElapsedMs());
+    }
+    return true;
+}
+
+int BenchDetect(int iterations) {
+    printf("Drive detection latency (%d iterations)\n\n", iterations);
+
+    struct Backend {
+        const char* coldLabel;
+        const char* warmLabel;
+        BackendFactory factory;
+    };
+    const Backend backends[] = {
+        {"wmi cold (connect + query)", "wmi warm (session)", core::CreateWmiDiskBackend},
+        {"native cold", "native warm (session)", core::CreateNativeDiskBackend},
+    };
+
+    double wmiColdMedian = 0.0;
+    for (const Backend& backend : backends) {
+        std::vector<double> cold;
+        std::vector<double> warm;
+        size_t diskCount = 0;
+
+        if (!TimeColdQueries(backend.factory, iterations, cold) ||
+            !TimeWarmQueries(backend.factory, iterations, warm, diskCount)) {
+            fprintf(stderr, "Error: %s query failed\n", backend.coldLabel);
+            return EXIT_OPERATION_FAILED;
+        }
+
+        LatencySummary coldSummary = SummarizeLatencies(cold);
+        LatencySummary warmSummary = SummarizeLatencies(warm);
+        if (wmiColdMedian == 0.0) wmiColdMedian = coldSummary.median;
+
+        PrintSummary(backend.coldLabel, coldSummary);
+        PrintSummary(backend.warmLabel, warmSummary);
+        if (warmSummary.median > 0.0) {
+            printf("  %-28s %.1fx vs. wmi cold (%zu disks enumerated)\n\n", "median speedup:",
+                   wmiColdMedian / warmSummary.median, diskCount);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+const char* const SHELL_BENCH_COMMAND = "Write-Output ok";
+const uint32_t SHELL_BENCH_TIMEOUT_MS = 30000;
+
+int BenchShell(int iterations) {
+    printf("PowerShell command latency (%d iterations): %s\n\n", iterations, SHELL_BENCH_COMMAND);
+
+    std::vector<double> cold;
+    std::string coldCommand = std::string("powershell.exe -NoLogo -NoProfile -NonInteractive -Command \"") +
+                              SHELL_BENCH_COMMAND + "\"";
+    for (int i = 0; i < iterations; i++) {
+        Stopwatch timer;
+        core::CommandResult result = core::RunCommand(coldCommand, SHELL_BENCH_TIMEOUT_MS, true);
+        double elapsed = timer.ElapsedMs();
+        if (!result.started || result.timedOut || result.exitCode != 0) {
+            fprintf(stderr, "Error: powershell.exe run failed\n");
+            return EXIT_OPERATION_FAILED;
+        }
+        cold.push_back(elapsed);
+    }
+
+    // First call starts the interpreter; timed separately
+    core::ShellHost host;
+    Stopwatch startTimer;
+    core::CommandResult first = host.Run(SHELL_BENCH_COMMAND, SHELL_BENCH_TIMEOUT_MS);
+    double startMs = startTimer.ElapsedMs();
+    if (first.exitCode != 0 || TrimWhitespace(first.output) != "ok") {
+        fprintf(stderr, "Error: shell host did not answer (output: %s)\n", first.output.c_str());
+        return EXIT_OPERATION_FAILED;
+    }
+
+    std::vector<double> warm;
+    for (int i = 0; i < iterations; i++) {
+        Stopwatch timer;
+        core::CommandResult result = host.Run(SHELL_BENCH_COMMAND, SHELL_BENCH_TIMEOUT_MS);
+        double elapsed = timer.ElapsedMs();
+        if (result.exitCode != 0) {
+            fprintf(stderr, "Error: shell host command failed\n");
+            return EXIT_OPERATION_FAILED;
+        }
+        warm.push_back(elapsed);
+    }
+
+    LatencySummary coldSummary = SummarizeLatencies(cold);
+    LatencySummary warmSummary = SummarizeLatencies(warm);
+    PrintSummary("process per call", coldSummary);
+    printf("  %-28s %8.3f ms\n", "shell host start:", startMs);
+    PrintSummary("shell host (warm)", warmSummary);
+    if (warmSummary.median > 0.0) {
+        printf("  %-28s %.1fx (%u interpreter start%s)\n", "median speedup:",
+               coldSummary.median / warmSummary.median, host.StartCount(),
+               host.StartCount() == 1 ? "" : "s");
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int BenchRelay(int iterations, int channel) {
+    printf("Relay switch latency (%d iterations, channel %d ON)\n\n", iterations, channel);
+
+    unsigned char report[RELAY_REPORT_SIZE];
+    core::BuildRelayReport(channel, true, report);
+
+    // Cold: a new connection per switch, i.e. device lookup + open every time
+    std::vector<double> cold;
+    unsigned long enumerationsBefore = core::GetRelayEnumerationCount();
+    for (int i = 0; i < iterations; i++) {
+        core::RelayConnection connection(core::CreateRelayTransport());
+        Stopwatch timer;
+        bool ok = connection.SetFeature(report, RELAY_REPORT_SIZE);
+        double elapsed = timer.ElapsedMs();
+        if (!ok) {
+            fprintf(stderr, "Error: USB relay not found or write failed\n");
+            return EXIT_DEVICE_NOT_FOUND;
+        }
+        cold.push_back(elapsed);
+    }
+    unsigned long coldEnumerations = core::GetRelayEnumerationCount() - enumerationsBefore;
+
+    // Warm: one connection, opened before timing starts
+    core::RelayConnection connection(core::CreateRelayTransport());
+    if (!connection.SetFeature(report, RELAY_REPORT_SIZE)) {
+        fprintf(stderr, "Error: USB relay not found or write failed\n");
+        return EXIT_DEVICE_NOT_FOUND;
+    }
+    std::vector<double> warm;
+    enumerationsBefore = core::GetRelayEnumerationCount();
+    for (int i = 0; i < iterations; i++) {
+        Stopwatch timer;
+        if (!connection.SetFeature(report, RELAY_REPORT_SIZE)) {
+            fprintf(stderr, "Error: Relay write failed\n");
+            return EXIT_OPERATION_FAILED;
+        }
+        warm.push_back(timer.ElapsedMs());
+    }
+    unsigned long warmEnumerations = core::GetRelayEnumerationCount() - enumerationsBefore;
+
+    LatencySummary coldSummary = SummarizeLatencies(cold);
+    LatencySummary warmSummary = SummarizeLatencies(warm);
+    PrintSummary("open + write", coldSummary);
+    PrintSummary("persistent handle write", warmSummary);
+    printf("  %-28s %lu cold, %lu warm\n", "HID enumerations:", coldEnumerations, warmEnumerations);
+    if (warmSummary.median > 0.0) {
+        printf("  %-28s %.1fx\n", "median speedup:", coldSummary.median / warmSummary.median);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+const size_t HID_FIXTURE_SIZE = 200;
+
+// Interface paths as SetupDi reports them on a desk full of HID devices:
+// keyboards, mice, receivers, UPSes, a few Bluetooth devices without USB
+// IDs, and the relay somewhere in the middle
+std::vector<std::string> BuildHidFixture() {
+    static const unsigned short vendors[] = {0x046D, 0x045E, 0x051D, 0x0764, 0x1532, 0x258A, 0x05AC, 0x413C};
+    char path[160];
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < HID_FIXTURE_SIZE; i++) {
+        if (i == HID_FIXTURE_SIZE * 2 / 3) {
+            snprintf(path, sizeof(path), "\\\\?\\hid#vid_%04x&pid_%04x#7&1a2b3c4d&0&0000#"
+                     "{4d1e55b2-f16f-11cf-88cb-001111000030}", RELAY_VENDOR_ID, RELAY_PRODUCT_ID);
+        } else if (i % 40 == 7) {
+            snprintf(path, sizeof(path), "\\\\?\\hid#{00001124-0000-1000-8000-00805f9b34fb}_localmfg&000f#"
+                     "9&%08zx&0&0000#{4d1e55b2-f16f-11cf-88cb-001111000030}", i);
+        } else {
+            snprintf(path, sizeof(path), "\\\\?\\hid#vid_%04x&pid_%04zx&mi_%02zu&col%02zu#8&%08zx&0&%04zu#"
+                     "{4d1e55b2-f16f-11cf-88cb-001111000030}",
+                     vendors[i % 8], 0xC000 + i, i % 3, i % 5 + 1, i * 2654435761u % 0xFFFFFFFF, i);
+        }
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+int BenchHid(int iterations) {
+    printf("Relay lookup (%d iterations)\n\n", iterations);
+
+    // Fixture: how much the prefilter costs and how many opens it leaves
+    std::vector<std::string> fixture = BuildHidFixture();
+    std::vector<double> filter;
+    size_t candidates = 0;
+    for (int i = 0; i < iterations; i++) {
+        candidates = 0;
+        Stopwatch timer;
+        for (const auto& path : fixture) {
+            if (core::MatchHidInterfacePath(path, RELAY_VENDOR_ID, RELAY_PRODUCT_ID) !=
+                core::HidPathMatch::Mismatch) {
+                candidates++;
+            }
+        }
+        filter.push_back(timer.ElapsedMs());
+    }
+    PrintSummary("prefilter, fixture", SummarizeLatencies(filter));
+    printf("  %-28s %zu of %zu entries\n\n", "left to open:", candidates, fixture.size());
+
+    // This machine: full enumeration with and without the prefilter
+    struct Mode {
+        const char* label;
+        bool prefilter;
+    };
+    const Mode modes[] = {{"open every interface", false}, {"path prefilter", true}};
+    double medians[2] = {0.0, 0.0};
+    for (int m = 0; m < 2; m++) {
+        std::vector<double> samples;
+        core::RelayScanStats stats;
+        for (int i = 0; i < iterations; i++) {
+            stats = core::RelayScanStats();
+            Stopwatch timer;
+            bool found = core::ScanForRelay(modes[m].prefilter, stats);
+            samples.push_back(timer.ElapsedMs());
+            if (!found && i == 0) printf("  (relay not connected; timing the full scan)\n");
+        }
+        LatencySummary summary = SummarizeLatencies(samples);
+        medians[m] = summary.median;
+        PrintSummary(modes[m].label, summary);
+        printf("  %-28s %lu of %lu interfaces\n", "opened per scan:", stats.opened, stats.interfaces);
+    }
+    if (medians[1] > 0.0) {
+        printf("  %-28s %.1fx\n", "median speedup:", medians[0] / medians[1]);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+} // anonymous namespace
+
+int RunBench(int argc, char* argv[]) {
+    BenchOptions opts = ParseBenchArgs(argc, argv);
+
+    if (opts.help || opts.target.empty()) {
+        ShowBenchUsage();
+        return opts.help ? EXIT_SUCCESS : EXIT_INVALID_ARGS;
+    }
+
+    if (opts.target == "detect") {
+        return BenchDetect(opts.iterations);
+    }
+    if (opts.target == "shell") {
+        return BenchShell(opts.iterations);
+    }
+    if (opts.target == "relay") {
+        return BenchRelay(opts.iterations, opts.channel);
+    }
+    if (opts.target == "hid") {
+        return BenchHid(opts.iterations);
+    }
+
+    fprintf(stderr, "Error: Unknown bench target '%s'\n", opts.target.c_str());
+    ShowBenchUsage();
+    return EXIT_INVALID_ARGS;
+}
+
+} // namespace commands
+} // namespace hdd
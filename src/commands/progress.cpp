@@ -0,0 +1,27 @@
+// Operation progress for HDD Toggle
+// Lets wake/sleep surface live status (e.g. helper output) to whoever is
+// driving them: the tray shows it in its tooltip, the CLI prints it anyway
+
+#include "commands.h"
+#include <atomic>
+
+namespace hdd {
+namespace commands {
+
+namespace {
+
+std::atomic<ProgressHandler> g_progressHandler(nullptr);
+
+} // anonymous namespace
+
+void SetProgressHandler(ProgressHandler handler) {
+    g_progressHandler = handler;
+}
+
+void ReportProgress(const char* message) {
+    ProgressHandler handler = g_progressHandler.load();
+    if (handler) handler(message);
+}
+
+} // namespace commands
+} // namespace hdd
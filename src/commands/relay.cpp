@@ -4,179 +4,183 @@
 
 #include "commands.h"
 #include "hdd-toggle.h"
+#include "core/config.h"
+#include "core/relay-device.h"
 #include <windows.h>
-#include <hidsdi.h>
-#include <setupapi.h>
+#include <chrono>
 #include <cstdio>
 #include <cstring>
+#include <memory>
 #include <string>
-
-#pragma comment(lib, "hid.lib")
-#pragma comment(lib, "setupapi.lib")
+#include <vector>
 
 namespace hdd {
 namespace commands {
 
 namespace {
 
-// Enumerate HID devices and open the first one that matches VENDOR_ID/PRODUCT_ID.
-// Returns INVALID_HANDLE_VALUE on failure. On success, caller must CloseHandle().
-HANDLE FindRelayDevice() {
-    GUID hidGuid;
-    HidD_GetHidGuid(&hidGuid);
-
-    HDEVINFO deviceInfo = SetupDiGetClassDevs(&hidGuid, NULL, NULL,
-                                               DIGCF_PRESENT | DIGCF_DEVICEINTERFACE);
-
-    if (deviceInfo == INVALID_HANDLE_VALUE) return INVALID_HANDLE_VALUE;
-
-    SP_DEVICE_INTERFACE_DATA interfaceData = {sizeof(SP_DEVICE_INTERFACE_DATA)};
-
-    // Stack allocation to avoid malloc/free
-    BYTE buffer[1024];
-    PSP_DEVICE_INTERFACE_DETAIL_DATA detailData = (PSP_DEVICE_INTERFACE_DETAIL_DATA)buffer;
-
-    // Enumerate all present HID device interfaces
-    for (DWORD i = 0; SetupDiEnumDeviceInterfaces(deviceInfo, NULL, &hidGuid, i, &interfaceData); i++) {
-        DWORD requiredSize;
-        // First call asks for the required buffer size
-        SetupDiGetDeviceInterfaceDetail(deviceInfo, &interfaceData, NULL, 0, &requiredSize, NULL);
-
-        if (requiredSize > sizeof(buffer)) continue;
-
-        // cbSize must be set before retrieving interface details
-        detailData->cbSize = sizeof(SP_DEVICE_INTERFACE_DETAIL_DATA);
-
-        if (SetupDiGetDeviceInterfaceDetail(deviceInfo, &interfaceData,
-                                           detailData, requiredSize, NULL, NULL)) {
-
-            // Open the HID device path for read/write, allowing shared access
-            HANDLE device = CreateFile(detailData->DevicePath,
-                                     GENERIC_READ | GENERIC_WRITE,
-                                     FILE_SHARE_READ | FILE_SHARE_WRITE,
-                                     NULL, OPEN_EXISTING, 0, NULL);
-
-            if (device != INVALID_HANDLE_VALUE) {
-                HIDD_ATTRIBUTES attributes = {sizeof(HIDD_ATTRIBUTES)};
-
-                if (HidD_GetAttributes(device, &attributes)) {
-                    if (attributes.VendorID == RELAY_VENDOR_ID &&
-                        attributes.ProductID == RELAY_PRODUCT_ID) {
-                        SetupDiDestroyDeviceInfoList(deviceInfo);
-                        return device;
-                    }
-                }
+const char* RelayName(int relayNum) {
+    static const char* const names[] = {"ALL", "1", "2", "3", "4", "5", "6", "7", "8"};
+    return relayNum >= 0 && relayNum <= 8 ? names[relayNum] : "?";
+}
 
-                CloseHandle(device);
+// Control the relay with given parameters
+// relayNum: 0 = all relays, 1..RELAY_CHANNEL_COUNT = specific relay
+// stateOn: true = ON, false = OFF
+bool ControlRelay(int relayNum, bool stateOn) {
+    // The shared connection keeps the device open between switches and only
+    // enumerates HID devices again if the handle went stale
+    core::RelayConnection& relay = core::GetRelayConnection();
+    switch (relay.Switch(relayNum, stateOn)) {
+        case core::RelaySwitchResult::Switched:
+        case core::RelaySwitchResult::Unverified:
+            printf("Relay %s: %s\n", RelayName(relayNum), stateOn ? "ON" : "OFF");
+            return true;
+
+        case core::RelaySwitchResult::Skipped:
+            printf("Relay %s: %s (already)\n", RelayName(relayNum), stateOn ? "ON" : "OFF");
+            return true;
+
+        default:
+            if (relay.LastError() == core::RelayError::Failed) {
+                fprintf(stderr, "Error: Failed to switch relay %s\n", RelayName(relayNum));
+            } else {
+                fprintf(stderr, "Error: %s\n", core::RelayErrorMessage(relay.LastError()));
             }
+            return false;
+    }
+}
+
+// Print each channel's state; fresh bypasses the cached state
+bool ShowRelayStatus(bool fresh) {
+    core::RelayConnection& relay = core::GetRelayConnection();
+
+    auto start = std::chrono::steady_clock::now();
+    uint8_t mask = 0;
+    bool ok = relay.GetState(mask, fresh);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    if (!ok) {
+        if (relay.LastError() == core::RelayError::Failed) {
+            fprintf(stderr, "Error: Failed to read relay state\n");
+        } else {
+            fprintf(stderr, "Error: %s\n", core::RelayErrorMessage(relay.LastError()));
         }
+        return false;
     }
 
-    SetupDiDestroyDeviceInfoList(deviceInfo);
-    return INVALID_HANDLE_VALUE;
+    for (int channel = 1; channel <= RELAY_CHANNEL_COUNT; channel++) {
+        printf("Relay %d: %s\n", channel, (mask & core::RelayChannelMask(channel)) ? "ON" : "OFF");
+    }
+    printf("(read in %lld us)\n", static_cast<long long>(elapsed.count()));
+    return true;
 }
 
-// Control the relay with given parameters
-// relayNum: 0 = all relays, 1 or 2 = specific relay
-// stateOn: true = ON, false = OFF
-bool ControlRelay(int relayNum, bool stateOn) {
-    HANDLE device = FindRelayDevice();
+// Run timed steps on the shared connection and print how close each step
+// came to its planned time
+bool RunSequence(const std::vector<core::RelayStep>& steps) {
+    std::unique_ptr<core::SequenceClock> clock = core::CreatePrecisionClock();
+    core::RelaySequenceResult result = core::RunRelaySequence(core::GetRelayConnection(), steps, *clock);
+
+    for (size_t i = 0; i < result.steps.size(); i++) {
+        const core::RelayStepTiming& timing = result.steps[i];
+        printf("  +%7.1f ms  relay %s %-3s  (error %+lld us)%s\n",
+               timing.issuedUs / 1000.0, RelayName(steps[i].channel), steps[i].on ? "ON" : "OFF",
+               static_cast<long long>(timing.ErrorUs()),
+               timing.result == core::RelaySwitchResult::Skipped ? " already" :
+               timing.result == core::RelaySwitchResult::Failed ? " FAILED" : "");
+    }
 
-    if (device == INVALID_HANDLE_VALUE) {
-        fprintf(stderr, "Error: USB relay not found\n");
+    if (!result.ok) {
+        fprintf(stderr, "Error: %s (sequence stopped at step %zu)\n",
+                core::RelayErrorMessage(core::GetRelayConnection().LastError()), result.steps.size());
         return false;
     }
+    printf("Sequence complete: max timing error %lld us\n", static_cast<long long>(result.MaxErrorUs()));
+    return true;
+}
 
-    unsigned char report[RELAY_REPORT_SIZE] = {0};
-
-    // Command lookup table to map (target, state) -> command byte.
-    // Row 0 = all relays, Row 1 = single relay
-    // Column 0 = OFF, Column 1 = ON
-    // Values are specific to the relay firmware:
-    //   0xFC=ALL OFF, 0xFE=ALL ON, 0xFD=SINGLE OFF, 0xFF=SINGLE ON
-    static const unsigned char commands[2][2] = {{0xFC, 0xFE}, {0xFD, 0xFF}};
-
-    report[0] = 0;  // Report ID
-    report[1] = commands[relayNum > 0 ? 1 : 0][stateOn ? 1 : 0];
-    if (relayNum > 0) report[2] = static_cast<unsigned char>(relayNum);
-
-    BOOLEAN result = HidD_SetFeature(device, report, RELAY_REPORT_SIZE);
-    CloseHandle(device);
-
-    if (result) {
-        printf("Relay %s: %s\n",
-               relayNum == 0 ? "ALL" : (relayNum == 1 ? "1" : "2"),
-               stateOn ? "ON" : "OFF");
-        return true;
-    } else {
-        fprintf(stderr, "Error: Failed to send command\n");
+bool RunSequenceSpec(const std::string& spec) {
+    std::vector<core::RelayStep> steps;
+    std::string error;
+    if (!core::ParseRelaySequence(spec, steps, error)) {
+        fprintf(stderr, "Error: %s\n", error.c_str());
         return false;
     }
+    return RunSequence(steps);
 }
 
 void ShowRelayUsage() {
     printf("USB Relay Control (DCT Tech dual-channel relay)\n");
     printf("Usage: hdd-toggle relay <on|off>        (controls all relays)\n");
     printf("       hdd-toggle relay <1|2> <on|off>  (controls specific relay)\n");
+    printf("       hdd-toggle relay status [--fresh] (shows relay states)\n");
+    printf("       hdd-toggle relay sequence <steps> (timed steps, e.g. 2:on 200 1:on)\n");
 }
 
 } // anonymous namespace
 
 // Public helper for internal use by wake/sleep commands
+// Uses the [Relay] wake/sleep sequence when one is configured
 bool ControlRelayPower(bool on) {
-    return ControlRelay(0, on);
+    const RelaySettings& settings = core::GetConfig().relay;
+    std::string spec = on ? settings.wakeSequence : settings.sleepSequence;
+    bool reverse = !on && spec.empty() && !settings.wakeSequence.empty();
+    if (reverse) spec = settings.wakeSequence;
+    if (spec.empty()) return ControlRelay(0, on);
+
+    std::vector<core::RelayStep> steps;
+    std::string error;
+    if (!core::ParseRelaySequence(spec, steps, error)) {
+        fprintf(stderr, "Warning: [Relay] %s: %s; switching all relays at once\n",
+                reverse || on ? "WakeSequence" : "SleepSequence", error.c_str());
+        return ControlRelay(0, on);
+    }
+    if (reverse) steps = core::ReverseRelaySequence(steps);
+
+    printf("Relay sequence: %s\n", core::FormatRelaySequence(steps).c_str());
+    return RunSequence(steps);
+}
+
+bool ControlRelayChannel(int channel, bool on) {
+    return ControlRelay(channel, on);
+}
+
+// A drive with its own channel must not switch the rest of the pool
+bool ControlDrivePower(const DriveTarget& drive, bool on) {
+    if (drive.relayChannel > 0) return ControlRelayChannel(drive.relayChannel, on);
+    return ControlRelayPower(on);
+}
+
+std::string DrivePowerTarget(const DriveTarget& drive) {
+    return drive.relayChannel > 0 ? "relay " + std::to_string(drive.relayChannel) : "all relays";
 }
 
 int RunRelay(int argc, char* argv[]) {
     // argv[0] is "relay", actual args start at argv[1]
     // Adjust for the fact that we receive args after "relay" command
+    core::RelayArgs args = core::ParseRelayArgs(argc, argv);
 
-    if (argc < 1) {
-        ShowRelayUsage();
-        return EXIT_SUCCESS;  // Not an error - user likely wants to see usage
-    }
-
-    // Check for help flag
-    if (argc == 1 && (strcmp(argv[0], "-h") == 0 ||
-                      strcmp(argv[0], "--help") == 0 ||
-                      strcmp(argv[0], "/?") == 0)) {
-        ShowRelayUsage();
-        return EXIT_SUCCESS;
-    }
+    switch (args.action) {
+        case core::RelayAction::Usage:
+            ShowRelayUsage();
+            return EXIT_SUCCESS;  // Not an error - user likely wants to see usage
 
-    // Support shorthand: "on" or "off" means control ALL relays
-    if (argc == 1 && (_stricmp(argv[0], "on") == 0 || _stricmp(argv[0], "off") == 0)) {
-        bool stateOn = (_stricmp(argv[0], "on") == 0);
-        return ControlRelay(0, stateOn) ? EXIT_SUCCESS : EXIT_OPERATION_FAILED;
-    }
+        case core::RelayAction::Switch:
+            return ControlRelay(args.channel, args.on) ? EXIT_SUCCESS : EXIT_OPERATION_FAILED;
 
-    // Two arguments: relay number and state
-    if (argc != 2) {
-        fprintf(stderr, "Error: Invalid arguments\n");
-        ShowRelayUsage();
-        return EXIT_INVALID_ARGS;
-    }
+        case core::RelayAction::Status:
+            return ShowRelayStatus(args.fresh) ? EXIT_SUCCESS : EXIT_OPERATION_FAILED;
 
-    // Parse relay number
-    int relayNum = -1;
-    if (_stricmp(argv[0], "all") == 0) relayNum = 0;
-    else if (argv[0][0] == '1' && argv[0][1] == '\0') relayNum = 1;
-    else if (argv[0][0] == '2' && argv[0][1] == '\0') relayNum = 2;
-    else {
-        fprintf(stderr, "Error: Invalid relay '%s' (use 1, 2, or all)\n", argv[0]);
-        return EXIT_INVALID_ARGS;
-    }
+        case core::RelayAction::Sequence:
+            return RunSequenceSpec(args.sequence) ? EXIT_SUCCESS : EXIT_OPERATION_FAILED;
 
-    // Parse state
-    bool stateOn;
-    if (_stricmp(argv[1], "on") == 0) stateOn = true;
-    else if (_stricmp(argv[1], "off") == 0) stateOn = false;
-    else {
-        fprintf(stderr, "Error: Invalid state '%s' (use on or off)\n", argv[1]);
-        return EXIT_INVALID_ARGS;
+        default:
+            fprintf(stderr, "Error: %s\n", args.error.c_str());
+            if (args.showUsage) ShowRelayUsage();
+            return EXIT_INVALID_ARGS;
     }
-
-    return ControlRelay(relayNum, stateOn) ? EXIT_SUCCESS : EXIT_OPERATION_FAILED;
 }
 
 } // namespace commands
@@ -4,12 +4,14 @@
 
 #include "commands.h"
 #include "hdd-toggle.h"
+#include "hdd-utils.h"
 #include "core/process.h"
 #include "core/admin.h"
+#include "core/config.h"
 #include "core/disk.h"
+#include "core/storage.h"
 #include <windows.h>
 #include <cstdio>
-#include <cstring>
 #include <string>
 #include <vector>
 
@@ -23,10 +25,17 @@ namespace {
 
 const int MAX_COMMAND_LEN = 1024;
 const int MAX_PATH_LEN = 512;
+const uint32_t REMOVE_DRIVE_ATTEMPT_TIMEOUT_MS = 20000;
+const uint32_t REMOVE_DRIVE_TOTAL_TIMEOUT_MS = 60000;
+const size_t REMOVE_DRIVE_RETAINED_BYTES = 4096;
+const uint32_t BLOCKER_CLOSE_WAIT_MS = 5000;
+const uint32_t BLOCKER_POLL_MS = 500;
 
 struct SleepOptions {
     bool help = false;
     bool offline = false;
+    bool closeBlockers = false;
+    bool force = false;
 };
 
 // Parse command line arguments
@@ -40,6 +49,12 @@ SleepOptions ParseSleepArgs(int argc, char* argv[]) {
         else if (_stricmp(argv[i], "-offline") == 0 || _stricmp(argv[i], "--offline") == 0) {
             opts.offline = true;
         }
+        else if (_stricmp(argv[i], "-close-blockers") == 0 || _stricmp(argv[i], "--close-blockers") == 0) {
+            opts.closeBlockers = true;
+        }
+        else if (_stricmp(argv[i], "-force") == 0 || _stricmp(argv[i], "--force") == 0) {
+            opts.force = true;
+        }
     }
 
     return opts;
@@ -47,89 +62,120 @@ SleepOptions ParseSleepArgs(int argc, char* argv[]) {
 
 void ShowSleepUsage() {
     printf("Sleep HDD - Safely eject and power down hard drive\n\n");
-    printf("Usage: hdd-toggle sleep [--offline] [-h|--help]\n\n");
+    printf("Usage: hdd-toggle sleep [--offline] [--close-blockers] [--force] [-h|--help]\n\n");
     printf("Options:\n");
-    printf("  --offline    Take disk offline before power down (requires Administrator)\n");
-    printf("  -h, --help   Show this help message\n\n");
-    printf("Target: %s (Serial: %s)\n\n", DEFAULT_TARGET_MODEL, DEFAULT_TARGET_SERIAL);
+    printf("  --offline          Take disk offline before power down (requires Administrator)\n");
+    printf("  --close-blockers   Ask programs with files open on the drive to close first\n");
+    printf("  --force            Power off even if the drive is in use or was not ejected\n");
+    printf("  -h, --help         Show this help message\n\n");
+    printf("Target: %s (Serial: %s)\n\n", core::GetConfig().targetModel.c_str(), core::GetConfig().targetSerial.c_str());
     printf("Notes:\n");
+    printf("  - Lists programs with files open on the drive before ejecting\n");
     printf("  - Attempts safe removal using various methods\n");
-    printf("  - Falls back to relay power-off regardless\n");
+    printf("  - Power is only cut once the drive has been ejected, unless --force is given\n");
 }
 
 // Check if target disk exists and get its info
 bool GetTargetDiskInfo(std::string& modelOut, int& diskIndex) {
-    char command[MAX_COMMAND_LEN];
-    const char* tempFile = "disk_sleep_info.tmp";
-
-    snprintf(command, sizeof(command),
-        "powershell.exe -NoProfile -ExecutionPolicy Bypass -Command "
-        "\"$disk = Get-CimInstance -ClassName Win32_DiskDrive | Where-Object { $_.SerialNumber -match '%s' -or $_.Model -match '%s' } -ErrorAction SilentlyContinue | Select-Object -First 1; "
-        "if ($disk) { ($disk.Model + '|' + $disk.Index) | Out-File -FilePath '%s' -Encoding ASCII }\"",
-        DEFAULT_TARGET_SERIAL, DEFAULT_TARGET_MODEL, tempFile);
-
-    if (core::ExecuteCommand(command, true) == 0) {
-        Sleep(500);
-        FILE* fp = fopen(tempFile, "r");
-        if (fp) {
-            char line[256];
-            if (fgets(line, sizeof(line), fp)) {
-                line[strcspn(line, "\r\n")] = '\0';
-
-                char* pipePos = strchr(line, '|');
-                if (pipePos) {
-                    *pipePos = '\0';
-                    modelOut = line;
-                    diskIndex = atoi(pipePos + 1);
-                    fclose(fp);
-                    DeleteFileA(tempFile);
-                    return true;
-                }
-            }
-            fclose(fp);
-        }
+    core::DiskRecord disk;
+    if (!core::FindTargetDisk(core::GetConfig().targetSerial, core::GetConfig().targetModel, disk)) {
+        return false;
     }
 
-    DeleteFileA(tempFile);
-    return false;
+    modelOut = disk.model;
+    diskIndex = disk.number;
+    return true;
 }
 
 // Get drive letters for the target disk
-std::vector<std::string> GetDriveLetters() {
-    std::vector<std::string> letters;
-    char command[MAX_COMMAND_LEN];
-    const char* tempFile = "drive_letters.tmp";
-
-    snprintf(command, sizeof(command),
-        "powershell.exe -NoProfile -ExecutionPolicy Bypass -Command "
-        "\"$disk = Get-CimInstance Win32_DiskDrive | Where-Object { $_.SerialNumber -match '%s' -or $_.Model -match '%s' } | Select-Object -First 1; "
-        "if ($disk) { "
-        "$parts = Get-CimAssociatedInstance -InputObject $disk -Association Win32_DiskDriveToDiskPartition -ErrorAction SilentlyContinue; "
-        "foreach ($p in $parts) { "
-        "$ldisks = Get-CimAssociatedInstance -InputObject $p -Association Win32_LogicalDiskToPartition -ErrorAction SilentlyContinue; "
-        "foreach ($ld in $ldisks) { if ($ld.DeviceID) { $ld.DeviceID | Out-File -FilePath '%s' -Encoding ASCII -Append } } } }\"",
-        DEFAULT_TARGET_SERIAL, DEFAULT_TARGET_MODEL, tempFile);
-
-    // Delete temp file first since we're using -Append
-    DeleteFileA(tempFile);
-
-    if (core::ExecuteCommand(command, true) == 0) {
-        Sleep(500);
-        FILE* fp = fopen(tempFile, "r");
-        if (fp) {
-            char line[16];
-            while (fgets(line, sizeof(line), fp)) {
-                line[strcspn(line, "\r\n")] = '\0';
-                if (strlen(line) > 0 && strlen(line) < 4) {
-                    letters.push_back(std::string(line));
-                }
-            }
-            fclose(fp);
+std::vector<std::string> GetDriveLetters(int diskIndex) {
+    return core::GetDiskDriveLetters(diskIndex);
+}
+
+// The disk's volumes that are mounted somewhere; only these can hold
+// cached data or open files
+std::vector<core::VolumeMount> GetMountedVolumes(int diskIndex) {
+    std::vector<core::VolumeMount> mounted;
+    for (auto& volume : core::ResolveDiskVolumes(diskIndex)) {
+        if (!volume.mountPoints.empty()) mounted.push_back(std::move(volume));
+    }
+    return mounted;
+}
+
+// Write back every mounted volume of the disk in parallel, so the ejection
+// does not race the system's own write-back. Returns false if any flush failed.
+bool FlushDiskVolumes(const std::vector<core::VolumeMount>& mounted) {
+    std::vector<std::string> volumes;
+    std::vector<std::string> labels;
+    for (const auto& volume : mounted) {
+        volumes.push_back(volume.volumeName);
+        labels.push_back(volume.mountPoints.front());
+    }
+    if (volumes.empty()) return true;
+
+    printf("Flushing %zu volume(s)...\n", volumes.size());
+    ReportProgress("Flushing volumes...");
+    ULONGLONG start = GetTickCount64();
+    std::vector<core::VolumeFlushResult> results = core::FlushVolumesInParallel(volumes, core::FlushVolume);
+
+    bool allFlushed = true;
+    uint64_t totalBytes = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        const core::VolumeFlushResult& result = results[i];
+        if (result.ok) {
+            std::string written = result.bytesKnown ? core::FormatByteCount(result.bytesWritten) : "unknown size";
+            printf("  %s: flushed %s in %u ms\n", labels[i].c_str(), written.c_str(), result.durationMs);
+            totalBytes += result.bytesWritten;
+        } else if (result.accessDenied) {
+            printf("  %s: not flushed (requires Administrator)\n", labels[i].c_str());
+            allFlushed = false;
+        } else {
+            printf("  %s: flush failed after %u ms\n", labels[i].c_str(), result.durationMs);
+            allFlushed = false;
         }
     }
+    printf("Flush stage: %s in %llu ms\n", core::FormatByteCount(totalBytes).c_str(),
+           static_cast<unsigned long long>(GetTickCount64() - start));
+    return allFlushed;
+}
+
+void PrintBlockers(const std::vector<core::BlockerProcess>& blockers) {
+    printf("Open on the drive:\n");
+    for (const auto& blocker : blockers) {
+        printf("  %s\n", core::FormatBlocker(blocker).c_str());
+    }
+}
+
+// Report what holds the drive open, and with --close-blockers ask it to
+// close and wait a little for it to go. Returns what is still open.
+std::vector<core::BlockerProcess> CheckBlockers(const std::vector<core::VolumeMount>& volumes, bool close) {
+    if (volumes.empty()) return std::vector<core::BlockerProcess>();
+
+    ULONGLONG start = GetTickCount64();
+    std::vector<core::BlockerProcess> blockers = core::FindVolumeBlockers(volumes);
+    printf("Blocker scan: %zu process(es) in %llu ms\n", blockers.size(),
+           static_cast<unsigned long long>(GetTickCount64() - start));
+    if (blockers.empty()) return blockers;
+
+    PrintBlockers(blockers);
+    if (!close) return blockers;
+
+    size_t asked = core::RequestBlockersClose(blockers);
+    printf("Asked %zu window(s) to close; waiting up to %u ms...\n", asked, BLOCKER_CLOSE_WAIT_MS);
+    ReportProgress("Closing programs using the drive...");
 
-    DeleteFileA(tempFile);
-    return letters;
+    uint64_t deadline = DeadlineAfter(GetTickCount64(), BLOCKER_CLOSE_WAIT_MS);
+    while (!blockers.empty() && GetTickCount64() < deadline) {
+        Sleep(BLOCKER_POLL_MS);
+        blockers = core::FindVolumeBlockers(volumes);
+    }
+    if (blockers.empty()) {
+        printf("Drive released\n");
+    } else {
+        printf("Still in use after waiting.\n");
+        PrintBlockers(blockers);
+    }
+    return blockers;
 }
 
 // Find RemoveDrive.exe in PATH or current directory
@@ -137,64 +183,88 @@ std::string FindRemoveDrive() {
     return core::FindExecutable("RemoveDrive.exe");
 }
 
-// Attempt safe removal using RemoveDrive.exe with proper retry logic
-bool AttemptSafeRemoval(const std::vector<std::string>& letters) {
+// Attempt safe removal using RemoveDrive.exe with proper retry logic. A
+// retry only helps when the veto was transient: if a process still holds
+// the drive, say which and stop instead of waiting out the retries.
+bool AttemptSafeRemoval(const std::vector<std::string>& letters, const std::vector<core::VolumeMount>& volumes) {
     std::string removeDrivePath = FindRemoveDrive();
 
     if (removeDrivePath.empty()) {
-        printf("RemoveDrive.exe not found on PATH or current directory. Skipping safe removal and powering off.\n");
+        printf("RemoveDrive.exe not found on PATH or current directory. Cannot eject the drive safely.\n");
         return false;
     }
 
     printf("Found RemoveDrive.exe: %s\n", removeDrivePath.c_str());
 
+    // A hung RemoveDrive must not hold up the power-down (or the tray) forever
+    uint64_t deadline = DeadlineAfter(GetTickCount64(), REMOVE_DRIVE_TOTAL_TIMEOUT_MS);
+
     // Try each drive letter with retries
     for (int retry = 1; retry <= 3; retry++) {
         for (const auto& letter : letters) {
             char command[MAX_COMMAND_LEN];
             snprintf(command, sizeof(command), "\"%s\" %s -b", removeDrivePath.c_str(), letter.c_str());
 
+            uint32_t timeoutMs = StepTimeoutMs(REMOVE_DRIVE_ATTEMPT_TIMEOUT_MS, deadline, GetTickCount64());
+            if (timeoutMs == 0) {
+                printf("Safe removal ran out of time.\n");
+                return false;
+            }
+
             printf("RemoveDrive attempt %d: %s -b\n", retry, letter.c_str());
 
-            int exitCode = core::ExecuteCommand(command, false);
-            if (exitCode == 0) {
+            // Capture output over a pipe: no console window pops up when run
+            // from the tray, and each line is logged (and shown by the tray)
+            // as RemoveDrive prints it. Only a short tail is kept in memory.
+            core::CaptureOptions capture;
+            capture.maxRetainedBytes = REMOVE_DRIVE_RETAINED_BYTES;
+            capture.onLine = [](core::OutputSource, const std::string& line) {
+                if (TrimWhitespace(line).empty()) return;
+                printf("  RemoveDrive: %s\n", line.c_str());
+                ReportProgress(line.c_str());
+            };
+            core::CommandResult result = core::RunCommand(command, timeoutMs, capture);
+
+            if (result.timedOut) {
+                printf("RemoveDrive timed out for %s after %u ms and was stopped\n", letter.c_str(), timeoutMs);
+            } else if (result.exitCode == 0) {
                 printf("Safe removal succeeded via RemoveDrive (%s)\n", letter.c_str());
                 return true;
             } else {
-                printf("RemoveDrive failed for %s (exit code: %d)\n", letter.c_str(), exitCode);
+                printf("RemoveDrive failed for %s (exit code: %d)\n", letter.c_str(), result.exitCode);
             }
         }
 
         if (retry < 3) {
+            std::vector<core::BlockerProcess> blockers = core::FindVolumeBlockers(volumes);
+            if (!blockers.empty()) {
+                PrintBlockers(blockers);
+                printf("Not retrying while the drive is in use.\n");
+                return false;
+            }
             printf("Retrying in 2 seconds...\n");
             Sleep(2000);
         }
     }
 
-    printf("Safe removal did not complete after retries; proceeding anyway.\n");
+    printf("Safe removal did not complete after retries.\n");
     return false;
 }
 
-// Take disk offline using diskpart (requires admin)
+// Take disk offline (requires admin)
 bool TakeDiskOffline(int diskIndex) {
     if (!core::IsRunningAsAdmin()) {
         printf("WARNING: --offline requested but not running as Administrator. Skipping offline.\n");
         return false;
     }
 
-    printf("Taking disk offline via diskpart (Disk %d)...\n", diskIndex);
-
-    char command[MAX_COMMAND_LEN];
-    snprintf(command, sizeof(command),
-        "echo select disk %d & echo offline disk | diskpart",
-        diskIndex);
+    printf("Taking disk offline (Disk %d)...\n", diskIndex);
 
-    if (core::ExecuteCommand(command, true) == 0) {
+    if (core::SetDiskOffline(diskIndex, true)) {
         printf("Disk taken offline successfully\n");
-        Sleep(1000);
         return true;
     } else {
-        printf("diskpart offline failed\n");
+        printf("Failed to take disk offline\n");
         return false;
     }
 }
@@ -205,7 +275,7 @@ int RunSleep(int argc, char* argv[]) {
     SleepOptions opts = ParseSleepArgs(argc, argv);
 
     printf("HDD Sleep Utility\n");
-    printf("Target: %s (Serial: %s)\n\n", DEFAULT_TARGET_MODEL, DEFAULT_TARGET_SERIAL);
+    printf("Target: %s (Serial: %s)\n\n", core::GetConfig().targetModel.c_str(), core::GetConfig().targetSerial.c_str());
 
     // Show help if requested
     if (opts.help) {
@@ -225,8 +295,20 @@ int RunSleep(int argc, char* argv[]) {
     } else {
         printf("Found disk: %s (Index: %d)\n", model.c_str(), diskIndex);
 
-        // 2. Get drive letters for safe removal
-        std::vector<std::string> letters = GetDriveLetters();
+        // 2. Write back cached data before anything tries to eject
+        std::vector<core::VolumeMount> volumes = GetMountedVolumes(diskIndex);
+        FlushDiskVolumes(volumes);
+
+        // 3. See what would veto the ejection. Cutting power under open
+        // files loses data, so stop here unless forced.
+        if (!CheckBlockers(volumes, opts.closeBlockers).empty() && !opts.force) {
+            printf("\nDrive is in use; not powering off. Close these programs (or use --close-blockers)\n");
+            printf("and run sleep again, or use --force to power off anyway.\n");
+            return EXIT_OPERATION_FAILED;
+        }
+
+        // 4. Get drive letters for safe removal
+        std::vector<std::string> letters = GetDriveLetters(diskIndex);
 
         if (!letters.empty()) {
             printf("Found %zu drive letter(s): ", letters.size());
@@ -235,30 +317,35 @@ int RunSleep(int argc, char* argv[]) {
             }
             printf("\n");
 
-            // 3. Attempt safe removal
-            bool safeRemovalSucceeded = AttemptSafeRemoval(letters);
+            // 5. Attempt safe removal
+            bool safeRemovalSucceeded = AttemptSafeRemoval(letters, volumes);
+            if (!safeRemovalSucceeded && !opts.force) {
+                printf("\nSafe removal failed; not powering off. Use --force to power off anyway.\n");
+                return EXIT_OPERATION_FAILED;
+            }
             if (!safeRemovalSucceeded) {
-                printf("WARNING: Safe removal failed - drive may not have been safely ejected\n");
+                printf("WARNING: Safe removal failed - powering off anyway (--force)\n");
             }
         } else {
             printf("No drive letters found for target disk.\n");
         }
 
-        // 4. Optional: Take disk offline
+        // 6. Optional: Take disk offline
         if (opts.offline) {
             TakeDiskOffline(diskIndex);
         }
     }
 
-    // 5. Always power down relays
+    // 7. Power down the drive's relay channel (all channels if it has none)
+    const DriveTarget& drive = core::GetConfig().drives.front();
     printf("Powering down HDD...\n");
-    if (!ControlRelayPower(false)) {
+    if (!ControlDrivePower(drive, false)) {
         printf("ERROR: Failed to deactivate relay power\n");
         return EXIT_OPERATION_FAILED;
     }
-    printf("Power OFF: Both relays deactivated\n");
+    printf("Power OFF: %s deactivated\n", DrivePowerTarget(drive).c_str());
 
-    // 6. Final status
+    // 8. Final status
     printf("\n");
     if (diskFound) {
         printf("HDD SLEEP COMPLETE\n");
@@ -267,6 +354,7 @@ int RunSleep(int argc, char* argv[]) {
         printf("HDD POWER DOWN COMPLETE\n");
         printf("Drive not detected by Windows at time of power down\n");
     }
+    printf("Helper processes started: %lu\n", core::GetSpawnedProcessCount());
     printf("\n");
     printf("To wake the drive again, run: hdd-toggle wake\n");
 
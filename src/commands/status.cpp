@@ -5,11 +5,14 @@
 #include "commands.h"
 #include "hdd-toggle.h"
 #include "hdd-utils.h"
+#include "core/config.h"
 #include "core/disk.h"
+#include "core/storage.h"
 #include <windows.h>
 #include <cstdio>
 #include <cstring>
 #include <string>
+#include <vector>
 
 namespace hdd {
 namespace commands {
@@ -37,32 +40,53 @@ StatusOptions ParseStatusArgs(int argc, char* argv[]) {
 }
 
 void ShowStatusUsage() {
+    const Config& config = core::GetConfig();
+
     printf("Drive Status - Show current hard drive status\n\n");
     printf("Usage: hdd-toggle status [--json] [-h|--help]\n\n");
     printf("Options:\n");
     printf("  --json, -j   Output in JSON format for scripting\n");
     printf("  -h, --help   Show this help message\n\n");
-    printf("Target: %s (Serial: %s)\n", DEFAULT_TARGET_MODEL, DEFAULT_TARGET_SERIAL);
+    for (const auto& drive : config.drives) {
+        printf("Target: %s (Serial: %s)\n", drive.model.c_str(), drive.serial.c_str());
+    }
 }
 
-void OutputJson(const core::DriveInfo& info) {
+// Fields shared by the top-level (primary drive) object and each drives[] entry
+void OutputJsonFields(const core::DriveInfo& info) {
     if (!info.found) {
-        printf("{\"status\":\"offline\",\"found\":false}\n");
+        printf("\"status\":\"offline\",\"found\":false");
         return;
     }
 
     const char* status = (info.state == DriveState::Online) ? "online" : "offline";
-    printf("{\"status\":\"%s\",\"found\":true,\"serial\":\"%s\",\"model\":\"%s\",\"disk\":%d}\n",
+    printf("\"status\":\"%s\",\"found\":true,\"serial\":\"%s\",\"model\":\"%s\",\"disk\":%d",
            status,
            info.serialNumber.c_str(),
            info.model.c_str(),
            info.diskNumber);
 }
 
+void OutputJson(const std::vector<core::DriveInfo>& infos) {
+    printf("{");
+    OutputJsonFields(infos.front());
+    printf(",\"drives\":[");
+    for (size_t i = 0; i < infos.size(); i++) {
+        printf("%s{\"name\":\"%s\",", i ? "," : "", infos[i].name.c_str());
+        if (!infos[i].found) {
+            // Identify missing drives by their configured serial
+            printf("\"serial\":\"%s\",", infos[i].serialNumber.c_str());
+        }
+        OutputJsonFields(infos[i]);
+        printf("}");
+    }
+    printf("]}\n");
+}
+
 void OutputText(const core::DriveInfo& info) {
     if (!info.found) {
         printf("Drive: OFFLINE (not detected)\n");
-        printf("Target: %s (Serial: %s)\n", DEFAULT_TARGET_MODEL, DEFAULT_TARGET_SERIAL);
+        printf("Target: %s (Serial: %s)\n", info.model.c_str(), info.serialNumber.c_str());
         return;
     }
 
@@ -71,6 +95,15 @@ void OutputText(const core::DriveInfo& info) {
     printf("Model: %s\n", info.model.c_str());
     printf("Serial: %s\n", info.serialNumber.c_str());
     printf("Disk Number: %d\n", info.diskNumber);
+
+    if (info.state == DriveState::Online) {
+        std::vector<core::VolumeMount> volumes = core::ResolveDiskVolumes(info.diskNumber);
+        printf("Mount Points:");
+        for (const auto& volume : volumes) {
+            for (const auto& mount : volume.mountPoints) printf(" %s", mount.c_str());
+        }
+        printf(volumes.empty() ? " (none)\n" : "\n");
+    }
 }
 
 } // anonymous namespace
@@ -83,12 +116,16 @@ int RunStatus(int argc, char* argv[]) {
         return EXIT_SUCCESS;
     }
 
-    core::DriveInfo info = core::DetectDriveInfo(DEFAULT_TARGET_SERIAL);
+    // One enumeration covers every configured drive
+    std::vector<core::DriveInfo> infos = core::DetectDriveInfos(core::GetConfig().drives);
 
     if (opts.json) {
-        OutputJson(info);
+        OutputJson(infos);
     } else {
-        OutputText(info);
+        for (size_t i = 0; i < infos.size(); i++) {
+            if (infos.size() > 1) printf("%s[%s]\n", i ? "\n" : "", infos[i].name.c_str());
+            OutputText(infos[i]);
+        }
     }
 
     return EXIT_SUCCESS;
@@ -6,14 +6,18 @@
 #include "hdd-toggle.h"
 #include "core/process.h"
 #include "core/admin.h"
+#include "core/config.h"
 #include "core/disk.h"
+#include "core/storage.h"
+#include "core/wake-pool.h"
+#include "core/wake-readiness.h"
 #include <windows.h>
-#include <shellapi.h>
 #include <cstdio>
-#include <cstring>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
-#pragma comment(lib, "shell32.lib")
 #pragma comment(lib, "advapi32.lib")
 
 namespace hdd {
@@ -21,150 +25,168 @@ namespace commands {
 
 namespace {
 
-const int MAX_COMMAND_LEN = 1024;
+const uint32_t ELEVATED_RESCAN_TIMEOUT_MS = 20000;
 
-// Check if disk is already online and available
-bool IsDiskOnline() {
-    char command[MAX_COMMAND_LEN];
-    snprintf(command, sizeof(command),
-        "powershell.exe -NoProfile -ExecutionPolicy Bypass -Command "
-        "\"$disk = Get-Disk | Where-Object { $_.SerialNumber -match '%s' -or $_.FriendlyName -match '%s' } -ErrorAction SilentlyContinue; "
-        "if ($disk -and -not $disk.IsOffline) { exit 0 } else { exit 1 }\"",
-        DEFAULT_TARGET_SERIAL, DEFAULT_TARGET_MODEL);
+struct WakeOptions {
+    bool help = false;
+    bool all = false;
+};
 
-    return core::ExecuteCommand(command, true) == 0;
-}
+WakeOptions ParseWakeArgs(int argc, char* argv[]) {
+    WakeOptions opts;
 
-// Get disk information for status display
-bool GetDiskInfo(std::string& friendlyName, int& diskNumber) {
-    char command[MAX_COMMAND_LEN];
-    const char* tempFile = "disk_info.tmp";
-
-    snprintf(command, sizeof(command),
-        "powershell.exe -NoProfile -ExecutionPolicy Bypass -Command "
-        "\"$disk = Get-Disk | Where-Object { $_.SerialNumber -match '%s' -or $_.FriendlyName -match '%s' } -ErrorAction SilentlyContinue; "
-        "if ($disk) { Write-Output \\\"$($disk.FriendlyName)|$($disk.Number)\\\" | Out-File -FilePath '%s' -Encoding ASCII }\"",
-        DEFAULT_TARGET_SERIAL, DEFAULT_TARGET_MODEL, tempFile);
-
-    if (core::ExecuteCommand(command, true) == 0) {
-        Sleep(500); // Give file time to be written
-        FILE* fp = fopen(tempFile, "r");
-        if (fp) {
-            char line[256];
-            if (fgets(line, sizeof(line), fp)) {
-                // Remove trailing newline/whitespace
-                line[strcspn(line, "\r\n")] = '\0';
-
-                char* pipePos = strchr(line, '|');
-                if (pipePos) {
-                    *pipePos = '\0';
-                    friendlyName = line;
-                    diskNumber = atoi(pipePos + 1);
-                    fclose(fp);
-                    DeleteFileA(tempFile);
-                    return true;
-                }
-            }
-            fclose(fp);
+    for (int i = 0; i < argc; i++) {
+        if (core::IsHelpFlag(argv[i])) {
+            opts.help = true;
+        }
+        else if (_stricmp(argv[i], "--all") == 0 || _stricmp(argv[i], "-a") == 0) {
+            opts.all = true;
         }
     }
 
-    DeleteFileA(tempFile);
-    return false;
+    return opts;
 }
 
 // Try to perform elevated device rescan
-bool TryElevatedDeviceRescan() {
+void TryElevatedDeviceRescan() {
     printf("Attempting elevated device rescan...\n");
 
-    HINSTANCE result = ShellExecuteA(NULL, "runas", "powershell.exe",
+    // Waits for the helper itself instead of a fixed 6 s sleep
+    if (core::RunElevated("powershell.exe",
         "-NoProfile -ExecutionPolicy Bypass -WindowStyle Hidden -Command \"try { pnputil /scan-devices | Out-Null } catch {} try { 'rescan' | diskpart | Out-Null } catch {} Start-Sleep -Seconds 2\"",
-        NULL, SW_HIDE);
-
-    // ShellExecute returns > 32 on success
-    if ((INT_PTR)result > 32) {
-        Sleep(6000); // Give time for elevated process to complete
-        return true;
+        ELEVATED_RESCAN_TIMEOUT_MS)) {
+        return;
     }
 
     printf("Elevated rescan failed or cancelled.\n");
-    return false;
 }
 
-// Perform non-elevated device rescan
-void PerformBasicDeviceRescan() {
-    printf("Performing basic device rescan...\n");
-    core::ExecuteCommand("pnputil /scan-devices", true);
-    core::ExecuteCommand("echo rescan | diskpart", true);
+// Rescan for hardware changes in-process; only needs a helper process when
+// not elevated, since re-enumeration requires administrator rights.
+// Pool members share elevatedOnce so one wake shows at most one UAC prompt.
+void PerformDeviceRescan(std::once_flag& elevatedOnce) {
+    static std::mutex rescanMutex;
+    {
+        std::lock_guard<std::mutex> lock(rescanMutex);
+        if (core::RescanDevices()) return;
+    }
+    std::call_once(elevatedOnce, TryElevatedDeviceRescan);
+}
+
+// Key for a drive's learned spin-up times
+std::string SpinUpKey(const DriveTarget& drive) {
+    return drive.serial.empty() ? drive.model : drive.serial;
+}
+
+// Wait for a freshly powered drive to appear. Probes follow the drive's
+// learned spin-up times and any disk arrival triggers one at once; the
+// rescan only happens if the drive is later than it usually is.
+// prefix labels output lines when several drives wake at once
+bool WaitForDrive(const DriveTarget& drive, const std::string& prefix, std::once_flag& elevatedOnce,
+                  core::DiskArrivalListener& arrivals, ULONGLONG powerOnMs, core::DiskRecord& disk) {
+    static std::mutex modelMutex;   // Pool members share the state file
+    core::SpinUpModel model;
+    {
+        std::lock_guard<std::mutex> lock(modelMutex);
+        model = core::LoadSpinUpModel(SpinUpKey(drive));
+    }
+
+    std::vector<uint32_t> probes = core::PlanProbeTimes(model.FirstProbeMs(), model.TimeoutMs());
+    uint32_t rescanAt = model.RescanAtMs();
+    bool rescanned = false;
+    uint64_t seen = arrivals.Count();
+
+    printf("%sWaiting for drive (usually %.1f s)...\n", prefix.c_str(),
+           (model.Count() > 0 ? model.Quantile(0.5) : core::DEFAULT_SPINUP_MS) / 1000.0);
+
+    for (size_t next = 0; next < probes.size();) {
+        uint32_t elapsed = static_cast<uint32_t>(GetTickCount64() - powerOnMs);
+        if (elapsed < probes[next]) {
+            // An arrival is worth a look now; otherwise wait out the gap
+            if (arrivals.WaitForArrival(seen, probes[next] - elapsed)) {
+                seen = arrivals.Count();
+            } else {
+                next++;
+            }
+        } else {
+            next++;
+        }
+
+        if (core::FindTargetDisk(drive.serial, drive.model, disk)) {
+            uint32_t took = static_cast<uint32_t>(GetTickCount64() - powerOnMs);
+            model.Record(took);
+            {
+                std::lock_guard<std::mutex> lock(modelMutex);
+                core::SaveSpinUpModel(SpinUpKey(drive), model);
+            }
+            printf("%sFound drive: %s (Disk %d) after %.1f s\n", prefix.c_str(),
+                   disk.model.c_str(), disk.number, took / 1000.0);
+            return true;
+        }
+
+        elapsed = static_cast<uint32_t>(GetTickCount64() - powerOnMs);
+        if (!rescanned && elapsed >= rescanAt) {
+            printf("%sDrive not detected yet, scanning for new devices...\n", prefix.c_str());
+            PerformDeviceRescan(elevatedOnce);
+            rescanned = true;
+        }
+    }
+
+    printf("%sERROR: Target drive not detected after %.0f seconds.\n", prefix.c_str(),
+           (GetTickCount64() - powerOnMs) / 1000.0);
+    printf("%sThe drive may need more time to initialize or there may be a hardware issue.\n", prefix.c_str());
+    return false;
 }
 
 // Check if disk is offline and try to bring it online
-bool BringDiskOnline() {
-    char command[MAX_COMMAND_LEN];
-
-    // First check if disk is offline
-    snprintf(command, sizeof(command),
-        "powershell.exe -NoProfile -ExecutionPolicy Bypass -Command "
-        "\"$disk = Get-Disk | Where-Object { $_.SerialNumber -match '%s' -or $_.FriendlyName -match '%s' } -ErrorAction SilentlyContinue; "
-        "if ($disk -and $disk.IsOffline) { exit 1 } else { exit 0 }\"",
-        DEFAULT_TARGET_SERIAL, DEFAULT_TARGET_MODEL);
-
-    if (core::ExecuteCommand(command, true) == 0) {
-        printf("Disk is already online\n");
+bool BringDiskOnline(const DriveTarget& drive, const std::string& prefix) {
+    core::DiskRecord disk;
+    if (!core::FindTargetDisk(drive.serial, drive.model, disk) || !disk.isOffline) {
+        printf("%sDisk is already online\n", prefix.c_str());
         return true;
     }
 
     // Disk is offline, try to bring it online
     if (!core::IsRunningAsAdmin()) {
-        printf("WARNING: Disk is offline but not running as Administrator.\n");
-        printf("Please run as Administrator to bring disk online.\n");
+        printf("%sWARNING: Disk is offline but not running as Administrator.\n", prefix.c_str());
+        printf("%sPlease run as Administrator to bring disk online.\n", prefix.c_str());
         return false;
     }
 
-    printf("Bringing disk online...\n");
-    snprintf(command, sizeof(command),
-        "powershell.exe -NoProfile -ExecutionPolicy Bypass -Command "
-        "\"$disk = Get-Disk | Where-Object { $_.SerialNumber -match '%s' -or $_.FriendlyName -match '%s' } -ErrorAction SilentlyContinue; "
-        "if ($disk -and $disk.IsOffline) { Set-Disk -Number $disk.Number -IsOffline $false; Start-Sleep -Seconds 1 }\"",
-        DEFAULT_TARGET_SERIAL, DEFAULT_TARGET_MODEL);
-
-    if (core::ExecuteCommand(command, true) == 0) {
-        printf("Disk brought online successfully\n");
+    printf("%sBringing disk online...\n", prefix.c_str());
+    if (core::SetDiskOffline(disk.number, false)) {
+        printf("%sDisk brought online successfully\n", prefix.c_str());
         return true;
     } else {
-        printf("Failed to bring disk online\n");
+        printf("%sFailed to bring disk online\n", prefix.c_str());
         return false;
     }
 }
 
 void ShowWakeUsage() {
+    const Config& config = core::GetConfig();
+
     printf("Wake HDD - Power on and initialize hard drive\n");
-    printf("Usage: hdd-toggle wake [-h|--help]\n\n");
-    printf("Target: %s (Serial: %s)\n", DEFAULT_TARGET_MODEL, DEFAULT_TARGET_SERIAL);
+    printf("Usage: hdd-toggle wake [--all] [-h|--help]\n\n");
+    printf("Options:\n");
+    printf("  --all, -a    Wake every configured drive, staggering relay channels\n");
+    printf("               to stay within [Power] InrushBudget\n");
+    printf("  -h, --help   Show this help message\n\n");
+    printf("Target: %s (Serial: %s)\n", config.targetModel.c_str(), config.targetSerial.c_str());
 }
 
-} // anonymous namespace
-
-int RunWake(int argc, char* argv[]) {
-    // Check for help flag
-    if (argc >= 1 && core::IsHelpFlag(argv[0])) {
-        ShowWakeUsage();
-        return EXIT_SUCCESS;
-    }
-
-    std::string friendlyName;
-    int diskNumber = -1;
-
+int WakeSingleDrive(const DriveTarget& drive) {
     printf("HDD Wake Utility\n");
-    printf("Target: %s (Serial: %s)\n\n", DEFAULT_TARGET_MODEL, DEFAULT_TARGET_SERIAL);
+    printf("Target: %s (Serial: %s)\n\n", drive.model.c_str(), drive.serial.c_str());
 
     // 1. Check if drive is already online
     printf("Checking current drive status...\n");
-    if (IsDiskOnline()) {
-        if (GetDiskInfo(friendlyName, diskNumber)) {
+    core::DiskRecord disk;
+    if (core::IsDiskOnline(drive.serial, drive.model)) {
+        if (core::FindTargetDisk(drive.serial, drive.model, disk)) {
             printf("\nDRIVE ALREADY ONLINE\n");
-            printf("Drive: %s\n", friendlyName.c_str());
-            printf("Disk Number: %d\n\n", diskNumber);
+            printf("Drive: %s\n", disk.model.c_str());
+            printf("Disk Number: %d\n\n", disk.number);
         } else {
             printf("\nDRIVE ALREADY ONLINE\n\n");
         }
@@ -172,58 +194,125 @@ int RunWake(int argc, char* argv[]) {
         return EXIT_SUCCESS;
     }
 
-    // 2. Power up relays
+    // 2. Power up relays, listening before the drive can arrive
     printf("Powering up HDD...\n");
-    if (!ControlRelayPower(true)) {
+    core::DiskArrivalListener arrivals;
+    ULONGLONG powerOnMs = GetTickCount64();
+    if (!ControlDrivePower(drive, true)) {
         printf("ERROR: Failed to activate relay power\n");
         return EXIT_OPERATION_FAILED;
     }
-    printf("Power ON: Both relays activated\n");
+    printf("Power ON: %s activated\n", DrivePowerTarget(drive).c_str());
 
-    Sleep(3000); // Wait for drive to initialize
+    // 3. Detection, with a device rescan if the drive is late
+    std::once_flag elevatedOnce;
+    if (!WaitForDrive(drive, "", elevatedOnce, arrivals, powerOnMs, disk)) {
+        return EXIT_DEVICE_NOT_FOUND;
+    }
 
-    // 3. Device rescan (try elevated first, fallback to basic)
-    printf("Scanning for new devices...\n");
-    if (!TryElevatedDeviceRescan()) {
-        PerformBasicDeviceRescan();
+    // 4. Ensure drive is online
+    if (!BringDiskOnline(drive, "")) {
+        return EXIT_OPERATION_FAILED;
     }
 
-    Sleep(3000); // Wait for device detection
+    // 5. Final status
+    printf("\nHDD WAKE COMPLETE\n");
+    printf("Drive: %s\n", disk.model.c_str());
+    printf("Status: Online and ready for use\n");
+    printf("Disk Number: %d\n", disk.number);
+    printf("Helper processes started: %lu\n\n", core::GetSpawnedProcessCount());
+    printf("To sleep the drive again, run: hdd-toggle sleep\n");
 
-    // 4. Verify drive is detected (with retry logic)
-    printf("Checking for target drive...\n");
-    int retryCount = 0;
-    int maxRetries = 4; // Try for up to ~12 more seconds
+    return EXIT_SUCCESS;
+}
 
-    while (retryCount < maxRetries && !GetDiskInfo(friendlyName, diskNumber)) {
-        retryCount++;
-        if (retryCount == 1) {
-            printf("Drive not detected yet, waiting for initialization...\n");
+// Detection and online phases for one pool member; runs on its own thread
+// so drives that are already powered overlap with later relay slots
+bool WakePoolMember(const DriveTarget& drive, std::once_flag& elevatedOnce,
+                    core::DiskArrivalListener& arrivals, ULONGLONG powerOnMs) {
+    std::string prefix = "[" + drive.name + "] ";
+    core::DiskRecord disk;
+    return WaitForDrive(drive, prefix, elevatedOnce, arrivals, powerOnMs, disk) &&
+           BringDiskOnline(drive, prefix);
+}
+
+int WakeDrivePool(const Config& config) {
+    printf("HDD Wake Utility - %zu drives\n\n", config.drives.size());
+
+    // One enumeration tells us which members still need power
+    std::vector<core::DriveInfo> infos = core::DetectDriveInfos(config.drives);
+    std::vector<size_t> pending;
+    std::vector<int> channels;
+    for (size_t i = 0; i < infos.size(); i++) {
+        if (infos[i].found && infos[i].state == DriveState::Online) {
+            printf("[%s] Already online (Disk %d)\n", infos[i].name.c_str(), infos[i].diskNumber);
+        } else {
+            pending.push_back(i);
+            channels.push_back(config.drives[i].relayChannel);
         }
-        Sleep(3000); // Wait 3 seconds between retries
     }
 
-    if (!GetDiskInfo(friendlyName, diskNumber)) {
-        printf("ERROR: Target drive not detected after %d seconds.\n", 6 + (maxRetries * 3));
-        printf("The drive may need more time to initialize or there may be a hardware issue.\n");
-        return EXIT_DEVICE_NOT_FOUND;
+    if (pending.empty()) {
+        printf("\nALL DRIVES ALREADY ONLINE\n");
+        return EXIT_SUCCESS;
     }
 
-    printf("Found drive: %s (Disk %d)\n", friendlyName.c_str(), diskNumber);
-
-    // 5. Ensure drive is online
-    if (!BringDiskOnline()) {
-        return EXIT_OPERATION_FAILED;
+    std::vector<core::PowerSlot> plan = core::PlanStaggeredPowerOn(channels, config.power);
+    core::ReadinessBarrier barrier(pending.size());
+    std::once_flag elevatedOnce;
+    core::DiskArrivalListener arrivals;     // Shared: any arrival wakes every waiting member
+    std::vector<std::thread> members;
+    ULONGLONG start = GetTickCount64();
+
+    for (const auto& slot : plan) {
+        ULONGLONG due = start + slot.startMs;
+        ULONGLONG now = GetTickCount64();
+        if (due > now) Sleep(static_cast<DWORD>(due - now));
+
+        printf("Powering relay %s at +%.1f s (%zu drive(s))\n",
+               slot.channel == 0 ? "ALL" : std::to_string(slot.channel).c_str(),
+               slot.startMs / 1000.0, slot.drives.size());
+        ULONGLONG powerOnMs = GetTickCount64();
+        bool powered = ControlRelayChannel(slot.channel, true);
+
+        for (size_t member : slot.drives) {
+            const DriveTarget& drive = config.drives[pending[member]];
+            if (!powered) {
+                printf("[%s] ERROR: Failed to activate relay power\n", drive.name.c_str());
+                barrier.Arrive(false);
+                continue;
+            }
+            members.emplace_back([&drive, &barrier, &elevatedOnce, &arrivals, powerOnMs] {
+                barrier.Arrive(WakePoolMember(drive, elevatedOnce, arrivals, powerOnMs));
+            });
+        }
     }
 
-    // 6. Final status
-    printf("\nHDD WAKE COMPLETE\n");
-    printf("Drive: %s\n", friendlyName.c_str());
-    printf("Status: Online and ready for use\n");
-    printf("Disk Number: %d\n\n", diskNumber);
-    printf("To sleep the drive again, run: hdd-toggle sleep\n");
+    bool ready = barrier.Wait();
+    double elapsed = (GetTickCount64() - start) / 1000.0;
+    for (auto& member : members) member.join();
 
-    return EXIT_SUCCESS;
+    printf("\n%s in %.1f s\n", ready ? "POOL WAKE COMPLETE" : "POOL WAKE INCOMPLETE", elapsed);
+    printf("Helper processes started: %lu\n", core::GetSpawnedProcessCount());
+
+    return ready ? EXIT_SUCCESS : EXIT_OPERATION_FAILED;
+}
+
+} // anonymous namespace
+
+int RunWake(int argc, char* argv[]) {
+    WakeOptions opts = ParseWakeArgs(argc, argv);
+
+    if (opts.help) {
+        ShowWakeUsage();
+        return EXIT_SUCCESS;
+    }
+
+    const Config& config = core::GetConfig();
+    if (opts.all && config.drives.size() > 1) {
+        return WakeDrivePool(config);
+    }
+    return WakeSingleDrive(config.drives.front());
 }
 
 } // namespace commands
@@ -63,5 +63,24 @@ bool RequestElevation() {
     return false;
 }
 
+bool RunElevated(const std::string& file, const std::string& parameters, uint32_t timeoutMs) {
+    SHELLEXECUTEINFOA sei = {};
+    sei.cbSize = sizeof(sei);
+    sei.fMask = SEE_MASK_NOCLOSEPROCESS;
+    sei.lpVerb = "runas";
+    sei.lpFile = file.c_str();
+    sei.lpParameters = parameters.c_str();
+    sei.nShow = SW_HIDE;
+
+    if (!ShellExecuteExA(&sei)) return false;
+    CountSpawnedProcess();
+
+    if (sei.hProcess) {
+        WaitForSingleObject(sei.hProcess, timeoutMs);
+        CloseHandle(sei.hProcess);
+    }
+    return true;
+}
+
 } // namespace core
 } // namespace hdd
@@ -0,0 +1,216 @@
+// Open-handle blocker scan for HDD Toggle (Windows)
+// Walks the system handle table for file handles on the drive's volumes,
+// the way handle.exe does, without a driver: each candidate handle is
+// duplicated into this process and resolved to its volume GUID path.
+
+#include "core/storage.h"
+#include <windows.h>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace hdd {
+namespace core {
+
+namespace {
+
+const ULONG SYSTEM_EXTENDED_HANDLE_INFORMATION = 64;
+const LONG STATUS_INFO_LENGTH_MISMATCH = static_cast<LONG>(0xC0000004);
+
+struct SystemHandleEntry {
+    PVOID object;
+    ULONG_PTR processId;
+    ULONG_PTR handleValue;
+    ULONG grantedAccess;
+    USHORT creatorBackTraceIndex;
+    USHORT objectTypeIndex;
+    ULONG handleAttributes;
+    ULONG reserved;
+};
+
+struct SystemHandleInformation {
+    ULONG_PTR numberOfHandles;
+    ULONG_PTR reserved;
+    SystemHandleEntry handles[1];
+};
+
+typedef LONG (WINAPI *NtQuerySystemInformationFn)(ULONG, PVOID, ULONG, PULONG);
+
+// Snapshot of every handle in the system
+bool QueryHandleTable(std::vector<unsigned char>& buffer) {
+    static NtQuerySystemInformationFn query = reinterpret_cast<NtQuerySystemInformationFn>(
+        GetProcAddress(GetModuleHandleA("ntdll.dll"), "NtQuerySystemInformation"));
+    if (!query) return false;
+
+    buffer.resize(4 * 1024 * 1024);
+    for (int attempt = 0; attempt < 8; attempt++) {
+        ULONG needed = 0;
+        LONG status = query(SYSTEM_EXTENDED_HANDLE_INFORMATION, buffer.data(),
+                            static_cast<ULONG>(buffer.size()), &needed);
+        if (status >= 0) return true;
+        if (status != STATUS_INFO_LENGTH_MISMATCH) return false;
+        // Handles come and go between calls: leave headroom
+        buffer.resize((std::max)(static_cast<size_t>(needed), buffer.size()) * 3 / 2);
+    }
+    return false;
+}
+
+// Object type index of files on this system, found from a handle we own
+bool FindFileTypeIndex(const SystemHandleInformation& table, HANDLE ownFile, USHORT& typeIndex) {
+    ULONG_PTR self = GetCurrentProcessId();
+    for (ULONG_PTR i = 0; i < table.numberOfHandles; i++) {
+        const SystemHandleEntry& entry = table.handles[i];
+        if (entry.processId == self && entry.handleValue == reinterpret_cast<ULONG_PTR>(ownFile)) {
+            typeIndex = entry.objectTypeIndex;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string ProcessName(HANDLE process) {
+    char path[MAX_PATH];
+    DWORD size = sizeof(path);
+    if (!QueryFullProcessImageNameA(process, 0, path, &size)) return std::string();
+    const char* slash = strrchr(path, '\\');
+    return slash ? slash + 1 : path;
+}
+
+// Resolve one process's file handles; only handles on the volumes become hits
+void ScanProcessHandles(DWORD pid, const std::vector<ULONG_PTR>& handles, const std::vector<VolumeMount>& volumes,
+                        std::vector<BlockerHit>& hits) {
+    HANDLE process = OpenProcess(PROCESS_DUP_HANDLE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!process) return;
+
+    std::string name;
+    for (ULONG_PTR value : handles) {
+        HANDLE duplicate = NULL;
+        if (!DuplicateHandle(process, reinterpret_cast<HANDLE>(value), GetCurrentProcess(), &duplicate,
+                             0, FALSE, DUPLICATE_SAME_ACCESS)) {
+            continue;
+        }
+
+        // Only disk files: asking a synchronous pipe for its name can hang
+        char path[1024];
+        DWORD length = 0;
+        if (GetFileType(duplicate) == FILE_TYPE_DISK) {
+            length = GetFinalPathNameByHandleA(duplicate, path, sizeof(path), VOLUME_NAME_GUID);
+        }
+        CloseHandle(duplicate);
+        if (length == 0 || length >= sizeof(path)) continue;
+
+        std::string target(path, length);
+        for (const auto& volume : volumes) {
+            if (!PathOnVolumes(target, {volume.volumeName})) continue;
+
+            // Show it under the drive letter or mount folder when there is one
+            if (!volume.mountPoints.empty()) {
+                target = volume.mountPoints.front() + target.substr(volume.volumeName.size());
+            }
+            if (name.empty()) name = ProcessName(process);
+
+            BlockerHit hit;
+            hit.pid = pid;
+            hit.process = name;
+            hit.kind = BlockerKind::File;
+            hit.path = target;
+            hits.push_back(std::move(hit));
+            break;
+        }
+    }
+    CloseHandle(process);
+}
+
+// Shell windows that must never get WM_CLOSE (it would offer to shut down)
+bool IsShellWindow(HWND window) {
+    char className[64];
+    if (!GetClassNameA(window, className, sizeof(className))) return false;
+    return strcmp(className, "Progman") == 0 || strcmp(className, "WorkerW") == 0 ||
+           strcmp(className, "Shell_TrayWnd") == 0 || strcmp(className, "Shell_SecondaryTrayWnd") == 0;
+}
+
+struct CloseRequest {
+    std::unordered_set<DWORD> pids;
+    size_t posted = 0;
+};
+
+BOOL CALLBACK PostCloseToWindow(HWND window, LPARAM context) {
+    CloseRequest& request = *reinterpret_cast<CloseRequest*>(context);
+    DWORD pid = 0;
+    GetWindowThreadProcessId(window, &pid);
+    if (request.pids.count(pid) && IsWindowVisible(window) && !GetWindow(window, GW_OWNER) &&
+        !IsShellWindow(window) && PostMessageA(window, WM_CLOSE, 0, 0)) {
+        request.posted++;
+    }
+    return TRUE;
+}
+
+} // anonymous namespace
+
+std::vector<BlockerProcess> FindVolumeBlockers(const std::vector<VolumeMount>& volumes) {
+    std::vector<BlockerProcess> blockers;
+    if (volumes.empty()) return blockers;
+
+    // A file handle of our own identifies the File object type
+    char ownPath[MAX_PATH];
+    GetModuleFileNameA(NULL, ownPath, MAX_PATH);
+    HANDLE ownFile = CreateFileA(ownPath, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                 NULL, OPEN_EXISTING, 0, NULL);
+    if (ownFile == INVALID_HANDLE_VALUE) return blockers;
+
+    std::vector<unsigned char> buffer;
+    USHORT fileType = 0;
+    bool ok = QueryHandleTable(buffer) &&
+              FindFileTypeIndex(*reinterpret_cast<const SystemHandleInformation*>(buffer.data()), ownFile, fileType);
+    CloseHandle(ownFile);
+    if (!ok) return blockers;
+
+    // File handles per process, skipping our own and the kernel's
+    const SystemHandleInformation& table = *reinterpret_cast<const SystemHandleInformation*>(buffer.data());
+    std::unordered_map<DWORD, std::vector<ULONG_PTR>> byProcess;
+    DWORD self = GetCurrentProcessId();
+    for (ULONG_PTR i = 0; i < table.numberOfHandles; i++) {
+        const SystemHandleEntry& entry = table.handles[i];
+        DWORD pid = static_cast<DWORD>(entry.processId);
+        if (entry.objectTypeIndex == fileType && pid != self && pid > 4) {
+            byProcess[pid].push_back(entry.handleValue);
+        }
+    }
+
+    // Processes are independent: spread them over a few threads. Workers
+    // only read this flat list, never the map.
+    std::vector<std::pair<DWORD, std::vector<ULONG_PTR>>> processes(
+        std::make_move_iterator(byProcess.begin()), std::make_move_iterator(byProcess.end()));
+    unsigned threads = (std::max)(1u, (std::min)(8u, std::thread::hardware_concurrency()));
+    std::atomic<size_t> next(0);
+    std::vector<std::vector<BlockerHit>> found(threads);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++) {
+        pool.emplace_back([&, t] {
+            for (size_t i; (i = next++) < processes.size();) {
+                ScanProcessHandles(processes[i].first, processes[i].second, volumes, found[t]);
+            }
+        });
+    }
+    for (auto& thread : pool) thread.join();
+
+    std::vector<BlockerHit> hits;
+    for (auto& part : found) hits.insert(hits.end(), part.begin(), part.end());
+    return GroupBlockers(std::move(hits));
+}
+
+size_t RequestBlockersClose(const std::vector<BlockerProcess>& blockers) {
+    CloseRequest request;
+    for (const auto& blocker : blockers) request.pids.insert(blocker.pid);
+    if (request.pids.empty()) return 0;
+
+    EnumWindows(PostCloseToWindow, reinterpret_cast<LPARAM>(&request));
+    return request.posted;
+}
+
+} // namespace core
+} // namespace hdd
@@ -0,0 +1,142 @@
+// Configuration loading for HDD Toggle
+
+#include "core/config.h"
+#include "core/disk.h"
+#include "core/process.h"
+#include "hdd-toggle.h"
+#include <windows.h>
+#include <vector>
+
+namespace hdd {
+namespace core {
+
+namespace {
+
+std::string ReadString(const char* section, const char* key, const std::string& fallback, const char* iniPath) {
+    char value[256];
+    GetPrivateProfileStringA(section, key, fallback.c_str(), value, sizeof(value), iniPath);
+    return TrimWhitespace(std::string(value));
+}
+
+// Read a drive section; false if it has no serial number
+bool ReadDriveSection(const std::string& section, const char* iniPath, DriveTarget& drive) {
+    drive.name = section;
+    drive.serial = ReadString(section.c_str(), "SerialNumber", "", iniPath);
+    drive.model = ReadString(section.c_str(), "Model", "", iniPath);
+    drive.relayChannel = static_cast<int>(GetPrivateProfileIntA(section.c_str(), "RelayChannel", 0, iniPath));
+    return !drive.serial.empty();
+}
+
+std::vector<std::string> ReadSectionNames(const char* iniPath) {
+    std::vector<char> buffer(4096);
+    for (;;) {
+        DWORD length = GetPrivateProfileSectionNamesA(buffer.data(), static_cast<DWORD>(buffer.size()), iniPath);
+        // Returns size - 2 when the buffer is too small
+        if (length < buffer.size() - 2 || buffer.size() >= 65536) {
+            return SplitMultiString(buffer.data(), length + 1);
+        }
+        buffer.resize(buffer.size() * 2);
+    }
+}
+
+} // anonymous namespace
+
+std::string GetConfigPath() {
+    return GetExeDirectory() + "\\hdd-control.ini";
+}
+
+std::string GetStatePath() {
+    return GetExeDirectory() + "\\hdd-state.ini";
+}
+
+SpinUpModel LoadSpinUpModel(const std::string& serial) {
+    return SpinUpModel::Parse(ReadString("SpinUpMs", serial.c_str(), "", GetStatePath().c_str()));
+}
+
+bool SaveSpinUpModel(const std::string& serial, const SpinUpModel& model) {
+    return WritePrivateProfileStringA("SpinUpMs", serial.c_str(), model.Format().c_str(),
+                                      GetStatePath().c_str()) != FALSE;
+}
+
+bool LoadWakePredictor(WakePredictor& predictor) {
+    return predictor.Parse(ReadString("Predictor", "History", "", GetStatePath().c_str()));
+}
+
+bool SaveWakePredictor(const WakePredictor& predictor) {
+    return WritePrivateProfileStringA("Predictor", "History", predictor.Format().c_str(),
+                                      GetStatePath().c_str()) != FALSE;
+}
+
+Config LoadConfig(const std::string& iniPath) {
+    Config config;
+    config.targetSerial = DEFAULT_TARGET_SERIAL;
+    config.targetModel = DEFAULT_TARGET_MODEL;
+
+    const char* path = iniPath.c_str();
+    if (GetFileAttributesA(path) != INVALID_FILE_ATTRIBUTES) {
+        DriveTarget drive;
+        if (ReadDriveSection("Drive", path, drive)) {
+            config.drives.push_back(drive);
+        }
+        for (const auto& section : SelectDriveSections(ReadSectionNames(path))) {
+            if (ReadDriveSection(section, path, drive)) {
+                config.drives.push_back(drive);
+            }
+        }
+
+        config.periodicCheckMinutes = ValidatePeriodicCheckMinutes(
+            GetPrivateProfileIntA("Timing", "PeriodicCheckMinutes", config.periodicCheckMinutes, path));
+        config.postOperationCheckSeconds = GetPrivateProfileIntA("Timing", "PostOperationCheckSeconds",
+                                                                 config.postOperationCheckSeconds, path);
+        config.showNotifications = GetPrivateProfileIntA("UI", "ShowNotifications", config.showNotifications, path) != 0;
+        config.debugMode = GetPrivateProfileIntA("Advanced", "DebugMode", config.debugMode, path) != 0;
+
+        PowerSettings& power = config.power;
+        power.inrushBudget = GetPrivateProfileIntA("Power", "InrushBudget", power.inrushBudget, path);
+        power.spinUpMs = GetPrivateProfileIntA("Power", "SpinUpMs", power.spinUpMs, path);
+        power.staggerMs = GetPrivateProfileIntA("Power", "StaggerMs", power.staggerMs, path);
+        power.autoSleepIdleMinutes = GetPrivateProfileIntA("Power", "AutoSleepIdleMinutes",
+                                                           power.autoSleepIdleMinutes, path);
+
+        config.relay.type = ToLower(ReadString("Relay", "Type", config.relay.type, path));
+        config.relay.port = ReadString("Relay", "Port", config.relay.port, path);
+        config.relay.wakeSequence = ReadString("Relay", "WakeSequence", "", path);
+        config.relay.sleepSequence = ReadString("Relay", "SleepSequence", "", path);
+
+        PredictorSettings& predictor = config.predictor;
+        predictor.enabled = GetPrivateProfileIntA("Predictor", "Enabled", predictor.enabled, path) != 0;
+        predictor.confidence = GetPrivateProfileIntA("Predictor", "ConfidencePercent",
+                                                     static_cast<int>(predictor.confidence * 100), path) / 100.0;
+        predictor.leadMinutes = GetPrivateProfileIntA("Predictor", "LeadMinutes", predictor.leadMinutes, path);
+        predictor.historyWeeks = GetPrivateProfileIntA("Predictor", "HistoryWeeks", predictor.historyWeeks, path);
+        predictor.hitWindowMinutes = GetPrivateProfileIntA("Predictor", "HitWindowMinutes",
+                                                           predictor.hitWindowMinutes, path);
+
+        config.detectionBackend = ToLower(ReadString("Advanced", "DetectionBackend", config.detectionBackend, path));
+    }
+
+    if (config.drives.empty()) {
+        DriveTarget drive;
+        drive.name = "Drive";
+        drive.serial = config.targetSerial;
+        drive.model = config.targetModel;
+        config.drives.push_back(drive);
+    }
+
+    config.targetSerial = config.drives.front().serial;
+    config.targetModel = config.drives.front().model;
+    return config;
+}
+
+const Config& GetConfig() {
+    static const Config config = [] {
+        Config loaded = LoadConfig(GetConfigPath());
+        SetPreferredDiskBackend(loaded.detectionBackend == "wmi"
+            ? DiskBackendType::Wmi : DiskBackendType::Native);
+        return loaded;
+    }();
+    return config;
+}
+
+} // namespace core
+} // namespace hdd
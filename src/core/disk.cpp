@@ -3,11 +3,12 @@
 
 #include "core/disk.h"
 #include "core/com.h"
-#include "core/process.h"
 #include "hdd-toggle.h"
 #include <windows.h>
+#include <winioctl.h>
 #include <wbemidl.h>
 #include <comdef.h>
+#include <atomic>
 #include <cstdio>
 
 #pragma comment(lib, "wbemuuid.lib")
@@ -17,114 +18,323 @@
 namespace hdd {
 namespace core {
 
-DriveInfo DetectDriveInfo(const std::string& targetSerial) {
-    DriveInfo info;
+namespace {
 
-    ComInitializer comInit;
-    if (!comInit.IsInitialized()) {
-        return info;
+// HRESULTs that mean the WMI connection itself is gone rather than the query
+bool IsDisconnectError(HRESULT hr) {
+    return hr == RPC_E_DISCONNECTED ||
+           hr == HRESULT_FROM_WIN32(RPC_S_SERVER_UNAVAILABLE) ||
+           hr == HRESULT_FROM_WIN32(RPC_S_CALL_FAILED) ||
+           hr == WBEM_E_TRANSPORT_FAILURE ||
+           hr == WBEM_E_SHUTTING_DOWN;
+}
+
+std::string BstrToString(BSTR value) {
+    char buffer[256];
+    wcstombs_s(NULL, buffer, sizeof(buffer), value, _TRUNCATE);
+    return TrimWhitespace(std::string(buffer));
+}
+
+// WMI backend for DiskQuerySession
+// Connects to ROOT\Microsoft\Windows\Storage once and keeps the proxy.
+// CoIncrementMTAUsage keeps the multithreaded apartment (and with it the
+// proxy) alive even when the thread that connected calls CoUninitialize.
+class WmiDiskBackend : public DiskQueryBackend {
+public:
+    WmiDiskBackend() : m_mtaCookie(nullptr) {}
+
+    ~WmiDiskBackend() override {
+        Disconnect();
+        if (m_mtaCookie) CoDecrementMTAUsage(m_mtaCookie);
     }
 
-    // Set COM security levels (ignore failure if already set)
-    CoInitializeSecurity(
-        NULL, -1, NULL, NULL,
-        RPC_C_AUTHN_LEVEL_NONE,
-        RPC_C_IMP_LEVEL_IMPERSONATE,
-        NULL, EOAC_NONE, NULL
-    );
-
-    ComPtr<IWbemLocator> pLoc;
-    HRESULT hres = CoCreateInstance(
-        CLSID_WbemLocator, 0, CLSCTX_INPROC_SERVER,
-        IID_IWbemLocator, (LPVOID*)&pLoc);
-    if (FAILED(hres)) return info;
-
-    ComPtr<IWbemServices> pSvc;
-    hres = pLoc->ConnectServer(
-        _bstr_t(L"ROOT\\Microsoft\\Windows\\Storage"),
-        NULL, NULL, 0, NULL, 0, 0, &pSvc);
-    if (FAILED(hres)) return info;
-
-    hres = CoSetProxyBlanket(
-        pSvc.Get(),
-        RPC_C_AUTHN_WINNT, RPC_C_AUTHZ_NONE, NULL,
-        RPC_C_AUTHN_LEVEL_CALL, RPC_C_IMP_LEVEL_IMPERSONATE,
-        NULL, EOAC_NONE);
-    if (FAILED(hres)) return info;
-
-    ComPtr<IEnumWbemClassObject> pEnumerator;
-    hres = pSvc->ExecQuery(
-        bstr_t("WQL"),
-        bstr_t("SELECT * FROM MSFT_Disk"),
-        WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
-        NULL, &pEnumerator);
-    if (FAILED(hres)) return info;
-
-    while (pEnumerator) {
-        ComPtr<IWbemClassObject> pclsObj;
-        ULONG uReturn = 0;
-        HRESULT hr = pEnumerator->Next(WBEM_INFINITE, 1, &pclsObj, &uReturn);
-        if (uReturn == 0) break;
-
-        VARIANT vtProp;
-        VariantInit(&vtProp);
-
-        // Get SerialNumber
-        hr = pclsObj->Get(L"SerialNumber", 0, &vtProp, 0, 0);
-        if (SUCCEEDED(hr) && vtProp.vt == VT_BSTR) {
-            char serialStr[256];
-            wcstombs_s(NULL, serialStr, 256, vtProp.bstrVal, _TRUNCATE);
-            std::string serial = TrimWhitespace(std::string(serialStr));
-
-            if (SerialMatches(serial, targetSerial)) {
-                info.found = true;
-                info.serialNumber = serial;
-                VariantClear(&vtProp);
-
-                // Get FriendlyName (model)
-                hr = pclsObj->Get(L"FriendlyName", 0, &vtProp, 0, 0);
-                if (SUCCEEDED(hr) && vtProp.vt == VT_BSTR) {
-                    char modelStr[256];
-                    wcstombs_s(NULL, modelStr, 256, vtProp.bstrVal, _TRUNCATE);
-                    info.model = TrimWhitespace(std::string(modelStr));
-                }
-                VariantClear(&vtProp);
-
-                // Get Number
-                hr = pclsObj->Get(L"Number", 0, &vtProp, 0, 0);
-                if (SUCCEEDED(hr)) {
-                    if (vtProp.vt == VT_I4) {
-                        info.diskNumber = vtProp.lVal;
-                    } else if (vtProp.vt == VT_UI4) {
-                        info.diskNumber = static_cast<int>(vtProp.ulVal);
-                    }
-                }
-                VariantClear(&vtProp);
+    bool Connect() override {
+        if (!m_mtaCookie && FAILED(CoIncrementMTAUsage(&m_mtaCookie))) {
+            m_mtaCookie = nullptr;
+            return false;
+        }
+
+        ComInitializer comInit;
+        if (!comInit.IsInitialized()) return false;
+
+        // Set COM security levels (ignore failure if already set)
+        CoInitializeSecurity(
+            NULL, -1, NULL, NULL,
+            RPC_C_AUTHN_LEVEL_NONE,
+            RPC_C_IMP_LEVEL_IMPERSONATE,
+            NULL, EOAC_NONE, NULL
+        );
+
+        ComPtr<IWbemLocator> pLoc;
+        HRESULT hres = CoCreateInstance(
+            CLSID_WbemLocator, 0, CLSCTX_INPROC_SERVER,
+            IID_IWbemLocator, (LPVOID*)&pLoc);
+        if (FAILED(hres)) return false;
+
+        m_svc.Release();
+        hres = pLoc->ConnectServer(
+            _bstr_t(L"ROOT\\Microsoft\\Windows\\Storage"),
+            NULL, NULL, 0, NULL, 0, 0, &m_svc);
+        if (FAILED(hres)) {
+            m_svc.Release();
+            return false;
+        }
+
+        hres = CoSetProxyBlanket(
+            m_svc.Get(),
+            RPC_C_AUTHN_WINNT, RPC_C_AUTHZ_NONE, NULL,
+            RPC_C_AUTHN_LEVEL_CALL, RPC_C_IMP_LEVEL_IMPERSONATE,
+            NULL, EOAC_NONE);
+        if (FAILED(hres)) {
+            m_svc.Release();
+            return false;
+        }
+
+        return true;
+    }
+
+    void Disconnect() override {
+        m_svc.Release();
+    }
+
+    QueryStatus EnumerateDisks(std::vector<DiskRecord>& disks) override {
+        disks.clear();
+        if (!m_svc) return QueryStatus::Disconnected;
 
-                // Get IsOffline property
-                hr = pclsObj->Get(L"IsOffline", 0, &vtProp, 0, 0);
-                if (SUCCEEDED(hr) && vtProp.vt == VT_BOOL) {
-                    info.state = (vtProp.boolVal == VARIANT_TRUE) ? DriveState::Offline : DriveState::Online;
+        ComInitializer comInit;
+        if (!comInit.IsInitialized()) return QueryStatus::Failed;
+
+        ComPtr<IEnumWbemClassObject> pEnumerator;
+        HRESULT hres = m_svc->ExecQuery(
+            bstr_t("WQL"),
+            bstr_t("SELECT Number, SerialNumber, FriendlyName, IsOffline FROM MSFT_Disk"),
+            WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
+            NULL, &pEnumerator);
+        if (FAILED(hres)) {
+            return IsDisconnectError(hres) ? QueryStatus::Disconnected : QueryStatus::Failed;
+        }
+
+        while (pEnumerator) {
+            ComPtr<IWbemClassObject> pclsObj;
+            ULONG uReturn = 0;
+            HRESULT hr = pEnumerator->Next(WBEM_INFINITE, 1, &pclsObj, &uReturn);
+            if (FAILED(hr)) {
+                return IsDisconnectError(hr) ? QueryStatus::Disconnected : QueryStatus::Failed;
+            }
+            if (uReturn == 0) break;
+
+            DiskRecord record;
+            VARIANT vtProp;
+            VariantInit(&vtProp);
+
+            hr = pclsObj->Get(L"SerialNumber", 0, &vtProp, 0, 0);
+            if (SUCCEEDED(hr) && vtProp.vt == VT_BSTR) {
+                record.serialNumber = BstrToString(vtProp.bstrVal);
+            }
+            VariantClear(&vtProp);
+
+            hr = pclsObj->Get(L"FriendlyName", 0, &vtProp, 0, 0);
+            if (SUCCEEDED(hr) && vtProp.vt == VT_BSTR) {
+                record.model = BstrToString(vtProp.bstrVal);
+            }
+            VariantClear(&vtProp);
+
+            hr = pclsObj->Get(L"Number", 0, &vtProp, 0, 0);
+            if (SUCCEEDED(hr)) {
+                if (vtProp.vt == VT_I4) {
+                    record.number = vtProp.lVal;
+                } else if (vtProp.vt == VT_UI4) {
+                    record.number = static_cast<int>(vtProp.ulVal);
                 }
-                VariantClear(&vtProp);
-                break;
             }
+            VariantClear(&vtProp);
+
+            hr = pclsObj->Get(L"IsOffline", 0, &vtProp, 0, 0);
+            if (SUCCEEDED(hr) && vtProp.vt == VT_BOOL) {
+                record.isOffline = (vtProp.boolVal == VARIANT_TRUE);
+            }
+            VariantClear(&vtProp);
+
+            disks.push_back(record);
         }
-        VariantClear(&vtProp);
+
+        return QueryStatus::Ok;
+    }
+
+private:
+    ComPtr<IWbemServices> m_svc;
+    CO_MTA_USAGE_COOKIE m_mtaCookie;
+};
+
+// Native backend for DiskQuerySession
+// Lists PhysicalDriveN devices from the DOS device namespace and reads each
+// one's storage descriptor and disk attributes with DeviceIoControl.
+// Handles are opened with no access rights, which needs no elevation and
+// never touches the media, so a full pass costs only a few IOCTLs per disk.
+class NativeDiskBackend : public DiskQueryBackend {
+public:
+    NativeDiskBackend() : m_names(16 * 1024), m_descriptor(1024) {}
+
+    bool Connect() override {
+        // Nothing to hold open; verify the device namespace is readable
+        return RefreshDeviceNames();
     }
 
+    void Disconnect() override {}
+
+    QueryStatus EnumerateDisks(std::vector<DiskRecord>& disks) override {
+        disks.clear();
+        if (!RefreshDeviceNames()) return QueryStatus::Failed;
+
+        for (const char* name = m_names.data(); *name; name += strlen(name) + 1) {
+            int number = ParsePhysicalDriveNumber(name);
+            if (number < 0) continue;
+
+            DiskRecord record;
+            record.number = number;
+            if (ReadDisk(name, record)) {
+                disks.push_back(record);
+            }
+        }
+
+        return QueryStatus::Ok;
+    }
+
+private:
+    // Fill m_names with the double-NUL-terminated list of DOS device names
+    bool RefreshDeviceNames() {
+        for (int attempt = 0; attempt < 4; attempt++) {
+            DWORD len = QueryDosDeviceA(NULL, m_names.data(), static_cast<DWORD>(m_names.size()));
+            if (len > 0) return true;
+            if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) return false;
+            m_names.resize(m_names.size() * 4);
+        }
+        return false;
+    }
+
+    bool ReadDisk(const char* name, DiskRecord& record) {
+        std::string path = std::string("\\\\.\\") + name;
+        HANDLE device = CreateFileA(path.c_str(), 0,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                    NULL, OPEN_EXISTING, 0, NULL);
+        if (device == INVALID_HANDLE_VALUE) return false;
+
+        STORAGE_PROPERTY_QUERY query = {};
+        query.PropertyId = StorageDeviceProperty;
+        query.QueryType = PropertyStandardQuery;
+
+        DWORD bytes = 0;
+        bool ok = DeviceIoControl(device, IOCTL_STORAGE_QUERY_PROPERTY,
+                                  &query, sizeof(query),
+                                  m_descriptor.data(), static_cast<DWORD>(m_descriptor.size()),
+                                  &bytes, NULL) != FALSE;
+
+        if (ok && bytes >= sizeof(STORAGE_DEVICE_DESCRIPTOR)) {
+            const STORAGE_DEVICE_DESCRIPTOR* desc =
+                reinterpret_cast<const STORAGE_DEVICE_DESCRIPTOR*>(m_descriptor.data());
+            const unsigned char* raw = m_descriptor.data();
+            size_t size = (std::min)(static_cast<size_t>(bytes), m_descriptor.size());
+
+            SerialBus bus = desc->BusType == BusTypeAta || desc->BusType == BusTypeSata ? SerialBus::Ata
+                          : desc->BusType == BusTypeUnknown ? SerialBus::Unknown
+                          : SerialBus::Other;
+            record.serialNumber = DecodeStorageSerial(
+                ReadDescriptorString(raw, size, desc->SerialNumberOffset), bus);
+            record.model = ComposeDiskModel(
+                ReadDescriptorString(raw, size, desc->VendorIdOffset),
+                ReadDescriptorString(raw, size, desc->ProductIdOffset));
+        }
+
+        GET_DISK_ATTRIBUTES attributes = {};
+        attributes.Version = sizeof(GET_DISK_ATTRIBUTES);
+        if (DeviceIoControl(device, IOCTL_DISK_GET_DISK_ATTRIBUTES,
+                            NULL, 0, &attributes, sizeof(attributes), &bytes, NULL)) {
+            record.isOffline = (attributes.Attributes & DISK_ATTRIBUTE_OFFLINE) != 0;
+        }
+
+        CloseHandle(device);
+        return ok;
+    }
+
+    std::vector<char> m_names;
+    std::vector<unsigned char> m_descriptor;
+};
+
+std::atomic<DiskBackendType> g_preferredBackend(DiskBackendType::Native);
+
+void FillDriveInfo(const DiskRecord& disk, DriveInfo& info) {
+    info.found = true;
+    info.serialNumber = disk.serialNumber;
+    info.model = disk.model;
+    info.diskNumber = disk.number;
+}
+
+} // anonymous namespace
+
+std::unique_ptr<DiskQueryBackend> CreateWmiDiskBackend() {
+    return std::unique_ptr<DiskQueryBackend>(new WmiDiskBackend());
+}
+
+std::unique_ptr<DiskQueryBackend> CreateNativeDiskBackend() {
+    return std::unique_ptr<DiskQueryBackend>(new NativeDiskBackend());
+}
+
+void SetPreferredDiskBackend(DiskBackendType type) {
+    g_preferredBackend = type;
+}
+
+DiskQuerySession& GetDiskQuerySession() {
+    // Intentionally leaked: releasing COM proxies during static destruction
+    // (after the apartment may be gone) is worse than letting the OS reclaim them
+    static DiskQuerySession* session = new DiskQuerySession(
+        g_preferredBackend == DiskBackendType::Wmi ? CreateWmiDiskBackend() : CreateNativeDiskBackend());
+    return *session;
+}
+
+DriveInfo DetectDriveInfo(const std::string& targetSerial) {
+    DriveInfo info;
+    info.serialNumber = targetSerial;
+
+    std::vector<DiskRecord> disks;
+    if (!GetDiskQuerySession().EnumerateDisks(disks)) {
+        return info;
+    }
+
+    const DiskRecord* disk = FindDiskBySerial(disks, targetSerial);
+    if (disk) FillDriveInfo(*disk, info);
+    info.state = DiskRecordState(disk);
+
     return info;
 }
 
+std::vector<DriveInfo> DetectDriveInfos(const std::vector<DriveTarget>& targets) {
+    std::vector<DriveInfo> infos(targets.size());
+    for (size_t i = 0; i < targets.size(); i++) {
+        infos[i].name = targets[i].name;
+        infos[i].serialNumber = targets[i].serial;
+        infos[i].model = targets[i].model;
+    }
+
+    std::vector<DiskRecord> disks;
+    if (!GetDiskQuerySession().EnumerateDisks(disks)) {
+        return infos;
+    }
+
+    std::vector<const DiskRecord*> matches = MatchDiskTargets(disks, targets);
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (matches[i]) FillDriveInfo(*matches[i], infos[i]);
+        infos[i].state = DiskRecordState(matches[i]);
+    }
+
+    return infos;
+}
+
 bool IsDiskOnline(const std::string& targetSerial, const std::string& targetModel) {
-    char command[1024];
-    snprintf(command, sizeof(command),
-        "powershell.exe -NoProfile -ExecutionPolicy Bypass -Command "
-        "\"$disk = Get-Disk | Where-Object { $_.SerialNumber -match '%s' -or $_.FriendlyName -match '%s' } -ErrorAction SilentlyContinue; "
-        "if ($disk -and -not $disk.IsOffline) { exit 0 } else { exit 1 }\"",
-        targetSerial.c_str(), targetModel.c_str());
-
-    return ExecuteCommand(command, true) == 0;
+    std::vector<DiskRecord> disks;
+    if (!GetDiskQuerySession().EnumerateDisks(disks)) return false;
+
+    const DiskRecord* disk = FindDiskByTarget(disks, targetSerial, targetModel);
+    return disk && !disk->isOffline;
 }
 
 } // namespace core
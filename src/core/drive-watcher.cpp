@@ -0,0 +1,92 @@
+// Drive presence watcher for HDD Toggle
+// Uses RegisterDeviceNotification so the system pushes disk changes to us;
+// nothing runs while the drive state is stable
+
+#include "core/drive-watcher.h"
+
+#pragma comment(lib, "user32.lib")
+
+namespace hdd {
+namespace core {
+
+namespace {
+
+HDEVNOTIFY RegisterInterface(HWND hwnd, const GUID& classGuid) {
+    DEV_BROADCAST_DEVICEINTERFACE filter = {};
+    filter.dbcc_size = sizeof(filter);
+    filter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+    filter.dbcc_classguid = classGuid;
+
+    return RegisterDeviceNotification(hwnd, &filter, DEVICE_NOTIFY_WINDOW_HANDLE);
+}
+
+} // anonymous namespace
+
+DriveWatcher::DriveWatcher() : m_diskNotify(nullptr), m_volumeNotify(nullptr), m_hidNotify(nullptr) {}
+
+DriveWatcher::~DriveWatcher() {
+    Stop();
+}
+
+bool DriveWatcher::Start(HWND hwnd) {
+    Stop();
+
+    m_diskNotify = RegisterInterface(hwnd, kDiskInterfaceGuid);
+    if (!m_diskNotify) return false;
+
+    // Volume events catch online/offline toggles, which leave the disk
+    // interface in place but tear down or recreate its volumes.
+    // Not fatal if this one fails; disk arrival/removal still works.
+    m_volumeNotify = RegisterInterface(hwnd, kVolumeInterfaceGuid);
+
+    // HID removals tell the relay connection to drop its cached handle
+    m_hidNotify = RegisterInterface(hwnd, kHidInterfaceGuid);
+    return true;
+}
+
+void DriveWatcher::Stop() {
+    if (m_hidNotify) {
+        UnregisterDeviceNotification(m_hidNotify);
+        m_hidNotify = nullptr;
+    }
+    if (m_volumeNotify) {
+        UnregisterDeviceNotification(m_volumeNotify);
+        m_volumeNotify = nullptr;
+    }
+    if (m_diskNotify) {
+        UnregisterDeviceNotification(m_diskNotify);
+        m_diskNotify = nullptr;
+    }
+}
+
+DeviceChanges DriveWatcher::Classify(WPARAM wParam, LPARAM lParam) {
+    DeviceAction action = wParam == DBT_DEVICEARRIVAL ? DeviceAction::Arrival
+                        : wParam == DBT_DEVICEREMOVECOMPLETE ? DeviceAction::Removal
+                        : DeviceAction::Other;
+
+    const DEV_BROADCAST_HDR* hdr = reinterpret_cast<const DEV_BROADCAST_HDR*>(lParam);
+    if (action == DeviceAction::Other || !hdr) return DeviceChanges();
+
+    // Drive letter broadcasts are sent to all top-level windows
+    DeviceClass deviceClass = DeviceClass::Other;
+    if (hdr->dbch_devicetype == DBT_DEVTYP_VOLUME) {
+        deviceClass = DeviceClass::VolumeMount;
+    } else if (hdr->dbch_devicetype == DBT_DEVTYP_DEVICEINTERFACE) {
+        const GUID& classGuid = reinterpret_cast<const DEV_BROADCAST_DEVICEINTERFACE*>(hdr)->dbcc_classguid;
+        if (IsEqualGUID(classGuid, kDiskInterfaceGuid)) deviceClass = DeviceClass::Disk;
+        else if (IsEqualGUID(classGuid, kVolumeInterfaceGuid)) deviceClass = DeviceClass::Volume;
+        else if (IsEqualGUID(classGuid, kHidInterfaceGuid)) deviceClass = DeviceClass::Hid;
+    }
+    return ClassifyDeviceEvent(action, deviceClass);
+}
+
+bool DriveWatcher::IsDiskChange(WPARAM wParam, LPARAM lParam) {
+    return Classify(wParam, lParam).disk;
+}
+
+bool DriveWatcher::IsHidRemoval(WPARAM wParam, LPARAM lParam) {
+    return Classify(wParam, lParam).hidRemoved;
+}
+
+} // namespace core
+} // namespace hdd
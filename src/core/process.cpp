@@ -2,94 +2,432 @@
 
 #include "core/process.h"
 #include <windows.h>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <vector>
 
 namespace hdd {
 namespace core {
 
-int ExecuteCommand(const std::string& command, bool hideWindow) {
+namespace {
+
+std::atomic<unsigned long> g_spawnedProcesses(0);
+
+const char* const SHELL_HOST_COMMAND =
+    "powershell.exe -NoLogo -NoProfile -NonInteractive -ExecutionPolicy Bypass -Command -";
+
+// Job object: lets a kill reach grandchildren (cmd.exe pipelines, tools
+// that re-launch themselves) and cleans them up if we exit first
+HANDLE CreateKillOnCloseJob() {
+    HANDLE job = CreateJobObjectA(NULL, NULL);
+    if (job) {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+        limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+        SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+    }
+    return job;
+}
+
+} // anonymous namespace
+
+unsigned long GetSpawnedProcessCount() {
+    return g_spawnedProcesses.load();
+}
+
+void CountSpawnedProcess() {
+    g_spawnedProcesses++;
+}
+
+ChildProcess::ChildProcess() : m_process(NULL), m_job(NULL), m_outputDone(NULL), m_openStreams(0) {}
+
+ChildProcess::~ChildProcess() {
+    if (m_process && WaitForSingleObject(m_process, 0) == WAIT_TIMEOUT) {
+        Kill();
+    }
+    if (m_reader.joinable() || m_errorReader.joinable()) {
+        // The readers end when every process holding the pipes is gone
+        if (m_job) TerminateJobObject(m_job, 1);
+        JoinReaders();
+    }
+    if (m_outputDone) CloseHandle(m_outputDone);
+    if (m_process) CloseHandle(m_process);
+    if (m_job) CloseHandle(m_job);   // KILL_ON_JOB_CLOSE reaps any stragglers
+}
+
+std::unique_ptr<ChildProcess> ChildProcess::Start(const std::string& command, bool captureOutput,
+                                                  bool hideWindow) {
+    CaptureOptions capture;
+    return Launch(command, captureOutput ? &capture : nullptr, hideWindow);
+}
+
+std::unique_ptr<ChildProcess> ChildProcess::Start(const std::string& command, const CaptureOptions& capture,
+                                                  bool hideWindow) {
+    return Launch(command, &capture, hideWindow);
+}
+
+std::unique_ptr<ChildProcess> ChildProcess::Launch(const std::string& command, const CaptureOptions* capture,
+                                                   bool hideWindow) {
+    std::unique_ptr<ChildProcess> child(new ChildProcess());
+    child->m_job = CreateKillOnCloseJob();
+
+    HANDLE readPipe = NULL;
+    HANDLE writePipe = NULL;
+    HANDLE errorReadPipe = NULL;
+    HANDLE errorWritePipe = NULL;
+    if (capture) {
+        SECURITY_ATTRIBUTES sa = {};
+        sa.nLength = sizeof(sa);
+        sa.bInheritHandle = TRUE;
+        if (!CreatePipe(&readPipe, &writePipe, &sa, 0)) return nullptr;
+
+        // Ensure the read handle is not inherited
+        SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0);
+
+        if (capture->separateStderr) {
+            if (!CreatePipe(&errorReadPipe, &errorWritePipe, &sa, 0)) {
+                CloseHandle(readPipe);
+                CloseHandle(writePipe);
+                return nullptr;
+            }
+            SetHandleInformation(errorReadPipe, HANDLE_FLAG_INHERIT, 0);
+        }
+    }
+
     STARTUPINFOA si = {};
     PROCESS_INFORMATION pi = {};
-    DWORD exitCode = 1;
-
     si.cb = sizeof(si);
-    if (hideWindow) {
+    DWORD creationFlags = CREATE_SUSPENDED;   // Join the job before it can spawn anything
+
+    if (capture) {
+        si.dwFlags = STARTF_USESHOWWINDOW | STARTF_USESTDHANDLES;
+        si.wShowWindow = hideWindow ? SW_HIDE : SW_SHOW;
+        si.hStdOutput = writePipe;
+        si.hStdError = errorWritePipe ? errorWritePipe : writePipe;
+        if (hideWindow) creationFlags |= CREATE_NO_WINDOW;
+    } else if (hideWindow) {
         si.dwFlags = STARTF_USESHOWWINDOW | STARTF_USESTDHANDLES;
         si.wShowWindow = SW_HIDE;
-        si.hStdInput = NULL;
-        si.hStdOutput = NULL;
-        si.hStdError = NULL;
+        creationFlags |= CREATE_NO_WINDOW | CREATE_NEW_PROCESS_GROUP;
     }
 
-    DWORD creationFlags = hideWindow ? (CREATE_NO_WINDOW | CREATE_NEW_PROCESS_GROUP) : 0;
-
     // CreateProcess needs a modifiable string
     std::vector<char> cmdBuf(command.begin(), command.end());
     cmdBuf.push_back('\0');
 
-    if (CreateProcessA(NULL, cmdBuf.data(), NULL, NULL, FALSE, creationFlags, NULL, NULL, &si, &pi)) {
-        WaitForSingleObject(pi.hProcess, INFINITE);
-        GetExitCodeProcess(pi.hProcess, &exitCode);
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
+    BOOL created = CreateProcessA(NULL, cmdBuf.data(), NULL, NULL, capture ? TRUE : FALSE,
+                                  creationFlags, NULL, NULL, &si, &pi);
+
+    // Our copies of the write ends must go, or the readers never see EOF
+    if (writePipe) CloseHandle(writePipe);
+    if (errorWritePipe) CloseHandle(errorWritePipe);
+
+    if (!created) {
+        if (readPipe) CloseHandle(readPipe);
+        if (errorReadPipe) CloseHandle(errorReadPipe);
+        return nullptr;
+    }
+
+    // Can fail if we are already in a job that forbids nesting (pre-Windows 8);
+    // Kill() then falls back to terminating just the process
+    if (child->m_job && !AssignProcessToJobObject(child->m_job, pi.hProcess)) {
+        CloseHandle(child->m_job);
+        child->m_job = NULL;
+    }
+
+    ResumeThread(pi.hThread);
+    CloseHandle(pi.hThread);
+    child->m_process = pi.hProcess;
+    CountSpawnedProcess();
+
+    if (capture) {
+        child->m_outputDone = CreateEventA(NULL, TRUE, FALSE, NULL);
+        child->m_onLine = capture->onLine;
+        child->m_output = BoundedTail(capture->maxRetainedBytes);
+        child->m_errorOutput = BoundedTail(capture->maxRetainedBytes);
+        child->m_openStreams = errorReadPipe ? 2 : 1;
+
+        ChildProcess* self = child.get();
+        child->m_reader = std::thread([self, readPipe] {
+            self->ReadStream(readPipe, OutputSource::Stdout, self->m_output);
+        });
+        if (errorReadPipe) {
+            child->m_errorReader = std::thread([self, errorReadPipe] {
+                self->ReadStream(errorReadPipe, OutputSource::Stderr, self->m_errorOutput);
+            });
+        }
+    }
+
+    return child;
+}
+
+void ChildProcess::ReadStream(void* pipe, OutputSource source, BoundedTail& tail) {
+    LineAssembler lines;
+    auto emit = [this, source](const std::string& line) {
+        std::lock_guard<std::mutex> lock(m_lineMutex);
+        m_onLine(source, line);
+    };
+
+    char buffer[4096];
+    DWORD bytesRead;
+    while (ReadFile(pipe, buffer, sizeof(buffer), &bytesRead, NULL) && bytesRead > 0) {
+        tail.Append(buffer, bytesRead);
+        if (m_onLine) lines.Feed(buffer, bytesRead, emit);
+    }
+    if (m_onLine) lines.Flush(emit);
+    CloseHandle(pipe);
+
+    if (--m_openStreams == 0) SetEvent(m_outputDone);
+}
+
+void ChildProcess::JoinReaders() {
+    if (m_reader.joinable()) m_reader.join();
+    if (m_errorReader.joinable()) m_errorReader.join();
+}
+
+bool ChildProcess::Wait(uint32_t timeoutMs) {
+    if (m_outputDone) {
+        HANDLE handles[2] = {m_process, m_outputDone};
+        if (WaitForMultipleObjects(2, handles, TRUE, timeoutMs) != WAIT_OBJECT_0) return false;
+        JoinReaders();
+        return true;
+    }
+    return WaitForSingleObject(m_process, timeoutMs) == WAIT_OBJECT_0;
+}
+
+void ChildProcess::Kill() {
+    if (m_job) {
+        TerminateJobObject(m_job, 1);
+    } else {
+        TerminateProcess(m_process, 1);
     }
+    WaitForSingleObject(m_process, INFINITE);
+    JoinReaders();
+}
 
+int ChildProcess::ExitCode() const {
+    DWORD exitCode = 1;
+    GetExitCodeProcess(m_process, &exitCode);
     return static_cast<int>(exitCode);
 }
 
+int WaitForAnyChild(const std::vector<ChildProcess*>& children, uint32_t timeoutMs) {
+    if (children.empty() || children.size() > MAXIMUM_WAIT_OBJECTS) return -1;
+
+    std::vector<HANDLE> handles;
+    for (const auto* child : children) handles.push_back(child->NativeHandle());
+
+    DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, timeoutMs);
+    if (result >= WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + handles.size()) {
+        return static_cast<int>(result - WAIT_OBJECT_0);
+    }
+    return -1;
+}
+
+namespace {
+
+CommandResult WaitForCommand(std::unique_ptr<ChildProcess> child, uint32_t timeoutMs) {
+    CommandResult result;
+    if (!child) return result;
+    result.started = true;
+
+    if (!child->Wait(timeoutMs)) {
+        child->Kill();
+        result.timedOut = true;
+    }
+
+    result.exitCode = child->ExitCode();
+    result.output = child->Output();
+    result.errorOutput = child->ErrorOutput();
+    result.droppedBytes = child->DroppedBytes();
+    return result;
+}
+
+} // anonymous namespace
+
+CommandResult RunCommand(const std::string& command, uint32_t timeoutMs,
+                         bool captureOutput, bool hideWindow) {
+    return WaitForCommand(ChildProcess::Start(command, captureOutput, hideWindow), timeoutMs);
+}
+
+CommandResult RunCommand(const std::string& command, uint32_t timeoutMs,
+                         const CaptureOptions& capture, bool hideWindow) {
+    return WaitForCommand(ChildProcess::Start(command, capture, hideWindow), timeoutMs);
+}
+
+int ExecuteCommand(const std::string& command, bool hideWindow) {
+    return RunCommand(command, WAIT_NO_TIMEOUT, false, hideWindow).exitCode;
+}
+
 int ExecuteCommandWithOutput(const std::string& command, std::string& output, bool hideWindow) {
+    CommandResult result = RunCommand(command, WAIT_NO_TIMEOUT, true, hideWindow);
+    output = result.output;
+    return result.exitCode;
+}
+
+ShellHost::ShellHost()
+    : m_process(NULL), m_job(NULL), m_stdin(NULL), m_exited(false),
+      m_marker("__HDD_FRAME_" + std::to_string(GetCurrentProcessId()) + "_" +
+               std::to_string(GetTickCount64()) + "_"),
+      m_parser(m_marker), m_seq(0), m_startCount(0) {}
+
+ShellHost::~ShellHost() {
+    Stop();
+}
+
+void ShellHost::Stop() {
+    std::lock_guard<std::mutex> lock(m_runMutex);
+    Shutdown();
+}
+
+bool ShellHost::EnsureStarted() {
+    if (m_process) {
+        std::lock_guard<std::mutex> state(m_stateMutex);
+        if (!m_exited) return true;
+    }
+    Shutdown();   // Crashed or never started
+
     SECURITY_ATTRIBUTES sa = {};
     sa.nLength = sizeof(sa);
     sa.bInheritHandle = TRUE;
 
-    HANDLE hReadPipe, hWritePipe;
-    if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) {
-        return 1;
+    HANDLE outRead = NULL, outWrite = NULL, inRead = NULL, inWrite = NULL;
+    if (!CreatePipe(&outRead, &outWrite, &sa, 0)) return false;
+    if (!CreatePipe(&inRead, &inWrite, &sa, 0)) {
+        CloseHandle(outRead);
+        CloseHandle(outWrite);
+        return false;
     }
-
-    // Ensure the read handle is not inherited
-    SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(outRead, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(inWrite, HANDLE_FLAG_INHERIT, 0);
 
     STARTUPINFOA si = {};
     PROCESS_INFORMATION pi = {};
-    DWORD exitCode = 1;
-
     si.cb = sizeof(si);
     si.dwFlags = STARTF_USESHOWWINDOW | STARTF_USESTDHANDLES;
-    si.wShowWindow = hideWindow ? SW_HIDE : SW_SHOW;
-    si.hStdInput = NULL;
-    si.hStdOutput = hWritePipe;
-    si.hStdError = hWritePipe;
-
-    DWORD creationFlags = hideWindow ? CREATE_NO_WINDOW : 0;
+    si.wShowWindow = SW_HIDE;
+    si.hStdInput = inRead;
+    si.hStdOutput = outWrite;
+    si.hStdError = outWrite;
+
+    std::vector<char> cmdBuf(SHELL_HOST_COMMAND, SHELL_HOST_COMMAND + strlen(SHELL_HOST_COMMAND) + 1);
+    BOOL created = CreateProcessA(NULL, cmdBuf.data(), NULL, NULL, TRUE,
+                                  CREATE_SUSPENDED | CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+    CloseHandle(inRead);
+    CloseHandle(outWrite);
+    if (!created) {
+        CloseHandle(outRead);
+        CloseHandle(inWrite);
+        return false;
+    }
 
-    std::vector<char> cmdBuf(command.begin(), command.end());
-    cmdBuf.push_back('\0');
+    m_job = CreateKillOnCloseJob();
+    if (m_job && !AssignProcessToJobObject(m_job, pi.hProcess)) {
+        CloseHandle(m_job);
+        m_job = NULL;
+    }
+    ResumeThread(pi.hThread);
+    CloseHandle(pi.hThread);
+    CountSpawnedProcess();
 
-    if (CreateProcessA(NULL, cmdBuf.data(), NULL, NULL, TRUE, creationFlags, NULL, NULL, &si, &pi)) {
-        CloseHandle(hWritePipe);
-        hWritePipe = NULL;
+    m_process = pi.hProcess;
+    m_stdin = inWrite;
+    m_startCount++;
 
-        // Read output
-        output.clear();
+    m_reader = std::thread([this, outRead] {
         char buffer[4096];
         DWORD bytesRead;
-        while (ReadFile(hReadPipe, buffer, sizeof(buffer) - 1, &bytesRead, NULL) && bytesRead > 0) {
-            buffer[bytesRead] = '\0';
-            output += buffer;
+        while (ReadFile(outRead, buffer, sizeof(buffer), &bytesRead, NULL) && bytesRead > 0) {
+            std::lock_guard<std::mutex> state(m_stateMutex);
+            m_parser.Feed(buffer, bytesRead);
+            m_frameReady.notify_all();
         }
+        CloseHandle(outRead);
+
+        std::lock_guard<std::mutex> state(m_stateMutex);
+        m_exited = true;
+        m_frameReady.notify_all();
+    });
+
+    // Fail fast instead of prompting; progress bars only add output noise
+    return SendLine("$ErrorActionPreference = 'Stop'; $ProgressPreference = 'SilentlyContinue'\n");
+}
+
+bool ShellHost::SendLine(const std::string& line) {
+    DWORD written = 0;
+    return WriteFile(m_stdin, line.data(), static_cast<DWORD>(line.size()), &written, NULL) &&
+           written == line.size();
+}
 
-        WaitForSingleObject(pi.hProcess, INFINITE);
-        GetExitCodeProcess(pi.hProcess, &exitCode);
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
+void ShellHost::Shutdown() {
+    if (m_stdin) {
+        CloseHandle(m_stdin);   // EOF on stdin ends an idle interpreter
+        m_stdin = NULL;
     }
+    if (m_process) {
+        if (m_job) TerminateJobObject(m_job, 1);
+        else TerminateProcess(m_process, 1);
+        WaitForSingleObject(m_process, INFINITE);
+    }
+    if (m_reader.joinable()) m_reader.join();
+    if (m_process) CloseHandle(m_process);
+    if (m_job) CloseHandle(m_job);
+    m_process = NULL;
+    m_job = NULL;
+
+    std::lock_guard<std::mutex> state(m_stateMutex);
+    m_parser.Reset();
+    m_exited = false;
+}
+
+CommandResult ShellHost::Run(const std::string& command, uint32_t timeoutMs) {
+    std::lock_guard<std::mutex> lock(m_runMutex);
+    CommandResult result;
+
+    // A dead interpreter found before sending is safe to replace and retry;
+    // one that dies mid-command is not, since the command may have run
+    uint32_t seq = ++m_seq;
+    std::string frame = BuildShellFrame(ShellDialect::PowerShell, m_marker, seq, command);
+    if (!EnsureStarted() || !SendLine(frame)) {
+        Shutdown();
+        if (!EnsureStarted() || !SendLine(frame)) {
+            Shutdown();
+            return result;
+        }
+    }
+    result.started = true;
+
+    std::unique_lock<std::mutex> state(m_stateMutex);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    ShellFrame done;
+    for (;;) {
+        bool found = false;
+        while (m_parser.Next(done)) {
+            if (done.seq == seq) {
+                found = true;
+                break;
+            }
+            // Older frames belong to commands that already gave up
+        }
+        if (found) {
+            result.exitCode = done.exitCode;
+            result.output = std::move(done.output);
+            return result;
+        }
+        if (m_exited) break;
 
-    if (hWritePipe) CloseHandle(hWritePipe);
-    CloseHandle(hReadPipe);
+        if (timeoutMs == WAIT_NO_TIMEOUT) {
+            m_frameReady.wait(state);
+        } else if (m_frameReady.wait_until(state, deadline) == std::cv_status::timeout) {
+            result.timedOut = true;
+            break;
+        }
+    }
 
-    return static_cast<int>(exitCode);
+    state.unlock();
+    Shutdown();
+    return result;
 }
 
 std::string GetExeDirectory() {
@@ -111,43 +449,33 @@ std::string GetExePath() {
     return std::string(path);
 }
 
-std::string FindExecutable(const std::string& name) {
-    // Try current directory first
-    std::string exeDir = GetExeDirectory();
-    std::string fullPath = exeDir + "\\" + name;
-    if (GetFileAttributesA(fullPath.c_str()) != INVALID_FILE_ATTRIBUTES) {
-        return fullPath;
-    }
+namespace {
 
-    // Try just the name (in case it's in working directory)
-    if (GetFileAttributesA(name.c_str()) != INVALID_FILE_ATTRIBUTES) {
-        return name;
+class WindowsExeProbe : public ExeProbe {
+public:
+    bool IsExecutable(const std::string& path) override {
+        DWORD attributes = GetFileAttributesA(path.c_str());
+        return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
     }
 
-    // Search in PATH
-    const char* pathEnv = std::getenv("PATH");
-    if (!pathEnv) return "";
-
-    std::string pathStr(pathEnv);
-    size_t start = 0;
-    size_t end;
+    uint64_t DirectoryStamp(const std::string& dir) override {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExA(dir.empty() ? "." : dir.c_str(), GetFileExInfoStandard, &data)) return 0;
+        return (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+               data.ftLastWriteTime.dwLowDateTime;
+    }
+};
 
-    while ((end = pathStr.find(';', start)) != std::string::npos || start < pathStr.length()) {
-        if (end == std::string::npos) end = pathStr.length();
+ExeResolverCache g_exeCache;
 
-        std::string dir = pathStr.substr(start, end - start);
-        if (!dir.empty()) {
-            std::string testPath = dir + "\\" + name;
-            if (GetFileAttributesA(testPath.c_str()) != INVALID_FILE_ATTRIBUTES) {
-                return testPath;
-            }
-        }
+} // anonymous namespace
 
-        start = end + 1;
-        if (start >= pathStr.length()) break;
-    }
+std::string FindExecutable(const std::string& name) {
+    static std::string exeDir = GetExeDirectory();
+    const char* pathEnv = std::getenv("PATH");
 
-    return "";
+    WindowsExeProbe probe;
+    return g_exeCache.Resolve(probe, name, pathEnv ? pathEnv : "", exeDir, GetTickCount64());
 }
 
 } // namespace core
@@ -0,0 +1,369 @@
+// USB HID relay access for HDD Toggle
+// Controls DCT Tech dual-channel USB HID relay
+
+#include "core/relay-device.h"
+#include "core/config.h"
+#include "core/hid-path.h"
+#include "core/relay-serial.h"
+#include "hdd-toggle.h"
+#include <windows.h>
+#include <hidsdi.h>
+#include <setupapi.h>
+#include <atomic>
+#include <string>
+
+#pragma comment(lib, "hid.lib")
+#pragma comment(lib, "setupapi.lib")
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace hdd {
+namespace core {
+
+namespace {
+
+std::atomic<unsigned long> g_enumerations(0);
+
+// Enumerate HID devices and open the first one that matches VENDOR_ID/PRODUCT_ID.
+// With prefilter, interfaces whose path names other USB IDs are skipped
+// without being opened. Returns INVALID_HANDLE_VALUE on failure; on success
+// path holds the device path.
+HANDLE FindRelayDevice(std::string& path, bool prefilter = true, RelayScanStats* stats = nullptr) {
+    g_enumerations++;
+
+    GUID hidGuid;
+    HidD_GetHidGuid(&hidGuid);
+
+    HDEVINFO deviceInfo = SetupDiGetClassDevs(&hidGuid, NULL, NULL,
+                                               DIGCF_PRESENT | DIGCF_DEVICEINTERFACE);
+
+    if (deviceInfo == INVALID_HANDLE_VALUE) return INVALID_HANDLE_VALUE;
+
+    SP_DEVICE_INTERFACE_DATA interfaceData = {sizeof(SP_DEVICE_INTERFACE_DATA)};
+
+    // Stack allocation to avoid malloc/free
+    BYTE buffer[1024];
+    PSP_DEVICE_INTERFACE_DETAIL_DATAA detailData = (PSP_DEVICE_INTERFACE_DETAIL_DATAA)buffer;
+
+    // Enumerate all present HID device interfaces
+    for (DWORD i = 0; SetupDiEnumDeviceInterfaces(deviceInfo, NULL, &hidGuid, i, &interfaceData); i++) {
+        if (stats) stats->interfaces++;
+
+        DWORD requiredSize;
+        // First call asks for the required buffer size
+        SetupDiGetDeviceInterfaceDetailA(deviceInfo, &interfaceData, NULL, 0, &requiredSize, NULL);
+
+        if (requiredSize > sizeof(buffer)) continue;
+
+        // cbSize must be set before retrieving interface details
+        detailData->cbSize = sizeof(SP_DEVICE_INTERFACE_DETAIL_DATAA);
+
+        if (!SetupDiGetDeviceInterfaceDetailA(deviceInfo, &interfaceData,
+                                              detailData, requiredSize, NULL, NULL)) {
+            continue;
+        }
+
+        // Keyboards, mice and UPSes name their own IDs in the path; opening
+        // them is the slow part and can block on a busy device
+        if (prefilter && MatchHidInterfacePath(detailData->DevicePath, RELAY_VENDOR_ID, RELAY_PRODUCT_ID) ==
+                         HidPathMatch::Mismatch) {
+            continue;
+        }
+
+        // Open the HID device path for read/write, allowing shared access
+        if (stats) stats->opened++;
+        HANDLE device = CreateFileA(detailData->DevicePath,
+                                    GENERIC_READ | GENERIC_WRITE,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                    NULL, OPEN_EXISTING, 0, NULL);
+
+        if (device != INVALID_HANDLE_VALUE) {
+            HIDD_ATTRIBUTES attributes = {sizeof(HIDD_ATTRIBUTES)};
+
+            // The attributes stay authoritative; the path is only a hint
+            if (HidD_GetAttributes(device, &attributes)) {
+                if (attributes.VendorID == RELAY_VENDOR_ID &&
+                    attributes.ProductID == RELAY_PRODUCT_ID) {
+                    path = detailData->DevicePath;
+                    SetupDiDestroyDeviceInfoList(deviceInfo);
+                    return device;
+                }
+            }
+
+            CloseHandle(device);
+        }
+    }
+
+    SetupDiDestroyDeviceInfoList(deviceInfo);
+    return INVALID_HANDLE_VALUE;
+}
+
+class HidRelayTransport : public RelayTransport {
+public:
+    HidRelayTransport() : m_device(INVALID_HANDLE_VALUE) {}
+    ~HidRelayTransport() override { Close(); }
+
+    bool Open() override {
+        Close();
+
+        // Known path: one CreateFile instead of opening every HID interface
+        if (!m_path.empty()) {
+            m_device = CreateFileA(m_path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                                   FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+            if (m_device != INVALID_HANDLE_VALUE) return true;
+            m_path.clear();   // Replugged into another port, or gone
+        }
+
+        m_device = FindRelayDevice(m_path);
+        return m_device != INVALID_HANDLE_VALUE;
+    }
+
+    void Close() override {
+        if (m_device != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_device);
+            m_device = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    void ForgetDevice() override {
+        m_path.clear();
+    }
+
+    RelayIoStatus SetFeature(const unsigned char* report, size_t size) override {
+        if (HidD_SetFeature(m_device, const_cast<unsigned char*>(report), static_cast<ULONG>(size))) {
+            return RelayIoStatus::Ok;
+        }
+        return LastErrorStatus();
+    }
+
+    RelayIoStatus GetFeature(unsigned char* report, size_t size) override {
+        if (HidD_GetFeature(m_device, report, static_cast<ULONG>(size))) {
+            return RelayIoStatus::Ok;
+        }
+        return LastErrorStatus();
+    }
+
+private:
+    // Unplugged or re-enumerated devices fail with these; anything else
+    // is the device rejecting the report. ERROR_GEN_FAILURE is a stalled
+    // control transfer on a device that is still there, so it is a failed
+    // write to retry on the same handle, not a reason to search again.
+    static RelayIoStatus LastErrorStatus() {
+        DWORD error = GetLastError();
+        if (error == ERROR_DEVICE_NOT_CONNECTED || error == ERROR_INVALID_HANDLE ||
+            error == ERROR_FILE_NOT_FOUND) {
+            return RelayIoStatus::Disconnected;
+        }
+        return RelayIoStatus::Failed;
+    }
+
+    std::string m_path;
+    HANDLE m_device;
+};
+
+// QueryPerformanceCounter time with a waitable timer for the bulk of each
+// wait and a short spin at the end
+class PrecisionClock : public SequenceClock {
+public:
+    PrecisionClock() : m_spinUs(500) {
+        QueryPerformanceFrequency(&m_frequency);
+        m_timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (!m_timer) {
+            // Older Windows: the timer follows the ~15.6 ms system tick
+            m_timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+            m_spinUs = 16000;
+        }
+    }
+
+    ~PrecisionClock() override {
+        if (m_timer) CloseHandle(m_timer);
+    }
+
+    int64_t NowUs() override {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        // Split to keep counter * 1e6 from overflowing
+        int64_t seconds = counter.QuadPart / m_frequency.QuadPart;
+        int64_t rest = counter.QuadPart % m_frequency.QuadPart;
+        return seconds * 1000000 + rest * 1000000 / m_frequency.QuadPart;
+    }
+
+    void SleepUntilUs(int64_t deadlineUs) override {
+        int64_t remaining = deadlineUs - NowUs();
+        if (remaining > m_spinUs && m_timer) {
+            LARGE_INTEGER due;
+            due.QuadPart = -(remaining - m_spinUs) * 10;    // Relative, 100 ns units
+            if (SetWaitableTimer(m_timer, &due, 0, NULL, NULL, FALSE)) {
+                WaitForSingleObject(m_timer, INFINITE);
+            }
+        }
+        while (NowUs() < deadlineUs) YieldProcessor();
+    }
+
+private:
+    LARGE_INTEGER m_frequency;
+    HANDLE m_timer;
+    int64_t m_spinUs;
+};
+
+// COM port for serial relay boards. Settings and timeouts are applied once
+// at open; reads only change the timeout when the caller asks for another.
+class Win32SerialPort : public SerialPort {
+public:
+    Win32SerialPort() : m_handle(INVALID_HANDLE_VALUE), m_readTimeoutMs(0), m_busy(false) {}
+    ~Win32SerialPort() override { Close(); }
+
+    bool Open(const std::string& name) override {
+        Close();
+        if (name.empty()) return false;
+
+        // COM10 and up only open through the device namespace
+        std::string path = StartsWith(name, "\\\\.\\") ? name : "\\\\.\\" + name;
+        m_handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (m_handle == INVALID_HANDLE_VALUE) {
+            // COM ports open exclusively: access denied means someone else has it
+            DWORD error = GetLastError();
+            m_busy = error == ERROR_ACCESS_DENIED || error == ERROR_SHARING_VIOLATION;
+            return false;
+        }
+        m_busy = false;
+
+        DCB dcb = {};
+        dcb.DCBlength = sizeof(DCB);
+        if (!GetCommState(m_handle, &dcb)) {
+            Close();
+            return false;
+        }
+        dcb.BaudRate = RELAY_SERIAL_BAUD;
+        dcb.ByteSize = 8;
+        dcb.Parity = NOPARITY;
+        dcb.StopBits = ONESTOPBIT;
+        dcb.fBinary = TRUE;
+        dcb.fParity = FALSE;
+        dcb.fOutxCtsFlow = FALSE;
+        dcb.fOutxDsrFlow = FALSE;
+        dcb.fOutX = FALSE;
+        dcb.fInX = FALSE;
+        dcb.fDtrControl = DTR_CONTROL_ENABLE;
+        dcb.fRtsControl = RTS_CONTROL_ENABLE;
+
+        if (!SetCommState(m_handle, &dcb) || !ApplyTimeouts(0)) {
+            Close();
+            return false;
+        }
+        PurgeComm(m_handle, PURGE_RXCLEAR | PURGE_TXCLEAR);
+        return true;
+    }
+
+    void Close() override {
+        if (m_handle != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_handle);
+            m_handle = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    // A few bytes go straight into the driver's buffer; the write timeout
+    // only matters if that buffer is full
+    RelayIoStatus Write(const unsigned char* data, size_t size) override {
+        DWORD written = 0;
+        if (!WriteFile(m_handle, data, static_cast<DWORD>(size), &written, NULL)) {
+            return IsDisconnectError(GetLastError()) ? RelayIoStatus::Disconnected : RelayIoStatus::Failed;
+        }
+        return written == size ? RelayIoStatus::Ok : RelayIoStatus::Failed;
+    }
+
+    int Read(unsigned char* buffer, size_t size, uint32_t timeoutMs) override {
+        if (timeoutMs != m_readTimeoutMs && !ApplyTimeouts(timeoutMs)) return -1;
+
+        DWORD count = 0;
+        if (!ReadFile(m_handle, buffer, static_cast<DWORD>(size), &count, NULL)) return -1;
+        return static_cast<int>(count);
+    }
+
+    bool IsBusy() const override { return m_busy; }
+
+    // Only one handle per COM port system-wide, so it is closed between
+    // switches (reopening costs a few milliseconds)
+    bool IsExclusive() const override { return true; }
+
+private:
+    // Reads return as soon as a byte is there, or after timeoutMs with
+    // nothing (0 = immediately)
+    bool ApplyTimeouts(uint32_t timeoutMs) {
+        COMMTIMEOUTS timeouts = {};
+        timeouts.ReadIntervalTimeout = MAXDWORD;
+        if (timeoutMs > 0) {
+            timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+            timeouts.ReadTotalTimeoutConstant = timeoutMs;
+        }
+        timeouts.WriteTotalTimeoutConstant = SERIAL_WRITE_TIMEOUT_MS;
+        if (!SetCommTimeouts(m_handle, &timeouts)) return false;
+        m_readTimeoutMs = timeoutMs;
+        return true;
+    }
+
+    // A USB serial adapter that was pulled fails with these
+    static bool IsDisconnectError(DWORD error) {
+        return error == ERROR_BAD_COMMAND ||
+               error == ERROR_DEVICE_NOT_CONNECTED || error == ERROR_GEN_FAILURE ||
+               error == ERROR_OPERATION_ABORTED || error == ERROR_INVALID_HANDLE;
+    }
+
+    HANDLE m_handle;
+    uint32_t m_readTimeoutMs;
+    bool m_busy;
+};
+
+// Serial transport that owns its COM port (declared first, so the port
+// outlives the transport)
+struct ComPortHolder {
+    Win32SerialPort comPort;
+};
+
+class ComRelayTransport : private ComPortHolder, public SerialRelayTransport {
+public:
+    explicit ComRelayTransport(const std::string& portName)
+        : SerialRelayTransport(comPort, portName) {}
+};
+
+} // anonymous namespace
+
+std::unique_ptr<RelayTransport> CreateHidRelayTransport() {
+    return std::unique_ptr<RelayTransport>(new HidRelayTransport());
+}
+
+std::unique_ptr<RelayTransport> CreateSerialRelayTransport(const std::string& portName) {
+    return std::unique_ptr<RelayTransport>(new ComRelayTransport(portName));
+}
+
+std::unique_ptr<RelayTransport> CreateRelayTransport() {
+    const RelaySettings& settings = GetConfig().relay;
+    if (settings.type == "serial") return CreateSerialRelayTransport(settings.port);
+    return CreateHidRelayTransport();
+}
+
+RelayConnection& GetRelayConnection() {
+    static RelayConnection connection(CreateRelayTransport());
+    return connection;
+}
+
+std::unique_ptr<SequenceClock> CreatePrecisionClock() {
+    return std::unique_ptr<SequenceClock>(new PrecisionClock());
+}
+
+bool ScanForRelay(bool prefilter, RelayScanStats& stats) {
+    std::string path;
+    HANDLE device = FindRelayDevice(path, prefilter, &stats);
+    if (device == INVALID_HANDLE_VALUE) return false;
+    CloseHandle(device);
+    return true;
+}
+
+unsigned long GetRelayEnumerationCount() {
+    return g_enumerations.load();
+}
+
+} // namespace core
+} // namespace hdd
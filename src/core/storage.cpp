@@ -0,0 +1,276 @@
+// In-process storage queries for HDD Toggle
+
+#include "core/storage.h"
+#include "core/disk.h"
+#include "core/drive-watcher.h"
+#include <windows.h>
+#include <winioctl.h>
+#include <cfgmgr32.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#pragma comment(lib, "cfgmgr32.lib")
+
+namespace hdd {
+namespace core {
+
+namespace {
+
+HANDLE OpenPhysicalDrive(int diskNumber, DWORD access) {
+    char path[64];
+    snprintf(path, sizeof(path), "\\\\.\\PhysicalDrive%d", diskNumber);
+    return CreateFileA(path, access, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                       NULL, OPEN_EXISTING, 0, NULL);
+}
+
+VolumeMapCache g_volumeCache;
+
+// GUID paths of every volume in the system; cheap, opens no devices
+bool ListVolumeNames(std::vector<std::string>& names) {
+    char name[MAX_PATH];
+    HANDLE find = FindFirstVolumeA(name, sizeof(name));
+    if (find == INVALID_HANDLE_VALUE) return false;
+
+    do {
+        names.push_back(name);
+    } while (FindNextVolumeA(find, name, sizeof(name)));
+
+    FindVolumeClose(find);
+    return true;
+}
+
+// Disks a volume occupies (more than one for spanned/striped volumes)
+void ReadVolumeDisks(const std::string& volumeName, std::vector<int>& disks, int& partitionNumber) {
+    // CreateFile wants the GUID path without its trailing backslash.
+    // Zero access is enough for these IOCTLs and does not lock the volume.
+    std::string path = volumeName;
+    if (!path.empty() && path.back() == '\\') path.pop_back();
+
+    HANDLE volume = CreateFileA(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                NULL, OPEN_EXISTING, 0, NULL);
+    if (volume == INVALID_HANDLE_VALUE) return;
+
+    // Room for several extents on the stack
+    union {
+        VOLUME_DISK_EXTENTS extents;
+        BYTE raw[sizeof(VOLUME_DISK_EXTENTS) + 7 * sizeof(DISK_EXTENT)];
+    } buffer;
+    DWORD bytes = 0;
+
+    if (DeviceIoControl(volume, IOCTL_VOLUME_GET_VOLUME_DISK_EXTENTS,
+                        NULL, 0, &buffer, sizeof(buffer), &bytes, NULL)) {
+        for (DWORD i = 0; i < buffer.extents.NumberOfDiskExtents; i++) {
+            int disk = static_cast<int>(buffer.extents.Extents[i].DiskNumber);
+            if (std::find(disks.begin(), disks.end(), disk) == disks.end()) {
+                disks.push_back(disk);
+            }
+        }
+    }
+
+    STORAGE_DEVICE_NUMBER number = {};
+    if (DeviceIoControl(volume, IOCTL_STORAGE_GET_DEVICE_NUMBER,
+                        NULL, 0, &number, sizeof(number), &bytes, NULL)) {
+        partitionNumber = static_cast<int>(number.PartitionNumber);
+    }
+
+    CloseHandle(volume);
+}
+
+// Drive letters and folder mounts of a volume
+void ReadMountPoints(const std::string& volumeName, std::vector<std::string>& mountPoints) {
+    char buffer[1024];
+    std::vector<char> large;
+    char* paths = buffer;
+    DWORD length = 0;
+
+    if (!GetVolumePathNamesForVolumeNameA(volumeName.c_str(), buffer, sizeof(buffer), &length)) {
+        if (GetLastError() != ERROR_MORE_DATA) return;
+        large.resize(length);
+        paths = large.data();
+        if (!GetVolumePathNamesForVolumeNameA(volumeName.c_str(), paths, length, &length)) return;
+    }
+
+    // Double-NUL-terminated list
+    for (const char* p = paths; *p; p += strlen(p) + 1) {
+        mountPoints.push_back(p);
+    }
+}
+
+} // anonymous namespace
+
+bool FindTargetDisk(const std::string& targetSerial, const std::string& targetModel, DiskRecord& disk) {
+    std::vector<DiskRecord> disks;
+    if (!GetDiskQuerySession().EnumerateDisks(disks)) return false;
+
+    const DiskRecord* match = FindDiskByTarget(disks, targetSerial, targetModel);
+    if (!match) return false;
+
+    disk = *match;
+    return true;
+}
+
+std::vector<VolumeMount> ResolveDiskVolumes(int diskNumber) {
+    std::vector<VolumeMount> volumes;
+    std::vector<std::string> names;
+    if (diskNumber < 0 || !ListVolumeNames(names)) return volumes;
+
+    uint64_t generation = VolumeSetGeneration(names, static_cast<uint32_t>(GetLogicalDrives()));
+    if (g_volumeCache.Lookup(diskNumber, generation, volumes)) return volumes;
+    uint64_t epoch = g_volumeCache.Epoch();
+
+    // One pass over all volumes fills the map for every disk
+    DiskVolumeMap map;
+    for (const auto& name : names) {
+        std::vector<int> disks;
+        int partitionNumber = 0;
+        ReadVolumeDisks(name, disks, partitionNumber);
+        if (disks.empty()) continue;   // CD-ROMs, network and virtual volumes
+
+        VolumeMount volume;
+        volume.volumeName = name;
+        volume.partitionNumber = disks.size() == 1 ? partitionNumber : 0;
+        ReadMountPoints(name, volume.mountPoints);
+
+        for (int disk : disks) map[disk].push_back(volume);
+    }
+
+    auto it = map.find(diskNumber);
+    if (it != map.end()) volumes = it->second;
+
+    g_volumeCache.Store(generation, std::move(map), epoch);
+    return volumes;
+}
+
+void InvalidateVolumeCache() {
+    g_volumeCache.Invalidate();
+}
+
+std::vector<std::string> GetDiskDriveLetters(int diskNumber) {
+    return DriveLettersFromMounts(ResolveDiskVolumes(diskNumber));
+}
+
+bool SetDiskOffline(int diskNumber, bool offline) {
+    HANDLE device = OpenPhysicalDrive(diskNumber, GENERIC_READ | GENERIC_WRITE);
+    if (device == INVALID_HANDLE_VALUE) return false;
+
+    SET_DISK_ATTRIBUTES attributes = {};
+    attributes.Version = sizeof(SET_DISK_ATTRIBUTES);
+    attributes.Persist = TRUE;
+    attributes.Attributes = offline ? DISK_ATTRIBUTE_OFFLINE : 0;
+    attributes.AttributesMask = DISK_ATTRIBUTE_OFFLINE;
+
+    DWORD bytes = 0;
+    BOOL ok = DeviceIoControl(device, IOCTL_DISK_SET_DISK_ATTRIBUTES,
+                              &attributes, sizeof(attributes), NULL, 0, &bytes, NULL);
+    if (ok) {
+        // Have the partition manager pick up the change (mount or tear down volumes)
+        DeviceIoControl(device, IOCTL_DISK_UPDATE_PROPERTIES, NULL, 0, NULL, 0, &bytes, NULL);
+    }
+
+    CloseHandle(device);
+    return ok != FALSE;
+}
+
+void FlushVolume(const std::string& volumeName, VolumeFlushResult& result) {
+    // CreateFile wants the GUID path without its trailing backslash
+    std::string path = volumeName;
+    if (!path.empty() && path.back() == '\\') path.pop_back();
+
+    HANDLE volume = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                NULL, OPEN_EXISTING, 0, NULL);
+    if (volume == INVALID_HANDLE_VALUE) {
+        result.accessDenied = GetLastError() == ERROR_ACCESS_DENIED;
+        return;
+    }
+
+    DISK_PERFORMANCE before = {};
+    DISK_PERFORMANCE after = {};
+    DWORD bytes = 0;
+    bool counted = DeviceIoControl(volume, IOCTL_DISK_PERFORMANCE, NULL, 0,
+                                   &before, sizeof(before), &bytes, NULL) != FALSE;
+
+    result.ok = FlushFileBuffers(volume) != FALSE;
+
+    if (counted && DeviceIoControl(volume, IOCTL_DISK_PERFORMANCE, NULL, 0,
+                                   &after, sizeof(after), &bytes, NULL)) {
+        result.bytesKnown = true;
+        result.bytesWritten = static_cast<uint64_t>(after.BytesWritten.QuadPart - before.BytesWritten.QuadPart);
+    }
+    CloseHandle(volume);
+}
+
+bool ReadDiskIoCounters(int diskNumber, DiskIoCounters& counters) {
+    // Query-only access: opening for read would need administrator rights
+    HANDLE device = OpenPhysicalDrive(diskNumber, 0);
+    if (device == INVALID_HANDLE_VALUE) return false;
+
+    DISK_PERFORMANCE performance = {};
+    DWORD bytes = 0;
+    BOOL ok = DeviceIoControl(device, IOCTL_DISK_PERFORMANCE, NULL, 0,
+                              &performance, sizeof(performance), &bytes, NULL);
+    CloseHandle(device);
+    if (!ok) return false;
+
+    counters.reads = performance.ReadCount;
+    counters.writes = performance.WriteCount;
+    return true;
+}
+
+struct DiskArrivalCallback {
+    // Runs on a system thread pool thread
+    static DWORD CALLBACK OnNotify(HCMNOTIFICATION, PVOID context, CM_NOTIFY_ACTION action,
+                                   PCM_NOTIFY_EVENT_DATA, DWORD) {
+        if (action == CM_NOTIFY_ACTION_DEVICEINTERFACEARRIVAL) {
+            static_cast<DiskArrivalListener*>(context)->OnArrival();
+        }
+        return ERROR_SUCCESS;
+    }
+};
+
+DiskArrivalListener::DiskArrivalListener() : m_notify(nullptr), m_count(0) {
+    CM_NOTIFY_FILTER filter = {};
+    filter.cbSize = sizeof(filter);
+    filter.FilterType = CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE;
+    filter.u.DeviceInterface.ClassGuid = kDiskInterfaceGuid;
+
+    HCMNOTIFICATION notify = NULL;
+    if (CM_Register_Notification(&filter, this, DiskArrivalCallback::OnNotify, &notify) == CR_SUCCESS) {
+        m_notify = notify;
+    }
+}
+
+DiskArrivalListener::~DiskArrivalListener() {
+    // Waits for callbacks in flight, so none can touch this afterwards
+    if (m_notify) CM_Unregister_Notification(static_cast<HCMNOTIFICATION>(m_notify));
+}
+
+uint64_t DiskArrivalListener::Count() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
+
+bool DiskArrivalListener::WaitForArrival(uint64_t seen, uint32_t timeoutMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_arrived.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] { return m_count > seen; });
+}
+
+void DiskArrivalListener::OnArrival() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_count++;
+    }
+    m_arrived.notify_all();
+}
+
+bool RescanDevices() {
+    DEVINST root;
+    if (CM_Locate_DevNodeA(&root, NULL, CM_LOCATE_DEVNODE_NORMAL) != CR_SUCCESS) {
+        return false;
+    }
+    return CM_Reenumerate_DevNode(root, CM_REENUMERATE_SYNCHRONOUS) == CR_SUCCESS;
+}
+
+} // namespace core
+} // namespace hdd
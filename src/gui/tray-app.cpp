@@ -5,19 +5,26 @@
 #include "commands.h"
 #include "hdd-toggle.h"
 #include "hdd-utils.h"
+#include "core/config.h"
+#include "core/disk.h"
+#include "core/drive-watcher.h"
+#include "core/relay-device.h"
+#include "core/storage.h"
+#include "core/wake-predictor.h"
 #include <windows.h>
 #include <shellapi.h>
 #include <commctrl.h>
-#include <wbemidl.h>
-#include <comdef.h>
 #include <shlwapi.h>
 #include <dwmapi.h>
 #include <shobjidl.h>
 #include <shlobj.h>
 #include <propvarutil.h>
 #include <propkey.h>
+#include <ctime>
+#include <mutex>
 #include <thread>
 #include <string>
+#include <vector>
 #include <filesystem>
 
 // C++/WinRT for toast notifications
@@ -48,6 +55,7 @@ namespace commands {
 namespace {
 
 #define WM_TRAYICON (WM_USER + 1)
+#define WM_DRIVESTATE (WM_USER + 2)
 #define IDM_WAKE_DRIVE 1001
 #define IDM_SLEEP_DRIVE 1002
 #define IDM_REFRESH_STATUS 1003
@@ -55,14 +63,29 @@ namespace {
 #define IDM_WAKE_COMPLETE 1005
 #define IDM_SLEEP_COMPLETE 1006
 #define IDM_STATUS_DISPLAY 1007
+#define IDM_PREWAKE_STATS 1008
 #define IDT_STATUS_TIMER 2001
 #define IDT_ANIMATION_TIMER 2002
 #define IDT_PERIODIC_CHECK 2003
+#define IDT_DEVICE_SETTLE 2004
+#define IDT_PREWAKE 2005
+#define IDT_PREWAKE_CHECK 2006
+#define IDT_IDLE_CHECK 2007
 #define TRAY_ICON_ID 1
 #define IDI_MAIN_ICON 100
 #define IDI_DRIVE_ON_ICON 101
 #define IDI_DRIVE_OFF_ICON 102
 
+// Longest single pre-wake timer; rescheduling this often also picks up
+// clock changes and newly learned slots
+const UINT PREWAKE_RECHECK_MS = 60 * 60000;
+
+// How often a pre-woken drive is checked for use
+const UINT PREWAKE_USE_CHECK_MS = 60000;
+
+// I/O operations after the arrival burst that count as someone using the drive
+const uint64_t PREWAKE_USE_MIN_IO = 32;
+
 // Windows 11 Dark Mode support
 enum PreferredAppMode {
     PAM_Default = 0,
@@ -80,48 +103,6 @@ static fnAllowDarkModeForWindow pAllowDarkModeForWindow = nullptr;
 static fnSetPreferredAppMode pSetPreferredAppMode = nullptr;
 static fnFlushMenuThemes pFlushMenuThemes = nullptr;
 
-// Simple COM smart pointer template
-template<typename T>
-class ComPtr {
-public:
-    ComPtr() : m_ptr(nullptr) {}
-    ~ComPtr() { Release(); }
-    T** operator&() { return &m_ptr; }
-    T* operator->() { return m_ptr; }
-    T* Get() const { return m_ptr; }
-    operator bool() const { return m_ptr != nullptr; }
-    void Release() {
-        if (m_ptr) { m_ptr->Release(); m_ptr = nullptr; }
-    }
-private:
-    ComPtr(const ComPtr&) = delete;
-    ComPtr& operator=(const ComPtr&) = delete;
-    T* m_ptr;
-};
-
-// RAII COM initializer
-class ComInitializer {
-public:
-    ComInitializer() : m_initialized(false) {
-        HRESULT hr = CoInitializeEx(0, COINIT_MULTITHREADED);
-        m_initialized = SUCCEEDED(hr);
-    }
-    ~ComInitializer() { if (m_initialized) CoUninitialize(); }
-    bool IsInitialized() const { return m_initialized; }
-private:
-    bool m_initialized;
-};
-
-// Configuration
-struct AppConfig {
-    char targetSerial[64];
-    char targetModel[128];
-    DWORD periodicCheckMinutes;
-    DWORD postOperationCheckSeconds;
-    BOOL showNotifications;
-    BOOL debugMode;
-};
-
 // Application state
 struct AppState {
     HINSTANCE hInstance = nullptr;
@@ -134,12 +115,30 @@ struct AppState {
     int animationFrame = 0;
     ULONGLONG lastPeriodicCheck = 0;
     ULONGLONG lastMenuCloseTime = 0;
-    AppConfig config = {};
+    Config config;
     UINT wmTaskbarCreated = 0;
+    core::DriveWatcher driveWatcher;
+    core::DeviceSettleTimer deviceSettle;
+
+    // Predictive pre-wake ([Predictor] Enabled)
+    core::WakePredictor predictor;
+    core::PreWakePlan preWakePlan;
+    int64_t handledSlot = -1;           // Slot last pre-woken (or skipped)
+    bool preWaking = false;             // Current wake was started by the predictor
+    bool ioBaselineValid = false;
+    core::DiskIoCounters ioBaseline;
+
+    // Auto-sleep ([Power] AutoSleepIdleMinutes)
+    core::IdleTracker idleTracker;
+    int idleDiskNumber = -1;            // Resolved once per online period
 };
 
 static AppState g_app;
 
+// Latest progress line from the running operation (set from worker threads)
+static std::mutex g_progressMutex;
+static std::string g_progressText;
+
 // Forward declarations
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 BOOL CreateTrayIcon(HWND hwnd);
@@ -153,10 +152,21 @@ void StartProgressAnimation();
 void StopProgressAnimation();
 void AsyncDriveOperation(HWND hwnd, bool isWake);
 void AsyncPeriodicCheck(HWND hwnd);
+void AsyncDeviceChangeCheck(HWND hwnd);
 void LoadConfiguration();
+void OnOperationProgress(const char* message);
 void OnWakeDrive();
 void OnSleepDrive();
 void OnRefreshStatus();
+void StartDriveOperation(bool isWake, const char* message);
+int64_t LocalMinutesNow();
+void InitPredictor(HWND hwnd);
+void RecordDriveUse();
+void SchedulePreWake(HWND hwnd);
+void OnPreWakeTimer(HWND hwnd);
+void OnPreWakeCheck(HWND hwnd);
+void InitIdleMonitor(HWND hwnd);
+void OnIdleCheck();
 BOOL EnsureStartMenuShortcut();
 
 // Get executable directory
@@ -188,10 +198,44 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     switch (uMsg) {
         case WM_CREATE:
             LoadConfiguration();
+            SetProgressHandler(OnOperationProgress);
             if (!CreateTrayIcon(hwnd)) return -1;
             g_app.driveState = DetectDriveState();
             UpdateTrayIcon();
-            SetTimer(hwnd, IDT_PERIODIC_CHECK, g_app.config.periodicCheckMinutes * 60000, NULL);
+            // Device notifications replace polling; only poll if they are unavailable
+            if (!g_app.driveWatcher.Start(hwnd)) {
+                SetTimer(hwnd, IDT_PERIODIC_CHECK, g_app.config.periodicCheckMinutes * 60000, NULL);
+            }
+            InitPredictor(hwnd);
+            InitIdleMonitor(hwnd);
+            break;
+
+        case WM_DEVICECHANGE:
+            if (core::DriveWatcher::IsHidRemoval(wParam, lParam)) {
+                // Possibly the relay: stop reusing its handle and path
+                core::GetRelayConnection().OnDeviceRemoved();
+            }
+            if (core::DriveWatcher::IsDiskChange(wParam, lParam)) {
+                // Disk numbers may have moved; flush, eject and blocker scans
+                // must not use the old disk-to-volume map
+                core::InvalidateVolumeCache();
+
+                // One detection pass once the burst of disk/volume events settles
+                g_app.deviceSettle.Trigger(GetTickCount64());
+                SetTimer(hwnd, IDT_DEVICE_SETTLE, g_app.deviceSettle.RemainingMs(GetTickCount64()), NULL);
+            }
+            return TRUE;
+
+        case WM_DRIVESTATE:
+            if (!g_app.isTransitioning && static_cast<DriveState>(wParam) != g_app.driveState) {
+                // Woken from outside the tray (e.g. "hdd-toggle wake"): a use the predictor missed
+                if (static_cast<DriveState>(wParam) == DriveState::Online &&
+                    g_app.driveState == DriveState::Offline) {
+                    RecordDriveUse();
+                }
+                g_app.driveState = static_cast<DriveState>(wParam);
+                UpdateTrayIcon();
+            }
             break;
 
         case WM_TRAYICON:
@@ -216,6 +260,12 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     StopProgressAnimation();
                     ShowBalloonTip("", lParam == 0 ? "Drive wake completed" : "Drive wake failed",
                                    lParam == 0 ? NIIF_INFO : NIIF_WARNING);
+                    if (g_app.preWaking) {
+                        // Watch the pre-woken drive for use until the prediction expires
+                        g_app.preWaking = false;
+                        g_app.ioBaselineValid = false;
+                        SetTimer(hwnd, IDT_PREWAKE_CHECK, PREWAKE_USE_CHECK_MS, NULL);
+                    }
                     SetTimer(hwnd, IDT_STATUS_TIMER, g_app.config.postOperationCheckSeconds * 1000, NULL);
                     break;
                 case IDM_SLEEP_COMPLETE:
@@ -239,12 +289,39 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             } else if (wParam == IDT_ANIMATION_TIMER) {
                 char tooltip[128];
                 g_app.animationFrame = (g_app.animationFrame + 1) % 4;
-                sprintf_s(tooltip, sizeof(tooltip), "HDD Toggle - Working%s", GetAnimationDots(g_app.animationFrame));
+                std::string progress;
+                {
+                    std::lock_guard<std::mutex> lock(g_progressMutex);
+                    progress = g_progressText;
+                }
+                // Second tooltip line shows what the helper is doing right now
+                sprintf_s(tooltip, sizeof(tooltip), "HDD Toggle - Working%s%s%.90s", GetAnimationDots(g_app.animationFrame),
+                          progress.empty() ? "" : "\n", progress.c_str());
                 strcpy_s(g_app.nid.szTip, sizeof(g_app.nid.szTip), tooltip);
                 g_app.nid.uFlags = NIF_TIP;
                 Shell_NotifyIcon(NIM_MODIFY, &g_app.nid);
             } else if (wParam == IDT_PERIODIC_CHECK) {
+                // Also covers missed device-change events (polling fallback)
+                core::InvalidateVolumeCache();
                 std::thread(AsyncPeriodicCheck, hwnd).detach();
+            } else if (wParam == IDT_DEVICE_SETTLE) {
+                ULONGLONG now = GetTickCount64();
+                if (g_app.deviceSettle.Fire(now)) {
+                    KillTimer(hwnd, IDT_DEVICE_SETTLE);
+                    if (!g_app.isTransitioning) {
+                        std::thread(AsyncDeviceChangeCheck, hwnd).detach();
+                    }
+                } else if (g_app.deviceSettle.IsPending()) {
+                    SetTimer(hwnd, IDT_DEVICE_SETTLE, g_app.deviceSettle.RemainingMs(now), NULL);
+                } else {
+                    KillTimer(hwnd, IDT_DEVICE_SETTLE);
+                }
+            } else if (wParam == IDT_PREWAKE) {
+                OnPreWakeTimer(hwnd);
+            } else if (wParam == IDT_PREWAKE_CHECK) {
+                OnPreWakeCheck(hwnd);
+            } else if (wParam == IDT_IDLE_CHECK) {
+                OnIdleCheck();
             }
             break;
 
@@ -253,6 +330,11 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             if (g_app.hMenu) DestroyMenu(g_app.hMenu);
             KillTimer(hwnd, IDT_STATUS_TIMER);
             KillTimer(hwnd, IDT_PERIODIC_CHECK);
+            KillTimer(hwnd, IDT_DEVICE_SETTLE);
+            KillTimer(hwnd, IDT_PREWAKE);
+            KillTimer(hwnd, IDT_PREWAKE_CHECK);
+            KillTimer(hwnd, IDT_IDLE_CHECK);
+            g_app.driveWatcher.Stop();
             PostQuitMessage(0);
             break;
 
@@ -320,6 +402,13 @@ void ShowContextMenu(HWND hwnd) {
 
     const char* statusText = DriveStateToStatusString(g_app.driveState);
     AppendMenu(g_app.hMenu, MF_STRING | MF_DISABLED | MF_GRAYED, IDM_STATUS_DISPLAY, statusText);
+    if (g_app.config.predictor.enabled) {
+        const core::PredictorStats& stats = g_app.predictor.Stats();
+        char preWakeText[96];
+        sprintf_s(preWakeText, sizeof(preWakeText), "Pre-wake: %u of %u used, %.0f%% of uses covered",
+                  stats.hits, stats.hits + stats.falseWakes, stats.Coverage() * 100);
+        AppendMenu(g_app.hMenu, MF_STRING | MF_DISABLED | MF_GRAYED, IDM_PREWAKE_STATS, preWakeText);
+    }
     AppendMenu(g_app.hMenu, MF_SEPARATOR, 0, NULL);
 
     if (g_app.driveState == DriveState::Online) {
@@ -370,29 +459,9 @@ HICON LoadIconForDriveState(DriveState state) {
 }
 
 void LoadConfiguration() {
-    fs::path iniPath = GetExeDirectory() / "hdd-control.ini";
-    std::string iniPathStr = iniPath.string();
-    const char* iniPathC = iniPathStr.c_str();
-
-    strcpy_s(g_app.config.targetSerial, sizeof(g_app.config.targetSerial), DEFAULT_TARGET_SERIAL);
-    strcpy_s(g_app.config.targetModel, sizeof(g_app.config.targetModel), DEFAULT_TARGET_MODEL);
-    g_app.config.periodicCheckMinutes = 10;
-    g_app.config.postOperationCheckSeconds = 3;
-    g_app.config.showNotifications = TRUE;
-    g_app.config.debugMode = FALSE;
-
-    if (fs::exists(iniPath)) {
-        GetPrivateProfileString("Drive", "SerialNumber", g_app.config.targetSerial,
-                               g_app.config.targetSerial, sizeof(g_app.config.targetSerial), iniPathC);
-        GetPrivateProfileString("Drive", "Model", g_app.config.targetModel,
-                               g_app.config.targetModel, sizeof(g_app.config.targetModel), iniPathC);
-        DWORD checkMinutes = GetPrivateProfileInt("Timing", "PeriodicCheckMinutes", g_app.config.periodicCheckMinutes, iniPathC);
-        if (checkMinutes >= 1) g_app.config.periodicCheckMinutes = checkMinutes;
-        g_app.config.postOperationCheckSeconds = GetPrivateProfileInt("Timing", "PostOperationCheckSeconds",
-                                                                 g_app.config.postOperationCheckSeconds, iniPathC);
-        g_app.config.showNotifications = GetPrivateProfileInt("UI", "ShowNotifications", g_app.config.showNotifications, iniPathC);
-        g_app.config.debugMode = GetPrivateProfileInt("Advanced", "DebugMode", g_app.config.debugMode, iniPathC);
-    }
+    // Shared with the CLI commands; also selects the detection backend.
+    // The tray tracks the primary drive ([Drive], else the first [Drive.N]).
+    g_app.config = core::GetConfig();
 }
 
 void AsyncPeriodicCheck(HWND hwnd) {
@@ -406,62 +475,18 @@ void AsyncPeriodicCheck(HWND hwnd) {
     }
 }
 
-DriveState DetectDriveState() {
-    ComInitializer comInit;
-    if (!comInit.IsInitialized()) return DriveState::Unknown;
-
-    CoInitializeSecurity(NULL, -1, NULL, NULL, RPC_C_AUTHN_LEVEL_NONE,
-                        RPC_C_IMP_LEVEL_IMPERSONATE, NULL, EOAC_NONE, NULL);
-
-    ComPtr<IWbemLocator> pLoc;
-    if (FAILED(CoCreateInstance(CLSID_WbemLocator, 0, CLSCTX_INPROC_SERVER,
-                                IID_IWbemLocator, (LPVOID*)&pLoc))) return DriveState::Unknown;
-
-    ComPtr<IWbemServices> pSvc;
-    if (FAILED(pLoc->ConnectServer(_bstr_t(L"ROOT\\Microsoft\\Windows\\Storage"),
-                                   NULL, NULL, 0, NULL, 0, 0, &pSvc))) return DriveState::Unknown;
-
-    if (FAILED(CoSetProxyBlanket(pSvc.Get(), RPC_C_AUTHN_WINNT, RPC_C_AUTHZ_NONE, NULL,
-                                 RPC_C_AUTHN_LEVEL_CALL, RPC_C_IMP_LEVEL_IMPERSONATE,
-                                 NULL, EOAC_NONE))) return DriveState::Unknown;
-
-    ComPtr<IEnumWbemClassObject> pEnumerator;
-    if (FAILED(pSvc->ExecQuery(bstr_t("WQL"), bstr_t("SELECT * FROM MSFT_Disk"),
-                               WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
-                               NULL, &pEnumerator))) return DriveState::Unknown;
-
-    DriveState state = DriveState::Unknown;
-    bool foundTarget = false;
-
-    while (pEnumerator) {
-        ComPtr<IWbemClassObject> pclsObj;
-        ULONG uReturn = 0;
-        if (pEnumerator->Next(WBEM_INFINITE, 1, &pclsObj, &uReturn) != S_OK || uReturn == 0) break;
-
-        VARIANT vtProp;
-        VariantInit(&vtProp);
-
-        if (SUCCEEDED(pclsObj->Get(L"SerialNumber", 0, &vtProp, 0, 0)) && vtProp.vt == VT_BSTR) {
-            _bstr_t serialNumber(vtProp.bstrVal, true);
-            char serialStr[256];
-            wcstombs_s(NULL, serialStr, 256, serialNumber, _TRUNCATE);
-            std::string serial = TrimWhitespace(std::string(serialStr));
-
-            if (SerialMatches(serial, g_app.config.targetSerial)) {
-                foundTarget = true;
-                VariantClear(&vtProp);
+// Runs after a disk/volume notification has settled. Posts the detected state
+// back to the UI thread, which applies it unless an operation is in flight.
+void AsyncDeviceChangeCheck(HWND hwnd) {
+    DriveState newState = DetectDriveState();
+    PostMessage(hwnd, WM_DRIVESTATE, static_cast<WPARAM>(newState), 0);
+}
 
-                if (SUCCEEDED(pclsObj->Get(L"IsOffline", 0, &vtProp, 0, 0)) && vtProp.vt == VT_BOOL) {
-                    state = (vtProp.boolVal == VARIANT_TRUE) ? DriveState::Offline : DriveState::Online;
-                }
-                VariantClear(&vtProp);
-                break;
-            }
-        }
-        VariantClear(&vtProp);
-    }
+DriveState DetectDriveState() {
+    std::vector<core::DiskRecord> disks;
+    if (!core::GetDiskQuerySession().EnumerateDisks(disks)) return DriveState::Unknown;
 
-    return foundTarget ? state : DriveState::Offline;
+    return core::DiskRecordState(core::FindDiskBySerial(disks, g_app.config.targetSerial));
 }
 
 void ShowBalloonTip(const char* title, const char* text, DWORD icon) {
@@ -501,7 +526,16 @@ void ShowBalloonTip(const char* title, const char* text, DWORD icon) {
     }
 }
 
+void OnOperationProgress(const char* message) {
+    std::lock_guard<std::mutex> lock(g_progressMutex);
+    g_progressText = message;
+}
+
 void StartProgressAnimation() {
+    {
+        std::lock_guard<std::mutex> lock(g_progressMutex);
+        g_progressText.clear();
+    }
     g_app.animationFrame = 0;
     g_app.animationTimer = SetTimer(g_app.hWnd, IDT_ANIMATION_TIMER, 500, NULL);
 }
@@ -526,28 +560,157 @@ void AsyncDriveOperation(HWND hwnd, bool isWake) {
     PostMessage(hwnd, WM_COMMAND, isWake ? IDM_WAKE_COMPLETE : IDM_SLEEP_COMPLETE, (LPARAM)result);
 }
 
-void OnWakeDrive() {
-    if (g_app.isTransitioning) return;
-
+void StartDriveOperation(bool isWake, const char* message) {
     g_app.isTransitioning = true;
     g_app.driveState = DriveState::Transitioning;
     UpdateTrayIcon();
-    ShowBalloonTip("", "Waking drive...", NIIF_INFO);
+    ShowBalloonTip("", message, NIIF_INFO);
     StartProgressAnimation();
 
-    std::thread(AsyncDriveOperation, g_app.hWnd, true).detach();
+    std::thread(AsyncDriveOperation, g_app.hWnd, isWake).detach();
+}
+
+void OnWakeDrive() {
+    if (g_app.isTransitioning) return;
+
+    RecordDriveUse();
+    StartDriveOperation(true, "Waking drive...");
 }
 
 void OnSleepDrive() {
     if (g_app.isTransitioning) return;
 
-    g_app.isTransitioning = true;
-    g_app.driveState = DriveState::Transitioning;
-    UpdateTrayIcon();
-    ShowBalloonTip("", "Sleeping drive...", NIIF_INFO);
-    StartProgressAnimation();
+    StartDriveOperation(false, "Sleeping drive...");
+}
+
+void InitIdleMonitor(HWND hwnd) {
+    unsigned int minutes = g_app.config.power.autoSleepIdleMinutes;
+    if (minutes == 0) return;
+
+    // A gap of several samples means the PC was suspended, not the drive idle
+    g_app.idleTracker = core::IdleTracker(minutes * 60000ULL, 3ULL * core::IDLE_SAMPLE_MS);
+    SetTimer(hwnd, IDT_IDLE_CHECK, core::IDLE_SAMPLE_MS, NULL);
+}
+
+// Samples the drive's I/O counters; sleeps it once they stay flat for the
+// idle window. Reading them is an IOCTL on the disk object, not disk I/O.
+void OnIdleCheck() {
+    if (g_app.driveState != DriveState::Online || g_app.isTransitioning) {
+        g_app.idleTracker.Reset();
+        g_app.idleDiskNumber = -1;
+        return;
+    }
+
+    core::DiskIoCounters counters;
+    if (g_app.idleDiskNumber < 0 || !core::ReadDiskIoCounters(g_app.idleDiskNumber, counters)) {
+        // Disk numbers change across power cycles: look it up again
+        core::DiskRecord disk;
+        if (!core::FindTargetDisk(g_app.config.targetSerial, g_app.config.targetModel, disk) ||
+            !core::ReadDiskIoCounters(disk.number, counters)) {
+            g_app.idleDiskNumber = -1;
+            return;
+        }
+        g_app.idleDiskNumber = disk.number;
+    }
+
+    // A pre-woken drive is left to the predictor's own expiry
+    if (g_app.idleTracker.Sample(GetTickCount64(), counters) && !g_app.predictor.IsPreWakePending()) {
+        g_app.idleDiskNumber = -1;
+        StartDriveOperation(false, "Drive idle, sleeping...");
+    }
+}
+
+// Local wall-clock minutes, so learned times of day survive DST changes
+int64_t LocalMinutesNow() {
+    time_t now = time(nullptr);
+    tm local = {};
+    localtime_s(&local, &now);
+    return static_cast<int64_t>(_mkgmtime(&local)) / 60;
+}
+
+void InitPredictor(HWND hwnd) {
+    if (!g_app.config.predictor.enabled) return;
+
+    g_app.predictor = core::WakePredictor(g_app.config.predictor);
+    core::LoadWakePredictor(g_app.predictor);
+    SchedulePreWake(hwnd);
+}
+
+// The user wanted the drive now: teach the predictor and plan around it
+void RecordDriveUse() {
+    if (!g_app.config.predictor.enabled) return;
+
+    g_app.predictor.RecordUse(LocalMinutesNow());
+    core::SaveWakePredictor(g_app.predictor);
+    SchedulePreWake(g_app.hWnd);
+}
+
+// Arm IDT_PREWAKE for the next confident slot, or for a later recheck
+void SchedulePreWake(HWND hwnd) {
+    if (!g_app.config.predictor.enabled) return;
+
+    int64_t now = LocalMinutesNow();
+    int64_t from = now;
+    if (g_app.handledSlot >= 0) {
+        from = (std::max)(now, g_app.handledSlot + static_cast<int64_t>(g_app.config.predictor.slotMinutes));
+    }
+    g_app.preWakePlan = g_app.predictor.NextPreWake(from);
+
+    UINT delay = PREWAKE_RECHECK_MS;
+    if (g_app.preWakePlan.IsValid()) {
+        int64_t minutes = g_app.preWakePlan.wakeAt - now;
+        if (minutes * 60000 < PREWAKE_RECHECK_MS) delay = static_cast<UINT>((std::max)(minutes, int64_t(0)) * 60000);
+    }
+    SetTimer(hwnd, IDT_PREWAKE, (std::max)(delay, UINT(1000)), NULL);
+}
+
+void OnPreWakeTimer(HWND hwnd) {
+    const core::PreWakePlan plan = g_app.preWakePlan;
+    if (plan.IsValid() && LocalMinutesNow() >= plan.wakeAt) {
+        g_app.handledSlot = plan.slot;
+
+        // Nothing to do if the drive is already up or busy
+        if (g_app.driveState != DriveState::Online && !g_app.isTransitioning &&
+            !g_app.predictor.IsPreWakePending()) {
+            g_app.predictor.OnPreWake(plan.slot);
+            g_app.preWaking = true;
+            StartDriveOperation(true, "Waking drive ahead of expected use...");
+        }
+    }
+    SchedulePreWake(hwnd);
+}
+
+// Runs every minute after a pre-wake until the drive is used or the
+// prediction expires; an unused drive is put back to sleep
+void OnPreWakeCheck(HWND hwnd) {
+    if (!g_app.predictor.IsPreWakePending()) {
+        KillTimer(hwnd, IDT_PREWAKE_CHECK);
+        return;
+    }
+
+    core::DiskRecord disk;
+    core::DiskIoCounters counters;
+    if (core::FindTargetDisk(g_app.config.targetSerial, g_app.config.targetModel, disk) &&
+        core::ReadDiskIoCounters(disk.number, counters)) {
+        // The first reading, after mounting has settled, is the baseline
+        if (!g_app.ioBaselineValid) {
+            g_app.ioBaseline = counters;
+            g_app.ioBaselineValid = true;
+        } else if (counters.Operations() >= g_app.ioBaseline.Operations() + PREWAKE_USE_MIN_IO) {
+            KillTimer(hwnd, IDT_PREWAKE_CHECK);
+            RecordDriveUse();
+            return;
+        }
+    }
 
-    std::thread(AsyncDriveOperation, g_app.hWnd, false).detach();
+    if (g_app.predictor.Expire(LocalMinutesNow())) {
+        KillTimer(hwnd, IDT_PREWAKE_CHECK);
+        core::SaveWakePredictor(g_app.predictor);
+        if (g_app.driveState == DriveState::Online && !g_app.isTransitioning) {
+            StartDriveOperation(false, "Drive not used as expected, sleeping it again...");
+        }
+        SchedulePreWake(hwnd);
+    }
 }
 
 void OnRefreshStatus() {
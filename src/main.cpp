@@ -9,6 +9,7 @@
 //   hdd-toggle relay <on|off>      # Control all relays
 //   hdd-toggle relay <1|2> <on|off># Control single relay
 //   hdd-toggle status [--json]     # Drive status
+//   hdd-toggle bench <target>      # Latency benchmarks
 //   hdd-toggle --help              # Help
 //   hdd-toggle --version           # Version
 
@@ -67,6 +68,7 @@ hdd::Command ParseCommand(int argc, char* argv[]) {
     if (_stricmp(cmd, "sleep") == 0) return hdd::Command::Sleep;
     if (_stricmp(cmd, "relay") == 0) return hdd::Command::Relay;
     if (_stricmp(cmd, "status") == 0) return hdd::Command::Status;
+    if (_stricmp(cmd, "bench") == 0) return hdd::Command::Bench;
     if (_stricmp(cmd, "help") == 0) return hdd::Command::Help;
     if (_stricmp(cmd, "version") == 0) return hdd::Command::Version;
 
@@ -88,11 +90,13 @@ int ShowHelp() {
     printf("  sleep          Safely eject and power off the drive\n");
     printf("  relay          Control USB relay directly\n");
     printf("  status         Show current drive status\n");
+    printf("  bench          Measure detection and control latency\n");
     printf("  help           Show this help message\n");
     printf("  version        Show version information\n\n");
     printf("Examples:\n");
     printf("  hdd-toggle                    Launch tray app\n");
     printf("  hdd-toggle wake               Wake the drive\n");
+    printf("  hdd-toggle wake --all         Wake every configured drive\n");
     printf("  hdd-toggle sleep --offline    Sleep with offline flag\n");
     printf("  hdd-toggle relay on           Turn on all relays\n");
     printf("  hdd-toggle relay 1 off        Turn off relay 1\n");
@@ -148,6 +152,10 @@ int main(int argc, char* argv[]) {
             result = hdd::commands::RunStatus(subArgc, subArgv);
             break;
 
+        case hdd::Command::Bench:
+            result = hdd::commands::RunBench(subArgc, subArgv);
+            break;
+
         case hdd::Command::Version:
             result = hdd::commands::ShowVersion();
             break;
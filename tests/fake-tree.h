@@ -0,0 +1,82 @@
+#pragma once
+// Temporary directory tree for the Linux tests that read sysfs, procfs or
+// udev lookalikes. Paths are relative to root and start with '/'; missing
+// parent directories are created. Everything is removed with the tree.
+
+#ifndef HDD_TESTS_FAKE_TREE_H
+#define HDD_TESTS_FAKE_TREE_H
+
+#ifdef __linux__
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace hdd {
+namespace test {
+
+class FakeTree {
+public:
+    // prefix names the tree: /tmp/hdd-<prefix>-XXXXXX
+    explicit FakeTree(const std::string& prefix) {
+        std::string dirTemplate = "/tmp/hdd-" + prefix + "-XXXXXX";
+        std::vector<char> buffer(dirTemplate.begin(), dirTemplate.end());
+        buffer.push_back('\0');
+        root = mkdtemp(buffer.data());
+    }
+
+    ~FakeTree() {
+        for (auto it = m_paths.rbegin(); it != m_paths.rend(); ++it) remove(it->c_str());
+        remove(root.c_str());
+    }
+
+    FakeTree(const FakeTree&) = delete;
+    FakeTree& operator=(const FakeTree&) = delete;
+
+    void MakeDir(const std::string& path) {
+        for (size_t slash = path.find('/', 1);; slash = path.find('/', slash + 1)) {
+            std::string dir = root + path.substr(0, slash);
+            if (mkdir(dir.c_str(), 0755) == 0) m_paths.push_back(dir);
+            if (slash == std::string::npos) break;
+        }
+    }
+
+    // Written in binary mode and truncated, so the file holds exactly contents
+    void WriteFile(const std::string& path, const std::string& contents) {
+        size_t slash = path.rfind('/');
+        if (slash > 0) MakeDir(path.substr(0, slash));
+        std::ofstream(root + path, std::ios::binary | std::ios::trunc) << contents;
+        m_paths.push_back(root + path);
+    }
+
+    std::string ReadFile(const std::string& path) const {
+        std::ifstream file(root + path);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+
+    bool Symlink(const std::string& path, const std::string& target) {
+        if (symlink(target.c_str(), (root + path).c_str()) != 0) return false;
+        m_paths.push_back(root + path);
+        return true;
+    }
+
+    // Removes a file early; the destructor skips what is already gone
+    void RemoveFile(const std::string& path) { remove((root + path).c_str()); }
+
+    std::string root;
+
+private:
+    std::vector<std::string> m_paths;
+};
+
+} // namespace test
+} // namespace hdd
+
+#endif // __linux__
+
+#endif // HDD_TESTS_FAKE_TREE_H
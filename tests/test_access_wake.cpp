@@ -0,0 +1,137 @@
+// Tests for fanotify wake-on-access: a temporary directory stands in for
+// the mount root and a tmpfs mount for the woken drive. Needs root (for
+// fanotify and the private mount namespace); skipped with a warning
+// otherwise.
+
+#include "catch.hpp"
+#include "core/access-wake.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mount.h>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+using namespace hdd::core;
+
+namespace {
+
+// Private mount namespace, so test mounts never reach the host
+bool EnterPrivateMounts() {
+    return unshare(CLONE_NEWNS) == 0 && mount("none", "/", nullptr, MS_REC | MS_PRIVATE, nullptr) == 0;
+}
+
+int OpenDirectory(const std::string& path) {
+    return open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+} // anonymous namespace
+
+TEST_CASE("Wake on access of an unmounted root", "[access]") {
+    if (!EnterPrivateMounts()) {
+        WARN("No private mount namespace (not root?), skipping");
+        return;
+    }
+
+    char pattern[] = "/tmp/hdd-access-XXXXXX";
+    REQUIRE(mkdtemp(pattern) != nullptr);
+    std::string root = pattern;
+    REQUIRE_FALSE(IsMountRoot(root));
+
+    // The "drive": spins up, then its filesystem appears at the root
+    std::atomic<int> wakes(0);
+    auto wake = [&] {
+        wakes++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        if (mount("tmpfs", root.c_str(), "tmpfs", 0, "size=1m") != 0) return false;
+        std::ofstream(root + "/on-drive") << "data";
+        return true;
+    };
+
+    FanotifyAccessWaker waker;
+    if (!waker.Start(root, wake)) {
+        WARN("fanotify unavailable, skipping");
+        rmdir(root.c_str());
+        return;
+    }
+
+    SECTION("Concurrent first accesses share one wake") {
+        const int openers = 4;
+        std::vector<std::thread> threads;
+        std::atomic<int> opened(0);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < openers; i++) {
+            threads.emplace_back([&] {
+                int fd = OpenDirectory(root);
+                if (fd >= 0) {
+                    opened++;
+                    close(fd);
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        double elapsedMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        CHECK(opened == openers);
+        CHECK(wakes == 1);
+        CHECK(elapsedMs >= 150);                       // Held for the spin-up
+        CHECK(IsMountRoot(root));
+
+        // The next lookup lands on the drive without another wake
+        CHECK(std::ifstream(root + "/on-drive").good());
+        int fd = OpenDirectory(root);
+        CHECK(fd >= 0);
+        if (fd >= 0) close(fd);
+        CHECK(wakes == 1);
+
+        AccessWakeStats stats = waker.Stats();
+        CHECK(stats.wakes == 1);
+        CHECK(stats.held == 1);
+        CHECK(stats.failedWakes == 0);
+        CHECK(stats.maxHoldMs >= 150);
+    }
+
+    SECTION("Unmounted again: the next access wakes again") {
+        int fd = OpenDirectory(root);
+        REQUIRE(fd >= 0);
+        close(fd);
+        REQUIRE(umount(root.c_str()) == 0);
+
+        fd = OpenDirectory(root);
+        REQUIRE(fd >= 0);
+        close(fd);
+        CHECK(wakes == 2);
+    }
+
+    waker.Stop();
+    umount(root.c_str());
+    rmdir(root.c_str());
+}
+
+TEST_CASE("Failed wake still releases the access", "[access]") {
+    if (!EnterPrivateMounts()) {
+        WARN("No private mount namespace (not root?), skipping");
+        return;
+    }
+
+    char pattern[] = "/tmp/hdd-access-XXXXXX";
+    REQUIRE(mkdtemp(pattern) != nullptr);
+    std::string root = pattern;
+
+    FanotifyAccessWaker waker;
+    if (!waker.Start(root, [] { return false; })) {
+        WARN("fanotify unavailable, skipping");
+        rmdir(root.c_str());
+        return;
+    }
+
+    int fd = OpenDirectory(root);
+    CHECK(fd >= 0);
+    if (fd >= 0) close(fd);
+    waker.Stop();
+    CHECK(waker.Stats().failedWakes == 1);
+    rmdir(root.c_str());
+}
+#endif
@@ -0,0 +1,346 @@
+// Tests for the blocker scan: grouping and reporting everywhere, and on
+// Linux a /proc scan against throwaway child processes holding a file, a
+// working directory and a mapping on a tmpfs. The scan runs in a forked
+// helper so the runner's mount namespace is left alone. Needs a
+// filesystem on its own device (a private tmpfs as root, else /dev/shm);
+// skipped with a warning otherwise.
+
+#include "catch.hpp"
+#include "core/blocker-scan.h"
+
+#include <chrono>
+
+using namespace hdd::core;
+
+namespace {
+
+BlockerHit Hit(uint32_t pid, BlockerKind kind, const std::string& path, const std::string& process = "app") {
+    BlockerHit hit;
+    hit.pid = pid;
+    hit.process = process;
+    hit.kind = kind;
+    hit.path = path;
+    return hit;
+}
+
+} // anonymous namespace
+
+TEST_CASE("GroupBlockers", "[blockers]") {
+    std::vector<BlockerHit> hits = {
+        Hit(20, BlockerKind::File, "E:\\b.txt", "editor.exe"),
+        Hit(7, BlockerKind::File, "E:\\x.db", "db.exe"),
+        Hit(20, BlockerKind::Cwd, "E:\\Photos", "editor.exe"),
+        Hit(20, BlockerKind::File, "E:\\a.txt", "editor.exe"),
+        Hit(20, BlockerKind::File, "E:\\a.txt", "editor.exe"),
+    };
+
+    std::vector<BlockerProcess> processes = GroupBlockers(hits);
+    REQUIRE(processes.size() == 2);
+    CHECK(processes[0].pid == 7);
+    CHECK(processes[0].process == "db.exe");
+
+    // Working directory first, then files by path, duplicates dropped
+    const BlockerProcess& editor = processes[1];
+    REQUIRE(editor.uses.size() == 3);
+    CHECK(editor.uses[0].kind == BlockerKind::Cwd);
+    CHECK(editor.uses[1].path == "E:\\a.txt");
+    CHECK(editor.uses[2].path == "E:\\b.txt");
+
+    CHECK(GroupBlockers(std::vector<BlockerHit>()).empty());
+}
+
+TEST_CASE("FormatBlocker", "[blockers]") {
+    BlockerProcess process;
+    process.pid = 1234;
+    process.process = "explorer.exe";
+    process.uses = {{BlockerKind::Cwd, "E:\\Photos"}, {BlockerKind::File, "E:\\a.txt"}};
+    CHECK(FormatBlocker(process) == "explorer.exe (1234): cwd E:\\Photos, file E:\\a.txt");
+
+    for (int i = 0; i < 3; i++) process.uses.push_back({BlockerKind::Map, "E:\\lib" + std::to_string(i) + ".dll"});
+    CHECK(FormatBlocker(process) == "explorer.exe (1234): cwd E:\\Photos, file E:\\a.txt, map E:\\lib0.dll (+2 more)");
+
+    process.process.clear();
+    process.uses.resize(1);
+    CHECK(FormatBlocker(process) == "? (1234): cwd E:\\Photos");
+}
+
+TEST_CASE("PathOnVolumes", "[blockers]") {
+    std::vector<std::string> volumes = {"\\\\?\\Volume{AB12}\\", "/mnt/hdd/"};
+    CHECK(PathOnVolumes("\\\\?\\Volume{ab12}\\Photos\\a.jpg", volumes));
+    CHECK(PathOnVolumes("/mnt/hdd/a", volumes));
+    CHECK_FALSE(PathOnVolumes("\\\\?\\Volume{CD34}\\a", volumes));
+    CHECK_FALSE(PathOnVolumes("/mnt/hd", volumes));
+    CHECK_FALSE(PathOnVolumes("/mnt/hdd/a", std::vector<std::string>()));
+}
+
+TEST_CASE("ParseMapsDevice", "[blockers]") {
+    unsigned major = 0, minor = 0;
+    CHECK(ParseMapsDevice("7f12a000-7f12b000 r--s 00000000 08:11 1234    /mnt/hdd/data.bin\n", major, minor));
+    CHECK(major == 8);
+    CHECK(minor == 0x11);
+
+    CHECK(ParseMapsDevice("7f12a000-7f12b000 rw-s 00000000 103:02 99 /x", major, minor));
+    CHECK(major == 0x103);
+    CHECK(minor == 2);
+
+    // Anonymous mappings and junk
+    CHECK_FALSE(ParseMapsDevice("7f12a000-7f12b000 rw-p 00000000 00:00 0 \n", major, minor));
+    CHECK_FALSE(ParseMapsDevice("7f12a000-7f12b000 rw-p 00000000 [heap]", major, minor));
+    CHECK_FALSE(ParseMapsDevice("", major, minor));
+}
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/mount.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <cstdlib>
+
+namespace {
+
+// Catch installs handlers for these; forked helpers must die quietly instead
+// of reporting a failed test from a copy of the runner
+void RestoreDefaultSignals() {
+    for (int signal : {SIGTERM, SIGINT, SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL}) {
+        ::signal(signal, SIG_DFL);
+    }
+}
+
+// Kills and reaps the children it still owns when it goes out of scope,
+// so an early return or a failed REQUIRE leaves nothing paused behind
+class ChildReaper {
+public:
+    ~ChildReaper() {
+        for (pid_t pid : m_pids) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+    }
+
+    pid_t Add(pid_t pid) {
+        if (pid > 0) m_pids.push_back(pid);
+        return pid;
+    }
+
+    // Reap pid now; false if it was not ours or did not exit
+    bool Wait(pid_t pid, int& status) {
+        auto it = std::find(m_pids.begin(), m_pids.end(), pid);
+        if (it == m_pids.end() || waitpid(pid, &status, 0) != pid) return false;
+        m_pids.erase(it);
+        return true;
+    }
+
+private:
+    std::vector<pid_t> m_pids;
+};
+
+// A directory on a filesystem of its own: a tmpfs in a private mount
+// namespace as root, else /dev/shm when it is a separate mount. Only
+// called in a forked helper, so the namespace never reaches the runner.
+bool MakeScratchDirectory(std::string& directory, dev_t& device, bool& mounted) {
+    struct stat rootInfo, info;
+    if (stat("/", &rootInfo) != 0) return false;
+
+    char pattern[] = "/tmp/hdd-blockers-XXXXXX";
+    mounted = false;
+    if (unshare(CLONE_NEWNS) == 0 && mount("none", "/", nullptr, MS_REC | MS_PRIVATE, nullptr) == 0 &&
+        mkdtemp(pattern)) {
+        mounted = mount("tmpfs", pattern, "tmpfs", 0, "size=1m") == 0;
+        if (!mounted) rmdir(pattern);
+    }
+    if (mounted) {
+        directory = pattern;
+    } else {
+        char shm[] = "/dev/shm/hdd-blockers-XXXXXX";
+        if (!mkdtemp(shm)) return false;
+        directory = shm;
+    }
+    if (stat(directory.c_str(), &info) != 0 || info.st_dev == rootInfo.st_dev) {
+        if (mounted) umount(directory.c_str());
+        rmdir(directory.c_str());
+        return false;
+    }
+    device = info.st_dev;
+    return true;
+}
+
+// Fork a child that runs setup, reports ready and waits to be signalled.
+// It dies with its parent, so a crashed helper leaves no holders behind.
+template <typename Setup>
+pid_t SpawnHolder(ChildReaper& reaper, Setup setup) {
+    int ready[2];
+    if (pipe(ready) != 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        RestoreDefaultSignals();
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        close(ready[0]);
+        char ok = setup() ? 1 : 0;
+        (void)!write(ready[1], &ok, 1);
+        close(ready[1]);
+        if (!ok) _exit(1);
+        while (true) pause();
+    }
+    reaper.Add(pid);
+    close(ready[1]);
+    char ok = 0;
+    bool started = pid > 0 && read(ready[0], &ok, 1) == 1 && ok == 1;
+    close(ready[0]);
+    return started ? pid : -1;
+}
+
+const BlockerProcess* FindPid(const std::vector<BlockerProcess>& blockers, pid_t pid) {
+    for (const auto& blocker : blockers) {
+        if (static_cast<pid_t>(blocker.pid) == pid) return &blocker;
+    }
+    return nullptr;
+}
+
+bool Uses(const BlockerProcess* blocker, BlockerKind kind, const std::string& path) {
+    if (!blocker) return false;
+    for (const auto& use : blocker->uses) {
+        if (use.kind == kind && use.path == path) return true;
+    }
+    return false;
+}
+
+// What the helper saw; plain data so it can be sent back over a pipe
+struct ScanReport {
+    bool ready = false;         // Scratch filesystem available
+    bool holdersStarted = false;
+    bool openerFile = false;
+    bool openerNamed = false;
+    bool residentCwd = false;
+    bool mapperMap = false;
+    bool bystanderFound = false;
+    bool selfFound = false;
+    long long scanMs = 0;
+    size_t signalled = 0;
+    int terminated = 0;         // Holders that exited on SIGTERM
+    bool holdersGone = false;   // None left in a second scan
+};
+
+// The scenario itself, run in a forked helper: throwaway holders of a file,
+// a working directory and a mapping on the scratch filesystem, plus a
+// bystander that holds nothing there
+ScanReport RunScanScenario() {
+    ScanReport report;
+    std::string directory;
+    dev_t device = 0;
+    bool mounted = false;
+    if (!MakeScratchDirectory(directory, device, mounted)) return report;
+    report.ready = true;
+
+    std::string file = directory + "/held.bin";
+    int fd = open(file.c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0600);
+    bool written = fd >= 0 && write(fd, "data", 4) == 4;
+    if (fd >= 0) close(fd);
+
+    if (written) {
+        ChildReaper reaper;
+        pid_t opener = SpawnHolder(reaper, [&] { return open(file.c_str(), O_RDONLY) >= 0; });
+        pid_t resident = SpawnHolder(reaper, [&] { return chdir(directory.c_str()) == 0; });
+        pid_t mapper = SpawnHolder(reaper, [&] {
+            int mapped = open(file.c_str(), O_RDONLY);
+            if (mapped < 0) return false;
+            void* map = mmap(nullptr, 4, PROT_READ, MAP_SHARED, mapped, 0);
+            close(mapped);
+            return map != MAP_FAILED;
+        });
+        pid_t bystander = SpawnHolder(reaper, [] { return chdir("/") == 0; });
+        report.holdersStarted = opener > 0 && resident > 0 && mapper > 0 && bystander > 0;
+
+        if (report.holdersStarted) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<BlockerProcess> blockers = ProcBlockerScanner({device}).Scan();
+            report.scanMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+            const BlockerProcess* found = FindPid(blockers, opener);
+            report.openerFile = Uses(found, BlockerKind::File, file);
+            report.openerNamed = found && !found->process.empty();
+            report.residentCwd = Uses(FindPid(blockers, resident), BlockerKind::Cwd, directory);
+            report.mapperMap = Uses(FindPid(blockers, mapper), BlockerKind::Map, file);
+            report.bystanderFound = FindPid(blockers, bystander) != nullptr;
+            report.selfFound = FindPid(blockers, getpid()) != nullptr;
+
+            // Only the blockers are asked to go
+            std::vector<BlockerProcess> ours;
+            for (pid_t child : {opener, resident, mapper}) {
+                if (const BlockerProcess* blocker = FindPid(blockers, child)) ours.push_back(*blocker);
+            }
+            report.signalled = SignalBlockers(ours);
+            for (pid_t child : {opener, resident, mapper}) {
+                int status = 0;
+                if (reaper.Wait(child, status) && WIFSIGNALED(status) && WTERMSIG(status) == SIGTERM) {
+                    report.terminated++;
+                }
+            }
+
+            std::vector<BlockerProcess> after = ProcBlockerScanner({device}).Scan();
+            report.holdersGone = !FindPid(after, opener) && !FindPid(after, resident) && !FindPid(after, mapper);
+        }
+    }
+
+    unlink(file.c_str());
+    if (mounted) umount(directory.c_str());
+    rmdir(directory.c_str());
+    return report;
+}
+
+std::string MountNamespace() {
+    char target[64] = {};
+    return readlink("/proc/self/ns/mnt", target, sizeof(target) - 1) > 0 ? target : "";
+}
+
+} // anonymous namespace
+
+TEST_CASE("ProcBlockerScanner finds holders and ignores others", "[blockers]") {
+    std::string ns = MountNamespace();
+    int channel[2];
+    REQUIRE(pipe(channel) == 0);
+
+    ChildReaper reaper;
+    pid_t helper = reaper.Add(fork());
+    if (helper == 0) {
+        RestoreDefaultSignals();
+        close(channel[0]);
+        ScanReport report = RunScanScenario();
+        (void)!write(channel[1], &report, sizeof(report));
+        _exit(0);
+    }
+    close(channel[1]);
+    REQUIRE(helper > 0);
+
+    ScanReport report;
+    ssize_t received = read(channel[0], &report, sizeof(report));
+    close(channel[0]);
+    int status = 0;
+    REQUIRE(reaper.Wait(helper, status));
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(received == static_cast<ssize_t>(sizeof(report)));
+    CHECK(MountNamespace() == ns);
+
+    if (!report.ready) {
+        WARN("No filesystem on its own device available, skipping");
+        return;
+    }
+    INFO("Scan took " << report.scanMs << " ms");
+    REQUIRE(report.holdersStarted);
+
+    CHECK(report.openerFile);
+    CHECK(report.openerNamed);
+    CHECK(report.residentCwd);
+    CHECK(report.mapperMap);
+    CHECK_FALSE(report.bystanderFound);
+    CHECK_FALSE(report.selfFound);
+    CHECK(report.scanMs < 1000);
+
+    CHECK(report.signalled == 3);
+    CHECK(report.terminated == 3);
+    CHECK(report.holdersGone);
+}
+
+#endif // __linux__
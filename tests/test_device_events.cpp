@@ -0,0 +1,260 @@
+// Tests for device change classification, the settle timer and, on Linux,
+// the netlink uevent watcher fed with synthetic uevents over a socketpair
+
+#include "catch.hpp"
+#include "core/device-events.h"
+#include <chrono>
+#include <string>
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+// Kernel uevent datagram: "action@devpath" then NUL-separated KEY=VALUE
+std::string MakeUevent(const std::string& action, const std::string& devpath, const std::string& subsystem,
+                       const std::string& devtype) {
+    std::string message = action + "@" + devpath;
+    message += '\0';
+    for (const std::string& field : {"ACTION=" + action, "DEVPATH=" + devpath, "SUBSYSTEM=" + subsystem,
+                                     "DEVTYPE=" + devtype, std::string("SEQNUM=4711")}) {
+        message += field;
+        message += '\0';
+    }
+    return message;
+}
+
+const char* const kSdbPath = "/devices/pci0000:00/0000:00:14.0/usb2/2-1/2-1:1.0/host4/target4:0:0/4:0:0:0/block/sdb";
+
+} // anonymous namespace
+
+TEST_CASE("ClassifyDeviceEvent", "[devices]") {
+    SECTION("Disks and volumes coming or going need a detection pass") {
+        for (DeviceAction action : {DeviceAction::Arrival, DeviceAction::Removal}) {
+            for (DeviceClass deviceClass : {DeviceClass::Disk, DeviceClass::Volume, DeviceClass::VolumeMount}) {
+                DeviceChanges changes = ClassifyDeviceEvent(action, deviceClass);
+                CHECK(changes.disk);
+                CHECK_FALSE(changes.hidRemoved);
+            }
+        }
+    }
+
+    SECTION("Only a HID removal drops the relay handle") {
+        CHECK(ClassifyDeviceEvent(DeviceAction::Removal, DeviceClass::Hid).hidRemoved);
+        CHECK_FALSE(ClassifyDeviceEvent(DeviceAction::Arrival, DeviceClass::Hid).Any());
+    }
+
+    SECTION("Other events and device classes are ignored") {
+        CHECK_FALSE(ClassifyDeviceEvent(DeviceAction::Other, DeviceClass::Disk).Any());
+        CHECK_FALSE(ClassifyDeviceEvent(DeviceAction::Other, DeviceClass::Hid).Any());
+        CHECK_FALSE(ClassifyDeviceEvent(DeviceAction::Arrival, DeviceClass::Other).Any());
+        CHECK_FALSE(ClassifyDeviceEvent(DeviceAction::Removal, DeviceClass::Other).Any());
+    }
+}
+
+TEST_CASE("DeviceSettleTimer", "[devices]") {
+    DeviceSettleTimer timer(500, 3000);
+
+    SECTION("Idle until triggered") {
+        CHECK_FALSE(timer.IsPending());
+        CHECK(timer.RemainingMs(1000) == WAIT_NO_TIMEOUT);
+        CHECK_FALSE(timer.Fire(1000000));
+    }
+
+    SECTION("A burst fires once, settleMs after its last event") {
+        timer.Trigger(1000);   // Disk interface
+        timer.Trigger(1120);   // First volume
+        timer.Trigger(1300);   // Second volume
+        CHECK(timer.RemainingMs(1300) == 500);
+        CHECK_FALSE(timer.Fire(1799));
+        CHECK(timer.RemainingMs(1799) == 1);
+        CHECK(timer.Fire(1800));
+        CHECK_FALSE(timer.Fire(1801));
+        CHECK_FALSE(timer.IsPending());
+    }
+
+    SECTION("A burst that never settles fires after maxDelayMs") {
+        uint64_t now = 10000;
+        for (; now < 10000 + 3000; now += 400) {
+            timer.Trigger(now);
+            CHECK_FALSE(timer.Fire(now));
+        }
+        CHECK(timer.Fire(13000));
+
+        // The next event starts a new burst
+        timer.Trigger(13100);
+        CHECK(timer.RemainingMs(13100) == 500);
+    }
+
+    SECTION("Cancel drops a pending burst") {
+        timer.Trigger(1000);
+        timer.Cancel();
+        CHECK_FALSE(timer.Fire(5000));
+    }
+}
+
+TEST_CASE("ParseUevent", "[devices]") {
+    Uevent event;
+
+    SECTION("Kernel message") {
+        std::string message = MakeUevent("add", kSdbPath, "block", "disk");
+        message += "DEVNAME=sdb";
+        message += '\0';
+        REQUIRE(ParseUevent(message.data(), message.size(), event));
+        CHECK(event.action == "add");
+        CHECK(event.devpath == kSdbPath);
+        CHECK(event.subsystem == "block");
+        CHECK(event.devtype == "disk");
+        CHECK(event.devname == "sdb");
+    }
+
+    SECTION("Last field without a terminating NUL") {
+        std::string message = MakeUevent("remove", kSdbPath, "block", "disk");
+        message.pop_back();
+        REQUIRE(ParseUevent(message.data(), message.size(), event));
+        CHECK(event.action == "remove");
+        CHECK(event.subsystem == "block");
+    }
+
+    SECTION("Rejected") {
+        // udev's re-broadcast has a binary header after "libudev"
+        std::string libudev("libudev\0\xfe\xed\xca\xfe", 12);
+        CHECK_FALSE(ParseUevent(libudev.data(), libudev.size(), event));
+
+        std::string noHeader("ACTION=add\0SUBSYSTEM=block\0", 27);
+        CHECK_FALSE(ParseUevent(noHeader.data(), noHeader.size(), event));
+
+        std::string headerOnly("add@/devices/x", 14);
+        CHECK_FALSE(ParseUevent(headerOnly.data(), headerOnly.size(), event));
+
+        std::string noSubsystem("add@/devices/x\0ACTION=add\0", 26);
+        CHECK_FALSE(ParseUevent(noSubsystem.data(), noSubsystem.size(), event));
+
+        CHECK_FALSE(ParseUevent("", 0, event));
+    }
+}
+
+TEST_CASE("ClassifyUevent", "[devices]") {
+    Uevent event;
+    event.action = "add";
+    event.subsystem = "block";
+
+    SECTION("Whole disks and partitions") {
+        event.devtype = "disk";
+        CHECK(ClassifyUevent(event).disk);
+        event.action = "remove";
+        event.devtype = "partition";
+        CHECK(ClassifyUevent(event).disk);
+    }
+
+    SECTION("A changed disk (media, partition table) is not an arrival") {
+        event.action = "change";
+        event.devtype = "disk";
+        CHECK_FALSE(ClassifyUevent(event).Any());
+    }
+
+    SECTION("hidraw removal") {
+        event.subsystem = "hidraw";
+        event.devtype.clear();
+        CHECK_FALSE(ClassifyUevent(event).Any());
+        event.action = "remove";
+        CHECK(ClassifyUevent(event).hidRemoved);
+    }
+
+    SECTION("Other subsystems") {
+        event.subsystem = "net";
+        CHECK_FALSE(ClassifyUevent(event).Any());
+        event.subsystem = "usb";
+        event.devtype = "usb_device";
+        CHECK_FALSE(ClassifyUevent(event).Any());
+    }
+}
+
+#ifdef __linux__
+
+namespace {
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SendUevent(int fd, const std::string& message) {
+    REQUIRE(send(fd, message.data(), message.size(), 0) == static_cast<ssize_t>(message.size()));
+}
+
+} // anonymous namespace
+
+TEST_CASE("UeventWatcher on a synthetic uevent socket", "[devices]") {
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == 0);
+    int kernel = fds[1];
+
+    UeventWatcher watcher(100, 1000);
+    watcher.Adopt(fds[0]);
+    REQUIRE(watcher.IsActive());
+
+    SECTION("Quiet socket: nothing to do") {
+        auto start = std::chrono::steady_clock::now();
+        CHECK_FALSE(watcher.Wait(50).Any());
+        CHECK(MsSince(start) >= 45);
+    }
+
+    SECTION("A power-on burst becomes one settled disk change") {
+        std::string disk = std::string(kSdbPath);
+        SendUevent(kernel, MakeUevent("add", disk, "block", "disk"));
+        SendUevent(kernel, MakeUevent("add", "/devices/virtual/net/veth0", "net", ""));
+        SendUevent(kernel, MakeUevent("add", disk + "/sdb1", "block", "partition"));
+        SendUevent(kernel, MakeUevent("add", disk + "/sdb2", "block", "partition"));
+
+        auto start = std::chrono::steady_clock::now();
+        DeviceChanges changes = watcher.Wait(5000);
+        double elapsed = MsSince(start);
+        CHECK(changes.disk);
+        CHECK_FALSE(changes.hidRemoved);
+        CHECK(elapsed >= 90);
+        CHECK(elapsed < 1000);
+
+        // Coalesced: nothing left over
+        CHECK_FALSE(watcher.Wait(150).Any());
+    }
+
+    SECTION("A HID removal is reported without waiting for the burst to settle") {
+        SendUevent(kernel, MakeUevent("remove", kSdbPath, "block", "disk"));
+        SendUevent(kernel, MakeUevent("remove", "/devices/pci0000:00/usb1/1-2/1-2:1.0/0003:16C0:05DF.0001/hidraw/hidraw0",
+                                      "hidraw", ""));
+
+        DeviceChanges changes = watcher.Wait(5000);
+        CHECK(changes.hidRemoved);
+        CHECK_FALSE(changes.disk);
+
+        // The disk removal is still settling
+        CHECK(watcher.Wait(5000).disk);
+    }
+
+    SECTION("A burst still settling at the deadline is reported by the next Wait") {
+        SendUevent(kernel, MakeUevent("add", kSdbPath, "block", "disk"));
+        CHECK_FALSE(watcher.Wait(20).Any());
+        CHECK(watcher.Wait(5000).disk);
+    }
+
+    SECTION("Malformed datagrams are skipped") {
+        SendUevent(kernel, std::string("libudev\0\xfe\xed\xca\xfe", 12));
+        SendUevent(kernel, "garbage");
+        CHECK_FALSE(watcher.Wait(150).Any());
+    }
+
+    close(kernel);
+}
+
+TEST_CASE("UeventWatcher subscribes to the kernel", "[devices]") {
+    // Needs a kernel with netlink; sandboxes without it fall back to polling
+    UeventWatcher watcher;
+    if (watcher.Start()) {
+        CHECK(watcher.IsActive());
+        CHECK(watcher.Fd() >= 0);
+        watcher.Stop();
+    }
+    CHECK_FALSE(watcher.IsActive());
+}
+
+#endif // __linux__
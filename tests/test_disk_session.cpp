@@ -0,0 +1,230 @@
+// Tests for the persistent disk query session (fake backend)
+
+#include "catch.hpp"
+#include "core/disk-session.h"
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+// Scriptable backend that records lifecycle calls
+class FakeDiskBackend : public DiskQueryBackend {
+public:
+    int connects = 0;
+    int disconnects = 0;
+    int queries = 0;
+    bool connectSucceeds = true;
+    std::vector<QueryStatus> script;   // Status per query; Ok once exhausted
+    std::vector<DiskRecord> disks;
+
+    bool Connect() override {
+        connects++;
+        return connectSucceeds;
+    }
+
+    void Disconnect() override {
+        disconnects++;
+    }
+
+    QueryStatus EnumerateDisks(std::vector<DiskRecord>& out) override {
+        out.clear();
+        QueryStatus status = queries < static_cast<int>(script.size())
+            ? script[queries] : QueryStatus::Ok;
+        queries++;
+        if (status == QueryStatus::Ok) out = disks;
+        return status;
+    }
+};
+
+DiskRecord MakeDisk(const char* serial, int number, bool offline = false) {
+    DiskRecord disk;
+    disk.serialNumber = serial;
+    disk.model = "Test Disk";
+    disk.number = number;
+    disk.isOffline = offline;
+    return disk;
+}
+
+} // anonymous namespace
+
+TEST_CASE("DiskQuerySession connects once and reuses the connection", "[session]") {
+    auto* backend = new FakeDiskBackend();
+    backend->disks = {MakeDisk("AAA", 0), MakeDisk("2VH7TM9L", 1)};
+    DiskQuerySession session{std::unique_ptr<DiskQueryBackend>(backend)};
+
+    CHECK_FALSE(session.IsConnected());
+
+    std::vector<DiskRecord> disks;
+    for (int i = 0; i < 5; i++) {
+        REQUIRE(session.EnumerateDisks(disks));
+        CHECK(disks.size() == 2);
+    }
+
+    CHECK(session.IsConnected());
+    CHECK(session.ConnectCount() == 1);
+    CHECK(backend->connects == 1);
+    CHECK(backend->queries == 5);
+}
+
+TEST_CASE("DiskQuerySession reconnects transparently when disconnected", "[session]") {
+    auto* backend = new FakeDiskBackend();
+    backend->disks = {MakeDisk("2VH7TM9L", 3)};
+    backend->script = {QueryStatus::Ok, QueryStatus::Disconnected, QueryStatus::Ok};
+    DiskQuerySession session{std::unique_ptr<DiskQueryBackend>(backend)};
+
+    std::vector<DiskRecord> disks;
+    REQUIRE(session.EnumerateDisks(disks));
+    REQUIRE(session.EnumerateDisks(disks));   // Broken, then retried
+
+    CHECK(disks.size() == 1);
+    CHECK(session.ConnectCount() == 2);
+    CHECK(backend->disconnects == 1);
+    CHECK(backend->queries == 3);
+}
+
+TEST_CASE("DiskQuerySession gives up after one reconnect attempt", "[session]") {
+    auto* backend = new FakeDiskBackend();
+    backend->script = {QueryStatus::Disconnected, QueryStatus::Disconnected};
+    DiskQuerySession session{std::unique_ptr<DiskQueryBackend>(backend)};
+
+    std::vector<DiskRecord> disks;
+    CHECK_FALSE(session.EnumerateDisks(disks));
+    CHECK(disks.empty());
+    CHECK_FALSE(session.IsConnected());
+    CHECK(backend->queries == 2);
+
+    // Next call starts over with a fresh connection
+    CHECK(session.EnumerateDisks(disks));
+    CHECK(session.ConnectCount() == 3);
+}
+
+TEST_CASE("DiskQuerySession keeps the connection on ordinary failures", "[session]") {
+    auto* backend = new FakeDiskBackend();
+    backend->script = {QueryStatus::Failed};
+    DiskQuerySession session{std::unique_ptr<DiskQueryBackend>(backend)};
+
+    std::vector<DiskRecord> disks;
+    CHECK_FALSE(session.EnumerateDisks(disks));
+    CHECK(session.IsConnected());
+    CHECK(backend->disconnects == 0);
+
+    CHECK(session.EnumerateDisks(disks));
+    CHECK(session.ConnectCount() == 1);
+}
+
+TEST_CASE("DiskQuerySession reports connect failures", "[session]") {
+    auto* backend = new FakeDiskBackend();
+    backend->connectSucceeds = false;
+    DiskQuerySession session{std::unique_ptr<DiskQueryBackend>(backend)};
+
+    std::vector<DiskRecord> disks;
+    CHECK_FALSE(session.EnumerateDisks(disks));
+    CHECK(backend->queries == 0);
+    CHECK(session.ConnectCount() == 0);
+
+    backend->connectSucceeds = true;
+    CHECK(session.EnumerateDisks(disks));
+    CHECK(session.ConnectCount() == 1);
+}
+
+TEST_CASE("DiskQuerySession Reset forces a reconnect", "[session]") {
+    auto* backend = new FakeDiskBackend();
+    DiskQuerySession session{std::unique_ptr<DiskQueryBackend>(backend)};
+
+    std::vector<DiskRecord> disks;
+    REQUIRE(session.EnumerateDisks(disks));
+    session.Reset();
+    CHECK_FALSE(session.IsConnected());
+    CHECK(backend->disconnects == 1);
+
+    REQUIRE(session.EnumerateDisks(disks));
+    CHECK(session.ConnectCount() == 2);
+}
+
+TEST_CASE("FindDiskBySerial", "[session]") {
+    std::vector<DiskRecord> disks = {MakeDisk("AAA", 0), MakeDisk("  2vh7tm9l ", 2, true)};
+
+    const DiskRecord* disk = FindDiskBySerial(disks, "2VH7TM9L");
+    REQUIRE(disk != nullptr);
+    CHECK(disk->number == 2);
+    CHECK(disk->isOffline);
+
+    CHECK(FindDiskBySerial(disks, "MISSING") == nullptr);
+    CHECK(FindDiskBySerial({}, "AAA") == nullptr);
+}
+
+TEST_CASE("FindDiskByTarget", "[session]") {
+    std::vector<DiskRecord> disks = {MakeDisk("AAA", 0), MakeDisk("BBB", 1)};
+    disks[0].model = "Samsung SSD 970 EVO";
+    disks[1].model = "WDC WD181KFGX-68AFPN0";
+
+    SECTION("Serial match wins") {
+        const DiskRecord* disk = FindDiskByTarget(disks, "aaa", "WDC WD181KFGX-68AFPN0");
+        REQUIRE(disk != nullptr);
+        CHECK(disk->number == 0);
+    }
+
+    SECTION("Falls back to model substring") {
+        const DiskRecord* disk = FindDiskByTarget(disks, "MISSING", "wd181kfgx");
+        REQUIRE(disk != nullptr);
+        CHECK(disk->number == 1);
+    }
+
+    SECTION("No match") {
+        CHECK(FindDiskByTarget(disks, "MISSING", "Seagate") == nullptr);
+        CHECK(FindDiskByTarget(disks, "MISSING", "   ") == nullptr);
+        CHECK(FindDiskByTarget(disks, "MISSING", "") == nullptr);
+    }
+}
+
+TEST_CASE("DiskRecordState", "[session]") {
+    DiskRecord disk;
+    disk.serialNumber = "ZFN0A1B2";
+    CHECK(DiskRecordState(&disk) == DriveState::Online);
+    disk.isOffline = true;
+    CHECK(DiskRecordState(&disk) == DriveState::Offline);
+
+    // Not enumerated: powered off, the same for one drive or many
+    CHECK(DiskRecordState(nullptr) == DriveState::Offline);
+}
+
+TEST_CASE("MatchDiskTargets", "[session]") {
+    std::vector<DiskRecord> disks = {MakeDisk("AAA", 0), MakeDisk(" bbb ", 1), MakeDisk("CCC", 2)};
+
+    auto target = [](const char* name, const char* serial) {
+        DriveTarget drive;
+        drive.name = name;
+        drive.serial = serial;
+        return drive;
+    };
+
+    SECTION("Matches all targets in one pass") {
+        std::vector<DriveTarget> targets = {target("Drive", "ccc"), target("Drive.1", "BBB"), target("Drive.2", "ZZZ")};
+        auto matches = MatchDiskTargets(disks, targets);
+
+        REQUIRE(matches.size() == 3);
+        REQUIRE(matches[0] != nullptr);
+        CHECK(matches[0]->number == 2);
+        REQUIRE(matches[1] != nullptr);
+        CHECK(matches[1]->number == 1);
+        CHECK(matches[2] == nullptr);
+    }
+
+    SECTION("Empty and duplicate serials") {
+        std::vector<DriveTarget> targets = {target("Drive", ""), target("Drive.1", "AAA"), target("Drive.2", "aaa")};
+        auto matches = MatchDiskTargets(disks, targets);
+
+        CHECK(matches[0] == nullptr);
+        REQUIRE(matches[1] != nullptr);
+        CHECK(matches[1]->number == 0);
+        CHECK(matches[2] == nullptr);
+    }
+
+    SECTION("No targets or no disks") {
+        CHECK(MatchDiskTargets(disks, {}).empty());
+        auto matches = MatchDiskTargets({}, {target("Drive", "AAA")});
+        REQUIRE(matches.size() == 1);
+        CHECK(matches[0] == nullptr);
+    }
+}
@@ -0,0 +1,163 @@
+// Tests for the sysfs disk backend: serial parsers, and on Linux a fixture
+// /sys/block and /dev/disk/by-id tree
+
+#include "catch.hpp"
+#include "core/disk-sysfs.h"
+#include <string>
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+// Unit serial VPD page as the kernel exposes it (binary, length in bytes 2-3)
+std::string MakeVpdPage(const std::string& serial) {
+    std::string page;
+    page += '\0';
+    page += '\x80';
+    page += static_cast<char>((serial.size() >> 8) & 0xFF);
+    page += static_cast<char>(serial.size() & 0xFF);
+    return page + serial;
+}
+
+} // anonymous namespace
+
+TEST_CASE("ParseVpdUnitSerial", "[sysfs]") {
+    CHECK(ParseVpdUnitSerial(MakeVpdPage("        ZFN0A1B2")) == "ZFN0A1B2");
+    CHECK(ParseVpdUnitSerial(MakeVpdPage(std::string("2VH7TM9L\0\0", 10))) == "2VH7TM9L");
+
+    // Wrong page, truncated, or length past the end
+    std::string otherPage = MakeVpdPage("ZFN0A1B2");
+    otherPage[1] = '\x83';
+    CHECK(ParseVpdUnitSerial(otherPage) == "");
+    CHECK(ParseVpdUnitSerial(std::string("\0\x80\0", 3)) == "");
+    CHECK(ParseVpdUnitSerial(MakeVpdPage("ZFN0A1B2").substr(0, 8)) == "");
+    CHECK(ParseVpdUnitSerial("") == "");
+}
+
+TEST_CASE("ParseT10WwidSerial", "[sysfs]") {
+    CHECK(ParseT10WwidSerial("t10.ATA     ST4000DM004-2CV104                      ZFN0A1B2\n") == "ZFN0A1B2");
+    CHECK(ParseT10WwidSerial("naa.5000c500a1b2c3d4") == "");
+    CHECK(ParseT10WwidSerial("eui.0025385b71b0a1b2") == "");
+    CHECK(ParseT10WwidSerial("t10.ATA") == "");
+}
+
+TEST_CASE("ParseByIdSerial", "[sysfs]") {
+    CHECK(ParseByIdSerial("ata-ST4000DM004-2CV104_ZFN0A1B2") == "ZFN0A1B2");
+    CHECK(ParseByIdSerial("scsi-SATA_ST4000DM004-2CV_ZFN0A1B2") == "ZFN0A1B2");
+    CHECK(ParseByIdSerial("nvme-Samsung_SSD_970_EVO_Plus_1TB_S4EWNX0R123456") == "S4EWNX0R123456");
+    CHECK(ParseByIdSerial("usb-WD_Elements_25A3_575835314444394B-0:0") == "575835314444394B");
+
+    // No serial in these
+    CHECK(ParseByIdSerial("ata-ST4000DM004-2CV104_ZFN0A1B2-part1") == "");
+    CHECK(ParseByIdSerial("wwn-0x5000c500a1b2c3d4") == "");
+    CHECK(ParseByIdSerial("nvme-eui.0025385b71b0a1b2") == "");
+    CHECK(ParseByIdSerial("nvme-nvme.144d-533445-00000001") == "");
+    CHECK(ParseByIdSerial("dm-name-vg0-root") == "");
+    CHECK(ParseByIdSerial("ata-NOSERIAL") == "");
+    CHECK(ParseByIdSerial("ata-MODEL_") == "");
+}
+
+#ifdef __linux__
+#include "fake-tree.h"
+#include <vector>
+
+namespace {
+
+// Temporary sys/ and by-id/ tree, removed afterwards
+class FakeSysBlock : public hdd::test::FakeTree {
+public:
+    FakeSysBlock() : FakeTree("sysfs") {
+        MakeDir("/sys/block");
+        MakeDir("/by-id");
+    }
+
+    // A disk with a device directory holding the given attribute files
+    void AddDisk(const std::string& name, const std::vector<std::pair<std::string, std::string>>& attributes) {
+        MakeDir("/sys/block/" + name + "/device");
+        for (const auto& attribute : attributes) {
+            WriteFile("/sys/block/" + name + "/device/" + attribute.first, attribute.second);
+        }
+    }
+
+    // A block device without a device link (loop, dm)
+    void AddVirtual(const std::string& name) { MakeDir("/sys/block/" + name); }
+
+    void AddByIdLink(const std::string& name, const std::string& target) {
+        REQUIRE(Symlink("/by-id/" + name, target));
+    }
+};
+
+} // anonymous namespace
+
+TEST_CASE("SysfsDiskBackend on a fixture tree", "[sysfs]") {
+    FakeSysBlock tree;
+    tree.AddDisk("nvme0n1", {{"model", "Samsung SSD 970 EVO Plus 1TB           \n"},
+                             {"serial", "S4EWNX0R123456      \n"},
+                             {"state", "live\n"}});
+    tree.AddDisk("sda", {{"model", "ST4000DM004-2CV1\n"},
+                         {"vpd_pg80", MakeVpdPage("            ZFN0A1B2")},
+                         {"state", "running\n"}});
+    tree.AddDisk("sdb", {{"model", "Elements 25A3    \n"}, {"state", "running\n"}});
+    tree.AddDisk("sdc", {{"model", "WDC WD40EFRX-68N\n"},
+                         {"wwid", "t10.ATA     WDC WD40EFRX-68N32N0                    WD-WCC7K1234567\n"},
+                         {"state", "offline\n"}});
+    tree.AddVirtual("loop0");
+    tree.AddVirtual("dm-0");
+
+    // sdb is a USB bridge that only udev knows the serial of
+    tree.AddByIdLink("usb-WD_Elements_25A3_575835314444394B-0:0", "../../sdb");
+    tree.AddByIdLink("usb-WD_Elements_25A3_575835314444394B-0:0-part1", "../../sdb1");
+    tree.AddByIdLink("wwn-0x5000c500a1b2c3d4", "../../sda");
+
+    SysfsDiskBackend backend(tree.root + "/sys", tree.root + "/by-id");
+    REQUIRE(backend.Connect());
+
+    std::vector<DiskRecord> disks;
+    REQUIRE(backend.EnumerateDisks(disks) == QueryStatus::Ok);
+    REQUIRE(disks.size() == 4);
+
+    CHECK(disks[0].number == 0);
+    CHECK(disks[0].device == "nvme0n1");
+    CHECK(disks[0].model == "Samsung SSD 970 EVO Plus 1TB");
+    CHECK(disks[0].serialNumber == "S4EWNX0R123456");
+    CHECK_FALSE(disks[0].isOffline);
+
+    CHECK(disks[1].model == "ST4000DM004-2CV1");
+    CHECK(disks[1].serialNumber == "ZFN0A1B2");
+    CHECK_FALSE(disks[1].isOffline);
+
+    CHECK(disks[2].model == "Elements 25A3");
+    CHECK(disks[2].serialNumber == "575835314444394B");
+
+    CHECK(disks[3].serialNumber == "WD-WCC7K1234567");
+    CHECK(disks[3].isOffline);
+
+    // Works with the session and the serial lookup like the Windows backends
+    DiskQuerySession session(std::unique_ptr<DiskQueryBackend>(
+        new SysfsDiskBackend(tree.root + "/sys", tree.root + "/by-id")));
+    REQUIRE(session.EnumerateDisks(disks));
+    const DiskRecord* target = FindDiskBySerial(disks, "zfn0a1b2");
+    REQUIRE(target);
+    CHECK(target->number == 1);
+}
+
+TEST_CASE("SysfsDiskBackend without a block directory", "[sysfs]") {
+    SysfsDiskBackend backend("/nonexistent-sysfs-root", "/nonexistent-by-id");
+    CHECK_FALSE(backend.Connect());
+
+    std::vector<DiskRecord> disks(1);
+    CHECK(backend.EnumerateDisks(disks) == QueryStatus::Failed);
+    CHECK(disks.empty());
+}
+
+TEST_CASE("SysfsDiskBackend on this machine", "[sysfs]") {
+    // Whatever disks there are, enumerated without a subprocess
+    SysfsDiskBackend backend;
+    if (!backend.Connect()) return;
+
+    std::vector<DiskRecord> disks;
+    CHECK(backend.EnumerateDisks(disks) == QueryStatus::Ok);
+}
+
+#endif // __linux__
@@ -0,0 +1,144 @@
+// Tests for the cached executable resolver
+
+#include "catch.hpp"
+#include "core/exe-resolver.h"
+#include <map>
+#include <set>
+
+#ifndef _WIN32
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#endif
+
+using namespace hdd::core;
+
+namespace {
+
+// In-memory file system that counts every access
+class FakeExeProbe : public ExeProbe {
+public:
+    std::set<std::string> executables;
+    std::map<std::string, uint64_t> stamps;
+    int fileChecks = 0;
+    int dirChecks = 0;
+
+    bool IsExecutable(const std::string& path) override {
+        fileChecks++;
+        return executables.count(path) > 0;
+    }
+
+    uint64_t DirectoryStamp(const std::string& dir) override {
+        dirChecks++;
+        auto it = stamps.find(dir);
+        return it == stamps.end() ? 0 : it->second;
+    }
+
+    int Accesses() const { return fileChecks + dirChecks; }
+};
+
+} // anonymous namespace
+
+TEST_CASE("SplitSearchPath", "[resolver]") {
+    auto dirs = SplitSearchPath("C:\\Windows;;\"C:\\Program Files\\Tool\" ; C:\\bin\\;", ';');
+    REQUIRE(dirs.size() == 3);
+    CHECK(dirs[0] == "C:\\Windows");
+    CHECK(dirs[1] == "C:\\Program Files\\Tool");
+    CHECK(dirs[2] == "C:\\bin\\");
+
+    auto posix = SplitSearchPath("/usr/bin::/bin", ':');
+    REQUIRE(posix.size() == 2);
+    CHECK(posix[1] == "/bin");
+
+    CHECK(SplitSearchPath("", ';').empty());
+}
+
+TEST_CASE("JoinSearchPath", "[resolver]") {
+    CHECK(JoinSearchPath("C:\\bin", "x.exe", '\\') == "C:\\bin\\x.exe");
+    CHECK(JoinSearchPath("C:\\bin\\", "x.exe", '\\') == "C:\\bin\\x.exe");
+    CHECK(JoinSearchPath("/usr/bin", "x", '/') == "/usr/bin/x");
+    CHECK(JoinSearchPath("", "x.exe", '\\') == "x.exe");
+}
+
+TEST_CASE("ExeResolverCache", "[resolver]") {
+    FakeExeProbe probe;
+    probe.executables = {"C:\\tools\\RemoveDrive.exe"};
+    probe.stamps = {{"C:\\app", 1}, {"", 2}, {"C:\\Windows", 3}, {"C:\\tools", 4}};
+    ExeResolverCache cache(';', '\\');
+    const std::string path = "C:\\Windows;C:\\tools";
+
+    SECTION("Search order and repeated lookups") {
+        CHECK(cache.Resolve(probe, "RemoveDrive.exe", path, "C:\\app", 0) == "C:\\tools\\RemoveDrive.exe");
+        CHECK(probe.fileChecks == 4);
+
+        int before = probe.Accesses();
+        for (int i = 0; i < 100; i++) {
+            CHECK(cache.Resolve(probe, "RemoveDrive.exe", path, "C:\\app", 1000) == "C:\\tools\\RemoveDrive.exe");
+        }
+        CHECK(probe.Accesses() == before);
+
+        probe.executables.insert("C:\\app\\RemoveDrive.exe");
+        probe.stamps["C:\\app"] = 10;
+        CHECK(cache.Resolve(probe, "RemoveDrive.exe", path, "C:\\app", 2000) == "C:\\tools\\RemoveDrive.exe");
+        CHECK(cache.Resolve(probe, "RemoveDrive.exe", path, "C:\\app", EXE_CACHE_REVALIDATE_MS + 1) ==
+              "C:\\app\\RemoveDrive.exe");
+    }
+
+    SECTION("Negative entries are cached") {
+        CHECK(cache.Resolve(probe, "missing.exe", path, "C:\\app", 0).empty());
+        int before = probe.Accesses();
+        CHECK(cache.Resolve(probe, "missing.exe", path, "C:\\app", 5).empty());
+        CHECK(probe.Accesses() == before);
+        CHECK(cache.Size() == 1);
+    }
+
+    SECTION("Unchanged directories only cost a re-stamp") {
+        cache.Resolve(probe, "missing.exe", path, "C:\\app", 0);
+        int files = probe.fileChecks;
+        CHECK(cache.Resolve(probe, "missing.exe", path, "C:\\app", EXE_CACHE_REVALIDATE_MS).empty());
+        CHECK(probe.fileChecks == files);
+
+        probe.executables.insert("C:\\Windows\\missing.exe");
+        probe.stamps["C:\\Windows"] = 30;
+        CHECK(cache.Resolve(probe, "missing.exe", path, "C:\\app", 2 * EXE_CACHE_REVALIDATE_MS) ==
+              "C:\\Windows\\missing.exe");
+    }
+
+    SECTION("PATH or exe directory change drops the cache") {
+        cache.Resolve(probe, "RemoveDrive.exe", path, "C:\\app", 0);
+        CHECK(cache.Resolve(probe, "RemoveDrive.exe", "C:\\Windows", "C:\\app", 1).empty());
+        CHECK(cache.Resolve(probe, "RemoveDrive.exe", path, "C:\\other", 2) == "C:\\tools\\RemoveDrive.exe");
+        CHECK(cache.Size() == 1);
+    }
+
+    SECTION("Invalidate") {
+        cache.Resolve(probe, "RemoveDrive.exe", path, "C:\\app", 0);
+        cache.Invalidate();
+        CHECK(cache.Size() == 0);
+    }
+}
+
+#ifndef _WIN32
+TEST_CASE("ExeResolverCache with the POSIX probe", "[resolver]") {
+    char dirTemplate[] = "/tmp/hdd-resolver-XXXXXX";
+    REQUIRE(mkdtemp(dirTemplate) != nullptr);
+    std::string dir = dirTemplate;
+    std::string tool = dir + "/tool";
+
+    std::ofstream(tool) << "#!/bin/sh\n";
+    PosixExeProbe probe;
+    ExeResolverCache cache;
+    std::string path = "/nonexistent:" + dir;
+
+    // Present but not executable
+    CHECK(cache.Resolve(probe, "tool", path, "", 0).empty());
+
+    REQUIRE(chmod(tool.c_str(), 0755) == 0);
+    CHECK(cache.Resolve(probe, "tool", path, "", 1).empty());   // Still cached
+    cache.Invalidate();
+    CHECK(cache.Resolve(probe, "tool", path, "", 2) == tool);
+
+    remove(tool.c_str());
+    rmdir(dir.c_str());
+}
+#endif
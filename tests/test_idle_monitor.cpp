@@ -0,0 +1,158 @@
+// Tests for idle detection and the /proc/diskstats parser
+
+#include "catch.hpp"
+#include "core/idle-monitor.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace hdd::core;
+
+namespace {
+
+// Trimmed /proc/diskstats from a machine with an NVMe system disk and a
+// USB hard drive (sdb); kernel 5.5+ layout with discard and flush fields
+const char* const kDiskstats =
+    " 259       0 nvme0n1 401325 102448 24385862 69542 813457 465113 31744904 811245 0 493216 923127 0 0 0 0 38521 42339\n"
+    " 259       1 nvme0n1p1 391 1034 19762 87 2 0 2 0 0 112 88 0 0 0 0 0 0\n"
+    " 259       2 nvme0n1p2 400811 101414 24360124 69437 813455 465113 31744902 811245 0 493080 880682 0 0 0 0 0 0\n"
+    "   8       0 sda 12 0 96 3 0 0 0 0 0 20 3 0 0 0 0 0 0\n"
+    "   8      16 sdb 57381 120 9185530 402177 3310 5512 1253600 90321 0 311520 492498 0 0 0 0 17 0\n"
+    "   8      17 sdb1 57240 120 9181258 401995 3310 5512 1253600 90321 0 311380 492317 0 0 0 0 0 0\n"
+    "   7       0 loop0 63 0 2222 12 0 0 0 0 0 28 12 0 0 0 0 0 0\n";
+
+DiskIoCounters Counters(uint64_t reads, uint64_t writes) {
+    DiskIoCounters counters;
+    counters.reads = reads;
+    counters.writes = writes;
+    return counters;
+}
+
+} // anonymous namespace
+
+TEST_CASE("ParseDiskstats", "[idle]") {
+    size_t size = strlen(kDiskstats);
+    DiskIoCounters counters;
+
+    REQUIRE(ParseDiskstats(kDiskstats, size, "sdb", counters));
+    CHECK(counters.reads == 57381);
+    CHECK(counters.writes == 3310);
+
+    // Whole names only: "sdb" is not "sdb1", "nvme0n1" not "nvme0n1p1"
+    REQUIRE(ParseDiskstats(kDiskstats, size, "sdb1", counters));
+    CHECK(counters.reads == 57240);
+    REQUIRE(ParseDiskstats(kDiskstats, size, "nvme0n1", counters));
+    CHECK(counters.writes == 813457);
+
+    CHECK_FALSE(ParseDiskstats(kDiskstats, size, "sdc", counters));
+    CHECK_FALSE(ParseDiskstats(kDiskstats, size, "sd", counters));
+
+    // Last line without a newline, truncated and malformed lines
+    const char* tail = "   8 16 sdb 5 0 40 1 7 0 56 2";
+    REQUIRE(ParseDiskstats(tail, strlen(tail), "sdb", counters));
+    CHECK(counters.reads == 5);
+    CHECK(counters.writes == 7);
+    const char* truncated = "   8 16 sdb 5 0 40";
+    CHECK_FALSE(ParseDiskstats(truncated, strlen(truncated), "sdb", counters));
+    const char* garbage = "   8 16 sdb 5 x 40 1 7 0 56 2\n";
+    CHECK_FALSE(ParseDiskstats(garbage, strlen(garbage), "sdb", counters));
+    CHECK_FALSE(ParseDiskstats("", 0, "sdb", counters));
+}
+
+TEST_CASE("ParseDiskstats cost", "[idle]") {
+    // At one sample per IDLE_SAMPLE_MS, staying under 0.1% CPU leaves
+    // IDLE_SAMPLE_MS / 1000 ms per sample; the parse should be far below
+    size_t size = strlen(kDiskstats);
+    DiskIoCounters counters;
+    const int rounds = 10000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) ParseDiskstats(kDiskstats, size, "loop0", counters);
+    double perParseMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count() / rounds;
+
+    INFO(perParseMs * 1000 << " us per parse");
+    CHECK(counters.reads == 63);
+    CHECK(perParseMs < IDLE_SAMPLE_MS / 1000.0 / 100);
+}
+
+TEST_CASE("IdleTracker", "[idle]") {
+    const uint64_t minute = 60000;
+    IdleTracker tracker(10 * minute, 3 * IDLE_SAMPLE_MS);
+
+    SECTION("Fires once after the window, again only after new I/O") {
+        CHECK_FALSE(tracker.Sample(0, Counters(100, 10)));
+
+        uint64_t now = 0;
+        bool fired = false;
+        while (!fired && now < 20 * minute) {
+            now += IDLE_SAMPLE_MS;
+            fired = tracker.Sample(now, Counters(100, 10));
+            if (now == 5 * minute) CHECK(tracker.IdleForMs(now) == 5 * minute);
+        }
+        CHECK(fired);
+        CHECK(now == 10 * minute);
+        CHECK_FALSE(tracker.Sample(now + IDLE_SAMPLE_MS, Counters(100, 10)));
+
+        CHECK_FALSE(tracker.Sample(now + 2 * IDLE_SAMPLE_MS, Counters(100, 11)));
+        CHECK(tracker.IdleForMs(now + 2 * IDLE_SAMPLE_MS) == 0);
+    }
+
+    SECTION("Any counter change restarts the window") {
+        uint64_t now = 0;
+        tracker.Sample(now, Counters(100, 10));
+        for (int i = 1; i <= 40; i++) {
+            now += IDLE_SAMPLE_MS;
+            // A read every 4 minutes keeps the drive busy enough
+            CHECK_FALSE(tracker.Sample(now, Counters(100 + i / 8, 10)));
+        }
+        // Counters reset (drive re-enumerated) is activity too
+        now += IDLE_SAMPLE_MS;
+        tracker.Sample(now, Counters(0, 0));
+        CHECK(tracker.IdleForMs(now) == 0);
+    }
+
+    SECTION("A long gap between samples is not idle time") {
+        tracker.Sample(0, Counters(1, 1));
+        CHECK_FALSE(tracker.Sample(60 * minute, Counters(1, 1)));   // Resumed from suspend
+        CHECK(tracker.IdleForMs(60 * minute) == 0);
+    }
+
+    SECTION("Disabled with a zero window") {
+        IdleTracker off;
+        off.Sample(0, Counters(1, 1));
+        CHECK_FALSE(off.Sample(1000 * minute, Counters(1, 1)));
+    }
+}
+
+#ifdef __linux__
+TEST_CASE("DiskstatsSampler reads a fixture file", "[idle]") {
+    char path[] = "/tmp/hdd-diskstats-XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    REQUIRE(write(fd, kDiskstats, strlen(kDiskstats)) == static_cast<ssize_t>(strlen(kDiskstats)));
+
+    DiskstatsSampler sampler;
+    REQUIRE(sampler.Open(path));
+    DiskIoCounters counters;
+    REQUIRE(sampler.Read("sdb", counters));
+    CHECK(counters.writes == 3310);
+
+    // Rewritten in place: the next sample sees the new numbers
+    const char* updated = "   8      16 sdb 57390 120 9185602 402180 3311 5512 1253608 90322 0 311525 492502 0 0 0 0 17 0\n";
+    REQUIRE(pwrite(fd, updated, strlen(updated), 0) == static_cast<ssize_t>(strlen(updated)));
+    REQUIRE(ftruncate(fd, static_cast<off_t>(strlen(updated))) == 0);
+    REQUIRE(sampler.Read("sdb", counters));
+    CHECK(counters.reads == 57390);
+    CHECK(counters.writes == 3311);
+    CHECK_FALSE(sampler.Read("sda", counters));
+
+    close(fd);
+    unlink(path);
+
+    // The real file, where there is one
+    DiskstatsSampler proc;
+    if (proc.Open()) {
+        CHECK_FALSE(proc.Read("no-such-disk", counters));
+    }
+}
+#endif
@@ -0,0 +1,90 @@
+// Tests for streaming output capture
+
+#include "catch.hpp"
+#include "core/output-stream.h"
+
+using namespace hdd::core;
+
+namespace {
+
+struct LineCollector {
+    std::vector<std::string>* lines;
+    void operator()(const std::string& line) { lines->push_back(line); }
+};
+
+} // anonymous namespace
+
+TEST_CASE("LineAssembler", "[output]") {
+    std::vector<std::string> lines;
+    LineCollector collect{&lines};
+
+    SECTION("Lines split across chunks") {
+        LineAssembler assembler;
+        std::string stream = "first\r\nsec";
+        assembler.Feed(stream.data(), stream.size(), collect);
+        REQUIRE(lines.size() == 1);
+        CHECK(lines[0] == "first");
+
+        std::string rest = "ond\n\nlast";
+        assembler.Feed(rest.data(), rest.size(), collect);
+        REQUIRE(lines.size() == 3);
+        CHECK(lines[1] == "second");
+        CHECK(lines[2].empty());
+
+        assembler.Flush(collect);
+        REQUIRE(lines.size() == 4);
+        CHECK(lines[3] == "last");
+
+        assembler.Flush(collect);
+        CHECK(lines.size() == 4);
+    }
+
+    SECTION("Long lines arrive in pieces") {
+        LineAssembler assembler(4);
+        std::string stream = "abcdefghij\n";
+        assembler.Feed(stream.data(), stream.size(), collect);
+        REQUIRE(lines.size() == 3);
+        CHECK(lines[0] == "abcd");
+        CHECK(lines[1] == "efgh");
+        CHECK(lines[2] == "ij");
+    }
+}
+
+TEST_CASE("BoundedTail", "[output]") {
+    SECTION("Unbounded keeps everything") {
+        BoundedTail tail;
+        tail.Append("hello ", 6);
+        tail.Append("world", 5);
+        CHECK(tail.Str() == "hello world");
+        CHECK(tail.Dropped() == 0);
+    }
+
+    SECTION("Keeps the last bytes across wraparound") {
+        BoundedTail tail(8);
+        tail.Append("abcde", 5);
+        CHECK(tail.Str() == "abcde");
+        tail.Append("fghij", 5);
+        CHECK(tail.Str() == "cdefghij");
+        CHECK(tail.Size() == 8);
+        CHECK(tail.Dropped() == 2);
+        tail.Append("k", 1);
+        CHECK(tail.Str() == "defghijk");
+        CHECK(tail.Dropped() == 3);
+    }
+
+    SECTION("Chunk larger than the capacity") {
+        BoundedTail tail(4);
+        tail.Append("xy", 2);
+        tail.Append("0123456789", 10);
+        CHECK(tail.Str() == "6789");
+        CHECK(tail.Dropped() == 8);
+    }
+
+    SECTION("Memory stays flat") {
+        BoundedTail tail(64);
+        std::string chunk(1000, 'x');
+        for (int i = 0; i < 1000; i++) tail.Append(chunk.data(), chunk.size());
+        CHECK(tail.Size() == 64);
+        CHECK(tail.Dropped() == 1000 * 1000 - 64);
+    }
+}
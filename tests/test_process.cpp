@@ -0,0 +1,252 @@
+// Tests for the process runner's deadline path: a command that outlives its
+// timeout is killed with its children, and what it printed is kept. Real
+// children: cmd.exe and ping on Windows (process.cpp), /bin/sh and sleep(1)
+// on Linux (process-posix.h), where the /bin/sh shell host is tested too.
+
+#include "catch.hpp"
+#include "core/process-posix.h"
+#include <chrono>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fstream>
+#endif
+
+#if defined(_WIN32) || defined(__linux__)
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+#ifdef _WIN32
+typedef ChildProcess TestChild;
+
+// ping is a grandchild that keeps the output pipe open until it is killed
+const char* const HUNG_COMMAND = "cmd.exe /c \"echo started& ping -n 30 127.0.0.1 >nul& echo finished\"";
+const char* const QUICK_COMMAND = "cmd.exe /c \"echo done& exit /b 3\"";
+
+CommandResult RunTestCommand(const std::string& command, uint32_t timeoutMs) {
+    return RunCommand(command, timeoutMs, true);
+}
+
+int WaitForAnyTestChild(const std::vector<TestChild*>& children, uint32_t timeoutMs) {
+    return WaitForAnyChild(children, timeoutMs);
+}
+#else
+typedef PosixChildProcess TestChild;
+
+// sleep is a grandchild that keeps the output pipe open until it is killed
+const char* const HUNG_COMMAND = "echo started; sleep 30; echo finished";
+const char* const QUICK_COMMAND = "echo done; exit 3";
+
+CommandResult RunTestCommand(const std::string& command, uint32_t timeoutMs) {
+    return RunPosixCommand(command, timeoutMs, true);
+}
+
+int WaitForAnyTestChild(const std::vector<TestChild*>& children, uint32_t timeoutMs) {
+    return WaitForAnyPosixChild(children, timeoutMs);
+}
+
+// Processes of a group that are still running. Killed members can linger as
+// zombies until init reaps them, so kill(-group, 0) would still succeed.
+int LiveGroupMembers(pid_t group) {
+    int live = 0;
+    DIR* proc = opendir("/proc");
+    if (!proc) return -1;
+    while (dirent* entry = readdir(proc)) {
+        std::ifstream stat(std::string("/proc/") + entry->d_name + "/stat");
+        std::string line;
+        if (!std::getline(stat, line)) continue;
+
+        // "pid (comm) state ppid pgrp ...", comm may contain spaces
+        size_t close = line.rfind(')');
+        if (close == std::string::npos) continue;
+        char state = 0;
+        int parent = 0, pgrp = 0;
+        if (sscanf(line.c_str() + close + 1, " %c %d %d", &state, &parent, &pgrp) == 3 &&
+            pgrp == group && state != 'Z' && state != 'X') {
+            live++;
+        }
+    }
+    closedir(proc);
+    return live;
+}
+#endif
+
+// Generous bound on the time a kill takes, for slow CI machines
+const double KILL_SLACK_MS = 1500;
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // anonymous namespace
+
+TEST_CASE("RunCommand kills a command that outlives its timeout", "[process]") {
+    auto start = std::chrono::steady_clock::now();
+    CommandResult result = RunTestCommand(HUNG_COMMAND, 300);
+    double elapsedMs = MsSince(start);
+
+    CHECK(result.started);
+    CHECK(result.timedOut);
+    CHECK(result.exitCode != 0);
+
+    // Output up to the kill is kept; nothing ran past it
+    CHECK(result.output.find("started") != std::string::npos);
+    CHECK(result.output.find("finished") == std::string::npos);
+
+    // The deadline held, and returning at all means the grandchild holding
+    // the pipe is gone too
+    CHECK(elapsedMs >= 290);
+    CHECK(elapsedMs < 300 + KILL_SLACK_MS);
+}
+
+TEST_CASE("RunCommand returns a command that finishes in time", "[process]") {
+    CommandResult result = RunTestCommand(QUICK_COMMAND, 10000);
+
+    CHECK(result.started);
+    CHECK_FALSE(result.timedOut);
+    CHECK(result.exitCode == 3);
+    CHECK(result.output.find("done") != std::string::npos);
+}
+
+TEST_CASE("ChildProcess::Kill takes down the whole tree", "[process]") {
+    std::unique_ptr<TestChild> child = TestChild::Start(HUNG_COMMAND, true);
+    REQUIRE(child);
+
+    CHECK_FALSE(child->Wait(200));
+
+    auto start = std::chrono::steady_clock::now();
+    child->Kill();
+    CHECK(MsSince(start) < KILL_SLACK_MS);
+    CHECK(child->ExitCode() != 0);
+    CHECK(child->Output().find("started") != std::string::npos);
+
+#ifndef _WIN32
+    // Nothing is left running in the child's process group
+    CHECK(LiveGroupMembers(child->Pid()) == 0);
+#endif
+}
+
+TEST_CASE("WaitForAnyChild returns the child that exits first", "[process]") {
+    std::unique_ptr<TestChild> slow = TestChild::Start(HUNG_COMMAND, true);
+    std::unique_ptr<TestChild> quick = TestChild::Start(QUICK_COMMAND, true);
+    REQUIRE(slow);
+    REQUIRE(quick);
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(WaitForAnyTestChild({slow.get(), quick.get()}, 10000) == 1);
+    CHECK(MsSince(start) < 10000);
+    REQUIRE(quick->Wait(1000));   // Exited; only its output may still be draining
+    CHECK(quick->ExitCode() == 3);
+
+    // Only the hung one left: times out
+    start = std::chrono::steady_clock::now();
+    CHECK(WaitForAnyTestChild({slow.get()}, 100) == -1);
+    CHECK(MsSince(start) >= 90);
+
+    // Destroying a running child kills it
+}
+
+#ifdef __linux__
+
+TEST_CASE("PosixShellHost runs framed commands in one shell", "[process][shell]") {
+    PosixShellHost host;
+
+    CommandResult first = host.Run("echo one; echo 'it'\"'\"'s on stderr' >&2; exit 4", 5000);
+    CHECK(first.started);
+    CHECK_FALSE(first.timedOut);
+    CHECK(first.exitCode == 4);
+    CHECK(first.output == "one\nit's on stderr\n");
+
+    // Each command runs in a subshell: nothing leaks into the next one
+    CHECK(host.Run("HDD_TEST_VAR=set; export HDD_TEST_VAR", 5000).exitCode == 0);
+    CommandResult second = host.Run("printf '[%s]\\n' \"$HDD_TEST_VAR\"\nprintf 'two\\nlines\\n'", 5000);
+    CHECK(second.exitCode == 0);
+    CHECK(second.output == "[]\ntwo\nlines\n");
+
+    CHECK(host.StartCount() == 1);
+}
+
+TEST_CASE("PosixShellHost kills a command that outlives its timeout", "[process][shell]") {
+    PosixShellHost host;
+    REQUIRE(host.Run("true", 5000).exitCode == 0);
+
+    auto start = std::chrono::steady_clock::now();
+    CommandResult hung = host.Run(HUNG_COMMAND, 300);
+    double elapsedMs = MsSince(start);
+    CHECK(hung.started);
+    CHECK(hung.timedOut);
+    CHECK(elapsedMs >= 290);
+    CHECK(elapsedMs < 300 + KILL_SLACK_MS);
+
+    // The next command gets a fresh shell
+    CommandResult next = host.Run(QUICK_COMMAND, 5000);
+    CHECK(next.exitCode == 3);
+    CHECK(next.output == "done\n");
+    CHECK(host.StartCount() == 2);
+}
+
+TEST_CASE("PosixShellHost restarts a shell that died", "[process][shell]") {
+    PosixShellHost host;
+
+    SECTION("During a command: reported as failed, not retried") {
+        CommandResult killed = host.Run("kill -9 $$", 5000);
+        CHECK(killed.started);
+        CHECK_FALSE(killed.timedOut);
+        CHECK(killed.exitCode != 0);
+
+        CHECK(host.Run("echo back", 5000).output == "back\n");
+        CHECK(host.StartCount() == 2);
+    }
+
+    SECTION("While idle: the next command is sent to a new shell") {
+        REQUIRE(host.Run("(sleep 0.1; kill -9 $$) >/dev/null 2>&1 &", 5000).exitCode == 0);
+        usleep(500 * 1000);
+
+        CommandResult again = host.Run("echo again", 5000);
+        CHECK(again.exitCode == 0);
+        CHECK(again.output == "again\n");
+        CHECK(host.StartCount() == 2);
+    }
+}
+
+// Not run by default: run-tests "[bench]"
+TEST_CASE("PosixShellHost latency against a process per command", "[.][bench]") {
+    const int iterations = 200;
+    const char* const command = "echo ok";
+
+    std::vector<double> cold;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        CommandResult result = RunPosixCommand(command, 5000, true);
+        cold.push_back(MsSince(start));
+        REQUIRE(result.exitCode == 0);
+    }
+
+    PosixShellHost host;
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE(TrimWhitespace(host.Run(command, 5000).output) == "ok");
+    double startMs = MsSince(start);
+
+    std::vector<double> warm;
+    for (int i = 0; i < iterations; i++) {
+        start = std::chrono::steady_clock::now();
+        CommandResult result = host.Run(command, 5000);
+        warm.push_back(MsSince(start));
+        REQUIRE(result.exitCode == 0);
+    }
+
+    LatencySummary coldSummary = SummarizeLatencies(cold);
+    LatencySummary warmSummary = SummarizeLatencies(warm);
+    printf("/bin/sh command latency (%d iterations): %s\n", iterations, command);
+    printf("  %-28s median %8.3f  mean %8.3f ms\n", "process per call", coldSummary.median, coldSummary.mean);
+    printf("  %-28s %8.3f ms\n", "shell host start:", startMs);
+    printf("  %-28s median %8.3f  mean %8.3f ms\n", "shell host (warm)", warmSummary.median, warmSummary.mean);
+    CHECK(host.StartCount() == 1);
+}
+
+#endif // __linux__
+
+#endif // _WIN32 || __linux__
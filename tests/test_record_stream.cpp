@@ -0,0 +1,140 @@
+// Tests for record-oriented helper output: splitting, typed fields, the
+// collector, and on Linux records streamed from /bin/sh children
+
+#include "catch.hpp"
+#include "core/record-stream.h"
+#include <string>
+#include <vector>
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+// The shape the old disk_info.tmp helper wrote: number|model|serial|online
+struct DiskLine {
+    int number = -1;
+    std::string model;
+    std::string serial;
+    bool online = false;
+};
+
+bool ParseDiskLine(const std::vector<std::string>& fields, DiskLine& disk) {
+    return ParseRecordField(fields[0], disk.number) && ParseRecordField(fields[1], disk.model) &&
+           ParseRecordField(fields[2], disk.serial) && ParseRecordField(fields[3], disk.online);
+}
+
+} // anonymous namespace
+
+TEST_CASE("SplitRecord", "[records]") {
+    std::vector<std::string> fields;
+    REQUIRE(SplitRecord(" 1 | ST4000DM004-2CV104 |ZFN0A1B2|True\r", 4, fields));
+    CHECK(fields == std::vector<std::string>{"1", "ST4000DM004-2CV104", "ZFN0A1B2", "True"});
+
+    // Empty fields are kept in place
+    REQUIRE(SplitRecord("2||", 3, fields));
+    CHECK(fields == std::vector<std::string>{"2", "", ""});
+
+    CHECK_FALSE(SplitRecord("1|ST4000DM004", 4, fields));
+    CHECK_FALSE(SplitRecord("1|a|b|c|d", 4, fields));
+    CHECK(SplitRecord("1|a|b|c|d", 0, fields));
+    CHECK(fields.size() == 5);
+    CHECK(SplitRecord("E:;F:", 2, fields, ';'));
+}
+
+TEST_CASE("ParseRecordField", "[records]") {
+    int number = 7;
+    CHECK(ParseRecordField("42", number));
+    CHECK(number == 42);
+    CHECK(ParseRecordField("-1", number));
+    CHECK(number == -1);
+    CHECK_FALSE(ParseRecordField("", number));
+    CHECK_FALSE(ParseRecordField("4x", number));
+    CHECK_FALSE(ParseRecordField("99999999999", number));
+    CHECK(number == -1);
+
+    uint64_t bytes = 0;
+    CHECK(ParseRecordField("4000787030016", bytes));
+    CHECK(bytes == 4000787030016ULL);
+    CHECK_FALSE(ParseRecordField("-5", bytes));
+    CHECK_FALSE(ParseRecordField("99999999999999999999999", bytes));
+
+    bool flag = false;
+    CHECK(ParseRecordField("True", flag));
+    CHECK(flag);
+    CHECK(ParseRecordField("0", flag));
+    CHECK_FALSE(flag);
+    CHECK_FALSE(ParseRecordField("yes", flag));
+}
+
+TEST_CASE("RecordCollector", "[records]") {
+    RecordCollector<DiskLine> collector(4, ParseDiskLine);
+    collector.AddLine("0|Samsung SSD 970 EVO Plus 1TB|S4EWNX0R123456|True");
+    collector.AddLine("");
+    collector.AddLine("   ");
+    collector.AddLine("1|ST4000DM004-2CV104|ZFN0A1B2|False");
+    collector.AddLine("WARNING: something the helper printed");
+    collector.AddLine("x|ST4000DM004-2CV104|ZFN0A1B2|False");
+
+    REQUIRE(collector.Records().size() == 2);
+    CHECK(collector.Records()[0].serial == "S4EWNX0R123456");
+    CHECK(collector.Records()[0].online);
+    CHECK(collector.Records()[1].number == 1);
+    CHECK_FALSE(collector.Records()[1].online);
+    CHECK(collector.MalformedLines() == 2);
+
+    std::vector<DiskLine> taken = collector.TakeRecords();
+    CHECK(taken.size() == 2);
+}
+
+#ifdef __linux__
+#include <chrono>
+
+TEST_CASE("RunRecordCommand streams records from /bin/sh", "[records]") {
+    SECTION("Records on stdout, diagnostics on stderr") {
+        auto result = RunRecordCommand<DiskLine>(
+            "printf '0|Samsung SSD 970|S4EWNX0R123456|True\\n'; echo 'not a record|x' >&2; "
+            "printf 'garbage\\n1|ST4000DM004-2CV104|ZFN0A1B2|False'; exit 2",
+            5000, 4, ParseDiskLine);
+        CHECK(result.command.started);
+        CHECK_FALSE(result.command.timedOut);
+        CHECK(result.command.exitCode == 2);
+        CHECK(result.command.errorOutput == "not a record|x\n");
+        REQUIRE(result.records.size() == 2);
+        CHECK(result.records[0].model == "Samsung SSD 970");
+        CHECK(result.records[1].serial == "ZFN0A1B2");   // Last line had no newline
+        CHECK(result.malformedLines == 1);
+    }
+
+    SECTION("Many records with a small retained tail") {
+        auto result = RunRecordCommand<DiskLine>(
+            "i=0; while [ $i -lt 2000 ]; do echo \"$i|Model $i|SERIAL$i|1\"; i=$((i+1)); done", 10000, 4,
+            ParseDiskLine);
+        CHECK(result.command.exitCode == 0);
+        REQUIRE(result.records.size() == 2000);
+        CHECK(result.records[1999].number == 1999);
+        CHECK(result.command.output.size() <= RECORD_RETAINED_BYTES);
+        CHECK(result.command.droppedBytes > 0);
+    }
+
+    SECTION("A hung helper is killed; records so far are kept") {
+        auto start = std::chrono::steady_clock::now();
+        auto result = RunRecordCommand<DiskLine>("echo '3|Model|SERIAL|1'; sleep 10; echo '4|Model|SERIAL|1'", 300,
+                                                 4, ParseDiskLine);
+        double elapsedMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        CHECK(result.command.timedOut);
+        REQUIRE(result.records.size() == 1);
+        CHECK(result.records[0].number == 3);
+        CHECK(elapsedMs < 2000);
+    }
+
+    SECTION("A command that cannot run") {
+        auto result = RunRecordCommand<DiskLine>("exec /nonexistent-helper", 5000, 4, ParseDiskLine);
+        CHECK(result.command.started);
+        CHECK(result.command.exitCode == 127);
+        CHECK(result.records.empty());
+    }
+}
+
+#endif // __linux__
@@ -0,0 +1,224 @@
+// Tests for the hidraw relay transport (fake sysfs tree and fake relay)
+
+#include "catch.hpp"
+#include "core/hid-path.h"
+#include "core/relay-hidraw.h"
+
+using namespace hdd;
+using namespace hdd::core;
+
+TEST_CASE("ParseHidIdUevent", "[hidraw]") {
+    unsigned short vendor = 0, product = 0;
+
+    REQUIRE(ParseHidIdUevent("DRIVER=hid-generic\nHID_ID=0003:000016C0:000005DF\nHID_NAME=www.dcttech.com USBRelay2\n",
+                             vendor, product));
+    CHECK(vendor == 0x16C0);
+    CHECK(product == 0x05DF);
+
+    CHECK_FALSE(ParseHidIdUevent("DRIVER=hid-generic\n", vendor, product));
+    CHECK_FALSE(ParseHidIdUevent("HID_ID=0003:16C0\n", vendor, product));
+    CHECK_FALSE(ParseHidIdUevent("HID_ID=0003:000016C0:05DFx\n", vendor, product));
+    CHECK_FALSE(ParseHidIdUevent("HID_ID=0003:000116C0:000005DF\n", vendor, product));
+}
+
+TEST_CASE("MatchHidInterfacePath", "[hidraw]") {
+    const std::string relay = "\\\\?\\hid#vid_16c0&pid_05df#7&1a2b3c4d&0&0000#{4d1e55b2-f16f-11cf-88cb-001111000030}";
+    CHECK(MatchHidInterfacePath(relay, 0x16C0, 0x05DF) == HidPathMatch::Match);
+    CHECK(MatchHidInterfacePath("\\\\?\\HID#VID_16C0&PID_05DF#x", 0x16C0, 0x05DF) == HidPathMatch::Match);
+    CHECK(MatchHidInterfacePath("\\\\?\\hid#vid_046d&pid_c52b&mi_01&col02#8&2d5a&0&0001#{x}",
+                                0x16C0, 0x05DF) == HidPathMatch::Mismatch);
+    CHECK(MatchHidInterfacePath("\\\\?\\hid#{00001124-0000-1000-8000-00805f9b34fb}_localmfg&000f#9&1&0&0000",
+                                0x16C0, 0x05DF) == HidPathMatch::Unknown);
+    CHECK(MatchHidInterfacePath("\\\\?\\hid#vid_16c0#x", 0x16C0, 0x05DF) == HidPathMatch::Unknown);
+    CHECK(MatchHidInterfacePath("\\\\?\\hid#vid_16zz&pid_05df#x", 0x16C0, 0x05DF) == HidPathMatch::Unknown);
+}
+
+TEST_CASE("Prefilter over 200 HID interfaces", "[hidraw]") {
+    std::vector<std::string> paths;
+    char path[128];
+    for (unsigned int i = 0; i < 200; i++) {
+        if (i == 150) snprintf(path, sizeof(path), "\\\\?\\hid#vid_16c0&pid_05df#7&%x&0&0000", i);
+        else if (i % 50 == 7) snprintf(path, sizeof(path), "\\\\?\\hid#{00001124}_localmfg&000f#9&%x", i);
+        else snprintf(path, sizeof(path), "\\\\?\\hid#vid_%04x&pid_%04x&mi_00#8&%x", 0x0400 + i % 8, 0xC000 + i, i);
+        paths.push_back(path);
+    }
+
+    size_t matches = 0, unknown = 0;
+    for (const auto& entry : paths) {
+        HidPathMatch match = MatchHidInterfacePath(entry, 0x16C0, 0x05DF);
+        if (match == HidPathMatch::Match) matches++;
+        if (match == HidPathMatch::Unknown) unknown++;
+    }
+    CHECK(matches == 1);
+    CHECK(unknown == 4);    // Only these still need an open
+}
+
+#ifdef __linux__
+#include "fake-tree.h"
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace {
+
+// Stand-in relay: accepts opens of the nodes it is plugged in as and
+// records every feature report
+class FakeRelayIo : public HidrawIo {
+public:
+    std::string pluggedPath;
+    std::vector<std::vector<unsigned char>> reports;
+    int opens = 0;
+    int openFds = 0;
+
+    int Open(const std::string& path) override {
+        opens++;
+        if (path != pluggedPath) {
+            errno = ENOENT;
+            return -1;
+        }
+        openFds++;
+        return 42;
+    }
+
+    void Close(int) override { openFds--; }
+
+    int SetFeature(int fd, const unsigned char* report, size_t size) override {
+        if (fd != 42 || pluggedPath.empty()) {
+            errno = ENODEV;
+            return -1;
+        }
+        reports.emplace_back(report, report + size);
+
+        uint8_t bits = RelayChannelMask((report[1] & 0x01) ? report[2] : 0);
+        if (report[1] & 0x02) state = static_cast<uint8_t>(state | bits);
+        else state = static_cast<uint8_t>(state & ~bits);
+        return static_cast<int>(size);
+    }
+
+    int GetFeature(int fd, unsigned char* report, size_t size) override {
+        if (fd != 42 || pluggedPath.empty()) {
+            errno = ENODEV;
+            return -1;
+        }
+        if (!readback) {
+            errno = EIO;
+            return -1;
+        }
+        memset(report, 0, size);
+        report[RELAY_STATE_OFFSET] = state;
+        return static_cast<int>(size);
+    }
+
+    uint8_t state = 0;
+    bool readback = true;
+};
+
+// Temporary /sys/class/hidraw lookalike
+class FakeSysfs : public hdd::test::FakeTree {
+public:
+    FakeSysfs() : FakeTree("hidraw") {}
+
+    void AddNode(const std::string& name, const std::string& hidId) {
+        WriteFile("/" + name + "/device/uevent", "DRIVER=hid-generic\nHID_ID=" + hidId + "\n");
+    }
+
+    void RemoveNode(const std::string& name) { RemoveFile("/" + name + "/device/uevent"); }
+};
+
+} // anonymous namespace
+
+TEST_CASE("FindHidrawNode", "[hidraw]") {
+    FakeSysfs sysfs;
+    sysfs.AddNode("hidraw0", "0003:0000046D:0000C52B");   // Receiver
+    sysfs.AddNode("hidraw1", "0003:000016C0:000005DF");   // Relay
+
+    CHECK(FindHidrawNode(sysfs.root, 0x16C0, 0x05DF) == "hidraw1");
+    CHECK(FindHidrawNode(sysfs.root, 0x1234, 0x5678).empty());
+    CHECK(FindHidrawNode(sysfs.root + "/missing", 0x16C0, 0x05DF).empty());
+}
+
+TEST_CASE("hidraw lookup opens only the relay", "[hidraw]") {
+    FakeSysfs sysfs;
+    char name[32], hidId[64];
+    for (unsigned int i = 0; i < 200; i++) {
+        snprintf(name, sizeof(name), "hidraw%u", i);
+        if (i == 137) snprintf(hidId, sizeof(hidId), "0003:000016C0:000005DF");
+        else snprintf(hidId, sizeof(hidId), "0003:%08X:%08X", 0x0400 + i % 8, 0xC000 + i);
+        sysfs.AddNode(name, hidId);
+    }
+
+    FakeRelayIo io;
+    io.pluggedPath = "/dev/hidraw137";
+    HidrawRelayTransport transport(io, sysfs.root, "/dev");
+    REQUIRE(transport.Open());
+    CHECK(transport.Node() == "hidraw137");
+    CHECK(io.opens == 1);
+}
+
+TEST_CASE("Relay commands end to end through hidraw", "[hidraw]") {
+    FakeSysfs sysfs;
+    sysfs.AddNode("hidraw0", "0003:0000046D:0000C52B");
+    sysfs.AddNode("hidraw2", "0003:000016C0:000005DF");
+
+    FakeRelayIo io;
+    io.pluggedPath = "/dev/hidraw2";
+    auto* transport = new HidrawRelayTransport(io, sysfs.root, "/dev");
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    auto run = [&relay](std::vector<const char*> argv) {
+        RelayArgs args = ParseRelayArgs(static_cast<int>(argv.size()), const_cast<char**>(argv.data()));
+        REQUIRE(args.action == RelayAction::Switch);
+        return SwitchRelay(relay, args.channel, args.on);
+    };
+
+    SECTION("Reports reach the device over one open node") {
+        REQUIRE(run({"on"}));
+        REQUIRE(run({"2", "off"}));
+
+        REQUIRE(io.reports.size() == 2);
+        CHECK(io.state == 0x01);
+        CHECK(io.reports[0].size() == RELAY_REPORT_SIZE);
+        CHECK(io.reports[0][1] == 0xFE);
+        CHECK(io.reports[1][1] == 0xFD);
+        CHECK(io.reports[1][2] == 2);
+        CHECK(transport->Node() == "hidraw2");
+        CHECK(transport->ScanCount() == 1);
+        CHECK(io.openFds == 1);
+    }
+
+    SECTION("Replug under a new node") {
+        REQUIRE(run({"1", "on"}));
+
+        // Unplugged: writes fail with ENODEV, the node disappears
+        io.pluggedPath.clear();
+        sysfs.RemoveNode("hidraw2");
+        CHECK_FALSE(run({"1", "off"}));
+
+        // Back as hidraw3
+        sysfs.AddNode("hidraw3", "0003:000016C0:000005DF");
+        io.pluggedPath = "/dev/hidraw3";
+        REQUIRE(run({"1", "off"}));
+        CHECK(transport->Node() == "hidraw3");
+        CHECK(io.reports.back()[1] == 0xFC);     // Relay 1 was the only one on
+        CHECK(io.state == 0x00);
+        CHECK(io.openFds == 1);
+    }
+
+    SECTION("Status and redundant switches") {
+        REQUIRE(run({"1", "on"}));
+        size_t writes = io.reports.size();
+        REQUIRE(run({"1", "on"}));
+        CHECK(io.reports.size() == writes);
+
+        uint8_t mask = 0;
+        REQUIRE(relay.GetState(mask));
+        CHECK(mask == 0x01);
+
+        io.readback = false;
+        REQUIRE(relay.Switch(2, true) == RelaySwitchResult::Unverified);
+        REQUIRE(relay.GetState(mask));
+        CHECK(mask == 0x03);
+        CHECK_FALSE(relay.GetState(mask, true));
+    }
+}
+#endif
@@ -0,0 +1,113 @@
+// Tests for relay firmware protocols and report planning
+
+#include "catch.hpp"
+#include "core/relay-protocol.h"
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+typedef std::vector<unsigned char> Bytes;
+
+template <typename Protocol>
+Bytes All(bool on) {
+    typename Protocol::Report report;
+    Protocol::EncodeAll(on, report.data());
+    return Bytes(report.begin(), report.end());
+}
+
+template <typename Protocol>
+Bytes One(unsigned channel, bool on) {
+    typename Protocol::Report report;
+    Protocol::EncodeChannel(channel, on, report.data());
+    return Bytes(report.begin(), report.end());
+}
+
+template <typename Protocol>
+std::vector<Bytes> Plan(uint8_t mask, bool on, uint8_t current, bool known) {
+    std::vector<Bytes> out;
+    for (const auto& report : PlanRelayReports<Protocol>(mask, on, current, known)) {
+        out.emplace_back(report.begin(), report.end());
+    }
+    return out;
+}
+
+// Common DCT Tech checks for an N-channel board
+template <unsigned N>
+void CheckDctEncoding() {
+    typedef RelayProtocol<N> P;
+    CHECK(P::Channels == N);
+    CHECK(P::ReportSize == 9);
+    CHECK(P::AllChannels() == static_cast<uint8_t>((1u << N) - 1));
+
+    CHECK(All<P>(true) == Bytes{0, 0xFE, 0, 0, 0, 0, 0, 0, 0});
+    CHECK(All<P>(false) == Bytes{0, 0xFC, 0, 0, 0, 0, 0, 0, 0});
+    for (unsigned channel = 1; channel <= N; channel++) {
+        CHECK(One<P>(channel, true) == Bytes{0, 0xFF, static_cast<unsigned char>(channel), 0, 0, 0, 0, 0, 0});
+        CHECK(One<P>(channel, false) == Bytes{0, 0xFD, static_cast<unsigned char>(channel), 0, 0, 0, 0, 0, 0});
+    }
+
+    unsigned char state[9] = {0, 'S', 'E', 'R', 'I', 'A', 0, 0, 0xFF};
+    CHECK(P::ParseState(state) == P::AllChannels());
+}
+
+// Hypothetical 8-channel firmware that sets every channel from one bitmask
+struct MaskRelayProtocol : DctHidRelayProtocol<8> {
+    static constexpr bool HasMaskCommand = true;
+
+    static void EncodeMask(uint8_t bits, unsigned char* report) {
+        memset(report, 0, ReportSize);
+        report[1] = 0xA0;
+        report[2] = bits;
+    }
+};
+
+} // anonymous namespace
+
+TEST_CASE("RelayProtocol encodings", "[relay]") {
+    SECTION("1 channel") { CheckDctEncoding<1>(); }
+    SECTION("2 channels") { CheckDctEncoding<2>(); }
+    SECTION("4 channels") { CheckDctEncoding<4>(); }
+    SECTION("8 channels") { CheckDctEncoding<8>(); }
+
+    CHECK_FALSE(RelayProtocol<8>::HasMaskCommand);
+    CHECK(ActiveRelayProtocol::Channels == RELAY_CHANNEL_COUNT);
+}
+
+TEST_CASE("PlanRelayReports", "[relay]") {
+    typedef RelayProtocol<4> P4;
+
+    SECTION("Whole board is one all-channels report") {
+        CHECK(Plan<P4>(0x0F, true, 0x00, false) == std::vector<Bytes>{All<P4>(true)});
+        CHECK(Plan<P4>(0x0F, false, 0x05, true) == std::vector<Bytes>{All<P4>(false)});
+    }
+
+    SECTION("Subsets write only the channels that change") {
+        CHECK(Plan<P4>(0x05, true, 0x01, true) == std::vector<Bytes>{One<P4>(3, true)});
+        CHECK(Plan<P4>(0x06, false, 0x0F, true) ==
+              (std::vector<Bytes>{One<P4>(2, false), One<P4>(3, false)}));
+        CHECK(Plan<P4>(0x05, true, 0x05, true).empty());
+    }
+
+    SECTION("Unknown state writes every requested channel") {
+        CHECK(Plan<P4>(0x05, true, 0x00, false) ==
+              (std::vector<Bytes>{One<P4>(1, true), One<P4>(3, true)}));
+    }
+
+    SECTION("Ending with every channel alike uses the all command") {
+        CHECK(Plan<P4>(0x03, true, 0x0C, true) == std::vector<Bytes>{All<P4>(true)});
+        CHECK(Plan<P4>(0x01, false, 0x01, true) == std::vector<Bytes>{All<P4>(false)});
+    }
+
+    SECTION("Channels outside the board are ignored") {
+        CHECK(Plan<RelayProtocol<2>>(0xF4, true, 0x00, true).empty());
+    }
+
+    SECTION("Bitmask firmware batches any subset") {
+        CHECK(Plan<MaskRelayProtocol>(0x16, true, 0x81, true) ==
+              std::vector<Bytes>{Bytes{0, 0xA0, 0x97, 0, 0, 0, 0, 0, 0}});
+        // Without the current state the mask would clobber other channels
+        CHECK(Plan<MaskRelayProtocol>(0x06, true, 0x00, false).size() == 2);
+    }
+}
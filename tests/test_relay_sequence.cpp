@@ -0,0 +1,169 @@
+// Tests for timed relay sequences (fake clock and relay)
+
+#include "catch.hpp"
+#include "core/relay-sequence.h"
+#include <cstring>
+
+using namespace hdd::core;
+
+namespace {
+
+// Clock that only moves when slept on or when the relay is written
+class FakeClock : public SequenceClock {
+public:
+    int64_t now = 1000000;
+    int64_t oversleepUs = 0;    // Added to every wait, like a late wakeup
+
+    int64_t NowUs() override { return now; }
+
+    void SleepUntilUs(int64_t deadlineUs) override {
+        if (deadlineUs > now) now = deadlineUs + oversleepUs;
+    }
+};
+
+// Relay that takes writeUs per write and records when each arrived
+class TimedRelay : public RelayTransport {
+public:
+    explicit TimedRelay(FakeClock& clock) : m_clock(clock) {}
+
+    bool Open() override { return present; }
+    void Close() override {}
+    void ForgetDevice() override {}
+
+    RelayIoStatus SetFeature(const unsigned char* report, size_t) override {
+        if (failAfter >= 0 && static_cast<int>(writeTimes.size()) >= failAfter) return RelayIoStatus::Failed;
+        writeTimes.push_back(m_clock.now);
+        m_clock.now += writeUs;
+        uint8_t bits = RelayChannelMask((report[1] & 0x01) ? report[2] : 0);
+        if (report[1] & 0x02) state = static_cast<uint8_t>(state | bits);
+        else state = static_cast<uint8_t>(state & ~bits);
+        return RelayIoStatus::Ok;
+    }
+
+    RelayIoStatus GetFeature(unsigned char* report, size_t size) override {
+        memset(report, 0, size);
+        report[RELAY_STATE_OFFSET] = state;
+        return RelayIoStatus::Ok;
+    }
+
+    bool present = true;
+    int failAfter = -1;
+    int64_t writeUs = 1500;
+    uint8_t state = 0;
+    std::vector<int64_t> writeTimes;
+
+private:
+    FakeClock& m_clock;
+};
+
+std::vector<RelayStep> Parse(const std::string& spec) {
+    std::vector<RelayStep> steps;
+    std::string error;
+    REQUIRE(ParseRelaySequence(spec, steps, error));
+    return steps;
+}
+
+std::string ParseError(const std::string& spec) {
+    std::vector<RelayStep> steps;
+    std::string error;
+    CHECK_FALSE(ParseRelaySequence(spec, steps, error));
+    return error;
+}
+
+} // anonymous namespace
+
+TEST_CASE("ParseRelaySequence", "[relay]") {
+    SECTION("Steps and delays") {
+        auto steps = Parse("2:on 200 1:ON");
+        REQUIRE(steps.size() == 2);
+        CHECK(steps[0].channel == 2);
+        CHECK(steps[0].on);
+        CHECK(steps[0].delayMs == 0);
+        CHECK(steps[1].channel == 1);
+        CHECK(steps[1].delayMs == 200);
+
+        steps = Parse(" 50ms, all:off,100,25MS ,2:on");
+        REQUIRE(steps.size() == 2);
+        CHECK(steps[0].channel == 0);
+        CHECK_FALSE(steps[0].on);
+        CHECK(steps[0].delayMs == 50);
+        CHECK(steps[1].delayMs == 125);
+    }
+
+    SECTION("Errors") {
+        CHECK(ParseError("") == "Sequence has no steps");
+        CHECK(ParseError("1:on 200") == "Sequence ends with a delay");
+        CHECK(ParseError("3:on").find("Invalid relay") == 0);
+        CHECK(ParseError("1:toggle").find("Invalid state") == 0);
+        CHECK(ParseError("1:on -5 2:on").find("Invalid delay") == 0);
+        CHECK(ParseError("1:on 60001 2:on").find("Invalid delay") == 0);
+        CHECK(ParseError("1:on soon 2:on").find("Invalid delay") == 0);
+    }
+
+    SECTION("Format and reverse") {
+        auto steps = Parse("2:on 200 1:on 50 all:on");
+        CHECK(FormatRelaySequence(steps) == "2:on 200 1:on 50 all:on");
+        CHECK(FormatRelaySequence(ReverseRelaySequence(steps)) == "all:off 50 1:off 200 2:off");
+    }
+}
+
+TEST_CASE("RunRelaySequence", "[relay]") {
+    FakeClock clock;
+    auto* transport = new TimedRelay(clock);
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    SECTION("Steps follow an absolute schedule") {
+        auto steps = Parse("2:on 200 1:on 200 2:off");
+        int64_t start = clock.now;
+        RelaySequenceResult result = RunRelaySequence(relay, steps, clock);
+
+        REQUIRE(result.ok);
+        REQUIRE(result.steps.size() == 3);
+        REQUIRE(transport->writeTimes.size() == 3);
+        // Write latency does not push later steps back
+        CHECK(transport->writeTimes[1] - start == 200000);
+        CHECK(transport->writeTimes[2] - start == 400000);
+        CHECK(result.MaxErrorUs() == 0);
+        CHECK(result.steps[2].doneUs == 400000 + transport->writeUs);
+        CHECK(transport->state == 0x01);
+    }
+
+    SECTION("Late wakeups are reported") {
+        clock.oversleepUs = 700;
+        RelaySequenceResult result = RunRelaySequence(relay, Parse("1:on 10 2:on"), clock);
+        REQUIRE(result.ok);
+        CHECK(result.steps[0].ErrorUs() == 0);
+        CHECK(result.steps[1].ErrorUs() == 700);
+        CHECK(result.MaxErrorUs() == 700);
+    }
+
+    SECTION("Steps already in place are skipped") {
+        transport->state = 0x02;
+        RelaySequenceResult result = RunRelaySequence(relay, Parse("2:on 5 1:on"), clock);
+        REQUIRE(result.ok);
+        CHECK(result.steps[0].result == RelaySwitchResult::Skipped);
+        CHECK(transport->writeTimes.size() == 1);
+    }
+
+    SECTION("Stops at the first failure") {
+        transport->failAfter = 1;
+        RelaySequenceResult result = RunRelaySequence(relay, Parse("1:on 5 2:on 5 1:off"), clock);
+        CHECK_FALSE(result.ok);
+        REQUIRE(result.steps.size() == 2);
+        CHECK(result.steps[1].result == RelaySwitchResult::Failed);
+    }
+
+    SECTION("No relay") {
+        transport->present = false;
+        RelaySequenceResult result = RunRelaySequence(relay, Parse("1:on"), clock);
+        CHECK_FALSE(result.ok);
+        CHECK(result.steps.size() == 1);
+    }
+}
+
+TEST_CASE("SteadySequenceClock never wakes early", "[relay]") {
+    SteadySequenceClock clock;
+    int64_t deadline = clock.NowUs() + 3000;
+    clock.SleepUntilUs(deadline);
+    CHECK(clock.NowUs() >= deadline);
+}
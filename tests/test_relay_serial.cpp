@@ -0,0 +1,228 @@
+// Tests for the serial (LCUS) relay transport: fake port, and on POSIX a
+// pseudo-terminal with a thread playing the board
+
+#include "catch.hpp"
+#include "core/relay-serial.h"
+#include <deque>
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+typedef std::vector<unsigned char> Bytes;
+
+Bytes ToBytes(const LcusFrame& frame) {
+    return Bytes(frame.begin(), frame.end());
+}
+
+// In-memory port: records writes, answers from a queue
+class FakeSerialPort : public SerialPort {
+public:
+    bool Open(const std::string& name) override {
+        opens++;
+        openedName = name;
+        return present;
+    }
+
+    void Close() override { closes++; }
+
+    bool IsExclusive() const override { return exclusive; }
+
+    RelayIoStatus Write(const unsigned char* data, size_t size) override {
+        if (!present) return RelayIoStatus::Disconnected;
+        written.emplace_back(data, data + size);
+        if (echo) incoming.insert(incoming.end(), data, data + size);
+        else incoming.insert(incoming.end(), reply.begin(), reply.end());
+        return RelayIoStatus::Ok;
+    }
+
+    int Read(unsigned char* buffer, size_t size, uint32_t timeoutMs) override {
+        if (!present) return -1;
+        if (incoming.empty()) {
+            if (timeoutMs > 0) waits++;
+            return 0;
+        }
+        size_t count = 0;
+        while (count < size && !incoming.empty()) {
+            buffer[count++] = incoming.front();
+            incoming.pop_front();
+        }
+        return static_cast<int>(count);
+    }
+
+    bool present = true;
+    bool exclusive = false;
+    bool echo = false;
+    Bytes reply;                // Sent back after each write when not echoing
+    int opens = 0;
+    int closes = 0;
+    int waits = 0;
+    std::string openedName;
+    std::vector<Bytes> written;
+    std::deque<unsigned char> incoming;
+};
+
+} // anonymous namespace
+
+TEST_CASE("LCUS frames", "[serial]") {
+    CHECK(ToBytes(BuildLcusFrame(1, true)) == Bytes{0xA0, 0x01, 0x01, 0xA2});
+    CHECK(ToBytes(BuildLcusFrame(1, false)) == Bytes{0xA0, 0x01, 0x00, 0xA1});
+    CHECK(ToBytes(BuildLcusFrame(2, true)) == Bytes{0xA0, 0x02, 0x01, 0xA3});
+
+    unsigned char good[] = {0xA0, 0x02, 0x00, 0xA2};
+    unsigned char badSum[] = {0xA0, 0x02, 0x00, 0xA3};
+    CHECK(IsValidLcusFrame(good, 4));
+    CHECK_FALSE(IsValidLcusFrame(badSum, 4));
+    CHECK_FALSE(IsValidLcusFrame(good, 3));
+
+    std::vector<LcusFrame> frames;
+    unsigned char report[RELAY_REPORT_SIZE];
+    BuildRelayReport(0, true, report);
+    REQUIRE(LcusFramesForReport(report, sizeof(report), frames));
+    REQUIRE(frames.size() == static_cast<size_t>(RELAY_CHANNEL_COUNT));
+    CHECK(ToBytes(frames[1]) == Bytes{0xA0, 0x02, 0x01, 0xA3});
+
+    BuildRelayReport(2, false, report);
+    REQUIRE(LcusFramesForReport(report, sizeof(report), frames));
+    REQUIRE(frames.size() == 1);
+    CHECK(ToBytes(frames[0]) == Bytes{0xA0, 0x02, 0x00, 0xA2});
+
+    report[2] = 9;
+    CHECK_FALSE(LcusFramesForReport(report, sizeof(report), frames));
+}
+
+TEST_CASE("SerialRelayTransport", "[serial]") {
+    FakeSerialPort port;
+    auto* transport = new SerialRelayTransport(port, "COM3");
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    SECTION("Silent board: one probe, then writes only") {
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Unverified);
+        CHECK(transport->GetAckMode() == SerialRelayTransport::AckMode::Silent);
+        CHECK(port.waits == 1);
+        CHECK(port.openedName == "COM3");
+
+        CHECK(relay.Switch(2, false) == RelaySwitchResult::Skipped);  // Assumed state
+        CHECK(relay.Switch(2, true) == RelaySwitchResult::Unverified);
+        CHECK(port.waits == 1);
+        // Both on is the all-channels report, one frame per channel here
+        REQUIRE(port.written.size() == 3);
+        CHECK(port.written[2] == Bytes{0xA0, 0x02, 0x01, 0xA3});
+        CHECK(port.opens == 1);
+    }
+
+    SECTION("Acknowledging board") {
+        port.echo = true;
+        CHECK(relay.Switch(0, true) == RelaySwitchResult::Unverified);
+        CHECK(transport->GetAckMode() == SerialRelayTransport::AckMode::Acks);
+        CHECK(port.written.size() == static_cast<size_t>(RELAY_CHANNEL_COUNT));
+
+        // Stops answering: the switch fails instead of passing silently
+        port.echo = false;
+        CHECK(relay.Switch(1, false) == RelaySwitchResult::Failed);
+    }
+
+    SECTION("Stale bytes are not taken for an acknowledgement") {
+        port.incoming = {0xA0, 0x01, 0x00, 0xA1};
+        port.echo = true;
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Unverified);
+        CHECK(transport->GetAckMode() == SerialRelayTransport::AckMode::Acks);
+    }
+
+    SECTION("Wrong acknowledgement") {
+        port.reply = {0xA0, 0x01, 0x00, 0xA1};
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Failed);
+        port.reply = {0xA0, 0x01, 0x01};            // Truncated
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Failed);
+    }
+
+    SECTION("Exclusive port: released after each switch") {
+        port.exclusive = true;
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Unverified);
+        CHECK(relay.Switch(2, true) == RelaySwitchResult::Unverified);
+        CHECK_FALSE(relay.IsOpen());
+        CHECK(port.opens == 2);
+        CHECK(port.closes == 2);
+        CHECK(port.waits == 1);     // Ack mode is kept across opens
+    }
+
+    SECTION("Port gone") {
+        port.present = false;
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Failed);
+        CHECK_FALSE(relay.IsOpen());
+    }
+}
+
+#ifndef _WIN32
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+TEST_CASE("Serial relay on a pseudo-terminal", "[serial]") {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    REQUIRE(master >= 0);
+    REQUIRE(grantpt(master) == 0);
+    REQUIRE(unlockpt(master) == 0);
+    std::string slave = ptsname(master);
+
+    // The board: reads frames from the master side, optionally echoes them
+    std::vector<Bytes> received;
+    std::atomic<size_t> receivedCount(0);
+    bool acks = GENERATE(false, true);
+    std::atomic<bool> stop(false);
+    std::thread board([&] {
+        Bytes pending;
+        while (!stop) {
+            pollfd pfd = {master, POLLIN, 0};
+            if (poll(&pfd, 1, 10) <= 0) continue;
+            unsigned char buffer[16];
+            ssize_t count = read(master, buffer, sizeof(buffer));
+            if (count <= 0) continue;
+            pending.insert(pending.end(), buffer, buffer + count);
+            while (pending.size() >= LCUS_FRAME_SIZE) {
+                Bytes frame(pending.begin(), pending.begin() + LCUS_FRAME_SIZE);
+                pending.erase(pending.begin(), pending.begin() + LCUS_FRAME_SIZE);
+                received.push_back(frame);
+                receivedCount++;
+                if (acks) (void)!write(master, frame.data(), frame.size());
+            }
+        }
+    });
+
+    PosixSerialPort port;
+    auto* transport = new SerialRelayTransport(port, slave);
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    // First switch also finds out whether the board answers
+    REQUIRE(relay.Switch(1, true) == RelaySwitchResult::Unverified);
+
+    const int switches = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < switches; i++) {
+        REQUIRE(relay.Switch(2, i % 2 == 0) == RelaySwitchResult::Unverified);
+    }
+    double perSwitchMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count() / switches;
+
+    // Let the board drain the silent case before checking what it got
+    // Relay 2 on leaves both on: the all-channels report, two frames
+    const size_t frames = 1 + switches / 2 * 2 + switches / 2;
+    for (int i = 0; i < 100 && receivedCount < frames; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    stop = true;
+    board.join();
+    close(master);
+
+    INFO("acks " << acks << ": " << perSwitchMs << " ms per switch");
+    CHECK(transport->GetAckMode() == (acks ? SerialRelayTransport::AckMode::Acks
+                                           : SerialRelayTransport::AckMode::Silent));
+    REQUIRE(received.size() == frames);
+    CHECK(received[0] == Bytes{0xA0, 0x01, 0x01, 0xA2});
+    CHECK(received.back() == Bytes{0xA0, 0x02, 0x00, 0xA2});
+    // Neither mode waits out the ack timeout once the board is known
+    CHECK(perSwitchMs < LCUS_ACK_TIMEOUT_MS);
+}
+#endif
@@ -0,0 +1,418 @@
+// Tests for the persistent relay connection (fake transport)
+
+#include "catch.hpp"
+#include "core/relay-session.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+// Scriptable transport that records lifecycle calls
+class FakeRelayTransport : public RelayTransport {
+public:
+    int opens = 0;
+    int closes = 0;
+    int searches = 0;          // Opens that had to look for the device
+    int writes = 0;
+    bool present = true;
+    bool knowsDevice = false;
+    std::vector<RelayIoStatus> script;   // Status per write; Ok once exhausted
+    std::vector<std::vector<unsigned char>> reports;
+
+    bool Open() override {
+        opens++;
+        busy = busyOpens > 0;
+        if (busy) {
+            busyOpens--;
+            return false;
+        }
+        if (!knowsDevice) {
+            searches++;
+            knowsDevice = present;
+        }
+        return present;
+    }
+
+    void Close() override { closes++; }
+
+    void ForgetDevice() override { knowsDevice = false; }
+
+    RelayIoStatus SetFeature(const unsigned char* report, size_t size) override {
+        RelayIoStatus status = writes < static_cast<int>(script.size())
+            ? script[writes] : RelayIoStatus::Ok;
+        writes++;
+        if (status == RelayIoStatus::Ok) {
+            reports.emplace_back(report, report + size);
+            if (ignoredWrites > 0) {
+                ignoredWrites--;
+            } else if (size > 2) {
+                // DCT Tech commands: 0xFE/0xFC all on/off, 0xFF/0xFD one on/off
+                uint8_t bits = RelayChannelMask((report[1] & 0x01) ? report[2] : 0);
+                if (report[1] & 0x02) state = static_cast<uint8_t>(state | bits);
+                else state = static_cast<uint8_t>(state & ~bits);
+            }
+        }
+        return status;
+    }
+
+    RelayIoStatus GetFeature(unsigned char* report, size_t size) override {
+        reads++;
+        if (!readback) return RelayIoStatus::Failed;
+        memset(report, 0, size);
+        report[RELAY_STATE_OFFSET] = state;
+        return RelayIoStatus::Ok;
+    }
+
+    bool IsBusy() const override { return busy; }
+    bool IsExclusive() const override { return exclusive; }
+
+    int reads = 0;
+    int busyOpens = 0;          // Opens that find the device held elsewhere
+    bool busy = false;
+    bool exclusive = false;
+    bool readback = true;
+    int ignoredWrites = 0;      // Writes the relay acknowledges but does not act on
+    uint8_t state = 0;
+};
+
+const unsigned char REPORT[3] = {0, 0xFF, 1};
+
+} // anonymous namespace
+
+TEST_CASE("BuildRelayReport", "[relay]") {
+    unsigned char report[RELAY_REPORT_SIZE];
+
+    BuildRelayReport(0, true, report);
+    CHECK(report[0] == 0);
+    CHECK(report[1] == 0xFE);
+    CHECK(report[2] == 0);
+
+    BuildRelayReport(0, false, report);
+    CHECK(report[1] == 0xFC);
+
+    BuildRelayReport(2, true, report);
+    CHECK(report[1] == 0xFF);
+    CHECK(report[2] == 2);
+
+    BuildRelayReport(1, false, report);
+    CHECK(report[1] == 0xFD);
+    CHECK(report[2] == 1);
+    for (int i = 3; i < RELAY_REPORT_SIZE; i++) CHECK(report[i] == 0);
+}
+
+TEST_CASE("RelayConnection opens once and keeps the handle", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    CHECK_FALSE(relay.IsOpen());
+    for (int i = 0; i < 10; i++) REQUIRE(relay.SetFeature(REPORT, sizeof(REPORT)));
+
+    CHECK(relay.IsOpen());
+    CHECK(relay.OpenCount() == 1);
+    CHECK(transport->searches == 1);
+    CHECK(transport->writes == 10);
+    CHECK(transport->reports.back() == std::vector<unsigned char>(REPORT, REPORT + 3));
+}
+
+TEST_CASE("RelayConnection searches again after a stale handle", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    transport->script = {RelayIoStatus::Ok, RelayIoStatus::Disconnected, RelayIoStatus::Ok};
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    REQUIRE(relay.SetFeature(REPORT, sizeof(REPORT)));
+    REQUIRE(relay.SetFeature(REPORT, sizeof(REPORT)));   // Stale, then retried
+
+    CHECK(transport->writes == 3);
+    CHECK(transport->closes == 1);
+    CHECK(transport->searches == 2);
+    CHECK(relay.OpenCount() == 2);
+}
+
+TEST_CASE("RelayConnection gives up after one retry", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    transport->script = {RelayIoStatus::Disconnected, RelayIoStatus::Disconnected};
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    CHECK_FALSE(relay.SetFeature(REPORT, sizeof(REPORT)));
+    CHECK_FALSE(relay.IsOpen());
+    CHECK(transport->writes == 2);
+
+    CHECK(relay.SetFeature(REPORT, sizeof(REPORT)));
+}
+
+TEST_CASE("RelayConnection keeps the handle on device errors", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    transport->script = {RelayIoStatus::Failed};
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    CHECK_FALSE(relay.SetFeature(REPORT, sizeof(REPORT)));
+    CHECK(relay.IsOpen());
+    CHECK(transport->closes == 0);
+    CHECK(transport->writes == 1);
+}
+
+TEST_CASE("RelayConnection reports a missing relay", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    transport->present = false;
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    CHECK_FALSE(relay.SetFeature(REPORT, sizeof(REPORT)));
+    CHECK(transport->writes == 0);
+    CHECK(relay.OpenCount() == 0);
+
+    transport->present = true;   // Plugged in
+    CHECK(relay.SetFeature(REPORT, sizeof(REPORT)));
+}
+
+TEST_CASE("RelayConnection device removal", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    REQUIRE(relay.SetFeature(REPORT, sizeof(REPORT)));
+    relay.OnDeviceRemoved();
+    CHECK_FALSE(relay.IsOpen());
+    CHECK(transport->closes == 1);
+
+    REQUIRE(relay.SetFeature(REPORT, sizeof(REPORT)));
+    CHECK(transport->searches == 2);
+
+    // Reset keeps the known device
+    relay.Reset();
+    REQUIRE(relay.SetFeature(REPORT, sizeof(REPORT)));
+    CHECK(transport->searches == 2);
+    CHECK(relay.OpenCount() == 3);
+}
+
+TEST_CASE("ParseRelayArgs", "[relay]") {
+    auto parse = [](std::vector<const char*> args) {
+        return ParseRelayArgs(static_cast<int>(args.size()), const_cast<char**>(args.data()));
+    };
+
+    CHECK(parse({}).action == RelayAction::Usage);
+    CHECK(parse({"--help"}).action == RelayAction::Usage);
+
+    RelayArgs all = parse({"ON"});
+    CHECK(all.action == RelayAction::Switch);
+    CHECK(all.channel == 0);
+    CHECK(all.on);
+
+    RelayArgs one = parse({"2", "off"});
+    CHECK(one.action == RelayAction::Switch);
+    CHECK(one.channel == 2);
+    CHECK_FALSE(one.on);
+
+    CHECK(parse({"all", "on"}).channel == 0);
+
+    RelayArgs badCount = parse({"1", "on", "now"});
+    CHECK(badCount.action == RelayAction::Invalid);
+    CHECK(badCount.showUsage);
+
+    RelayArgs badRelay = parse({"3", "on"});
+    CHECK(badRelay.action == RelayAction::Invalid);
+    CHECK(badRelay.error == "Invalid relay '3' (use 1, 2, or all)");
+    CHECK_FALSE(badRelay.showUsage);
+
+    CHECK(parse({"1", "maybe"}).error == "Invalid state 'maybe' (use on or off)");
+    CHECK(parse({"toggle"}).action == RelayAction::Invalid);
+
+    RelayArgs status = parse({"status"});
+    CHECK(status.action == RelayAction::Status);
+    CHECK_FALSE(status.fresh);
+    CHECK(parse({"STATUS", "--fresh"}).fresh);
+    CHECK(parse({"status", "now"}).action == RelayAction::Invalid);
+
+    RelayArgs sequence = parse({"sequence", "2:on", "200", "1:on"});
+    CHECK(sequence.action == RelayAction::Sequence);
+    CHECK(sequence.sequence == "2:on 200 1:on");
+    CHECK(parse({"sequence"}).action == RelayAction::Invalid);
+}
+
+TEST_CASE("ParseRelayStateReport", "[relay]") {
+    unsigned char report[RELAY_REPORT_SIZE] = {0, 'A', 'B', 'C', 'D', 'E', 0, 0, 0xFE};
+    uint8_t mask = 0;
+    REQUIRE(ParseRelayStateReport(report, sizeof(report), mask));
+    CHECK(mask == 0x02);
+    CHECK_FALSE(ParseRelayStateReport(report, RELAY_STATE_OFFSET, mask));
+
+    CHECK(RelayChannelMask(0) == 0x03);
+    CHECK(RelayChannelMask(1) == 0x01);
+    CHECK(RelayChannelMask(2) == 0x02);
+}
+
+TEST_CASE("RelayConnection Switch", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    SECTION("Verified switch, then redundant ones are skipped") {
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Switched);
+        CHECK(transport->writes == 1);
+        CHECK(transport->state == 0x01);
+
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Skipped);
+        CHECK(relay.Switch(0, false) == RelaySwitchResult::Switched);
+        CHECK(relay.Switch(2, false) == RelaySwitchResult::Skipped);
+        CHECK(transport->writes == 2);
+    }
+
+    SECTION("Already in the requested state on first use") {
+        transport->state = 0x03;
+        CHECK(relay.Switch(0, true) == RelaySwitchResult::Skipped);
+        CHECK(transport->writes == 0);
+        CHECK(transport->reads == 1);
+    }
+
+    SECTION("Readback mismatch is retried") {
+        transport->ignoredWrites = 1;
+        CHECK(relay.Switch(2, true) == RelaySwitchResult::Switched);
+        CHECK(transport->writes == 2);
+    }
+
+    SECTION("Bounded retries") {
+        transport->ignoredWrites = RELAY_WRITE_ATTEMPTS;
+        CHECK(relay.Switch(2, true) == RelaySwitchResult::Failed);
+        CHECK(transport->writes == RELAY_WRITE_ATTEMPTS);
+    }
+
+    SECTION("No readback") {
+        transport->readback = false;
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Unverified);
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Skipped);   // From the assumed state
+        CHECK(transport->writes == 1);
+    }
+
+    SECTION("Several channels at once") {
+        transport->state = 0x01;
+        CHECK(relay.SwitchChannels(0x03, true) == RelaySwitchResult::Switched);
+        CHECK(transport->writes == 1);
+        CHECK(transport->reports.back()[1] == 0xFE);
+        CHECK(relay.SwitchChannels(0x02, false) == RelaySwitchResult::Switched);
+        CHECK(transport->reports.back()[1] == 0xFD);
+        CHECK(transport->state == 0x01);
+    }
+
+    SECTION("Unreachable") {
+        transport->present = false;
+        CHECK(relay.Switch(1, true) == RelaySwitchResult::Failed);
+        CHECK_FALSE(SwitchRelay(relay, 1, true));
+    }
+}
+
+TEST_CASE("RelayConnection GetState", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    transport->state = 0x02;
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    uint8_t mask = 0;
+    REQUIRE(relay.GetState(mask));
+    CHECK(mask == 0x02);
+    CHECK(transport->reads == 1);
+
+    // Cached until asked for a fresh read
+    transport->state = 0x00;
+    REQUIRE(relay.GetState(mask));
+    CHECK(mask == 0x02);
+    REQUIRE(relay.GetState(mask, true));
+    CHECK(mask == 0x00);
+    CHECK(transport->reads == 2);
+
+    // Raw writes and removal drop the cache
+    unsigned char report[RELAY_REPORT_SIZE];
+    BuildRelayReport(0, true, report);
+    REQUIRE(relay.SetFeature(report, RELAY_REPORT_SIZE));
+    REQUIRE(relay.GetState(mask));
+    CHECK(mask == 0x03);
+    relay.OnDeviceRemoved();
+    REQUIRE(relay.GetState(mask));
+    CHECK(transport->reads == 4);
+}
+
+TEST_CASE("RelayConnection GetState re-reads state older than the trust window", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    transport->state = 0x02;
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport), 50};
+
+    uint8_t mask = 0;
+    REQUIRE(relay.GetState(mask));
+    CHECK(transport->reads == 1);
+
+    // Another process switches the relay: seen once the cache has aged out
+    transport->state = 0x00;
+    REQUIRE(relay.GetState(mask));
+    CHECK(mask == 0x02);
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    REQUIRE(relay.GetState(mask));
+    CHECK(mask == 0x00);
+    CHECK(transport->reads == 2);
+
+    // A switch refreshes the cache as well
+    REQUIRE(relay.Switch(1, true) == RelaySwitchResult::Switched);
+    int reads = transport->reads;
+    REQUIRE(relay.GetState(mask));
+    CHECK(mask == 0x01);
+    CHECK(transport->reads == reads);
+}
+
+TEST_CASE("RelayConnection reports why it failed", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    transport->present = false;
+    CHECK(relay.Switch(1, true) == RelaySwitchResult::Failed);
+    CHECK(relay.LastError() == RelayError::NotFound);
+    CHECK(transport->opens == 1);
+
+    // Held by another process for good: retried, then reported as busy
+    transport->present = true;
+    transport->busyOpens = RELAY_BUSY_ATTEMPTS;
+    CHECK(relay.Switch(1, true) == RelaySwitchResult::Failed);
+    CHECK(relay.LastError() == RelayError::Busy);
+    CHECK(transport->opens == 1 + RELAY_BUSY_ATTEMPTS);
+
+    // Released after a moment: the switch goes through
+    transport->busyOpens = 2;
+    CHECK(relay.Switch(1, true) == RelaySwitchResult::Switched);
+
+    // Rejected on every attempt
+    transport->script = {RelayIoStatus::Failed, RelayIoStatus::Failed, RelayIoStatus::Failed};
+    transport->writes = 0;
+    CHECK(relay.Switch(1, false) == RelaySwitchResult::Failed);
+    CHECK(relay.LastError() == RelayError::Failed);
+    CHECK(transport->writes == RELAY_WRITE_ATTEMPTS);
+}
+
+TEST_CASE("RelayConnection retries a rejected write on the same handle", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    transport->script = {RelayIoStatus::Failed};
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    CHECK(relay.Switch(1, true) == RelaySwitchResult::Switched);
+    CHECK(transport->state == 0x01);
+    CHECK(transport->writes == 2);
+    CHECK(transport->opens == 1);
+    CHECK(transport->searches == 1);
+    CHECK(transport->closes == 0);
+}
+
+TEST_CASE("RelayConnection closes exclusive devices between calls", "[relay]") {
+    auto* transport = new FakeRelayTransport();
+    transport->exclusive = true;
+    RelayConnection relay{std::unique_ptr<RelayTransport>(transport)};
+
+    CHECK(relay.Switch(1, true) == RelaySwitchResult::Switched);
+    CHECK_FALSE(relay.IsOpen());
+    CHECK(transport->closes == 1);
+
+    // The cached state survives the close, so this needs no open at all
+    CHECK(relay.Switch(1, true) == RelaySwitchResult::Skipped);
+    CHECK(transport->opens == 1);
+
+    CHECK(relay.Switch(2, true) == RelaySwitchResult::Switched);
+    CHECK(transport->opens == 2);
+    CHECK(transport->closes == 2);
+    CHECK(transport->searches == 1);
+}
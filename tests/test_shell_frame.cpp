@@ -0,0 +1,145 @@
+// Tests for shell coprocess framing
+
+#include "catch.hpp"
+#include "core/shell-frame.h"
+#include <cstdio>
+
+using namespace hdd::core;
+
+namespace {
+
+const char* const MARKER = "__HDD_FRAME_test_";
+
+void FeedString(ShellFrameParser& parser, const std::string& text) {
+    parser.Feed(text.data(), text.size());
+}
+
+} // anonymous namespace
+
+TEST_CASE("EncodeBase64", "[shell]") {
+    CHECK(EncodeBase64("") == "");
+    CHECK(EncodeBase64("f") == "Zg==");
+    CHECK(EncodeBase64("fo") == "Zm8=");
+    CHECK(EncodeBase64("foo") == "Zm9v");
+    CHECK(EncodeBase64("foobar") == "Zm9vYmFy");
+    CHECK(EncodeBase64(std::string("\xff\x00\x80", 3)) == "/wCA");
+}
+
+TEST_CASE("BuildShellFrame", "[shell]") {
+    SECTION("PowerShell encodes the command") {
+        std::string frame = BuildShellFrame(ShellDialect::PowerShell, MARKER, 7, "Write-Output 'a'");
+        CHECK(frame.find(EncodeBase64("Write-Output 'a'")) != std::string::npos);
+        CHECK(frame.find("Write-Output") == std::string::npos);
+        CHECK(frame.find(std::string(MARKER) + "7 $hddCode") != std::string::npos);
+        CHECK(frame.back() == '\n');
+        CHECK(frame.find('\n') == frame.size() - 1);
+    }
+
+    SECTION("Posix quotes single quotes") {
+        std::string frame = BuildShellFrame(ShellDialect::Posix, MARKER, 3, "echo 'x'");
+        CHECK(frame.find("eval 'echo '\\''x'\\'''") != std::string::npos);
+        CHECK(frame.find(std::string(MARKER) + "3") != std::string::npos);
+    }
+}
+
+TEST_CASE("ShellFrameParser splits frames", "[shell]") {
+    ShellFrameParser parser(MARKER);
+    ShellFrame frame;
+
+    SECTION("Output with and without a trailing newline") {
+        FeedString(parser, "hello\n\n__HDD_FRAME_test_1 0\nno newline\n__HDD_FRAME_test_2 3\n");
+
+        REQUIRE(parser.Next(frame));
+        CHECK(frame.seq == 1);
+        CHECK(frame.exitCode == 0);
+        CHECK(frame.output == "hello\n");
+
+        REQUIRE(parser.Next(frame));
+        CHECK(frame.seq == 2);
+        CHECK(frame.exitCode == 3);
+        CHECK(frame.output == "no newline");
+
+        CHECK_FALSE(parser.Next(frame));
+        CHECK(parser.PendingSize() == 0);
+    }
+
+    SECTION("Empty output and CRLF line endings") {
+        FeedString(parser, "\r\n__HDD_FRAME_test_5 -1\r\nline\r\n\r\n__HDD_FRAME_test_6 0\r\n");
+
+        REQUIRE(parser.Next(frame));
+        CHECK(frame.exitCode == -1);
+        CHECK(frame.output.empty());
+
+        REQUIRE(parser.Next(frame));
+        CHECK(frame.output == "line\r\n");
+    }
+
+    SECTION("Chunks split anywhere") {
+        std::string stream = "a\nb\n__HDD_FRAME_test_9 42\n";
+        for (char c : stream) {
+            CHECK_FALSE(parser.Next(frame));
+            parser.Feed(&c, 1);
+        }
+        REQUIRE(parser.Next(frame));
+        CHECK(frame.seq == 9);
+        CHECK(frame.exitCode == 42);
+        CHECK(frame.output == "a\nb");
+    }
+
+    SECTION("Marker text that is not a marker line") {
+        FeedString(parser, "x __HDD_FRAME_test_1 0\n__HDD_FRAME_test_ 0\n__HDD_FRAME_test_1 0 extra\n");
+        CHECK_FALSE(parser.Next(frame));
+
+        FeedString(parser, "\n__HDD_FRAME_test_1 0\n");
+        REQUIRE(parser.Next(frame));
+        CHECK(frame.output == "x __HDD_FRAME_test_1 0\n__HDD_FRAME_test_ 0\n__HDD_FRAME_test_1 0 extra\n");
+    }
+
+    SECTION("Reset drops partial output") {
+        FeedString(parser, "partial");
+        parser.Reset();
+        FeedString(parser, "ok\n__HDD_FRAME_test_1 0\n");
+        REQUIRE(parser.Next(frame));
+        CHECK(frame.output == "ok");
+    }
+}
+
+#ifndef _WIN32
+// Round trip through a real /bin/sh: several frames on one interpreter
+TEST_CASE("Posix frames round-trip through /bin/sh", "[shell]") {
+    const char* commands[] = {"echo hello", "printf 'no newline'", "echo err >&2; exit 7", "echo 'it'\\''s'"};
+
+    std::string script;
+    for (uint32_t i = 0; i < 4; i++) {
+        script += BuildShellFrame(ShellDialect::Posix, MARKER, i + 1, commands[i]);
+    }
+
+    std::string command = "/bin/sh -c '";
+    for (char c : script) {
+        if (c == '\'') command += "'\\''";
+        else command += c;
+    }
+    command += "'";
+
+    FILE* pipe = popen(command.c_str(), "r");
+    REQUIRE(pipe != nullptr);
+    ShellFrameParser parser(MARKER);
+    char buffer[256];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) parser.Feed(buffer, n);
+    pclose(pipe);
+
+    ShellFrame frame;
+    REQUIRE(parser.Next(frame));
+    CHECK(frame.output == "hello\n");
+    REQUIRE(parser.Next(frame));
+    CHECK(frame.output == "no newline");
+    REQUIRE(parser.Next(frame));
+    CHECK(frame.exitCode == 7);
+    CHECK(frame.output == "err\n");
+    REQUIRE(parser.Next(frame));
+    CHECK(frame.seq == 4);
+    CHECK(frame.exitCode == 0);
+    CHECK(frame.output == "it's\n");
+}
+#endif
@@ -0,0 +1,172 @@
+// Tests for the Linux storage queries: the mountinfo parser, and on Linux a
+// fixture /sys and /proc tree
+
+#include "catch.hpp"
+#include "core/storage-linux.h"
+#include <string>
+
+using namespace hdd;
+using namespace hdd::core;
+
+TEST_CASE("ParseMountinfoLine", "[storage-linux]") {
+    MountinfoEntry entry;
+
+    SECTION("With optional fields") {
+        REQUIRE(ParseMountinfoLine("36 25 8:17 / /mnt/backup rw,noatime shared:1 master:2 - ext4 /dev/sdb1 rw",
+                                   entry));
+        CHECK(entry.major == 8);
+        CHECK(entry.minor == 17);
+        CHECK(entry.root == "/");
+        CHECK(entry.mountPoint == "/mnt/backup");
+        CHECK(entry.source == "/dev/sdb1");
+    }
+
+    SECTION("Without optional fields") {
+        REQUIRE(ParseMountinfoLine("41 25 259:3 / /home rw,relatime - xfs /dev/nvme0n1p3 rw", entry));
+        CHECK(entry.major == 259);
+        CHECK(entry.minor == 3);
+        CHECK(entry.source == "/dev/nvme0n1p3");
+    }
+
+    SECTION("Escaped mount point and bind mount root") {
+        REQUIRE(ParseMountinfoLine("52 36 8:17 /photos /srv/My\\040Photos rw - ext4 /dev/sdb1 rw", entry));
+        CHECK(entry.root == "/photos");
+        CHECK(entry.mountPoint == "/srv/My Photos");
+    }
+
+    SECTION("Malformed") {
+        CHECK_FALSE(ParseMountinfoLine("", entry));
+        CHECK_FALSE(ParseMountinfoLine("36 25 8:17 / /mnt/backup rw shared:1", entry));
+        CHECK_FALSE(ParseMountinfoLine("36 25 8:17 / /mnt/backup rw -", entry));
+        CHECK_FALSE(ParseMountinfoLine("36 25 817 / /mnt/backup rw - ext4 /dev/sdb1 rw", entry));
+        CHECK_FALSE(ParseMountinfoLine("36 25 8:17x / /mnt/backup rw - ext4 /dev/sdb1 rw", entry));
+    }
+}
+
+TEST_CASE("UnescapeMountPath", "[storage-linux]") {
+    CHECK(UnescapeMountPath("/mnt/a\\011b") == "/mnt/a\tb");
+    CHECK(UnescapeMountPath("/mnt/back\\134slash") == "/mnt/back\\slash");
+    CHECK(UnescapeMountPath("/mnt/plain") == "/mnt/plain");
+
+    // Not an escape: too short or not octal
+    CHECK(UnescapeMountPath("/mnt/a\\04") == "/mnt/a\\04");
+    CHECK(UnescapeMountPath("/mnt/a\\089") == "/mnt/a\\089");
+}
+
+#ifdef __linux__
+#include "fake-tree.h"
+#include <vector>
+
+namespace {
+
+// Temporary sys/ and proc/ tree, removed afterwards
+class FakeSysProc : public hdd::test::FakeTree {
+public:
+    FakeSysProc() : FakeTree("storage") {
+        for (const char* dir : {"/sys/block", "/sys/class/scsi_host", "/proc/self", "/by-id"}) MakeDir(dir);
+    }
+};
+
+// sdb with two partitions, the first mounted twice plus a bind mount, and
+// one SCSI host
+void BuildTree(FakeSysProc& tree) {
+    tree.MakeDir("/sys/block/sdb");
+    tree.MakeDir("/sys/block/sdb/device");
+    tree.MakeDir("/sys/block/sdb/queue");
+    tree.WriteFile("/sys/block/sdb/dev", "8:16\n");
+    tree.WriteFile("/sys/block/sdb/device/model", "ST4000DM004-2CV1\n");
+    tree.WriteFile("/sys/block/sdb/device/serial", "ZFN0A1B2\n");
+    tree.WriteFile("/sys/block/sdb/device/state", "running\n");
+    for (int i = 1; i <= 2; i++) {
+        std::string partition = "/sys/block/sdb/sdb" + std::to_string(i);
+        tree.MakeDir(partition);
+        tree.WriteFile(partition + "/dev", "8:" + std::to_string(16 + i) + "\n");
+        tree.WriteFile(partition + "/partition", std::to_string(i) + "\n");
+    }
+
+    tree.WriteFile("/proc/self/mountinfo",
+                   "22 1 259:2 / / rw,relatime shared:1 - ext4 /dev/nvme0n1p2 rw\n"
+                   "36 22 8:17 / /mnt/backup rw,noatime shared:5 - ext4 /dev/sdb1 rw\n"
+                   "37 22 8:17 / /srv/backup rw,noatime shared:5 - ext4 /dev/sdb1 rw\n"
+                   "38 22 8:17 /photos /home/me/photos rw,noatime shared:5 - ext4 /dev/sdb1 rw\n");
+    tree.WriteFile("/proc/diskstats",
+                   " 259       0 nvme0n1 100 0 800 10 200 0 1600 20 0 30 30 0 0 0 0\n"
+                   "   8      16 sdb 4711 0 9000 50 815 0 7000 40 0 90 90 0 0 0 0\n");
+
+    tree.MakeDir("/sys/class/scsi_host/host0");
+    tree.WriteFile("/sys/class/scsi_host/host0/scan", "");
+}
+
+} // anonymous namespace
+
+TEST_CASE("SysfsStorage on a fixture tree", "[storage-linux]") {
+    FakeSysProc tree;
+    BuildTree(tree);
+    SysfsStorage storage(tree.root + "/sys", tree.root + "/proc", tree.root + "/by-id");
+
+    SECTION("Finds the target disk by serial") {
+        DiskRecord disk;
+        REQUIRE(storage.FindTargetDisk("zfn0a1b2", "", disk));
+        CHECK(disk.device == "sdb");
+        CHECK(disk.model == "ST4000DM004-2CV1");
+        CHECK_FALSE(storage.FindTargetDisk("NOSUCHSERIAL", "", disk));
+    }
+
+    SECTION("Partitions with their mount points, bind mounts skipped") {
+        std::vector<VolumeMount> volumes = storage.ResolveDiskVolumes("sdb");
+        REQUIRE(volumes.size() == 2);
+        CHECK(volumes[0].volumeName == "/dev/sdb1");
+        CHECK(volumes[0].partitionNumber == 1);
+        CHECK(volumes[0].mountPoints == std::vector<std::string>{"/mnt/backup", "/srv/backup"});
+        CHECK(volumes[1].volumeName == "/dev/sdb2");
+        CHECK(volumes[1].partitionNumber == 2);
+        CHECK(volumes[1].mountPoints.empty());
+
+        CHECK(storage.ResolveDiskVolumes("sdz").empty());
+    }
+
+    SECTION("Online state and taking the disk offline") {
+        CHECK(storage.IsDiskOnline("sdb"));
+        CHECK_FALSE(storage.IsDiskOnline("sdz"));
+
+        REQUIRE(storage.SetDiskOffline("sdb", true));
+        CHECK(tree.ReadFile("/sys/block/sdb/device/state") == "offline");
+        CHECK_FALSE(storage.IsDiskOnline("sdb"));
+
+        REQUIRE(storage.SetDiskOffline("sdb", false));
+        CHECK(storage.IsDiskOnline("sdb"));
+        CHECK_FALSE(storage.SetDiskOffline("sdz", true));
+    }
+
+    SECTION("I/O counters") {
+        DiskIoCounters counters;
+        REQUIRE(storage.ReadDiskIoCounters("sdb", counters));
+        CHECK(counters.reads == 4711);
+        CHECK(counters.writes == 815);
+        CHECK_FALSE(storage.ReadDiskIoCounters("sdz", counters));
+    }
+
+    SECTION("Rescan asks every SCSI host") {
+        CHECK(storage.RescanDevices() == 1);
+        CHECK(tree.ReadFile("/sys/class/scsi_host/host0/scan") == "- - -");
+    }
+}
+
+TEST_CASE("SysfsStorage with a whole-disk filesystem", "[storage-linux]") {
+    FakeSysProc tree;
+    tree.MakeDir("/sys/block/sdc");
+    tree.WriteFile("/sys/block/sdc/dev", "8:32\n");
+    tree.WriteFile("/proc/self/mountinfo", "40 22 8:32 / /mnt/raw rw - ext4 /dev/sdc rw\n");
+
+    SysfsStorage storage(tree.root + "/sys", tree.root + "/proc", tree.root + "/by-id");
+    std::vector<VolumeMount> volumes = storage.ResolveDiskVolumes("sdc");
+    REQUIRE(volumes.size() == 1);
+    CHECK(volumes[0].volumeName == "/dev/sdc");
+    CHECK(volumes[0].partitionNumber == 0);
+    CHECK(volumes[0].mountPoints == std::vector<std::string>{"/mnt/raw"});
+
+    // No state file: online while the block directory exists
+    CHECK(storage.IsDiskOnline("sdc"));
+}
+
+#endif // __linux__
@@ -158,6 +158,17 @@ TEST_CASE("ToUpper", "[string]") {
     CHECK(ToUpper("") == "");
 }
 
+TEST_CASE("HashFnv1a", "[string][hash]") {
+    // Reference values for 64-bit FNV-1a
+    CHECK(HashFnv1a(std::string("")) == 14695981039346656037ULL);
+    CHECK(HashFnv1a(std::string("a")) == 0xaf63dc4c8601ec8cULL);
+
+    SECTION("Chaining equals hashing the concatenation") {
+        CHECK(HashFnv1a(std::string("bar"), HashFnv1a(std::string("foo"))) ==
+              HashFnv1a(std::string("foobar")));
+    }
+}
+
 //=============================================================================
 // Drive State Tests
 //=============================================================================
@@ -310,6 +321,58 @@ TEST_CASE("ShouldPeriodicCheck", "[timing]") {
     }
 }
 
+TEST_CASE("Deadline helpers", "[timing][deadline]") {
+    SECTION("DeadlineAfter") {
+        CHECK(DeadlineAfter(1000, 500) == 1500);
+        CHECK(DeadlineAfter(1000, 0) == 1000);
+        CHECK(DeadlineAfter(1000, WAIT_NO_TIMEOUT) == NO_DEADLINE);
+    }
+
+    SECTION("RemainingWaitMs") {
+        CHECK(RemainingWaitMs(1500, 1000) == 500);
+        CHECK(RemainingWaitMs(1500, 1500) == 0);
+        CHECK(RemainingWaitMs(1500, 9000) == 0);
+        CHECK(RemainingWaitMs(NO_DEADLINE, 1000) == WAIT_NO_TIMEOUT);
+
+        // A finite deadline never turns into "wait forever"
+        CHECK(RemainingWaitMs(0x1FFFFFFFFULL, 0) == WAIT_NO_TIMEOUT - 1);
+    }
+
+    SECTION("StepTimeoutMs") {
+        CHECK(StepTimeoutMs(20000, 1000 + 60000, 1000) == 20000);
+        CHECK(StepTimeoutMs(20000, 1000 + 5000, 1000) == 5000);
+        CHECK(StepTimeoutMs(20000, 1000, 2000) == 0);
+        CHECK(StepTimeoutMs(20000, NO_DEADLINE, 1000) == 20000);
+        CHECK(StepTimeoutMs(WAIT_NO_TIMEOUT, NO_DEADLINE, 1000) == WAIT_NO_TIMEOUT);
+    }
+}
+
+TEST_CASE("SummarizeLatencies", "[timing][bench]") {
+    SECTION("Empty input") {
+        LatencySummary summary = SummarizeLatencies({});
+        CHECK(summary.count == 0);
+        CHECK(summary.min == 0.0);
+        CHECK(summary.median == 0.0);
+        CHECK(summary.mean == 0.0);
+        CHECK(summary.max == 0.0);
+    }
+
+    SECTION("Odd count uses middle sample") {
+        LatencySummary summary = SummarizeLatencies({5.0, 1.0, 3.0});
+        CHECK(summary.count == 3);
+        CHECK(summary.min == 1.0);
+        CHECK(summary.median == 3.0);
+        CHECK(summary.mean == Approx(3.0));
+        CHECK(summary.max == 5.0);
+    }
+
+    SECTION("Even count averages middle samples") {
+        LatencySummary summary = SummarizeLatencies({4.0, 1.0, 2.0, 10.0});
+        CHECK(summary.median == 3.0);
+        CHECK(summary.mean == Approx(4.25));
+    }
+}
+
 //=============================================================================
 // Configuration Tests
 //=============================================================================
@@ -325,6 +388,11 @@ TEST_CASE("Config has sensible defaults", "[config]") {
     CHECK(config.postOperationCheckSeconds == 3);
     CHECK(config.showNotifications == true);
     CHECK(config.debugMode == false);
+    CHECK(config.detectionBackend == "native");
+    CHECK(config.drives.empty());
+    CHECK(config.power.inrushBudget == 2);
+    CHECK(config.power.spinUpMs == 6000);
+    CHECK(config.power.staggerMs == 1000);
 }
 
 TEST_CASE("Config can be modified", "[config]") {
@@ -378,6 +446,206 @@ TEST_CASE("SerialMatches", "[config]") {
     }
 }
 
+TEST_CASE("NormalizeSerial", "[config]") {
+    CHECK(NormalizeSerial("  2vh7tm9l ") == "2VH7TM9L");
+    CHECK(NormalizeSerial("ABC") == "ABC");
+    CHECK(NormalizeSerial("   ").empty());
+}
+
+TEST_CASE("ParseDriveSectionIndex", "[config]") {
+    CHECK(ParseDriveSectionIndex("Drive.1") == 1);
+    CHECK(ParseDriveSectionIndex("drive.12") == 12);
+    CHECK(ParseDriveSectionIndex("DRIVE.0") == 0);
+
+    CHECK(ParseDriveSectionIndex("Drive") == -1);
+    CHECK(ParseDriveSectionIndex("Drive.") == -1);
+    CHECK(ParseDriveSectionIndex("Drive.x") == -1);
+    CHECK(ParseDriveSectionIndex("Drive.1a") == -1);
+    CHECK(ParseDriveSectionIndex("Drives.1") == -1);
+    CHECK(ParseDriveSectionIndex("Drive.123456") == -1);
+}
+
+TEST_CASE("SelectDriveSections", "[config]") {
+    std::vector<std::string> sections = {"Drive", "Drive.10", "Timing", "Drive.2", "drive.1", "UI"};
+    std::vector<std::string> drives = SelectDriveSections(sections);
+
+    REQUIRE(drives.size() == 3);
+    CHECK(drives[0] == "drive.1");
+    CHECK(drives[1] == "Drive.2");
+    CHECK(drives[2] == "Drive.10");
+
+    CHECK(SelectDriveSections({"Drive", "Timing"}).empty());
+}
+
+TEST_CASE("SplitMultiString", "[config]") {
+    const char list[] = "Drive\0Drive.1\0Timing\0";   // Literal adds the final NUL
+    std::vector<std::string> entries = SplitMultiString(list, sizeof(list));
+
+    REQUIRE(entries.size() == 3);
+    CHECK(entries[0] == "Drive");
+    CHECK(entries[1] == "Drive.1");
+    CHECK(entries[2] == "Timing");
+
+    const char empty[] = "";
+    CHECK(SplitMultiString(empty, sizeof(empty)).empty());
+
+    SECTION("Stops at the buffer size without a terminator") {
+        const char truncated[] = {'a', 'b', '\0', 'c', 'd'};
+        std::vector<std::string> parts = SplitMultiString(truncated, sizeof(truncated));
+        REQUIRE(parts.size() == 2);
+        CHECK(parts[1] == "cd");
+    }
+}
+
+//=============================================================================
+// Disk Identification Tests
+//=============================================================================
+
+TEST_CASE("ParsePhysicalDriveNumber", "[disk]") {
+    CHECK(ParsePhysicalDriveNumber("PhysicalDrive0") == 0);
+    CHECK(ParsePhysicalDriveNumber("PhysicalDrive3") == 3);
+    CHECK(ParsePhysicalDriveNumber("PhysicalDrive12") == 12);
+
+    CHECK(ParsePhysicalDriveNumber("PhysicalDrive") == -1);
+    CHECK(ParsePhysicalDriveNumber("PhysicalDrive1a") == -1);
+    CHECK(ParsePhysicalDriveNumber("CdRom0") == -1);
+    CHECK(ParsePhysicalDriveNumber("Harddisk0Partition1") == -1);
+    CHECK(ParsePhysicalDriveNumber("") == -1);
+    CHECK(ParsePhysicalDriveNumber(nullptr) == -1);
+}
+
+TEST_CASE("ReadDescriptorString", "[disk]") {
+    // Header bytes followed by space-padded, NUL-terminated fields
+    unsigned char buffer[40] = {0};
+    memcpy(buffer + 8, "WDC     ", 9);
+    memcpy(buffer + 20, "  2VH7TM9L  ", 13);
+
+    SECTION("Reads and trims fields") {
+        CHECK(ReadDescriptorString(buffer, sizeof(buffer), 8) == "WDC");
+        CHECK(ReadDescriptorString(buffer, sizeof(buffer), 20) == "2VH7TM9L");
+    }
+
+    SECTION("Offset zero means absent") {
+        CHECK(ReadDescriptorString(buffer, sizeof(buffer), 0) == "");
+    }
+
+    SECTION("Out of range offsets") {
+        CHECK(ReadDescriptorString(buffer, sizeof(buffer), 40) == "");
+        CHECK(ReadDescriptorString(buffer, sizeof(buffer), 1000) == "");
+        CHECK(ReadDescriptorString(nullptr, 0, 8) == "");
+    }
+
+    SECTION("Unterminated field stops at buffer end") {
+        unsigned char tail[12] = {0};
+        memcpy(tail + 8, "ABCD", 4);
+        CHECK(ReadDescriptorString(tail, sizeof(tail), 8) == "ABCD");
+    }
+}
+
+TEST_CASE("DecodeStorageSerial", "[disk]") {
+    // The 20-byte ATA serial field, right-aligned, as hex digits
+    auto ataField = [](const std::string& serial) { return std::string(20 - serial.size(), ' ') + serial; };
+    auto hex = [](const std::string& text) {
+        static const char digits[] = "0123456789ABCDEF";
+        std::string out;
+        for (unsigned char c : text) {
+            out += digits[c >> 4];
+            out += digits[c & 0x0F];
+        }
+        return out;
+    };
+
+    SECTION("Plain serials are unchanged") {
+        for (SerialBus bus : {SerialBus::Unknown, SerialBus::Ata, SerialBus::Other}) {
+            CHECK(DecodeStorageSerial("2VH7TM9L", bus) == "2VH7TM9L");
+            CHECK(DecodeStorageSerial("  WD-WCC4E1234567 ", bus) == "WD-WCC4E1234567");
+        }
+    }
+
+    SECTION("Hex-encoded ASCII from an ATA disk is decoded") {
+        // "2VH7TM9L" as hex
+        CHECK(DecodeStorageSerial("32564837544D394C", SerialBus::Ata) == "2VH7TM9L");
+        // Space padding inside the encoding is trimmed
+        CHECK(DecodeStorageSerial("202032564837544D394C20", SerialBus::Ata) == "2VH7TM9L");
+    }
+
+    SECTION("The full 40-digit ATA field is decoded whatever the bus") {
+        CHECK(DecodeStorageSerial(hex(ataField("2VH7TM9L")), SerialBus::Unknown) == "2VH7TM9L");
+        CHECK(DecodeStorageSerial(hex(ataField("WD-WCC4E1234567")), SerialBus::Other) == "WD-WCC4E1234567");
+    }
+
+    SECTION("A genuine all-hex serial is kept off the ATA bus") {
+        // NVMe and USB bridge serials can be hex digits that happen to decode
+        CHECK(DecodeStorageSerial("32564837544D394C", SerialBus::Other) == "32564837544D394C");
+        CHECK(DecodeStorageSerial("32564837544D394C", SerialBus::Unknown) == "32564837544D394C");
+        CHECK(DecodeStorageSerial("3234353637383930", SerialBus::Other) == "3234353637383930");
+        CHECK(DecodeStorageSerial("5000CCA264C1A2B3", SerialBus::Ata) == "5000CCA264C1A2B3");
+    }
+
+    SECTION("Byte-swapped ATA serials are swapped back") {
+        // Odd padding ends up inside the swapped serial
+        std::string swapped = SwapSerialPairs(ataField("WD-WCC4E1234567"));
+        CHECK(TrimWhitespace(swapped).find(' ') != std::string::npos);
+        CHECK(DecodeStorageSerial(swapped, SerialBus::Ata) == "WD-WCC4E1234567");
+
+        // Hex-encoded and swapped, as older Windows versions report SATA disks
+        CHECK(DecodeStorageSerial(hex(SwapSerialPairs(ataField("ZFN0A1B2C"))), SerialBus::Unknown) == "ZFN0A1B2C");
+
+        // Not an ATA field: left as it is
+        CHECK(DecodeStorageSerial(swapped, SerialBus::Other) == TrimWhitespace(swapped));
+
+        // Even padding cannot be told from a genuine serial
+        CHECK(DecodeStorageSerial(SwapSerialPairs(ataField("2VH7TM9L")), SerialBus::Ata) == "V27HMTL9");
+    }
+
+    SECTION("Short, odd-length or non-printable hex is left alone") {
+        CHECK(DecodeStorageSerial("ABCDEF12", SerialBus::Ata) == "ABCDEF12");
+        CHECK(DecodeStorageSerial("32564837544D394", SerialBus::Ata) == "32564837544D394");
+        CHECK(DecodeStorageSerial("0102030405060708", SerialBus::Ata) == "0102030405060708");
+        CHECK(DecodeStorageSerial("2020202020202020", SerialBus::Ata) == "2020202020202020");
+    }
+}
+
+TEST_CASE("SwapSerialPairs", "[disk]") {
+    CHECK(SwapSerialPairs("V27HMTL9") == "2VH7TM9L");
+    CHECK(SwapSerialPairs("BAC") == "ABC");
+    CHECK(SwapSerialPairs("") == "");
+}
+
+TEST_CASE("ComposeDiskModel", "[disk]") {
+    CHECK(ComposeDiskModel("WDC", "WD181KFGX-68AFPN0") == "WDC WD181KFGX-68AFPN0");
+    CHECK(ComposeDiskModel("ATA", "ST4000DM004-2CV104") == "ST4000DM004-2CV104");
+    CHECK(ComposeDiskModel("", "Samsung SSD 970") == "Samsung SSD 970");
+    CHECK(ComposeDiskModel("Samsung", "Samsung SSD 970") == "Samsung SSD 970");
+    CHECK(ComposeDiskModel("  WDC  ", "  WD40EFRX  ") == "WDC WD40EFRX");
+    CHECK(ComposeDiskModel("Generic", "") == "Generic");
+}
+
+//=============================================================================
+// Command Output Tests
+//=============================================================================
+
+TEST_CASE("SplitOutputLines", "[output]") {
+    SECTION("Handles CRLF and blank lines") {
+        auto lines = SplitOutputLines("first\r\n\r\n  second  \r\nthird");
+        REQUIRE(lines.size() == 3);
+        CHECK(lines[0] == "first");
+        CHECK(lines[1] == "second");
+        CHECK(lines[2] == "third");
+    }
+
+    SECTION("Empty and whitespace-only output") {
+        CHECK(SplitOutputLines("").empty());
+        CHECK(SplitOutputLines("\r\n \n\t\n").empty());
+    }
+}
+
+TEST_CASE("LastOutputLine", "[output]") {
+    CHECK(LastOutputLine("Removing 'E:'\r\n\r\nsuccess\r\n\r\n") == "success");
+    CHECK(LastOutputLine("single") == "single");
+    CHECK(LastOutputLine("\r\n").empty());
+}
+
 //=============================================================================
 // Path Utilities Tests
 //=============================================================================
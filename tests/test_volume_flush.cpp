@@ -0,0 +1,71 @@
+// Tests for the parallel volume flush stage
+
+#include "catch.hpp"
+#include "core/volume-flush.h"
+#include <atomic>
+#include <fstream>
+
+using namespace hdd::core;
+
+TEST_CASE("FlushVolumesInParallel", "[flush]") {
+    std::vector<std::string> volumes = {"E:\\", "F:\\", "G:\\", "C:\\Mount\\Data\\"};
+    std::atomic<int> running(0);
+    std::atomic<int> peak(0);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<VolumeFlushResult> results = FlushVolumesInParallel(volumes,
+        [&](const std::string& volume, VolumeFlushResult& result) {
+            int now = ++running;
+            for (int seen = peak; now > seen && !peak.compare_exchange_weak(seen, now);) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(150));
+            --running;
+
+            result.ok = volume != "F:\\";
+            result.bytesKnown = true;
+            result.bytesWritten = volume.size();
+        });
+    double elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    // All at once: about one flush long, not four
+    CHECK(peak == 4);
+    CHECK(elapsedMs < 4 * 150);
+
+    REQUIRE(results.size() == volumes.size());
+    for (size_t i = 0; i < volumes.size(); i++) {
+        CHECK(results[i].volume == volumes[i]);
+        CHECK(results[i].bytesWritten == volumes[i].size());
+        CHECK(results[i].durationMs >= 140);
+    }
+    CHECK_FALSE(results[1].ok);
+    CHECK(results[3].ok);
+
+    CHECK(FlushVolumesInParallel({}, [](const std::string&, VolumeFlushResult&) {}).empty());
+}
+
+TEST_CASE("FormatByteCount", "[flush]") {
+    CHECK(FormatByteCount(0) == "0 B");
+    CHECK(FormatByteCount(1023) == "1023 B");
+    CHECK(FormatByteCount(512 * 1024) == "512 KB");
+    CHECK(FormatByteCount(12900000) == "12.3 MB");
+}
+
+#ifdef __linux__
+TEST_CASE("SyncfsVolume", "[flush]") {
+    char pattern[] = "/tmp/hdd-flush-XXXXXX";
+    REQUIRE(mkdtemp(pattern) != nullptr);
+    std::string dir = pattern;
+    std::ofstream(dir + "/dirty") << std::string(64 * 1024, 'x');
+
+    VolumeFlushResult result;
+    SyncfsVolume(dir, result);
+    CHECK(result.ok);
+
+    VolumeFlushResult missing;
+    SyncfsVolume(dir + "/no-such-dir", missing);
+    CHECK_FALSE(missing.ok);
+
+    unlink((dir + "/dirty").c_str());
+    rmdir(dir.c_str());
+}
+#endif
@@ -0,0 +1,102 @@
+// Tests for the disk-to-volume map and its generation cache
+
+#include "catch.hpp"
+#include "core/volume-map.h"
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+VolumeMount MakeVolume(const char* name, std::vector<std::string> mounts) {
+    VolumeMount volume;
+    volume.volumeName = name;
+    volume.mountPoints = std::move(mounts);
+    return volume;
+}
+
+} // anonymous namespace
+
+TEST_CASE("DriveLettersFromMounts", "[volumes]") {
+    std::vector<VolumeMount> volumes = {
+        MakeVolume("\\\\?\\Volume{a}\\", {"E:\\", "C:\\Mount\\Data\\"}),
+        MakeVolume("\\\\?\\Volume{b}\\", {}),
+        MakeVolume("\\\\?\\Volume{c}\\", {"F:\\"}),
+    };
+
+    std::vector<std::string> letters = DriveLettersFromMounts(volumes);
+    REQUIRE(letters.size() == 2);
+    CHECK(letters[0] == "E:");
+    CHECK(letters[1] == "F:");
+
+    CHECK(DriveLettersFromMounts({}).empty());
+}
+
+TEST_CASE("VolumeSetGeneration", "[volumes]") {
+    std::vector<std::string> names = {"\\\\?\\Volume{a}\\", "\\\\?\\Volume{b}\\"};
+    uint64_t base = VolumeSetGeneration(names, 0x14);
+
+    SECTION("Stable for the same volume set") {
+        CHECK(VolumeSetGeneration(names, 0x14) == base);
+    }
+
+    SECTION("Changes when a volume arrives or leaves") {
+        std::vector<std::string> more = names;
+        more.push_back("\\\\?\\Volume{c}\\");
+        CHECK(VolumeSetGeneration(more, 0x14) != base);
+        CHECK(VolumeSetGeneration({names[0]}, 0x14) != base);
+    }
+
+    SECTION("Changes when a drive letter is assigned") {
+        CHECK(VolumeSetGeneration(names, 0x34) != base);
+    }
+
+    SECTION("Name boundaries matter") {
+        CHECK(VolumeSetGeneration({"ab", "c"}, 0) != VolumeSetGeneration({"a", "bc"}, 0));
+    }
+}
+
+TEST_CASE("VolumeMapCache", "[volumes]") {
+    VolumeMapCache cache;
+    std::vector<VolumeMount> volumes;
+
+    CHECK_FALSE(cache.Lookup(1, 42, volumes));
+
+    DiskVolumeMap map;
+    map[1].push_back(MakeVolume("\\\\?\\Volume{a}\\", {"E:\\"}));
+    cache.Store(42, map, cache.Epoch());
+
+    SECTION("Hit for the stored generation") {
+        REQUIRE(cache.Lookup(1, 42, volumes));
+        REQUIRE(volumes.size() == 1);
+        CHECK(volumes[0].mountPoints[0] == "E:\\");
+    }
+
+    SECTION("Disk without volumes is an empty hit") {
+        volumes.push_back(MakeVolume("stale", {}));
+        REQUIRE(cache.Lookup(7, 42, volumes));
+        CHECK(volumes.empty());
+    }
+
+    SECTION("Miss after the generation changes") {
+        CHECK_FALSE(cache.Lookup(1, 43, volumes));
+    }
+
+    SECTION("Miss after invalidation") {
+        cache.Invalidate();
+        CHECK_FALSE(cache.Lookup(1, 42, volumes));
+    }
+
+    SECTION("A walk that overlapped an invalidation is not stored") {
+        // Disk renumbered mid-walk: same generation, stale numbers
+        uint64_t epoch = cache.Epoch();
+        cache.Invalidate();
+        DiskVolumeMap stale;
+        stale[2].push_back(MakeVolume("\\\\?\\Volume{a}\\", {"E:\\"}));
+        cache.Store(42, stale, epoch);
+        CHECK_FALSE(cache.Lookup(2, 42, volumes));
+
+        cache.Store(42, map, cache.Epoch());
+        CHECK(cache.Lookup(1, 42, volumes));
+    }
+}
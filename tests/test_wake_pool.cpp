@@ -0,0 +1,132 @@
+// Tests for staggered wake planning and the pool readiness barrier
+
+#include "catch.hpp"
+#include "core/wake-pool.h"
+#include <thread>
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+PowerSettings MakePower(unsigned int budget, unsigned int spinUpMs, unsigned int staggerMs) {
+    PowerSettings power;
+    power.inrushBudget = budget;
+    power.spinUpMs = spinUpMs;
+    power.staggerMs = staggerMs;
+    return power;
+}
+
+} // anonymous namespace
+
+TEST_CASE("PlanStaggeredPowerOn respects the inrush budget", "[wakepool]") {
+    auto slots = PlanStaggeredPowerOn({1, 2, 3, 4}, MakePower(2, 6000, 1000));
+
+    REQUIRE(slots.size() == 4);
+    CHECK(slots[0].startMs == 0);
+    CHECK(slots[1].startMs == 1000);    // Two spinning: budget reached
+    CHECK(slots[2].startMs == 6000);    // Waits for the first to settle
+    CHECK(slots[3].startMs == 7000);    // Second settles at 7000
+
+    // Pool powers up in 7 s instead of 4 x 6 s back to back
+    CHECK(slots[3].startMs < 3 * 6000);
+}
+
+TEST_CASE("PlanStaggeredPowerOn groups drives by channel", "[wakepool]") {
+    auto slots = PlanStaggeredPowerOn({2, 3, 2}, MakePower(4, 6000, 1000));
+
+    REQUIRE(slots.size() == 2);
+    CHECK(slots[0].channel == 2);
+    CHECK(slots[0].drives == std::vector<size_t>{0, 2});
+    CHECK(slots[1].channel == 3);
+    CHECK(slots[1].drives == std::vector<size_t>{1});
+    CHECK(slots[1].startMs == 1000);
+}
+
+TEST_CASE("PlanStaggeredPowerOn switches channel 0 last, as the whole pool", "[wakepool]") {
+    SECTION("Waits until the drives still spinning leave room for all of them") {
+        // Channel 0 powers every relay: three drives against a budget of 4
+        auto slots = PlanStaggeredPowerOn({2, 0, 2}, MakePower(4, 6000, 1000));
+        REQUIRE(slots.size() == 2);
+        CHECK(slots[0].channel == 2);
+        CHECK(slots[0].startMs == 0);
+        CHECK(slots[1].channel == 0);
+        CHECK(slots[1].drives == std::vector<size_t>{1});
+        CHECK(slots[1].startMs == 6000);
+    }
+
+    SECTION("Listed first, still after every other channel") {
+        auto slots = PlanStaggeredPowerOn({0, 1, 2}, MakePower(3, 6000, 1000));
+        REQUIRE(slots.size() == 3);
+        CHECK(slots[0].channel == 1);
+        CHECK(slots[0].startMs == 0);
+        CHECK(slots[1].channel == 2);
+        CHECK(slots[1].startMs == 1000);
+        CHECK(slots[2].channel == 0);
+        CHECK(slots[2].drives == std::vector<size_t>{0});
+        CHECK(slots[2].startMs == 7000);    // Channel 2 settles at 7000
+    }
+
+    SECTION("A budget that covers the pool only staggers") {
+        auto slots = PlanStaggeredPowerOn({0, 1}, MakePower(4, 6000, 1000));
+        REQUIRE(slots.size() == 2);
+        CHECK(slots[1].channel == 0);
+        CHECK(slots[1].startMs == 1000);
+    }
+}
+
+TEST_CASE("PlanStaggeredPowerOn handles oversized channels and edge cases", "[wakepool]") {
+    SECTION("Channel larger than the budget waits for a quiet bus") {
+        auto slots = PlanStaggeredPowerOn({1, 2, 2}, MakePower(1, 6000, 1000));
+        REQUIRE(slots.size() == 2);
+        CHECK(slots[1].startMs == 6000);
+    }
+
+    SECTION("Oversized first channel still starts immediately") {
+        auto slots = PlanStaggeredPowerOn({0, 0, 0}, MakePower(1, 6000, 1000));
+        REQUIRE(slots.size() == 1);
+        CHECK(slots[0].startMs == 0);
+        CHECK(slots[0].drives.size() == 3);
+    }
+
+    SECTION("Zero budget is treated as one") {
+        auto slots = PlanStaggeredPowerOn({1, 2}, MakePower(0, 5000, 500));
+        REQUIRE(slots.size() == 2);
+        CHECK(slots[1].startMs == 5000);
+    }
+
+    SECTION("Budget never binds") {
+        auto slots = PlanStaggeredPowerOn({1, 2, 3}, MakePower(8, 6000, 250));
+        CHECK(slots[1].startMs == 250);
+        CHECK(slots[2].startMs == 500);
+    }
+
+    SECTION("No drives") {
+        CHECK(PlanStaggeredPowerOn({}, MakePower(2, 6000, 1000)).empty());
+    }
+}
+
+TEST_CASE("ReadinessBarrier", "[wakepool]") {
+    SECTION("Releases once every member arrives") {
+        ReadinessBarrier barrier(4);
+        std::vector<std::thread> members;
+        for (int i = 0; i < 4; i++) {
+            members.emplace_back([&barrier] { barrier.Arrive(true); });
+        }
+        CHECK(barrier.Wait());
+        for (auto& member : members) member.join();
+    }
+
+    SECTION("Reports a failed member") {
+        ReadinessBarrier barrier(2);
+        std::thread member([&barrier] { barrier.Arrive(false); });
+        barrier.Arrive(true);
+        CHECK_FALSE(barrier.Wait());
+        member.join();
+    }
+
+    SECTION("Empty pool is ready immediately") {
+        ReadinessBarrier barrier(0);
+        CHECK(barrier.Wait());
+    }
+}
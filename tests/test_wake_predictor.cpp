@@ -0,0 +1,148 @@
+// Tests for the time-of-week pre-wake predictor, run in simulated time
+
+#include "catch.hpp"
+#include "core/wake-predictor.h"
+
+using namespace hdd;
+using namespace hdd::core;
+
+namespace {
+
+const int64_t DAY = 24 * 60;
+
+// Minute of a weekday (0-6) and time of day in simulated week `week`
+int64_t At(int week, int day, int hour, int minute) {
+    return week * MINUTES_PER_WEEK + day * DAY + hour * 60 + minute;
+}
+
+// Simulated user: opens the drive at 09:05 on the days usesDay picks.
+// Drives the predictor like the tray does: each pre-wake fires when due,
+// and unused ones expire, through every day of weeks [fromWeek, toWeek).
+PredictorStats Simulate(WakePredictor& predictor, int fromWeek, int toWeek, bool (*usesDay)(int week, int day)) {
+    int64_t handled = -1;
+    for (int week = fromWeek; week < toWeek; week++) {
+        for (int day = 0; day < 7; day++) {
+            bool used = usesDay(week, day);
+            int64_t until = used ? At(week, day, 9, 5) : At(week, day + 1, 0, 0);
+
+            int64_t now = At(week, day, 0, 0);
+            while (true) {
+                PreWakePlan plan = predictor.NextPreWake(std::max(now, handled + 15));
+                if (!plan.IsValid() || plan.wakeAt >= until) break;
+                now = plan.wakeAt;
+                handled = plan.slot;
+                predictor.Expire(now);
+                if (!predictor.IsPreWakePending()) predictor.OnPreWake(plan.slot);
+            }
+            predictor.Expire(until);
+            if (used) predictor.RecordUse(until);
+        }
+    }
+    return predictor.Stats();
+}
+
+bool Weekdays(int, int day) { return day < 5; }
+
+} // anonymous namespace
+
+TEST_CASE("WakePredictor confidence", "[predictor]") {
+    WakePredictor predictor;
+
+    // No prediction from a single week
+    predictor.RecordUse(At(0, 1, 9, 5));
+    CHECK(predictor.Confidence(At(1, 1, 9, 5)) == 0.0);
+    CHECK_FALSE(predictor.NextPreWake(At(1, 1, 0, 0)).IsValid());
+
+    predictor.RecordUse(At(1, 1, 9, 10));
+    CHECK(predictor.Confidence(At(2, 1, 9, 0)) == 1.0);
+    CHECK(predictor.Confidence(At(2, 1, 9, 20)) == 0.0);
+
+    PreWakePlan plan = predictor.NextPreWake(At(2, 1, 0, 0));
+    REQUIRE(plan.IsValid());
+    CHECK(plan.slot == At(2, 1, 9, 0));
+    CHECK(plan.wakeAt == At(2, 1, 8, 58));
+
+    // Already used this week: the next candidate is a week later
+    predictor.RecordUse(At(2, 1, 9, 3));
+    CHECK(predictor.NextPreWake(At(2, 1, 9, 4)).slot == At(3, 1, 9, 0));
+}
+
+TEST_CASE("WakePredictor threshold", "[predictor]") {
+    PredictorSettings settings;
+    settings.confidence = 0.75;
+    WakePredictor predictor(settings);
+
+    // Used in 2 of the 4 weeks since the first use
+    predictor.RecordUse(At(0, 3, 11, 0));
+    predictor.RecordUse(At(1, 3, 12, 0));
+    predictor.RecordUse(At(3, 3, 12, 0));
+    CHECK(predictor.Confidence(At(4, 3, 12, 0)) == Approx(0.5));
+    CHECK_FALSE(predictor.NextPreWake(At(4, 3, 0, 0)).IsValid());
+
+    settings.confidence = 0.5;
+    WakePredictor lenient(settings);
+    lenient.Parse(predictor.Format());
+    CHECK(lenient.NextPreWake(At(4, 3, 0, 0)).slot == At(4, 3, 12, 0));
+}
+
+TEST_CASE("WakePredictor hits and false wakes", "[predictor]") {
+    WakePredictor predictor;
+    predictor.OnPreWake(At(0, 0, 9, 0));
+    CHECK(predictor.IsPreWakePending());
+    CHECK_FALSE(predictor.Expire(At(0, 0, 9, 45)));     // Slot end + hit window
+    predictor.RecordUse(At(0, 0, 9, 40));
+    CHECK(predictor.Stats().hits == 1);
+
+    predictor.OnPreWake(At(0, 1, 9, 0));
+    CHECK(predictor.Expire(At(0, 1, 9, 46)));
+    CHECK_FALSE(predictor.IsPreWakePending());
+    CHECK(predictor.Stats().falseWakes == 1);
+
+    predictor.RecordUse(At(0, 2, 9, 0));
+    CHECK(predictor.Stats().uncovered == 1);
+    CHECK(predictor.Stats().HitRate() == Approx(0.5));
+    CHECK(predictor.Stats().Coverage() == Approx(0.5));
+}
+
+TEST_CASE("WakePredictor learns a weekday routine", "[predictor]") {
+    WakePredictor predictor;
+    PredictorStats stats = Simulate(predictor, 0, 12, Weekdays);
+
+    // Two weeks to learn, then every weekday use is pre-woken
+    CHECK(stats.uncovered == 10);
+    CHECK(stats.hits == 50);
+    CHECK(stats.falseWakes == 0);
+
+    // Nothing planned for the weekend
+    PreWakePlan plan = predictor.NextPreWake(At(12, 5, 0, 0));
+    REQUIRE(plan.IsValid());
+    CHECK(plan.slot == At(13, 0, 9, 0));
+}
+
+TEST_CASE("WakePredictor stops predicting a dropped routine", "[predictor]") {
+    WakePredictor predictor;
+    Simulate(predictor, 0, 4, Weekdays);
+    REQUIRE(predictor.Stats().hits == 10);
+
+    // Mondays stop: 4 of 5, 6 and 7 weeks still pass the 60% default
+    PredictorStats stats = Simulate(predictor, 4, 12, [](int, int day) { return day > 0 && day < 5; });
+    CHECK(stats.falseWakes == 3);
+    CHECK(stats.hits == 10 + 8 * 4);
+    CHECK(predictor.Confidence(At(12, 0, 9, 0)) < predictor.Settings().confidence);
+}
+
+TEST_CASE("WakePredictor Format and Parse", "[predictor]") {
+    WakePredictor predictor;
+    predictor.RecordUse(600);
+    predictor.RecordUse(60);
+    predictor.OnPreWake(10000);
+    predictor.RecordUse(10005);
+    CHECK(predictor.Format() == "1,0,2;60,600,10005");
+
+    WakePredictor loaded;
+    REQUIRE(loaded.Parse(predictor.Format()));
+    CHECK(loaded.Format() == predictor.Format());
+    CHECK_FALSE(loaded.Parse("garbage"));
+    REQUIRE(loaded.Parse("1,2,3;5,x,-4,7"));
+    CHECK(loaded.Uses() == std::vector<int64_t>{5, 7});
+}
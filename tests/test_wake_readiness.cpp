@@ -0,0 +1,74 @@
+// Tests for learned spin-up times and the wake probe schedule
+
+#include "catch.hpp"
+#include "core/wake-readiness.h"
+
+using namespace hdd::core;
+
+TEST_CASE("SpinUpModel quantiles and history", "[wake]") {
+    SpinUpModel model;
+    CHECK(model.Quantile(0.5) == 0);
+
+    for (uint32_t ms : {5000u, 4000u, 6000u, 4500u, 5500u}) model.Record(ms);
+    CHECK(model.Quantile(0.0) == 4000);
+    CHECK(model.Quantile(0.5) == 5000);
+    CHECK(model.Quantile(1.0) == 6000);
+
+    // Oldest samples fall out once the history is full
+    for (size_t i = 0; i < SPINUP_HISTORY_SIZE; i++) model.Record(2000);
+    CHECK(model.Count() == SPINUP_HISTORY_SIZE);
+    CHECK(model.Quantile(1.0) == 2000);
+}
+
+TEST_CASE("SpinUpModel defaults until learned", "[wake]") {
+    SpinUpModel model;
+    CHECK(model.FirstProbeMs() == DEFAULT_FIRST_PROBE_MS);
+    CHECK(model.RescanAtMs() == DEFAULT_SPINUP_MS);
+    CHECK(model.TimeoutMs() == WAKE_READY_TIMEOUT_MS);
+
+    model.Record(7000);
+    model.Record(8000);
+    CHECK(model.FirstProbeMs() == DEFAULT_FIRST_PROBE_MS);
+
+    model.Record(9000);
+    CHECK(model.FirstProbeMs() == 8000);
+    CHECK(model.RescanAtMs() == 9000 + 9000 / 4);
+    CHECK(model.TimeoutMs() == WAKE_READY_TIMEOUT_MS);
+
+    // A very slow drive stretches the timeout
+    model.Record(12000);
+    CHECK(model.TimeoutMs() == 24000);
+}
+
+TEST_CASE("SpinUpModel Format and Parse", "[wake]") {
+    SpinUpModel model;
+    model.Record(5200);
+    model.Record(4900);
+    CHECK(model.Format() == "5200,4900");
+    CHECK(SpinUpModel::Parse(model.Format()).Format() == "5200,4900");
+
+    CHECK(SpinUpModel::Parse("").Count() == 0);
+    CHECK(SpinUpModel::Parse("5200,abc,-3,0,,4900").Format() == "5200,4900");
+}
+
+TEST_CASE("PlanProbeTimes", "[wake]") {
+    SECTION("Backoff doubles up to the cap and ends at the timeout") {
+        CHECK(PlanProbeTimes(1000, 6000, 250, 1000) ==
+              std::vector<uint32_t>{1000, 1250, 1750, 2750, 3750, 4750, 5750, 6000});
+    }
+
+    SECTION("Default schedule") {
+        std::vector<uint32_t> times = PlanProbeTimes(DEFAULT_FIRST_PROBE_MS, WAKE_READY_TIMEOUT_MS);
+        REQUIRE(times.size() > 2);
+        CHECK(times.front() == DEFAULT_FIRST_PROBE_MS);
+        CHECK(times.back() == WAKE_READY_TIMEOUT_MS);
+        for (size_t i = 1; i < times.size(); i++) {
+            CHECK(times[i] > times[i - 1]);
+            CHECK(times[i] - times[i - 1] <= PROBE_MAX_GAP_MS);
+        }
+    }
+
+    SECTION("First probe past the timeout still probes once") {
+        CHECK(PlanProbeTimes(20000, 18000) == std::vector<uint32_t>{18000});
+    }
+}